@@ -0,0 +1,40 @@
+# asm_sintetico.awk - genera un programa ASM sintético para medir el ensamblador
+#
+# Uso: awk -v lineas=1000000 -f bench/asm_sintetico.awk > sintetico.asm
+#
+# Un cuarto de las líneas son etiquetas, definidas al principio en grupos
+# sobre un NOP (así todas caen por debajo de 64K y el programa se ensambla
+# con --ancho=16 sin avisos); el resto son instrucciones de todos los tipos
+# que mezclan operandos numéricos, etiquetas anteriores, comentarios y
+# mayúsculas/minúsculas. No está pensado para ejecutarse.
+
+BEGIN {
+    if (lineas == "") lineas = 1000000
+    srand(12345)
+    n_etiq = int(lineas / 4)
+    por_nop = 20
+    n = 0
+
+    for (i = 0; i < n_etiq; ++i) {
+        printf "etiqueta_%d:\n", i
+        n++
+        if (i % por_nop == por_nop - 1) { print "        NOP"; n++ }
+    }
+
+    split("ADD SUB STORE LOADM load JMP JMPZ CALL MUL", con_dir, " ")
+    split("NOP PUSH POP RET halt", sin_op, " ")
+    while (n < lineas) {
+        r = int(rand() * 10)
+        if (r < 5)
+            printf "        %s etiqueta_%d\n", con_dir[1 + int(rand() * 9)], int(rand() * n_etiq)
+        else if (r < 7)
+            printf "        %s %d          ; operando numérico\n", con_dir[1 + int(rand() * 9)], int(rand() * 256)
+        else if (r < 8)
+            printf "        LOADI 0x%02X\n", int(rand() * 256)
+        else if (r < 9)
+            printf "\tloadi\t0b%d%d%d%d\n", rand() < .5, rand() < .5, rand() < .5, rand() < .5
+        else
+            printf "        %s\n", sin_op[1 + int(rand() * 5)]
+        n++
+    }
+}
@@ -0,0 +1,48 @@
+; bucles.asm - tres bucles contados anidados (4 x 255 x 255) que suman 1
+; por vuelta, como ejemplos/bucle_anidado.asm pero más corto.
+; esperado: MEM[244] = 4
+; esperado: MEM[241] = 0
+;
+; MEM[240] = const 1
+; MEM[241] = i, MEM[242] = j, MEM[243] = k
+; MEM[244] = suma (módulo 256: 4 x 255 x 255 = 260100 = 4 mod 256)
+
+        LOADI 1
+        STORE 240
+        LOADI 4
+        STORE 241
+
+externo:
+        LOADI 255
+        STORE 242
+
+medio:
+        LOADI 255
+        STORE 243
+
+interno:
+        LOADM 244
+        ADD 240
+        STORE 244
+        LOADM 243
+        SUB 240
+        STORE 243
+        JMPZ fin_interno
+        JMP interno
+
+fin_interno:
+        LOADM 242
+        SUB 240
+        STORE 242
+        JMPZ fin_medio
+        JMP medio
+
+fin_medio:
+        LOADM 241
+        SUB 240
+        STORE 241
+        JMPZ fin
+        JMP externo
+
+fin:
+        HALT
@@ -0,0 +1,121 @@
+; burbuja.asm - ordena de menor a mayor 12 bytes en 200..211 que empiezan
+; al revés (12, 11, ..., 1), 250 veces. Igual que memcpy.asm, el acceso
+; indexado pasa por las subrutinas leer y escribir, que el programa
+; reescribe. x > y se decide bajando los dos de uno en uno hasta que uno
+; llega a 0 (no hay comparación en la máquina).
+; esperado: MEM[200] = 1
+; esperado: MEM[205] = 6
+; esperado: MEM[211] = 12
+; esperado: MEM[220] = 0
+;
+; MEM[3] = operando de 'leer', MEM[6] = operando de 'escribir'
+; MEM[212] = const 1
+; MEM[213] = puntero, MEM[214] = comparaciones que quedan en la pasada
+; MEM[215] = pasadas que quedan, MEM[216] = x, MEM[217] = y
+; MEM[218] = t, MEM[219] = u (cuenta atrás de x e y), MEM[220] = vueltas
+
+        JMP inicio
+
+leer:                       ; dirección 2
+        LOADM 0
+        RET
+
+escribir:                   ; dirección 5
+        STORE 0
+        RET
+
+inicio:
+        LOADI 1
+        STORE 212
+        LOADI 250
+        STORE 220
+
+vuelta:
+        ; MEM[200 + i] = 12 - i
+        LOADI 200
+        STORE 213
+        LOADI 12
+        STORE 214
+llenar:
+        LOADM 213
+        STORE 6
+        LOADM 214
+        CALL escribir
+        LOADM 213
+        ADD 212
+        STORE 213
+        LOADM 214
+        SUB 212
+        STORE 214
+        JMPZ ordenar
+        JMP llenar
+
+ordenar:
+        LOADI 11
+        STORE 215
+pasada:
+        LOADI 200
+        STORE 213
+        LOADM 215
+        STORE 214
+comparar:
+        LOADM 213           ; x = MEM[p]
+        STORE 3
+        CALL leer
+        STORE 216
+        STORE 218
+        LOADM 213           ; y = MEM[p + 1]
+        ADD 212
+        STORE 3
+        CALL leer
+        STORE 217
+        STORE 219
+bajar:
+        LOADM 219           ; u == 0: x >= y
+        JMPZ cambiar
+        LOADM 218           ; t == 0: x < y
+        JMPZ siguiente
+        SUB 212
+        STORE 218
+        LOADM 219
+        SUB 212
+        STORE 219
+        JMP bajar
+
+cambiar:
+        LOADM 213           ; MEM[p] = y, MEM[p + 1] = x
+        STORE 6
+        LOADM 217
+        CALL escribir
+        LOADM 213
+        ADD 212
+        STORE 6
+        LOADM 216
+        CALL escribir
+
+siguiente:
+        LOADM 213
+        ADD 212
+        STORE 213
+        LOADM 214
+        SUB 212
+        STORE 214
+        JMPZ fin_pasada
+        JMP comparar
+
+fin_pasada:
+        LOADM 215
+        SUB 212
+        STORE 215
+        JMPZ fin_vuelta
+        JMP pasada
+
+fin_vuelta:
+        LOADM 220
+        SUB 212
+        STORE 220
+        JMPZ fin
+        JMP vuelta
+
+fin:
+        HALT
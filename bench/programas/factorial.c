@@ -0,0 +1,19 @@
+// factorial.c - 5! repetido 200 x 200 veces (valores de 8 bits)
+// esperado: resultado = 120
+// esperado: i = 0
+
+int n, resultado, i = 200, j;
+
+while (i != 0) {
+    j = 200;
+    while (j != 0) {
+        resultado = 1;
+        n = 5;
+        while (n != 0) {
+            resultado = resultado * n;
+            n = n - 1;
+        }
+        j = j - 1;
+    }
+    i = i - 1;
+}
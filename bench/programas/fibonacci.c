@@ -0,0 +1,18 @@
+// fibonacci.c - fib(200) módulo 256, calculado 250 veces de forma iterativa
+// esperado: b = 149
+// esperado: vueltas = 0
+
+int a, b, t, k, vueltas = 250;
+
+while (vueltas != 0) {
+    a = 0;
+    b = 1;
+    k = 199;
+    while (k != 0) {
+        t = a + b;
+        a = b;
+        b = t;
+        k = k - 1;
+    }
+    vueltas = vueltas - 1;
+}
@@ -0,0 +1,104 @@
+; memcpy.asm - llena 32 bytes en 160..191 y los copia a 192..223, 250 x 10
+; veces. La máquina no tiene direccionamiento indirecto: las subrutinas leer
+; y escribir están en direcciones fijas y el programa reescribe su operando.
+; esperado: MEM[192] = 7
+; esperado: MEM[208] = 119
+; esperado: MEM[223] = 224
+; esperado: MEM[226] = 0
+;
+; MEM[160 + i] = 7 * (i + 1) para i = 0..31 (módulo 256)
+;
+; MEM[3] = operando de 'leer' (dirección a leer)
+; MEM[6] = operando de 'escribir' (dirección a escribir)
+; MEM[224] = const 1, MEM[225] = const 7
+; MEM[226] = vueltas, MEM[227] = vueltas internas
+; MEM[228] = origen, MEM[229] = destino, MEM[230] = quedan, MEM[231] = valor
+
+        JMP inicio
+
+leer:                       ; dirección 2
+        LOADM 0
+        RET
+
+escribir:                   ; dirección 5
+        STORE 0
+        RET
+
+inicio:
+        LOADI 1
+        STORE 224
+        LOADI 7
+        STORE 225
+        LOADI 250
+        STORE 226
+
+externo:
+        LOADI 10
+        STORE 227
+
+vuelta:
+        ; llenar el origen: MEM[160 + i] = 7 * (i + 1)
+        LOADI 160
+        STORE 229
+        LOADI 32
+        STORE 230
+        LOADI 0
+        STORE 231
+llenar:
+        LOADM 229
+        STORE 6
+        LOADM 231
+        ADD 225
+        STORE 231
+        CALL escribir
+        LOADM 229
+        ADD 224
+        STORE 229
+        LOADM 230
+        SUB 224
+        STORE 230
+        JMPZ copiar_ini
+        JMP llenar
+
+copiar_ini:
+        LOADI 160
+        STORE 228
+        LOADI 192
+        STORE 229
+        LOADI 32
+        STORE 230
+copiar:
+        LOADM 228
+        STORE 3
+        LOADM 229
+        STORE 6
+        CALL leer
+        CALL escribir
+        LOADM 228
+        ADD 224
+        STORE 228
+        LOADM 229
+        ADD 224
+        STORE 229
+        LOADM 230
+        SUB 224
+        STORE 230
+        JMPZ fin_vuelta
+        JMP copiar
+
+fin_vuelta:
+        LOADM 227
+        SUB 224
+        STORE 227
+        JMPZ fin_externo
+        JMP vuelta
+
+fin_externo:
+        LOADM 226
+        SUB 224
+        STORE 226
+        JMPZ fin
+        JMP externo
+
+fin:
+        HALT
@@ -0,0 +1,54 @@
+; recursion.asm - suma(n) = n + suma(n - 1) con CALL/RET y la pila,
+; suma(40) repetida 250 x 20 veces.
+; esperado: MEM[152] = 52
+; esperado: MEM[151] = 0
+;
+; suma(40) = 820 = 52 mod 256. Cada nivel usa dos bytes de pila (retorno y
+; n guardado): 41 niveles bajan SP de 255 a 173, por encima de los datos.
+;
+; MEM[150] = const 1
+; MEM[151] = vueltas, MEM[154] = vueltas internas
+; MEM[152] = resultado, MEM[153] = temporal de suma
+
+        LOADI 1
+        STORE 150
+        LOADI 250
+        STORE 151
+
+externo:
+        LOADI 20
+        STORE 154
+
+vuelta:
+        LOADI 40
+        CALL suma
+        STORE 152
+        LOADM 154
+        SUB 150
+        STORE 154
+        JMPZ fin_vuelta
+        JMP vuelta
+
+fin_vuelta:
+        LOADM 151
+        SUB 150
+        STORE 151
+        JMPZ fin
+        JMP externo
+
+fin:
+        HALT
+
+; Entrada y salida en A; Z llega con (A == 0) del último LOADI/SUB
+suma:
+        JMPZ suma_cero
+        PUSH                ; guardar n
+        SUB 150             ; n - 1
+        CALL suma
+        STORE 153           ; suma(n - 1)
+        POP                 ; n
+        ADD 153
+        RET
+
+suma_cero:
+        RET
@@ -0,0 +1,45 @@
+; bucle_anidado.asm - carga de trabajo larga para medir el intérprete
+; Tres bucles anidados (100 x 255 x 255) que incrementan un contador.
+; MEM[240] = const 1
+; MEM[241] = i, MEM[242] = j, MEM[243] = k
+; MEM[244] = suma (módulo 256)
+
+        LOADI 1
+        STORE 240          ; MEM[240] = 1
+        LOADI 100
+        STORE 241          ; i = 100
+
+externo:
+        LOADI 255
+        STORE 242          ; j = 255
+
+medio:
+        LOADI 255
+        STORE 243          ; k = 255
+
+interno:
+        LOADM 244
+        ADD 240
+        STORE 244          ; suma = suma + 1
+        LOADM 243
+        SUB 240
+        STORE 243          ; k = k - 1
+        JMPZ fin_interno
+        JMP interno
+
+fin_interno:
+        LOADM 242
+        SUB 240
+        STORE 242          ; j = j - 1
+        JMPZ fin_medio
+        JMP medio
+
+fin_medio:
+        LOADM 241
+        SUB 240
+        STORE 241          ; i = i - 1
+        JMPZ fin
+        JMP externo
+
+fin:
+        HALT
@@ -0,0 +1,31 @@
+; memoria_ancha.asm - uso del espacio de 64K con operandos de 16 bits
+; Ensamblar con: assembler --ancho=16 memoria_ancha.asm memoria_ancha.img
+; Ejecutar con:  cpu_simulator --memoria=64K memoria_ancha.img
+; MEM[0x8000] = const 1
+; MEM[0xFF00] = contador (10 vueltas)
+; MEM[0xC000] = suma; al final se copia a MEM[200]
+; Sólo se reservan las páginas que el programa toca (0x80, 0xC0 y 0xFF).
+
+        LOADI 1
+        STORE 0x8000       ; constante 1
+        LOADI 10
+        STORE 0xFF00       ; contador = 10
+
+bucle:
+        LOADM 0xC000
+        ADD 0x8000
+        STORE 0xC000       ; suma = suma + 1
+        CALL decrementa    ; CALL/RET anchos: retorno de 2 bytes
+        JMPZ fin
+        JMP bucle
+
+fin:
+        LOADM 0xC000
+        STORE 200          ; resultado
+        HALT
+
+decrementa:
+        LOADM 0xFF00
+        SUB 0x8000
+        STORE 0xFF00       ; contador = contador - 1
+        RET
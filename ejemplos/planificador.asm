@@ -0,0 +1,83 @@
+; planificador.asm - dos tareas en turno rotativo con el temporizador
+; (interrupciones.h). Cada tarea cuenta en un bucle sin fin; cada 37
+; instrucciones la interrupción guarda A, Z y el PC de la que corría y
+; retoma la otra. Tras 20 interrupciones se detiene.
+; MEM[220] = interrupciones que faltan, MEM[221] / MEM[222] = cuentas de A / B
+; MEM[224..225] = periodo, MEM[226] = tarea en curso (0 = A, 1 = B)
+; MEM[227..229] = A, Z y PC guardados de la tarea A; MEM[230..232] los de B
+; MEM[233] = const 1, MEM[234] = A al entrar en la rutina
+
+        LOADI 20
+        STORE 220
+        LOADI 1
+        STORE 233
+        LOADI 37
+        STORE 224          ; periodo = 37 (MEM[225] = 0)
+        CALL arranque      ; apila la dirección de tarea_b
+
+tarea_b:
+        LOADM 222
+        ADD 233
+        STORE 222
+        JMP tarea_b
+
+arranque:
+        POP                ; PC inicial de B
+        STORE 232
+        LOADI 0
+        STORE 230
+        STORE 231
+        STORE 226          ; empieza A
+        VECTOR turno
+        TIMER 224
+        EI
+
+tarea_a:
+        LOADM 221
+        ADD 233
+        STORE 221
+        JMP tarea_a
+
+; En la pila: PC y Z de la tarea interrumpida (Z arriba)
+turno:
+        STORE 234
+        LOADM 220
+        SUB 233
+        STORE 220
+        JMPZ fin
+        LOADM 226
+        JMPZ desde_a
+
+        LOADM 234          ; se interrumpió B: se guarda y sigue A
+        STORE 230
+        POP
+        STORE 231
+        POP
+        STORE 232
+        LOADI 0
+        STORE 226
+        LOADM 229
+        PUSH
+        LOADM 228
+        PUSH
+        LOADM 227
+        RETI
+
+desde_a:
+        LOADM 234          ; se interrumpió A: se guarda y sigue B
+        STORE 227
+        POP
+        STORE 228
+        POP
+        STORE 229
+        LOADI 1
+        STORE 226
+        LOADM 232
+        PUSH
+        LOADM 231
+        PUSH
+        LOADM 230
+        RETI
+
+fin:
+        HALT
@@ -0,0 +1,39 @@
+; salida.asm - el invitado escribe texto con el dispositivo de salida
+; (cpu_simulator --dispositivo): cada STORE a MEM[248] es un byte.
+; Escribe 100 líneas con el abecedario.
+; MEM[200] = const 1, MEM[201] = letra
+; MEM[202] = líneas que faltan, MEM[203] = letras que faltan en la línea
+
+        LOADI 1
+        STORE 200
+        LOADI 100
+        STORE 202          ; 100 líneas
+
+linea:
+        LOADI 65
+        STORE 201          ; letra = 'A'
+        LOADI 26
+        STORE 203
+
+letra:
+        LOADM 201
+        STORE 248          ; sale la letra
+        ADD 200
+        STORE 201          ; letra = letra + 1
+        LOADM 203
+        SUB 200
+        STORE 203
+        JMPZ fin_linea
+        JMP letra
+
+fin_linea:
+        LOADI 10
+        STORE 248          ; '\n'
+        LOADM 202
+        SUB 200
+        STORE 202
+        JMPZ fin
+        JMP linea
+
+fin:
+        HALT
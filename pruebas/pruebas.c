@@ -0,0 +1,439 @@
+/*
+ * pruebas.c - Pruebas de regresión sobre libcomputadora (make check)
+ * Cada prueba arma su programa en memoria, lo corre y compara el estado
+ * final; al terminar informa cuántas comprobaciones fallaron (código de
+ * salida 1 si alguna).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "computadora.h"
+#include "dispositivo.h"
+#include "instantanea.h"
+#include "traza.h"
+
+static int comprobaciones, fallas;
+
+#define COMPROBAR(cond, ...) do {                                       \
+    comprobaciones++;                                                   \
+    if (!(cond)) {                                                      \
+        fallas++;                                                       \
+        printf("[FALLA] %s:%d: ", __func__, __LINE__);                  \
+        printf(__VA_ARGS__);                                            \
+        printf("\n");                                                   \
+    }                                                                   \
+} while (0)
+
+/* Dirección de 'nombre' en el mapa de datos que deja c_to_asm ("; MEM[n] = nombre") */
+static int direccion_de(const char *asm_txt, const char *nombre) {
+    for (const char *p = strstr(asm_txt, "; MEM["); p; p = strstr(p + 1, "; MEM[")) {
+        int dir, n = 0;
+        char var[64];
+        if (sscanf(p, "; MEM[%d] = %63s%n", &dir, var, &n) == 2 && strcmp(var, nombre) == 0)
+            return dir;
+    }
+    return -1;
+}
+
+// ==================== COMPILADOR ====================
+
+/*
+ * Un programa con muchas comparaciones deja sus datos más allá de MEM[255]:
+ * con ancho 8, o con 256 bytes, no cabe y la traducción falla; con ancho 16
+ * y 64K corre y da el resultado correcto.
+ */
+static void prueba_programa_grande(void) {
+    char fuente[2048];
+    int n = snprintf(fuente, sizeof(fuente), "int a = 1, b = 2, c = 3, d = 4, r = 0;\n");
+    for (int i = 0; i < 14; i++)
+        n += snprintf(fuente + n, sizeof(fuente) - n, "if (a + %d < b * c) r = r + d;\n", i);
+
+    char *asm_txt;
+    size_t asm_len;
+    COMPROBAR(compilador_traducir(fuente, n, 1, 8, MEM_SIZE, &asm_txt, &asm_len, NULL) < 0,
+              "con ancho 8 no debería caber");
+    COMPROBAR(compilador_traducir(fuente, n, 1, 8, MEM_MAX, &asm_txt, &asm_len, NULL) < 0,
+              "con ancho 8 no debería caber ni con 64K");
+    COMPROBAR(compilador_traducir(fuente, n, 1, 16, MEM_SIZE, &asm_txt, &asm_len, NULL) < 0,
+              "con 256 bytes no debería caber");
+
+    if (compilador_traducir(fuente, n, 1, 16, MEM_MAX, &asm_txt, &asm_len, NULL) < 0) {
+        COMPROBAR(0, "con ancho 16 y 64K debería caber");
+        return;
+    }
+    int r = direccion_de(asm_txt, "r");
+    Programa prog;
+    int ok = ensamblador_buffer(asm_txt, asm_len, 16, &prog, NULL) == 0;
+    free(asm_txt);
+    COMPROBAR(ok && r > MEM_SIZE, "ensamblado o mapa inesperado (r en %d)", r);
+    if (!ok)
+        return;
+
+    CPU cpu;
+    Memoria mem;
+    if (computadora_ejecutar(&prog, MEM_MAX, MOTOR_SWITCH, &cpu, &mem) == 0) {
+        int v = memoria_leer(&mem, (uint32_t)r);
+        COMPROBAR(v == 20, "r = %d, se esperaba 20", v);
+        memoria_liberar(&mem);
+    }
+    programa_liberar(&prog);
+}
+
+// ==================== INTERRUPCIONES ====================
+
+/* Espera N interrupciones del temporizador; la rutina guarda A en la pila */
+static const char programa_interrupciones[] =
+    "        LOADI 0\n"
+    "        STORE 200          ; interrupciones atendidas\n"
+    "        STORE 203\n"
+    "        LOADI 1\n"
+    "        STORE 201\n"
+    "        LOADI 10\n"
+    "        STORE 202          ; periodo = 10\n"
+    "        LOADI 8\n"
+    "        STORE 204          ; N\n"
+    "        VECTOR rutina\n"
+    "        TIMER 202\n"
+    "        EI\n"
+    "espera:\n"
+    "        LOADM 200\n"
+    "        SUB 204\n"
+    "        JMPZ fin\n"
+    "        JMP espera\n"
+    "fin:\n"
+    "        DI\n"
+    "        HALT\n"
+    "rutina:\n"
+    "        PUSH\n"
+    "        LOADM 200\n"
+    "        ADD 201\n"
+    "        STORE 200\n"
+    "        POP\n"
+    "        RETI\n";
+
+/*
+ * RETI desapila exactamente el marco que apiló la entrada: tras N
+ * interrupciones SP vuelve al final de la memoria con cualquier ancho de
+ * ensamblado, tamaño de memoria y motor.
+ */
+static void prueba_pila_interrupciones(void) {
+    static const struct { int ancho; uint32_t tam; } casos[] = {
+        { 8, MEM_SIZE }, { 8, MEM_MAX }, { 16, MEM_SIZE }, { 16, MEM_MAX },
+    };
+    static const MotorCPU motores[] = { MOTOR_SWITCH, MOTOR_THREADED, MOTOR_PREDECODE, MOTOR_JIT };
+
+    for (size_t k = 0; k < sizeof(casos) / sizeof(casos[0]); k++) {
+        Programa prog;
+        if (ensamblador_buffer(programa_interrupciones, sizeof(programa_interrupciones) - 1,
+                               casos[k].ancho, &prog, NULL) < 0) {
+            COMPROBAR(0, "no ensambla con ancho %d", casos[k].ancho);
+            continue;
+        }
+        for (size_t m = 0; m < sizeof(motores) / sizeof(motores[0]); m++) {
+            CPU cpu;
+            Memoria mem;
+            if (computadora_ejecutar(&prog, casos[k].tam, motores[m], &cpu, &mem) < 0) {
+                COMPROBAR(0, "no corre");
+                continue;
+            }
+            // puede entrar una más entre JMPZ fin y DI
+            int profundidad = (int)(casos[k].tam - 1) - cpu.sp_min;
+            COMPROBAR(cpu.irq.atendidas >= 8 && mem.data[200] == cpu.irq.atendidas &&
+                      cpu.SP == casos[k].tam - 1 && profundidad <= 4,
+                      "ancho %d, %u bytes, %s: %lu atendidas, SP = %u, profundidad %d",
+                      casos[k].ancho, casos[k].tam, cpu_motor_nombre(motores[m]),
+                      cpu.irq.atendidas, cpu.SP, profundidad);
+            memoria_liberar(&mem);
+        }
+        programa_liberar(&prog);
+    }
+}
+
+// ==================== CÓDIGO QUE SE MODIFICA ====================
+
+/*
+ * Llena MEM[200..215] con 3, 6, ..., 48 y los suma 40 veces. Como en
+ * bench/programas/memcpy.asm, 'leer' y 'escribir' reciben la dirección
+ * reescribiendo su operando; además cada suma reescribe el LOADI que la
+ * sigue en el mismo bloque. Suma de una vuelta: 408 % 256 = 152; total:
+ * 40 * 408 % 256 = 192.
+ */
+static const char programa_automodificable[] =
+    "        JMP inicio\n"
+    "leer:                       ; 2\n"
+    "        LOADM 0             ; operando en 3\n"
+    "        RET\n"
+    "escribir:                   ; 5\n"
+    "        STORE 0             ; operando en 6\n"
+    "        RET\n"
+    "inicio:\n"
+    "        LOADI 1\n"
+    "        STORE 240          ; const 1\n"
+    "        LOADI 216\n"
+    "        STORE 241          ; fin de los datos\n"
+    "        LOADI 40\n"
+    "        STORE 242          ; vueltas\n"
+    "        LOADI 200\n"
+    "        STORE 243          ; puntero\n"
+    "        LOADI 0\n"
+    "        STORE 244          ; valor\n"
+    "llenar:\n"
+    "        LOADM 243\n"
+    "        STORE 6\n"
+    "        LOADM 244\n"
+    "        ADD 240\n"
+    "        ADD 240\n"
+    "        ADD 240\n"
+    "        STORE 244\n"
+    "        CALL escribir\n"
+    "        LOADM 243\n"
+    "        ADD 240\n"
+    "        STORE 243\n"
+    "        SUB 241\n"
+    "        JMPZ vuelta\n"
+    "        JMP llenar\n"
+    "vuelta:\n"
+    "        LOADI 200\n"
+    "        STORE 243\n"
+    "        LOADI 0\n"
+    "        STORE 245          ; suma de la vuelta\n"
+    "sumar:\n"
+    "        LOADM 243\n"
+    "        STORE 3\n"
+    "        CALL leer\n"
+    "        STORE 73           ; operando del LOADI siguiente\n"
+    "        LOADI 0\n"
+    "        ADD 245\n"
+    "        STORE 245\n"
+    "        LOADM 243\n"
+    "        ADD 240\n"
+    "        STORE 243\n"
+    "        SUB 241\n"
+    "        JMPZ fin_vuelta\n"
+    "        JMP sumar\n"
+    "fin_vuelta:\n"
+    "        LOADM 245\n"
+    "        ADD 246\n"
+    "        STORE 246          ; total\n"
+    "        LOADM 242\n"
+    "        SUB 240\n"
+    "        STORE 242\n"
+    "        JMPZ fin\n"
+    "        JMP vuelta\n"
+    "fin:\n"
+    "        HALT\n";
+
+/*
+ * Todos los motores dejan la misma memoria y las mismas métricas que el
+ * switch, también con bloques reescritos más de JIT_UMBRAL_SMC veces (los
+ * de 'leer' y de la suma se reescriben 640 veces).
+ */
+static void prueba_automodificable(void) {
+    static const MotorCPU motores[] = { MOTOR_SWITCH, MOTOR_THREADED, MOTOR_PREDECODE, MOTOR_JIT };
+    Programa prog;
+    if (ensamblador_buffer(programa_automodificable, sizeof(programa_automodificable) - 1, 8,
+                           &prog, NULL) < 0) {
+        COMPROBAR(0, "no ensambla");
+        return;
+    }
+
+    CPU ref;
+    Memoria mem_ref;
+    if (computadora_ejecutar(&prog, MEM_SIZE, MOTOR_SWITCH, &ref, &mem_ref) < 0) {
+        COMPROBAR(0, "no corre");
+        programa_liberar(&prog);
+        return;
+    }
+    COMPROBAR(ref.halted && mem_ref.data[245] == 152 && mem_ref.data[246] == 192,
+              "switch: MEM[245] = %d, MEM[246] = %d, se esperaban 152 y 192",
+              mem_ref.data[245], mem_ref.data[246]);
+
+    for (size_t m = 1; m < sizeof(motores) / sizeof(motores[0]); m++) {
+        CPU cpu;
+        Memoria mem;
+        if (computadora_ejecutar(&prog, MEM_SIZE, motores[m], &cpu, &mem) < 0) {
+            COMPROBAR(0, "%s no corre", cpu_motor_nombre(motores[m]));
+            continue;
+        }
+        COMPROBAR(memcmp(mem.data, mem_ref.data, MEM_SIZE) == 0,
+                  "%s deja otra memoria (MEM[246] = %d)", cpu_motor_nombre(motores[m]),
+                  mem.data[246]);
+        COMPROBAR(cpu.halted == ref.halted && cpu.A == ref.A && cpu.Z == ref.Z &&
+                  cpu.PC == ref.PC && cpu.SP == ref.SP,
+                  "%s: registros distintos (PC %u, A %u)", cpu_motor_nombre(motores[m]),
+                  cpu.PC, cpu.A);
+        COMPROBAR(cpu.met.instrucciones == ref.met.instrucciones &&
+                  cpu.met.accesos_memoria == ref.met.accesos_memoria &&
+                  cpu.met.saltos_tomados == ref.met.saltos_tomados &&
+                  cpu.met.saltos_no_tomados == ref.met.saltos_no_tomados &&
+                  cpu.met.profundidad_pila == ref.met.profundidad_pila,
+                  "%s: %lu instrucciones, %lu accesos, %lu/%lu saltos; switch %lu, %lu, %lu/%lu",
+                  cpu_motor_nombre(motores[m]), cpu.met.instrucciones,
+                  cpu.met.accesos_memoria, cpu.met.saltos_tomados, cpu.met.saltos_no_tomados,
+                  ref.met.instrucciones, ref.met.accesos_memoria, ref.met.saltos_tomados,
+                  ref.met.saltos_no_tomados);
+        memoria_liberar(&mem);
+    }
+    memoria_liberar(&mem_ref);
+    programa_liberar(&prog);
+}
+
+// ==================== INSTANTÁNEAS ====================
+
+/* Tres bytes al puerto del dispositivo */
+static const char programa_salida[] =
+    "        LOADI 65\n"
+    "        STORE 248          ; DISPOSITIVO_PUERTO\n"
+    "        LOADI 66\n"
+    "        STORE 248\n"
+    "        LOADI 67\n"
+    "        STORE 248\n"
+    "        HALT\n";
+
+/*
+ * Un hijo de fork no escribe en el dispositivo del original: la salida
+ * tiene sólo los bytes del original y el STORE del hijo queda en su memoria.
+ */
+static void prueba_fork_dispositivo(void) {
+    Programa prog;
+    if (ensamblador_buffer(programa_salida, sizeof(programa_salida) - 1, 8, &prog, NULL) < 0) {
+        COMPROBAR(0, "no ensambla");
+        return;
+    }
+    Memoria mem, mem_hijo;
+    if (memoria_init_tam(&mem, MEM_SIZE) < 0 || computadora_cargar(&mem, &prog) < 0) {
+        COMPROBAR(0, "no carga");
+        programa_liberar(&prog);
+        return;
+    }
+    Dispositivo *d = dispositivo_abrir_memoria();
+    CPU cpu, hijo;
+    cpu_init(&cpu, &mem);
+    cpu.PC = prog.entrada;
+    cpu.dispositivo = d;
+    cpu.limite = 4;             // hasta después del segundo STORE
+    cpu_ejecutar(&cpu);
+
+    if (instantanea_fork(&cpu, &hijo, &mem_hijo) == 0) {
+        COMPROBAR(hijo.dispositivo == NULL, "el hijo heredó el dispositivo");
+        hijo.limite = 0;
+        cpu_ejecutar(&hijo);
+        COMPROBAR(hijo.halted && mem_hijo.data[DISPOSITIVO_PUERTO] == 67,
+                  "el hijo no terminó (MEM[%d] = %d)", DISPOSITIVO_PUERTO,
+                  mem_hijo.data[DISPOSITIVO_PUERTO]);
+        memoria_liberar(&mem_hijo);
+    } else {
+        COMPROBAR(0, "fork falló");
+    }
+    cpu.limite = 0;
+    cpu_ejecutar(&cpu);
+
+    uint64_t bytes = 0;
+    uint8_t *datos = NULL;
+    int r = dispositivo_cerrar(d, &bytes, NULL, &datos);
+    COMPROBAR(r == 0 && bytes == 3 && datos && memcmp(datos, "ABC", 3) == 0,
+              "salida de %lu bytes, se esperaba \"ABC\"", (unsigned long)bytes);
+    free(datos);
+    memoria_liberar(&mem);
+    programa_liberar(&prog);
+}
+
+// ==================== TRAZAS ====================
+
+/*
+ * Reconstruir desde la traza da el mismo estado, controlador de
+ * interrupciones incluido, que correr hasta ese punto; y lo reconstruido
+ * sigue hasta HALT igual que la corrida original.
+ */
+static void prueba_traza_interrupciones(void) {
+    Programa prog;
+    if (ensamblador_buffer(programa_interrupciones, sizeof(programa_interrupciones) - 1, 8,
+                           &prog, NULL) < 0) {
+        COMPROBAR(0, "no ensambla");
+        return;
+    }
+    char path[] = "/tmp/pruebas-traza-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        COMPROBAR(0, "no se pudo crear el archivo temporal");
+        programa_liberar(&prog);
+        return;
+    }
+    close(fd);
+
+    CPU cpu;
+    Memoria mem;
+    if (memoria_init_tam(&mem, MEM_SIZE) < 0 || computadora_cargar(&mem, &prog) < 0) {
+        COMPROBAR(0, "no carga");
+        goto salir;
+    }
+    cpu_init(&cpu, &mem);
+    cpu.PC = prog.entrada;
+    cpu.traza = traza_abrir(path, 16);
+    if (!cpu.traza) {
+        COMPROBAR(0, "no se pudo abrir la traza");
+        memoria_liberar(&mem);
+        goto salir;
+    }
+    cpu_ejecutar(&cpu);
+    int r = traza_cerrar(cpu.traza, &cpu, NULL, NULL);
+    cpu.traza = NULL;
+    unsigned long total = cpu.met.instrucciones;
+    unsigned long atendidas = cpu.irq.atendidas;
+    memoria_liberar(&mem);
+    COMPROBAR(r == 0 && cpu.halted && atendidas >= 8, "la corrida trazada falló");
+
+    for (unsigned long n = 1; n < total; n++) {
+        CPU ref, rec;
+        Memoria mem_ref, mem_rec;
+        if (memoria_init_tam(&mem_ref, MEM_SIZE) < 0 || computadora_cargar(&mem_ref, &prog) < 0)
+            break;
+        cpu_init(&ref, &mem_ref);
+        ref.PC = prog.entrada;
+        ref.limite = n;
+        cpu_ejecutar(&ref);
+
+        if (traza_reconstruir(path, n, &rec, &mem_rec) < 0) {
+            COMPROBAR(0, "no se pudo reconstruir en %lu", n);
+            memoria_liberar(&mem_ref);
+            break;
+        }
+        int igual = rec.PC == ref.PC && rec.A == ref.A && rec.SP == ref.SP &&
+                    rec.Z == ref.Z && rec.irq.habilitadas == ref.irq.habilitadas &&
+                    rec.irq.pendiente == ref.irq.pendiente &&
+                    rec.irq.vector == ref.irq.vector && rec.irq.periodo == ref.irq.periodo &&
+                    rec.irq.atendidas == ref.irq.atendidas &&
+                    interrupciones_vencimiento(&rec.irq) == interrupciones_vencimiento(&ref.irq) &&
+                    memcmp(mem_rec.data, mem_ref.data, MEM_SIZE) == 0;
+        COMPROBAR(igual, "en %lu: PC %u/%u, A %u/%u, vencimiento %lu/%lu", n, rec.PC, ref.PC,
+                  rec.A, ref.A, interrupciones_vencimiento(&rec.irq),
+                  interrupciones_vencimiento(&ref.irq));
+
+        rec.limite = 2 * total;
+        cpu_ejecutar(&rec);
+        COMPROBAR(rec.halted && rec.met.instrucciones == total && rec.irq.atendidas == atendidas,
+                  "desde %lu: %lu instrucciones y %lu atendidas, se esperaban %lu y %lu", n,
+                  rec.met.instrucciones, rec.irq.atendidas, total, atendidas);
+        memoria_liberar(&mem_rec);
+        memoria_liberar(&mem_ref);
+        if (!igual)
+            break;
+    }
+salir:
+    unlink(path);
+    programa_liberar(&prog);
+}
+
+int main(void) {
+    prueba_programa_grande();
+    prueba_pila_interrupciones();
+    prueba_automodificable();
+    prueba_fork_dispositivo();
+    prueba_traza_interrupciones();
+
+    printf("[%s] %d comprobaciones, %d fallas\n", fallas ? "FALLA" : "OK", comprobaciones,
+           fallas);
+    return fallas ? 1 : 0;
+}
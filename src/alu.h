@@ -3,13 +3,9 @@
 
 #include <stdint.h>
 
-<<<<<<< HEAD
 uint8_t alu_add(uint8_t a, uint8_t b);
 uint8_t alu_sub(uint8_t a, uint8_t b);
 uint8_t alu_mul(uint8_t a, uint8_t b);
-=======
-uint8_t alu_suma(uint8_t a, uint8_t b);
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
 
 #endif
 
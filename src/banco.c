@@ -0,0 +1,524 @@
+/*
+ * banco.c - banco de rendimiento: corre programas invitados con cada motor y
+ * compara con una medición guardada
+ *
+ * Uso: banco [opciones] programa.c|programa.asm...
+ *
+ *   --repeticiones=N  corridas por programa y motor (10 por defecto)
+ *   --motores=a,b     motores a medir (switch,threaded,predecode,jit)
+ *   --salida=F        resultados en JSON (stdout por defecto)
+ *   --base=F          JSON de una medición anterior a comparar
+ *   --umbral=P        regresión: la mejor corrida más de P % más lenta que
+ *                     en la base (25)
+ *   --pares=N         en vez de medir, las N secuencias de dos y de tres
+ *                     opcodes más ejecutadas en todo el corpus (ver abajo)
+ *
+ * Cada programa declara en comentarios lo que tiene que quedar en memoria:
+ *   ; esperado: MEM[200] = 1          (por dirección)
+ *   // esperado: resultado = 120      (en un .c, por nombre de variable, con
+ *                                      el mapa que deja el compilador en el ASM)
+ * Una corrida con otro resultado cuenta como fallo.
+ *
+ * Cada par programa/motor corre en un proceso hijo, así el pico de memoria
+ * (ru_maxrss) es el suyo. Los tiempos son de reloj de pared
+ * (CLOCK_MONOTONIC) alrededor de cpu_ejecutar; instrucciones por segundo
+ * se calcula con la mediana. Contra la base se compara la mejor corrida,
+ * que es la que menos depende de lo que haga el resto de la máquina; se
+ * informa la aceleración de cada par y la de la suma de las mejores
+ * corridas (así compara make release o make pgo con la compilación de
+ * depuración). Sale con 1 si algún programa falla o hay regresiones.
+ *
+ * El motor simd no está: con una sola corrida es el predecodificado.
+ *
+ * Con --pares cada programa corre una vez con el perfilador (perfil.h) y se
+ * suman, por cada PC, sus ejecuciones a la secuencia que empieza ahí: la
+ * instrucción siguiente es el próximo PC ejecutado (los operandos no se
+ * ejecutan nunca). Sólo cuentan las secuencias cuyas instrucciones, salvo
+ * la última, no saltan: son las que el núcleo predecodificado puede
+ * fusionar en una superinstrucción (ver superinstrucciones[] en cpu.c).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "computadora.h"
+#include "perfil.h"
+
+#define BANCO_MAX_ESPERADOS 16
+#define BANCO_MAX_MOTORES   8
+#define BANCO_OPCODES       32      // opcodes de 8 bits con --pares
+
+typedef struct {
+    char nombre[64];                // archivo sin directorio ni extensión
+    Programa prog;
+    uint16_t dir[BANCO_MAX_ESPERADOS];
+    uint8_t valor[BANCO_MAX_ESPERADOS];
+    int n_esperados;
+} ProgramaBanco;
+
+/* Lo que el hijo devuelve por la tubería */
+typedef struct {
+    int ok;                         // todas las corridas con el resultado esperado
+    unsigned long instrucciones;    // de una corrida
+    double min, media, p50, p99;    // segundos
+} Medicion;
+
+typedef struct {
+    char programa[64];
+    char motor[16];
+    double min;
+} EntradaBase;
+
+static double ahora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+}
+
+static int comparar_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Dirección de la variable 'nombre' según el mapa "; MEM[d] = nombre" del ASM */
+static int buscar_variable(const char *asm_txt, const char *nombre) {
+    for (const char *p = asm_txt; (p = strstr(p, "; MEM[")); p++) {
+        int dir;
+        char var[64];
+        if (sscanf(p, "; MEM[%d] = %63s", &dir, var) == 2 && strcmp(var, nombre) == 0)
+            return dir;
+    }
+    return -1;
+}
+
+/* Lee las líneas "esperado: X = v" de 'fuente'; 'asm_txt' resuelve los nombres */
+static int leer_esperados(ProgramaBanco *pb, const char *fuente, const char *asm_txt) {
+    for (const char *p = fuente; (p = strstr(p, "esperado:")); p++) {
+        char que[64];
+        int valor, dir;
+        if (sscanf(p, "esperado: %63[^= ] = %d", que, &valor) != 2) {
+            fprintf(stderr, "[ERROR] %s: línea 'esperado:' mal escrita\n", pb->nombre);
+            return -1;
+        }
+        if (sscanf(que, "MEM[%d]", &dir) != 1 &&
+            (!asm_txt || (dir = buscar_variable(asm_txt, que)) < 0)) {
+            fprintf(stderr, "[ERROR] %s: '%s' no es MEM[d] ni una variable\n", pb->nombre, que);
+            return -1;
+        }
+        if (dir < 0 || dir >= MEM_SIZE || pb->n_esperados == BANCO_MAX_ESPERADOS) {
+            fprintf(stderr, "[ERROR] %s: esperado fuera de memoria o demasiados\n", pb->nombre);
+            return -1;
+        }
+        pb->dir[pb->n_esperados] = (uint16_t)dir;
+        pb->valor[pb->n_esperados++] = (uint8_t)valor;
+    }
+    if (pb->n_esperados == 0) {
+        fprintf(stderr, "[ERROR] %s: sin líneas 'esperado:'\n", pb->nombre);
+        return -1;
+    }
+    return 0;
+}
+
+/* Traduce (si es .c) y ensambla 'path' con operandos de 8 bits */
+static int preparar(ProgramaBanco *pb, const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    snprintf(pb->nombre, sizeof(pb->nombre), "%s", base);
+    char *punto = strrchr(pb->nombre, '.');
+    int es_c = punto && strcmp(punto, ".c") == 0;
+    if (punto)
+        *punto = '\0';
+
+    char *fuente;
+    size_t len;
+    if (computadora_leer_archivo(path, &fuente, &len) < 0)
+        return -1;
+
+    char *asm_txt = NULL;
+    size_t asm_len = len;
+    int r = -1;
+    if (es_c && compilador_traducir(fuente, len, COMPILADOR_NIVEL_DEFECTO, 8, MEM_SIZE,
+                                    &asm_txt, &asm_len, NULL) < 0) {
+        fprintf(stderr, "[ERROR] No se pudo traducir %s\n", path);
+        goto fin;
+    }
+    if (leer_esperados(pb, fuente, asm_txt) < 0)
+        goto fin;
+    if (ensamblador_buffer(es_c ? asm_txt : fuente, asm_len, 8, &pb->prog, NULL) < 0) {
+        fprintf(stderr, "[ERROR] No se pudo ensamblar %s\n", path);
+        goto fin;
+    }
+    r = 0;
+fin:
+    free(asm_txt);
+    free(fuente);
+    return r;
+}
+
+/* En el hijo: 'n' corridas de 'pb' con 'motor' */
+static Medicion medir(const ProgramaBanco *pb, MotorCPU motor, int n) {
+    Medicion m = { .ok = 1 };
+    double *t = malloc((size_t)n * sizeof(double));
+    if (!t) {
+        m.ok = 0;
+        return m;
+    }
+
+    double total = 0;
+    for (int k = 0; k < n; ++k) {
+        Memoria mem;
+        CPU cpu;
+        if (memoria_init_tam(&mem, MEM_SIZE) < 0 || computadora_cargar(&mem, &pb->prog) < 0) {
+            m.ok = 0;
+            break;
+        }
+        cpu_init(&cpu, &mem);
+        cpu.motor = motor;
+        cpu.silencioso = 1;
+        cpu.PC = pb->prog.entrada;
+
+        double t0 = ahora();
+        cpu_ejecutar(&cpu);
+        t[k] = ahora() - t0;
+        total += t[k];
+
+        for (int e = 0; e < pb->n_esperados; ++e)
+            if (mem.data[pb->dir[e]] != pb->valor[e]) {
+                if (m.ok)
+                    fprintf(stderr, "[ERROR] %s/%s: MEM[%u] = %u, se esperaba %u\n",
+                            pb->nombre, cpu_motor_nombre(motor), pb->dir[e],
+                            mem.data[pb->dir[e]], pb->valor[e]);
+                m.ok = 0;
+            }
+        m.instrucciones = cpu.met.instrucciones;
+        memoria_liberar(&mem);
+    }
+
+    if (m.ok) {
+        qsort(t, (size_t)n, sizeof(double), comparar_double);
+        m.min = t[0];
+        m.media = total / n;
+        m.p50 = t[(n - 1) / 2];
+        m.p99 = t[(99 * n + 99) / 100 - 1];     // rango más cercano
+    }
+    free(t);
+    return m;
+}
+
+/* Corre medir() en un hijo; *rss_kb recibe su pico de memoria */
+static int medir_en_hijo(const ProgramaBanco *pb, MotorCPU motor, int n, Medicion *m,
+                         long *rss_kb) {
+    int tubo[2];
+    if (pipe(tubo) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(tubo[0]);
+        close(tubo[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(tubo[0]);
+        Medicion r = medir(pb, motor, n);
+        _exit(write(tubo[1], &r, sizeof(r)) == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+
+    close(tubo[1]);
+    ssize_t leido = read(tubo[0], m, sizeof(*m));
+    close(tubo[0]);
+    int estado;
+    struct rusage uso;
+    if (wait4(pid, &estado, 0, &uso) < 0 || leido != (ssize_t)sizeof(*m) ||
+        !WIFEXITED(estado) || WEXITSTATUS(estado) != 0) {
+        fprintf(stderr, "[ERROR] %s/%s: el proceso de medición terminó mal\n",
+                pb->nombre, cpu_motor_nombre(motor));
+        return -1;
+    }
+    *rss_kb = uso.ru_maxrss;
+    return 0;
+}
+
+/* --- Secuencias de opcodes (--pares) --- */
+
+typedef struct {
+    uint64_t pares[BANCO_OPCODES][BANCO_OPCODES];
+    uint64_t ternas[BANCO_OPCODES][BANCO_OPCODES][BANCO_OPCODES];
+    uint64_t instrucciones;
+} Secuencias;
+
+typedef struct {
+    uint64_t veces;
+    uint8_t ops[3];
+} Secuencia;
+
+/* JMP, HALT, CALL, RET, JMPZ y RETI: después no viene la instrucción siguiente */
+static int cambia_flujo(uint8_t op) {
+    switch (op & ~OP_ANCHO) {
+    case 7: case 8: case 11: case 12: case 13: case 17:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Próximo PC ejecutado después de 'pc' (p->tam si no hay) */
+static uint32_t siguiente_ejecutado(const Perfil *p, uint32_t pc) {
+    do
+        pc++;
+    while (pc < p->tam && !p->ejecuciones[pc]);
+    return pc;
+}
+
+/* Una corrida de 'pb' con el perfilador; suma sus secuencias a 's' */
+static int contar_secuencias(const ProgramaBanco *pb, Secuencias *s) {
+    Memoria mem;
+    if (memoria_init_tam(&mem, MEM_SIZE) < 0 || computadora_cargar(&mem, &pb->prog) < 0)
+        return -1;
+    Perfil *p = perfil_crear(MEM_SIZE, pb->prog.entrada);
+    if (!p) {
+        memoria_liberar(&mem);
+        return -1;
+    }
+    CPU cpu;
+    cpu_init(&cpu, &mem);
+    cpu.silencioso = 1;
+    cpu.PC = pb->prog.entrada;
+    cpu.perfil = p;
+    cpu_ejecutar(&cpu);
+    s->instrucciones += cpu.met.instrucciones;
+
+    for (uint32_t pc = 0; pc < p->tam; ++pc) {
+        uint64_t n = p->ejecuciones[pc];
+        uint8_t a = p->opcodes[pc];
+        if (!n || a >= BANCO_OPCODES || cambia_flujo(a))
+            continue;
+        uint32_t pc_b = siguiente_ejecutado(p, pc);
+        uint8_t b = pc_b < p->tam ? p->opcodes[pc_b] : 0;
+        if (b == 0 || b >= BANCO_OPCODES)
+            continue;
+        s->pares[a][b] += n;
+        if (cambia_flujo(b))
+            continue;
+        uint32_t pc_c = siguiente_ejecutado(p, pc_b);
+        uint8_t c = pc_c < p->tam ? p->opcodes[pc_c] : 0;
+        if (c != 0 && c < BANCO_OPCODES)
+            s->ternas[a][b][c] += n;
+    }
+    perfil_destruir(p);
+    memoria_liberar(&mem);
+    return 0;
+}
+
+static int por_veces(const void *a, const void *b) {
+    uint64_t x = ((const Secuencia *)a)->veces, y = ((const Secuencia *)b)->veces;
+    return (x < y) - (x > y);
+}
+
+/* Las 'top' secuencias más ejecutadas de 'v', en % de las instrucciones del corpus */
+static void informar_secuencias(Secuencia *v, size_t n, int largo, int top, uint64_t total) {
+    qsort(v, n, sizeof(Secuencia), por_veces);
+    for (size_t k = 0; k < n && k < (size_t)top; ++k) {
+        char nombre[48];
+        int len = 0;
+        for (int i = 0; i < largo; ++i)
+            len += snprintf(nombre + len, sizeof(nombre) - len, "%s%s", i ? "->" : "",
+                            cpu_opcode_nombre(v[k].ops[i]));
+        fprintf(stderr, "[METRIC] %-5s %-20s %12llu  %6.2f%%\n", largo == 2 ? "par" : "terna",
+                nombre, (unsigned long long)v[k].veces,
+                total ? 100.0 * (double)v[k].veces / (double)total : 0.0);
+    }
+}
+
+static void informar_pares(const Secuencias *s, int top) {
+    static Secuencia v[BANCO_OPCODES * BANCO_OPCODES * BANCO_OPCODES];
+    size_t n = 0;
+    for (int a = 0; a < BANCO_OPCODES; ++a)
+        for (int b = 0; b < BANCO_OPCODES; ++b)
+            if (s->pares[a][b])
+                v[n++] = (Secuencia){ s->pares[a][b], { (uint8_t)a, (uint8_t)b } };
+    informar_secuencias(v, n, 2, top, s->instrucciones);
+
+    n = 0;
+    for (int a = 0; a < BANCO_OPCODES; ++a)
+        for (int b = 0; b < BANCO_OPCODES; ++b)
+            for (int c = 0; c < BANCO_OPCODES; ++c)
+                if (s->ternas[a][b][c])
+                    v[n++] = (Secuencia){ s->ternas[a][b][c], { (uint8_t)a, (uint8_t)b, (uint8_t)c } };
+    informar_secuencias(v, n, 3, top, s->instrucciones);
+    fprintf(stderr, "[INFO] %llu instrucciones en el corpus\n", (unsigned long long)s->instrucciones);
+}
+
+/* Entradas de un JSON escrito por este mismo programa (una por línea) */
+static int leer_base(const char *path, EntradaBase **out) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("fopen base");
+        return -1;
+    }
+    EntradaBase *v = NULL;
+    int n = 0, cap = 0;
+    char linea[512];
+    while (fgets(linea, sizeof(linea), f)) {
+        EntradaBase e;
+        const char *min = strstr(linea, "\"min_s\": ");
+        if (sscanf(linea, " {\"programa\": \"%63[^\"]\", \"motor\": \"%15[^\"]\"",
+                   e.programa, e.motor) != 2 || !min || sscanf(min + 9, "%lf", &e.min) != 1)
+            continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 32;
+            EntradaBase *w = realloc(v, (size_t)cap * sizeof(EntradaBase));
+            if (!w) {
+                free(v);
+                fclose(f);
+                return -1;
+            }
+            v = w;
+        }
+        v[n++] = e;
+    }
+    fclose(f);
+    *out = v;
+    return n;
+}
+
+static const EntradaBase *buscar_base(const EntradaBase *b, int n, const char *programa,
+                                      const char *motor) {
+    for (int i = 0; i < n; ++i)
+        if (strcmp(b[i].programa, programa) == 0 && strcmp(b[i].motor, motor) == 0)
+            return &b[i];
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int repeticiones = 10;
+    double umbral = 25;
+    const char *salida = NULL, *base = NULL;
+    MotorCPU motores[BANCO_MAX_MOTORES] = { MOTOR_SWITCH, MOTOR_THREADED, MOTOR_PREDECODE, MOTOR_JIT };
+    int n_motores = 4;
+    int pares = 0;
+    int k = 1;
+
+    for (; k < argc && argv[k][0] == '-' && argv[k][1] == '-'; ++k) {
+        if (strncmp(argv[k], "--repeticiones=", 15) == 0) {
+            repeticiones = atoi(argv[k] + 15);
+        } else if (strncmp(argv[k], "--umbral=", 9) == 0) {
+            umbral = atof(argv[k] + 9);
+        } else if (strncmp(argv[k], "--salida=", 9) == 0) {
+            salida = argv[k] + 9;
+        } else if (strncmp(argv[k], "--base=", 7) == 0) {
+            base = argv[k] + 7;
+        } else if (strncmp(argv[k], "--pares=", 8) == 0) {
+            pares = atoi(argv[k] + 8);
+        } else if (strncmp(argv[k], "--motores=", 10) == 0) {
+            char lista[128];
+            snprintf(lista, sizeof(lista), "%s", argv[k] + 10);
+            n_motores = 0;
+            for (char *s = strtok(lista, ","); s; s = strtok(NULL, ",")) {
+                int m = cpu_motor_desde_nombre(s);
+                if (m < 0 || m == MOTOR_SIMD || n_motores == BANCO_MAX_MOTORES) {
+                    fprintf(stderr, "Motor no válido aquí: %s\n", s);
+                    return 1;
+                }
+                motores[n_motores++] = (MotorCPU)m;
+            }
+        } else {
+            break;
+        }
+    }
+    if (k == argc || repeticiones < 1 || n_motores == 0 || pares < 0) {
+        fprintf(stderr, "Uso: %s [--repeticiones=N] [--motores=a,b] [--salida=F] [--base=F] [--umbral=P] [--pares=N] programa.c|programa.asm...\n", argv[0]);
+        return 1;
+    }
+
+    if (pares) {
+        Secuencias *s = calloc(1, sizeof(Secuencias));
+        int fallos = s ? 0 : 1;
+        for (; s && k < argc; ++k) {
+            ProgramaBanco pb = { 0 };
+            if (preparar(&pb, argv[k]) < 0 || contar_secuencias(&pb, s) < 0)
+                fallos++;
+            programa_liberar(&pb.prog);
+        }
+        if (s)
+            informar_pares(s, pares);
+        free(s);
+        return fallos ? 1 : 0;
+    }
+
+    EntradaBase *entradas_base = NULL;
+    int n_base = 0;
+    if (base && (n_base = leer_base(base, &entradas_base)) < 0)
+        return 1;
+
+    FILE *f = salida ? fopen(salida, "w") : stdout;
+    if (!f) {
+        perror("fopen salida");
+        free(entradas_base);
+        return 1;
+    }
+    fprintf(f, "{\n  \"repeticiones\": %d,\n  \"resultados\": [\n", repeticiones);
+
+    int fallos = 0, regresiones = 0, primera = 1;
+    double suma_base = 0, suma_min = 0;     // mejores corridas de los pares con base
+    for (; k < argc; ++k) {
+        ProgramaBanco pb = { 0 };
+        if (preparar(&pb, argv[k]) < 0) {
+            fallos++;
+            continue;
+        }
+        for (int i = 0; i < n_motores; ++i) {
+            const char *motor = cpu_motor_nombre(motores[i]);
+            Medicion m;
+            long rss_kb;
+            if (medir_en_hijo(&pb, motores[i], repeticiones, &m, &rss_kb) < 0 || !m.ok) {
+                fallos++;
+                continue;
+            }
+            double ips = m.p50 > 0 ? (double)m.instrucciones / m.p50 : 0;
+
+            fprintf(f, "%s    {\"programa\": \"%s\", \"motor\": \"%s\", \"instrucciones\": %lu, "
+                    "\"instr_por_s\": %.0f, \"min_s\": %.6f, \"media_s\": %.6f, \"p50_s\": %.6f, "
+                    "\"p99_s\": %.6f, \"rss_kb\": %ld}", primera ? "" : ",\n", pb.nombre, motor,
+                    m.instrucciones, ips, m.min, m.media, m.p50, m.p99, rss_kb);
+            primera = 0;
+            fprintf(stderr, "[METRIC] %-10s %-9s %9lu instr  %8.2f MIPS  min %.6f s  media %.6f s  p50 %.6f s  p99 %.6f s  %ld KB\n",
+                    pb.nombre, motor, m.instrucciones, ips / 1e6, m.min, m.media, m.p50, m.p99,
+                    rss_kb);
+
+            const EntradaBase *b = buscar_base(entradas_base, n_base, pb.nombre, motor);
+            if (b && b->min > 0 && m.min > 0) {
+                fprintf(stderr, "[METRIC] %-10s %-9s x%.2f contra la base (%.6f s -> %.6f s)\n",
+                        pb.nombre, motor, b->min / m.min, b->min, m.min);
+                suma_base += b->min;
+                suma_min += m.min;
+            }
+            if (b && b->min > 0 && m.min > b->min * (1 + umbral / 100)) {
+                fprintf(stderr, "[ERROR] Regresión en %s/%s: mejor corrida %.6f s contra %.6f s de la base (%+.0f%%)\n",
+                        pb.nombre, motor, m.min, b->min, 100 * (m.min / b->min - 1));
+                regresiones++;
+            }
+        }
+        programa_liberar(&pb.prog);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    if (salida)
+        fclose(f);
+    free(entradas_base);
+
+    if (base && suma_min > 0)
+        fprintf(stderr, "[METRIC] aceleración total contra %s: x%.2f (%.6f s -> %.6f s)\n",
+                base, suma_base / suma_min, suma_base, suma_min);
+    if (base)
+        fprintf(stderr, "[INFO] %d regresiones de más del %.0f%% contra %s\n", regresiones, umbral, base);
+    if (fallos)
+        fprintf(stderr, "[ERROR] %d programas/motores fallaron\n", fallos);
+    return fallos || regresiones ? 1 : 0;
+}
@@ -1,98 +1,118 @@
 /*
- * c_to_asm.c - Traductor C simple a ASM sin etiquetas
- * Lee un .c con pseudocódigo estructurado y genera .asm con direcciones explícitas
+ * c_to_asm.c - Traductor de un subconjunto de C a ASM con etiquetas
+ * Lee el .c y escribe el .asm para el ensamblador (la traducción vive en
+ * compilador.c, libcomputadora)
+ *
+ * Uso: c_to_asm [-O0|-O1|-O2] [--ancho=16] [--memoria=N|NK] archivo.c [salida.asm]
+ * Sin salida escribe <archivo>.asm en el directorio actual; al terminar
+ * informa cuántas instrucciones quitó cada pasada del optimizador. El ancho
+ * y la memoria son los del ensamblado y la simulación (8 y MEM_TAM_DEFECTO
+ * por defecto): si los datos no caben ahí, no se genera nada.
  */
 
 #include <stdio.h>
-#include <string.h>
 #include <stdlib.h>
+#include <string.h>
+#include "compilador.h"
+#include "computadora.h"
+
+/* Sin salida explícita: el nombre del .c sin directorio y con .asm */
+static void nombre_salida(const char *entrada, char *buf, size_t tam) {
+    const char *base = strrchr(entrada, '/');
+    base = base ? base + 1 : entrada;
+    const char *punto = strrchr(base, '.');
+    int n = punto && punto != base ? (int)(punto - base) : (int)strlen(base);
+    snprintf(buf, tam, "%.*s.asm", n, base);
+}
+
+static void imprimir_informe(int nivel, const InformeOptimizacion *inf) {
+    printf("[METRIC] -O%d: %d -> %d instrucciones", nivel, inf->instrucciones_sin,
+           inf->instrucciones);
+    if (nivel >= 1)
+        printf(" (%d vueltas de pasadas)", inf->vueltas);
+    printf("\n");
+    if (nivel < 1)
+        return;
+    for (int p = 0; p < COMPILADOR_PASADAS; p++)
+        printf("[METRIC]   %-18s %d menos\n", compilador_nombre_pasada(p), inf->ahorradas[p]);
+    if (nivel >= 2)
+        printf("[METRIC]   %-18s %d expresiones fuera de bucles (hasta %d instrucciones menos por vuelta)\n",
+               "invariantes", inf->invariantes, inf->por_vuelta);
+}
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Uso: %s archivo.c\n", argv[0]);
+    int nivel = COMPILADOR_NIVEL_DEFECTO;
+    int ancho = 8;
+    uint32_t mem_tam = MEM_TAM_DEFECTO;
+    const char *args[2] = { NULL, NULL };
+    int n_args = 0;
+    for (int k = 1; k < argc; ++k) {
+        if (argv[k][0] == '-' && argv[k][1] == 'O' && argv[k][2] >= '0' && argv[k][2] <= '2' &&
+            !argv[k][3])
+            nivel = argv[k][2] - '0';
+        else if (strcmp(argv[k], "--ancho=16") == 0)
+            ancho = 16;
+        else if (strcmp(argv[k], "--ancho=8") == 0)
+            ancho = 8;
+        else if (strncmp(argv[k], "--memoria=", 10) == 0) {
+            char *fin;
+            unsigned long t = strtoul(argv[k] + 10, &fin, 0);
+            if (*fin == 'K' || *fin == 'k') {
+                t *= 1024;
+                fin++;
+            }
+            if (*fin || t < MEM_SIZE || t > MEM_MAX) {
+                printf("Tamaño de memoria inválido: %s (de %u a %u bytes)\n", argv[k] + 10,
+                       MEM_SIZE, MEM_MAX);
+                return 1;
+            }
+            mem_tam = (uint32_t)t;
+        } else if (n_args < 2 && argv[k][0] != '-')
+            args[n_args++] = argv[k];
+        else
+            n_args = 3;                 // de más o desconocida
+    }
+    if (n_args < 1 || n_args > 2) {
+        printf("Uso: %s [-O0|-O1|-O2] [--ancho=16] [--memoria=N] archivo.c [salida.asm]\n",
+               argv[0]);
         return 1;
     }
 
-    FILE *in = fopen(argv[1], "r");
-    if (!in) {
-        printf("No se pudo abrir %s\n", argv[1]);
+    char defecto[4096];
+    const char *salida = args[1] ? args[1] : defecto;
+    if (!args[1])
+        nombre_salida(args[0], defecto, sizeof(defecto));
+
+    char *fuente;
+    size_t len;
+    if (computadora_leer_archivo(args[0], &fuente, &len) < 0)
+        return 1;
+
+    char *asm_txt;
+    size_t asm_len;
+    InformeOptimizacion inf;
+    int r = compilador_traducir(fuente, len, nivel, ancho, mem_tam, &asm_txt, &asm_len, &inf);
+    free(fuente);
+    if (r < 0) {
+        printf("No se pudo traducir %s\n", args[0]);
         return 1;
     }
 
-    FILE *out = fopen("factorial.asm", "w");
+    FILE *out = fopen(salida, "w");
     if (!out) {
-        printf("No se pudo crear factorial.asm\n");
-        fclose(in);
+        printf("No se pudo crear %s\n", salida);
+        free(asm_txt);
         return 1;
     }
-
-    fprintf(out, "; factorial_no_labels.asm - generado por c_to_asm\n");
-    fprintf(out, "; MEM[100] = N\n");
-    fprintf(out, "; MEM[101] = contador\n");
-    fprintf(out, "; MEM[200] = resultado\n");
-    fprintf(out, "; MEM[2]   = const 1 (usada para decrementar)\n\n");
-
-    int pc = 0;
-
-    // 1. Inicializar N = 5
-    fprintf(out, "        LOADI 5        ; %d..%d   A=5\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 100      ; %d..%d   MEM[100]=5\n\n", pc, pc+1); pc+=2;
-
-    // 2. Inicializar resultado = 1
-    fprintf(out, "        LOADI 1        ; %d..%d   A=1\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 200      ; %d..%d   MEM[200]=1\n\n", pc, pc+1); pc+=2;
-
-    // 3. Constante 1
-    fprintf(out, "        LOADI 1        ; %d..%d   A=1\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 2        ; %d..%d   MEM[2]=1\n\n", pc, pc+1); pc+=2;
-
-    // 4. contador = N
-    fprintf(out, "        LOADM 100      ; %d..%d A = MEM[100]\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 101      ; %d..%d MEM[101] = N (contador)\n\n", pc, pc+1); pc+=2;
-
-    int bucle = pc; // inicio del bucle
-
-    // 5. while (contador != 0)
-    fprintf(out, "        LOADM 101      ; %d..%d A = contador\n", pc, pc+1); pc+=2;
-   // int saltoFin = pc;
-    fprintf(out, "        JMPZ 34        ; %d..%d salto a fin\n\n", pc, pc+1); pc+=2;
-
-    // 6. resultado = resultado * contador
-    fprintf(out, "        LOADM 200      ; %d..%d A = resultado\n", pc, pc+1); pc+=2;
-    fprintf(out, "        MUL 101        ; %d..%d A = resultado * contador\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 200      ; %d..%d MEM[200] = A\n\n", pc, pc+1); pc+=2;
-
-    // 7. contador = contador - 1
-    fprintf(out, "        LOADM 101      ; %d..%d A = contador\n", pc, pc+1); pc+=2;
-    fprintf(out, "        SUB 2          ; %d..%d A = A - MEM[2]\n", pc, pc+1); pc+=2;
-    fprintf(out, "        STORE 101      ; %d..%d MEM[101] = nuevo contador\n\n", pc, pc+1); pc+=2;
-
-    // 8. salto al inicio del bucle
-    fprintf(out, "        JMP %d         ; %d..%d volver al inicio del bucle\n\n", bucle, pc, pc+1); pc+=2;
-
-    // 9. parchear JMPZ XX
-    int fin = pc;
-    fseek(out, 0, SEEK_END);
-    fprintf(out, "        HALT           ; %d fin\n", fin);
-
-    fclose(in);
-    fclose(out);
-
-    // Ahora parcheamos el JMPZ XX
-    FILE *patch = fopen("factorial.asm", "r+");
-    char line[256];
-    long pos;
-    while (fgets(line, sizeof(line), patch)) {
-        if (strstr(line, "JMPZ XX")) {
-            pos = ftell(patch);
-            fseek(patch, pos - strlen(line), SEEK_SET);
-            fprintf(patch, "        JMPZ %d        ; salto a fin\n", fin);
-            break;
-        }
+    int ok = fwrite(asm_txt, 1, asm_len, out) == asm_len;
+    ok = (fclose(out) == 0) && ok;
+    free(asm_txt);
+    if (!ok) {
+        printf("No se pudo escribir %s\n", salida);
+        return 1;
     }
-    fclose(patch);
 
-    printf("Archivo factorial.asm generado correctamente (%d bytes aprox).\n", pc);
+    printf("Archivo %s generado correctamente (%zu bytes).\n", salida, asm_len);
+    imprimir_informe(nivel, &inf);
     return 0;
 }
-
@@ -0,0 +1,1524 @@
+/*
+ * compilador.c - subconjunto de C a ASM con etiquetas (ver compilador.h)
+ * Léxico -> árbol (descenso recursivo) -> código intermedio -> texto ASM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "compilador.h"
+#include "memoria.h"
+
+#define MAX_NOMBRE 64
+
+/* ------------------------------- Léxico ----------------------------------- */
+
+/* Los operadores de un carácter se representan con el propio carácter */
+enum {
+    T_FIN = 256,
+    T_NUM,
+    T_ID,
+    T_INT,
+    T_WHILE,
+    T_IF,
+    T_ELSE,
+    T_IGUAL,        // ==
+    T_DISTINTO,     // !=
+    T_MENOR_IGUAL,  // <=
+    T_MAYOR_IGUAL   // >=
+};
+
+typedef struct {
+    const char *p, *fin;
+    int linea;
+    int tipo;               // token actual
+    int linea_tok;          // línea donde empieza
+    long valor;             // T_NUM
+    char nombre[MAX_NOMBRE];// T_ID
+    int inicio;             // al principio de una línea (para '#')
+    int error;
+} Lexer;
+
+static void error_en(Lexer *lx, int linea, const char *fmt, ...) {
+    if (lx->error)
+        return;             // sólo el primero; los demás suelen ser consecuencia
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "[ERROR] linea %d: ", linea);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    lx->error = 1;
+}
+
+/* Salta espacios, comentarios y líneas de preprocesador */
+static void saltar_blancos(Lexer *lx) {
+    while (lx->p < lx->fin) {
+        char c = *lx->p;
+        if (c == '\n') {
+            lx->linea++;
+            lx->p++;
+            lx->inicio = 1;
+        } else if (isspace((unsigned char)c)) {
+            lx->p++;
+        } else if (c == '#' && lx->inicio) {
+            while (lx->p < lx->fin && *lx->p != '\n')
+                lx->p++;
+        } else if (c == '/' && lx->p + 1 < lx->fin && lx->p[1] == '/') {
+            while (lx->p < lx->fin && *lx->p != '\n')
+                lx->p++;
+        } else if (c == '/' && lx->p + 1 < lx->fin && lx->p[1] == '*') {
+            int linea = lx->linea;
+            lx->p += 2;
+            while (lx->p + 1 < lx->fin && !(lx->p[0] == '*' && lx->p[1] == '/')) {
+                if (*lx->p == '\n')
+                    lx->linea++;
+                lx->p++;
+            }
+            if (lx->p + 1 >= lx->fin) {
+                error_en(lx, linea, "comentario sin cerrar");
+                lx->p = lx->fin;
+                return;
+            }
+            lx->p += 2;
+            lx->inicio = 0;
+        } else {
+            return;
+        }
+    }
+}
+
+static void siguiente(Lexer *lx) {
+    saltar_blancos(lx);
+    lx->linea_tok = lx->linea;
+    lx->inicio = 0;
+    if (lx->error || lx->p >= lx->fin) {
+        lx->tipo = T_FIN;
+        return;
+    }
+
+    const char *s = lx->p;
+    char c = *s;
+
+    if (isdigit((unsigned char)c)) {
+        char *finnum;
+        int base = 10;
+        if (c == '0' && s + 1 < lx->fin && (s[1] == 'x' || s[1] == 'X'))
+            base = 16;
+        // copia acotada: la fuente no termina en '\0'
+        char buf[32];
+        size_t n = 0;
+        while (s + n < lx->fin && n < sizeof(buf) - 1 && isalnum((unsigned char)s[n]))
+            n++;
+        memcpy(buf, s, n);
+        buf[n] = '\0';
+        lx->valor = strtol(base == 16 ? buf + 2 : buf, &finnum, base);
+        if (*finnum != '\0' || (base == 16 && n == 2)) {
+            error_en(lx, lx->linea, "número mal formado '%s'", buf);
+            lx->tipo = T_FIN;
+            return;
+        }
+        lx->p += n;
+        lx->tipo = T_NUM;
+        return;
+    }
+
+    if (isalpha((unsigned char)c) || c == '_') {
+        size_t n = 0;
+        while (s + n < lx->fin && (isalnum((unsigned char)s[n]) || s[n] == '_'))
+            n++;
+        if (n >= MAX_NOMBRE) {
+            error_en(lx, lx->linea, "identificador demasiado largo");
+            lx->tipo = T_FIN;
+            return;
+        }
+        memcpy(lx->nombre, s, n);
+        lx->nombre[n] = '\0';
+        lx->p += n;
+        if (strcmp(lx->nombre, "int") == 0)        lx->tipo = T_INT;
+        else if (strcmp(lx->nombre, "while") == 0) lx->tipo = T_WHILE;
+        else if (strcmp(lx->nombre, "if") == 0)    lx->tipo = T_IF;
+        else if (strcmp(lx->nombre, "else") == 0)  lx->tipo = T_ELSE;
+        else                                       lx->tipo = T_ID;
+        return;
+    }
+
+    char d = s + 1 < lx->fin ? s[1] : '\0';
+    lx->p++;
+    if (d == '=') {
+        int doble = c == '=' ? T_IGUAL : c == '!' ? T_DISTINTO :
+                    c == '<' ? T_MENOR_IGUAL : c == '>' ? T_MAYOR_IGUAL : 0;
+        if (doble) {
+            lx->p++;
+            lx->tipo = doble;
+            return;
+        }
+    }
+    if (strchr("+-*()=<>{};,", c)) {
+        lx->tipo = c;
+        return;
+    }
+    error_en(lx, lx->linea, "carácter inesperado '%c'", c);
+    lx->tipo = T_FIN;
+}
+
+static const char *nombre_token(int t) {
+    static const char *const nombres[] = { "fin de archivo", "número", "identificador",
+        "'int'", "'while'", "'if'", "'else'", "'=='", "'!='", "'<='", "'>='" };
+    static const char simples[] = "+-*()=<>{};,";
+    static const char *const comillas[] = { "'+'", "'-'", "'*'", "'('", "')'", "'='",
+        "'<'", "'>'", "'{'", "'}'", "';'", "','" };
+    if (t >= T_FIN)
+        return nombres[t - T_FIN];
+    const char *c = strchr(simples, t);
+    return c ? comillas[c - simples] : "?";
+}
+
+/* -------------------------------- Árbol ----------------------------------- */
+
+typedef enum {
+    N_NUM,          // valor
+    N_VAR,          // valor = índice de la variable
+    N_BIN,          // op, a op b
+    N_NEG,          // -a
+    N_ASIG,         // variable 'valor' = a
+    N_MIENTRAS,     // while (a) b
+    N_SI,           // if (a) b else c
+    N_BLOQUE        // sentencias en a->sig->sig...
+} TipoNodo;
+
+typedef struct Nodo {
+    TipoNodo tipo;
+    int op;
+    int valor;
+    int linea;
+    struct Nodo *a, *b, *c;
+    struct Nodo *sig;       // siguiente sentencia del bloque
+    struct Nodo *todos;     // cadena de todos los nodos (para liberarlos)
+} Nodo;
+
+typedef struct {
+    Lexer lx;
+    Nodo *nodos;
+    char (*vars)[MAX_NOMBRE];
+    int n_vars, cap_vars;
+    int n_usuario;          // las demás las crea el optimizador
+} Parser;
+
+static Nodo *nodo(Parser *ps, TipoNodo tipo, int linea) {
+    Nodo *n = calloc(1, sizeof(Nodo));
+    if (!n) {
+        error_en(&ps->lx, linea, "sin memoria");
+        return NULL;
+    }
+    n->tipo = tipo;
+    n->linea = linea;
+    n->todos = ps->nodos;
+    ps->nodos = n;
+    return n;
+}
+
+static int buscar_var(const Parser *ps, const char *nombre) {
+    for (int i = 0; i < ps->n_vars; i++)
+        if (strcmp(ps->vars[i], nombre) == 0)
+            return i;
+    return -1;
+}
+
+/* Añade una variable; su índice o -1 si no hay memoria */
+static int nueva_var(Parser *ps, const char *nombre, int linea) {
+    if (ps->n_vars == ps->cap_vars) {
+        int cap = ps->cap_vars ? ps->cap_vars * 2 : 16;
+        void *q = realloc(ps->vars, (size_t)cap * sizeof(*ps->vars));
+        if (!q) {
+            error_en(&ps->lx, linea, "sin memoria");
+            return -1;
+        }
+        ps->vars = q;
+        ps->cap_vars = cap;
+    }
+    snprintf(ps->vars[ps->n_vars], MAX_NOMBRE, "%s", nombre);
+    return ps->n_vars++;
+}
+
+static int esperar(Parser *ps, int tipo) {
+    if (ps->lx.tipo != tipo) {
+        error_en(&ps->lx, ps->lx.linea_tok, "se esperaba %s y hay %s",
+                 nombre_token(tipo), nombre_token(ps->lx.tipo));
+        return 0;
+    }
+    siguiente(&ps->lx);
+    return 1;
+}
+
+/* Comprueba (sin consumirlo) que viene un identificador */
+static int esperar_id(Parser *ps) {
+    if (ps->lx.tipo == T_ID)
+        return 1;
+    error_en(&ps->lx, ps->lx.linea_tok, "se esperaba un identificador y hay %s",
+             nombre_token(ps->lx.tipo));
+    return 0;
+}
+
+static Nodo *expresion(Parser *ps);
+
+static Nodo *primario(Parser *ps) {
+    Lexer *lx = &ps->lx;
+    Nodo *n;
+    switch (lx->tipo) {
+    case T_NUM:
+        if (lx->valor > 255)
+            fprintf(stderr, "[WARN] linea %d: la constante %ld no cabe en 8 bits; se usa %ld\n",
+                    lx->linea_tok, lx->valor, lx->valor & 0xFF);
+        if (!(n = nodo(ps, N_NUM, lx->linea_tok)))
+            return NULL;
+        n->valor = (int)(lx->valor & 0xFF);
+        siguiente(lx);
+        return n;
+    case T_ID:
+        if (!(n = nodo(ps, N_VAR, lx->linea_tok)))
+            return NULL;
+        n->valor = buscar_var(ps, lx->nombre);
+        if (n->valor < 0) {
+            error_en(lx, lx->linea_tok, "variable '%s' no declarada", lx->nombre);
+            return NULL;
+        }
+        siguiente(lx);
+        return n;
+    case '(':
+        siguiente(lx);
+        n = expresion(ps);
+        return n && esperar(ps, ')') ? n : NULL;
+    default:
+        error_en(lx, lx->linea_tok, "se esperaba una expresión y hay %s", nombre_token(lx->tipo));
+        return NULL;
+    }
+}
+
+static Nodo *unario(Parser *ps) {
+    int t = ps->lx.tipo, linea = ps->lx.linea_tok;
+    if (t != '-' && t != '+')
+        return primario(ps);
+    siguiente(&ps->lx);
+    Nodo *x = unario(ps);
+    if (!x || t == '+')
+        return x;
+    Nodo *n = nodo(ps, N_NEG, linea);
+    if (n)
+        n->a = x;
+    return n;
+}
+
+/* Un nivel de operadores binarios asociativos por la izquierda */
+static Nodo *binario(Parser *ps, Nodo *(*menor)(Parser *), const int *ops) {
+    Nodo *izq = menor(ps);
+    while (izq) {
+        int t = ps->lx.tipo, linea = ps->lx.linea_tok;
+        const int *o = ops;
+        while (*o && *o != t)
+            o++;
+        if (!*o)
+            break;
+        siguiente(&ps->lx);
+        Nodo *der = menor(ps);
+        Nodo *n = der ? nodo(ps, N_BIN, linea) : NULL;
+        if (!n)
+            return NULL;
+        n->op = t;
+        n->a = izq;
+        n->b = der;
+        izq = n;
+    }
+    return izq;
+}
+
+static Nodo *producto(Parser *ps) {
+    static const int ops[] = { '*', 0 };
+    return binario(ps, unario, ops);
+}
+
+static Nodo *suma(Parser *ps) {
+    static const int ops[] = { '+', '-', 0 };
+    return binario(ps, producto, ops);
+}
+
+static Nodo *relacion(Parser *ps) {
+    static const int ops[] = { '<', '>', T_MENOR_IGUAL, T_MAYOR_IGUAL, 0 };
+    return binario(ps, suma, ops);
+}
+
+static Nodo *expresion(Parser *ps) {
+    static const int ops[] = { T_IGUAL, T_DISTINTO, 0 };
+    return binario(ps, relacion, ops);
+}
+
+/* Condición entre paréntesis de while/if */
+static Nodo *condicion(Parser *ps) {
+    if (!esperar(ps, '('))
+        return NULL;
+    Nodo *c = expresion(ps);
+    return c && esperar(ps, ')') ? c : NULL;
+}
+
+static Nodo *asignacion(Parser *ps, int var, int linea) {
+    Nodo *e = expresion(ps);
+    Nodo *n = e ? nodo(ps, N_ASIG, linea) : NULL;
+    if (n) {
+        n->valor = var;
+        n->a = e;
+    }
+    return n;
+}
+
+static Nodo *sentencia(Parser *ps);
+
+/* Añade las sentencias hasta 'cierre' a la lista de 'bloque' */
+static int sentencias(Parser *ps, Nodo *bloque, int cierre, int globales);
+
+static Nodo *sentencia(Parser *ps) {
+    Lexer *lx = &ps->lx;
+    int linea = lx->linea_tok;
+    Nodo *n;
+
+    switch (lx->tipo) {
+    case T_ID: {
+        int var = buscar_var(ps, lx->nombre);
+        if (var < 0) {
+            error_en(lx, linea, "variable '%s' no declarada", lx->nombre);
+            return NULL;
+        }
+        siguiente(lx);
+        if (!esperar(ps, '='))
+            return NULL;
+        n = asignacion(ps, var, linea);
+        return n && esperar(ps, ';') ? n : NULL;
+    }
+    case T_WHILE:
+        siguiente(lx);
+        if (!(n = nodo(ps, N_MIENTRAS, linea)) || !(n->a = condicion(ps)))
+            return NULL;
+        return (n->b = sentencia(ps)) ? n : NULL;
+    case T_IF:
+        siguiente(lx);
+        if (!(n = nodo(ps, N_SI, linea)) || !(n->a = condicion(ps)) || !(n->b = sentencia(ps)))
+            return NULL;
+        if (lx->tipo == T_ELSE) {
+            siguiente(lx);
+            if (!(n->c = sentencia(ps)))
+                return NULL;
+        }
+        return n;
+    case '{':
+        siguiente(lx);
+        if (!(n = nodo(ps, N_BLOQUE, linea)) || sentencias(ps, n, '}', 0) < 0)
+            return NULL;
+        siguiente(lx);
+        return n;
+    case ';':
+        siguiente(lx);
+        return nodo(ps, N_BLOQUE, linea);   // sentencia vacía
+    case T_INT:
+        error_en(lx, linea, "las declaraciones sólo pueden ir fuera de los bloques");
+        return NULL;
+    default:
+        error_en(lx, linea, "se esperaba una sentencia y hay %s", nombre_token(lx->tipo));
+        return NULL;
+    }
+}
+
+/* int a = expr, b, ...;  Los inicializadores quedan como asignaciones */
+static int declaracion(Parser *ps, Nodo ***cola) {
+    Lexer *lx = &ps->lx;
+    siguiente(lx);
+    for (;;) {
+        int linea = lx->linea_tok;
+        if (!esperar_id(ps))
+            return -1;
+        if (buscar_var(ps, lx->nombre) >= 0) {
+            error_en(lx, linea, "variable '%s' repetida", lx->nombre);
+            return -1;
+        }
+        int var = nueva_var(ps, lx->nombre, linea);
+        if (var < 0)
+            return -1;
+        siguiente(lx);
+        if (lx->tipo == '=') {
+            siguiente(lx);
+            Nodo *n = asignacion(ps, var, linea);
+            if (!n)
+                return -1;
+            **cola = n;
+            *cola = &n->sig;
+        }
+        if (lx->tipo != ',')
+            break;
+        siguiente(lx);
+    }
+    return esperar(ps, ';') ? 0 : -1;
+}
+
+static int sentencias(Parser *ps, Nodo *bloque, int cierre, int globales) {
+    Nodo **cola = &bloque->a;
+    while (ps->lx.tipo != cierre) {
+        if (ps->lx.tipo == T_FIN) {
+            error_en(&ps->lx, ps->lx.linea_tok, "falta %s", nombre_token(cierre));
+            return -1;
+        }
+        if (globales && ps->lx.tipo == T_INT) {
+            if (declaracion(ps, &cola) < 0)
+                return -1;
+            continue;
+        }
+        Nodo *n = sentencia(ps);
+        if (!n)
+            return -1;
+        *cola = n;
+        cola = &n->sig;
+    }
+    return ps->lx.error ? -1 : 0;
+}
+
+/* -------------------------- Código intermedio ------------------------------
+ * Una instrucción de la máquina por entrada, con operandos simbólicos: las
+ * direcciones de variables, constantes y temporales se fijan al escribir.
+ */
+
+typedef enum {
+    IR_LOADI, IR_LOADM, IR_STORE, IR_ADD, IR_SUB, IR_MUL,
+    IR_JMP, IR_JMPZ, IR_CALL, IR_RET, IR_HALT, IR_ETIQUETA,
+    IR_BORRADA      // la quitó el optimizador (ver compactar())
+} IrOp;
+
+typedef enum {
+    ARG_NADA,
+    ARG_INM,        // valor inmediato
+    ARG_VAR,        // variable del programa
+    ARG_CONST,      // celda con una constante (índice en Gen.consts)
+    ARG_TEMP,       // temporal
+    ARG_CMP,        // operando 0 (x) o 1 (y) de la rutina x < y
+    ARG_ETIQ        // etiqueta
+} ArgTipo;
+
+typedef struct {
+    uint8_t op;
+    uint8_t arg;
+    int valor;
+} Instr;
+
+static const char *const ir_nombres[] = {
+    "LOADI", "LOADM", "STORE", "ADD", "SUB", "MUL", "JMP", "JMPZ", "CALL", "RET", "HALT", NULL
+};
+
+typedef struct {
+    Instr *cod;
+    int n, cap;
+    int n_vars, n_usuario;      // del Parser
+    int celda_const[256];       // índice de la celda de cada valor, -1 si no hay
+    int consts[256];            // valor de cada celda, en orden de aparición
+    int n_consts;
+    int temps, max_temps;       // temporales en uso (pila) y máximo
+    int rutina_menor;           // etiqueta de la rutina x < y (-1 si no se usa)
+    const char **etiquetas;     // prefijo de cada etiqueta
+    int n_etiquetas, cap_etiquetas;
+    int error;
+} Gen;
+
+static void emitir(Gen *g, IrOp op, ArgTipo arg, int valor) {
+    if (g->n == g->cap) {
+        int cap = g->cap ? g->cap * 2 : 256;
+        Instr *q = realloc(g->cod, (size_t)cap * sizeof(Instr));
+        if (!q) {
+            g->error = 1;
+            return;
+        }
+        g->cod = q;
+        g->cap = cap;
+    }
+    g->cod[g->n++] = (Instr){ (uint8_t)op, (uint8_t)arg, valor };
+}
+
+static int etiqueta(Gen *g, const char *prefijo) {
+    if (g->n_etiquetas == g->cap_etiquetas) {
+        int cap = g->cap_etiquetas ? g->cap_etiquetas * 2 : 64;
+        const char **q = realloc(g->etiquetas, (size_t)cap * sizeof(*q));
+        if (!q) {
+            g->error = 1;
+            return 0;
+        }
+        g->etiquetas = q;
+        g->cap_etiquetas = cap;
+    }
+    g->etiquetas[g->n_etiquetas] = prefijo;
+    return g->n_etiquetas++;
+}
+
+static void poner(Gen *g, int e) { emitir(g, IR_ETIQUETA, ARG_ETIQ, e); }
+
+static int constante(Gen *g, int v) {
+    if (g->celda_const[v] < 0) {
+        g->celda_const[v] = g->n_consts;
+        g->consts[g->n_consts++] = v;
+    }
+    return g->celda_const[v];
+}
+
+static int temporal(Gen *g) {
+    if (++g->temps > g->max_temps)
+        g->max_temps = g->temps;
+    return g->temps - 1;
+}
+
+static int es_hoja(const Nodo *n) { return n->tipo == N_NUM || n->tipo == N_VAR; }
+
+/* Instrucción 'op' con una hoja como operando de memoria */
+static void emitir_hoja(Gen *g, IrOp op, const Nodo *h) {
+    if (h->tipo == N_VAR)
+        emitir(g, op, ARG_VAR, h->valor);
+    else
+        emitir(g, op, ARG_CONST, constante(g, h->valor));
+}
+
+static void gen_expr(Gen *g, const Nodo *n);
+static void gen_cond(Gen *g, const Nodo *n, int falso);
+
+/* A = a op b (op: + - *) */
+static void gen_aritmetica(Gen *g, int op, const Nodo *a, const Nodo *b) {
+    IrOp iop = op == '+' ? IR_ADD : op == '-' ? IR_SUB : IR_MUL;
+    if (es_hoja(b)) {
+        gen_expr(g, a);
+        emitir_hoja(g, iop, b);
+    } else if (op != '-' && es_hoja(a)) {
+        gen_expr(g, b);
+        emitir_hoja(g, iop, a);
+    } else {
+        int t = temporal(g);
+        gen_expr(g, b);
+        emitir(g, IR_STORE, ARG_TEMP, t);
+        gen_expr(g, a);
+        emitir(g, iop, ARG_TEMP, t);
+        g->temps--;
+    }
+}
+
+/* Z = (a == b); comparar con 0 no necesita restar */
+static void gen_resta(Gen *g, const Nodo *a, const Nodo *b) {
+    if (b->tipo == N_NUM && b->valor == 0)
+        gen_expr(g, a);
+    else
+        gen_aritmetica(g, '-', a, b);
+}
+
+/* A = (x < y): deja x e y en las celdas de la rutina y la llama */
+static void gen_menor(Gen *g, const Nodo *x, const Nodo *y) {
+    if (g->rutina_menor < 0)
+        g->rutina_menor = etiqueta(g, "menor");
+    if (es_hoja(y)) {
+        gen_expr(g, x);
+        emitir(g, IR_STORE, ARG_CMP, 0);
+        gen_expr(g, y);
+        emitir(g, IR_STORE, ARG_CMP, 1);
+    } else {
+        // y puede tener otra comparación: x espera en un temporal
+        int t = temporal(g);
+        gen_expr(g, x);
+        emitir(g, IR_STORE, ARG_TEMP, t);
+        gen_expr(g, y);
+        emitir(g, IR_STORE, ARG_CMP, 1);
+        emitir(g, IR_LOADM, ARG_TEMP, t);
+        emitir(g, IR_STORE, ARG_CMP, 0);
+        g->temps--;
+    }
+    emitir(g, IR_CALL, ARG_ETIQ, g->rutina_menor);
+}
+
+/*
+ * Rutina x < y sin bandera de acarreo: baja los dos operandos de uno en uno;
+ * si y llega a 0 primero (o a la vez) x >= y, si llega x, x < y. Devuelve
+ * 1 o 0 en A (con Z puesta).
+ */
+static void gen_rutina_menor(Gen *g) {
+    int si = etiqueta(g, "menor_si"), no = etiqueta(g, "menor_no");
+    int uno = constante(g, 1);
+    poner(g, g->rutina_menor);
+    emitir(g, IR_LOADM, ARG_CMP, 1);
+    emitir(g, IR_JMPZ, ARG_ETIQ, no);
+    emitir(g, IR_LOADM, ARG_CMP, 0);
+    emitir(g, IR_JMPZ, ARG_ETIQ, si);
+    emitir(g, IR_SUB, ARG_CONST, uno);
+    emitir(g, IR_STORE, ARG_CMP, 0);
+    emitir(g, IR_LOADM, ARG_CMP, 1);
+    emitir(g, IR_SUB, ARG_CONST, uno);
+    emitir(g, IR_STORE, ARG_CMP, 1);
+    emitir(g, IR_JMP, ARG_ETIQ, g->rutina_menor);
+    poner(g, no);
+    emitir(g, IR_LOADI, ARG_INM, 0);
+    emitir(g, IR_RET, ARG_NADA, 0);
+    poner(g, si);
+    emitir(g, IR_LOADI, ARG_INM, 1);
+    emitir(g, IR_RET, ARG_NADA, 0);
+}
+
+static int es_comparacion(int op) {
+    return op == T_IGUAL || op == T_DISTINTO || op == '<' || op == '>' ||
+           op == T_MENOR_IGUAL || op == T_MAYOR_IGUAL;
+}
+
+/* Salta a 'falso' si la condición vale 0; si no, sigue */
+static void gen_cond(Gen *g, const Nodo *n, int falso) {
+    if (n->tipo != N_BIN || !es_comparacion(n->op)) {
+        gen_expr(g, n);
+        emitir(g, IR_JMPZ, ARG_ETIQ, falso);
+        return;
+    }
+    if (n->op == T_DISTINTO) {
+        gen_resta(g, n->a, n->b);
+        emitir(g, IR_JMPZ, ARG_ETIQ, falso);
+        return;
+    }
+
+    switch (n->op) {
+    case '<':
+        gen_menor(g, n->a, n->b);
+        emitir(g, IR_JMPZ, ARG_ETIQ, falso);
+        return;
+    case '>':
+        gen_menor(g, n->b, n->a);
+        emitir(g, IR_JMPZ, ARG_ETIQ, falso);
+        return;
+    case T_MENOR_IGUAL:         // a <= b es !(b < a)
+        gen_menor(g, n->b, n->a);
+        break;
+    case T_MAYOR_IGUAL:         // a >= b es !(a < b)
+        gen_menor(g, n->a, n->b);
+        break;
+    case T_IGUAL:
+        gen_resta(g, n->a, n->b);
+        break;
+    }
+    // salta si Z: cierto cuando A == 0
+    int cierto = etiqueta(g, "cierto");
+    emitir(g, IR_JMPZ, ARG_ETIQ, cierto);
+    emitir(g, IR_JMP, ARG_ETIQ, falso);
+    poner(g, cierto);
+}
+
+/* Deja el valor en A (y Z = A == 0) */
+static void gen_expr(Gen *g, const Nodo *n) {
+    switch (n->tipo) {
+    case N_NUM:
+        emitir(g, IR_LOADI, ARG_INM, n->valor);
+        break;
+    case N_VAR:
+        emitir(g, IR_LOADM, ARG_VAR, n->valor);
+        break;
+    case N_NEG: {
+        int t = temporal(g);
+        gen_expr(g, n->a);
+        emitir(g, IR_STORE, ARG_TEMP, t);
+        emitir(g, IR_LOADI, ARG_INM, 0);
+        emitir(g, IR_SUB, ARG_TEMP, t);
+        g->temps--;
+        break;
+    }
+    case N_BIN:
+        if (es_comparacion(n->op)) {
+            int falso = etiqueta(g, "falso"), fin = etiqueta(g, "fin_cmp");
+            gen_cond(g, n, falso);
+            emitir(g, IR_LOADI, ARG_INM, 1);
+            emitir(g, IR_JMP, ARG_ETIQ, fin);
+            poner(g, falso);
+            emitir(g, IR_LOADI, ARG_INM, 0);
+            poner(g, fin);
+        } else {
+            gen_aritmetica(g, n->op, n->a, n->b);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void gen_sentencia(Gen *g, const Nodo *n) {
+    switch (n->tipo) {
+    case N_ASIG:
+        gen_expr(g, n->a);
+        emitir(g, IR_STORE, ARG_VAR, n->valor);
+        break;
+    case N_MIENTRAS: {
+        int ini = etiqueta(g, "mientras"), fin = etiqueta(g, "fin_mientras");
+        poner(g, ini);
+        gen_cond(g, n->a, fin);
+        gen_sentencia(g, n->b);
+        emitir(g, IR_JMP, ARG_ETIQ, ini);
+        poner(g, fin);
+        break;
+    }
+    case N_SI: {
+        int sino = etiqueta(g, "sino");
+        gen_cond(g, n->a, sino);
+        gen_sentencia(g, n->b);
+        if (n->c) {
+            int fin = etiqueta(g, "fin_si");
+            emitir(g, IR_JMP, ARG_ETIQ, fin);
+            poner(g, sino);
+            gen_sentencia(g, n->c);
+            poner(g, fin);
+        } else {
+            poner(g, sino);
+        }
+        break;
+    }
+    case N_BLOQUE:
+        for (const Nodo *s = n->a; s; s = s->sig)
+            gen_sentencia(g, s);
+        break;
+    default:
+        break;
+    }
+}
+
+static void gen_liberar(Gen *g) {
+    free(g->cod);
+    free(g->etiquetas);
+    g->cod = NULL;
+    g->etiquetas = NULL;
+}
+
+/* Programa entero: prólogo con las constantes, sentencias, HALT y rutinas */
+static int generar(Gen *g, const Parser *ps, const Nodo *programa) {
+    memset(g, 0, sizeof(*g));
+    memset(g->celda_const, -1, sizeof(g->celda_const));
+    g->rutina_menor = -1;
+    g->n_vars = ps->n_vars;
+    g->n_usuario = ps->n_usuario;
+
+    gen_sentencia(g, programa);
+    emitir(g, IR_HALT, ARG_NADA, 0);
+    if (g->rutina_menor >= 0)
+        gen_rutina_menor(g);
+    if (g->error)
+        return -1;
+
+    // las constantes sólo se conocen al final: el prólogo se pone delante
+    int prologo = 2 * g->n_consts;
+    Instr *q = malloc((size_t)(g->n + prologo + 1) * sizeof(Instr));
+    if (!q)
+        return -1;
+    for (int i = 0; i < g->n_consts; i++) {
+        q[2 * i] = (Instr){ IR_LOADI, ARG_INM, g->consts[i] };
+        q[2 * i + 1] = (Instr){ IR_STORE, ARG_CONST, i };
+    }
+    memcpy(q + prologo, g->cod, (size_t)g->n * sizeof(Instr));
+    free(g->cod);
+    g->cod = q;
+    g->n += prologo;
+    g->cap = g->n + 1;
+    return 0;
+}
+
+/* Instrucciones de una expresión suelta (para el informe de invariantes) */
+static int costo_expr(const Nodo *n) {
+    Gen g = { .rutina_menor = -1 };
+    memset(g.celda_const, -1, sizeof(g.celda_const));
+    gen_expr(&g, n);
+    int c = 0;
+    for (int i = 0; i < g.n; i++)
+        c += g.cod[i].op != IR_ETIQUETA;
+    gen_liberar(&g);
+    return c;
+}
+
+/* ----------------------- Invariantes de bucle (-O2) ------------------------
+ * Sobre el árbol: en cada while, las subexpresiones (con alguna variable)
+ * que sólo leen variables que el bucle no asigna pasan a una variable nueva
+ * que se calcula justo antes. Las expresiones no tienen efectos ni pueden
+ * fallar, así que calcularlas aunque el bucle no dé ninguna vuelta (o
+ * aunque estén en un if) no cambia el resultado. Se procesa de fuera hacia
+ * dentro: lo que sale del bucle de fuera ya no se mira en los de dentro.
+ */
+
+static void marcar_asignadas(const Nodo *n, uint8_t *mod) {
+    switch (n->tipo) {
+    case N_ASIG:
+        mod[n->valor] = 1;
+        break;
+    case N_MIENTRAS:
+        marcar_asignadas(n->b, mod);
+        break;
+    case N_SI:
+        marcar_asignadas(n->b, mod);
+        if (n->c)
+            marcar_asignadas(n->c, mod);
+        break;
+    case N_BLOQUE:
+        for (const Nodo *s = n->a; s; s = s->sig)
+            marcar_asignadas(s, mod);
+        break;
+    default:
+        break;
+    }
+}
+
+typedef struct {
+    Parser *ps;
+    const uint8_t *mod;         // variables asignadas en el bucle
+    int n_mod;                  // las posteriores son invariantes ya sacados
+    Nodo **cola;                // asignaciones que van antes del bucle
+    InformeOptimizacion *inf;
+} Sacar;
+
+/* 1 si 'n' no lee variables asignadas en el bucle; cuenta en *lee las que lee */
+static int invariante(const Sacar *sc, const Nodo *n, int *lee) {
+    switch (n->tipo) {
+    case N_NUM:
+        return 1;
+    case N_VAR:
+        (*lee)++;
+        return n->valor >= sc->n_mod || !sc->mod[n->valor];
+    default:
+        return invariante(sc, n->a, lee) && (!n->b || invariante(sc, n->b, lee));
+    }
+}
+
+static void sacar_expr(Sacar *sc, Nodo **pn) {
+    Nodo *n = *pn;
+    if (n->tipo == N_NUM || n->tipo == N_VAR)
+        return;
+    int lee = 0;
+    if (!invariante(sc, n, &lee) || lee == 0) {
+        // sólo constantes: eso lo pliega la pasada de constantes
+        sacar_expr(sc, &n->a);
+        if (n->b)
+            sacar_expr(sc, &n->b);
+        return;
+    }
+
+    char nombre[MAX_NOMBRE];
+    snprintf(nombre, sizeof(nombre), "invariante %d", sc->inf->invariantes);
+    int var = nueva_var(sc->ps, nombre, n->linea);
+    Nodo *asig = var >= 0 ? nodo(sc->ps, N_ASIG, n->linea) : NULL;
+    Nodo *ref = asig ? nodo(sc->ps, N_VAR, n->linea) : NULL;
+    if (!ref)
+        return;
+    asig->valor = ref->valor = var;
+    asig->a = n;
+    *sc->cola = asig;
+    sc->cola = &asig->sig;
+    *pn = ref;
+    sc->inf->invariantes++;
+    sc->inf->por_vuelta += costo_expr(n) - 1;
+}
+
+static void sacar_sent(Sacar *sc, Nodo *n) {
+    switch (n->tipo) {
+    case N_ASIG:
+        sacar_expr(sc, &n->a);
+        break;
+    case N_MIENTRAS:
+        sacar_expr(sc, &n->a);
+        sacar_sent(sc, n->b);
+        break;
+    case N_SI:
+        sacar_expr(sc, &n->a);
+        sacar_sent(sc, n->b);
+        if (n->c)
+            sacar_sent(sc, n->c);
+        break;
+    case N_BLOQUE:
+        for (Nodo *s = n->a; s; s = s->sig)
+            sacar_sent(sc, s);
+        break;
+    default:
+        break;
+    }
+}
+
+static int sacar_invariantes(Parser *ps, Nodo *n, InformeOptimizacion *inf) {
+    switch (n->tipo) {
+    case N_MIENTRAS: {
+        uint8_t *mod = calloc((size_t)ps->n_vars + 1, 1);
+        if (!mod)
+            return -1;
+        marcar_asignadas(n->b, mod);
+        Nodo *antes = NULL;
+        Sacar sc = { ps, mod, ps->n_vars, &antes, inf };
+        sacar_expr(&sc, &n->a);
+        sacar_sent(&sc, n->b);
+        free(mod);
+        if (ps->lx.error)
+            return -1;
+        if (antes) {
+            // el while pasa a ser { invariantes; while }, sin moverse de su lista
+            Nodo *w = nodo(ps, N_MIENTRAS, n->linea);
+            if (!w)
+                return -1;
+            w->a = n->a;
+            w->b = n->b;
+            *sc.cola = w;
+            n->tipo = N_BLOQUE;
+            n->a = antes;
+            n->b = NULL;
+            n = w;
+        }
+        return sacar_invariantes(ps, n->b, inf);
+    }
+    case N_SI:
+        if (sacar_invariantes(ps, n->b, inf) < 0)
+            return -1;
+        return n->c ? sacar_invariantes(ps, n->c, inf) : 0;
+    case N_BLOQUE:
+        for (Nodo *s = n->a; s; s = s->sig)
+            if (sacar_invariantes(ps, s, inf) < 0)
+                return -1;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+/* ------------------------------ Optimizador --------------------------------
+ * Pasadas sobre el código intermedio (-O1). Cada una marca IR_BORRADA lo que
+ * sobra y compactar() lo quita. Se repiten mientras alguna quite algo: lo
+ * que deja una (un LOADM que pasa a LOADI) lo aprovecha la siguiente (el
+ * STORE que lo alimentaba queda muerto).
+ *
+ * Todas las celdas (variables, constantes, temporales y los operandos de
+ * x < y) se numeran seguidas, ver celda(). Se usa que todas las
+ * instrucciones que escriben A ponen Z = (A == 0): quitar una que deja A
+ * igual no cambia Z, y tras un JMPZ tomado A vale 0.
+ */
+
+static int n_celdas(const Gen *g) {
+    return g->n_vars + g->n_consts + g->max_temps + 2;
+}
+
+static int celda(const Gen *g, const Instr *in) {
+    switch (in->arg) {
+    case ARG_VAR:   return in->valor;
+    case ARG_CONST: return g->n_vars + in->valor;
+    case ARG_TEMP:  return g->n_vars + g->n_consts + in->valor;
+    case ARG_CMP:   return g->n_vars + g->n_consts + g->max_temps + in->valor;
+    default:        return -1;
+    }
+}
+
+static int compactar(Gen *g) {
+    int j = 0;
+    for (int i = 0; i < g->n; i++)
+        if (g->cod[i].op != IR_BORRADA)
+            g->cod[j++] = g->cod[i];
+    int quitadas = g->n - j;
+    g->n = j;
+    return quitadas;
+}
+
+/*
+ * Análisis hacia delante de lo que se sabe en cada punto: el valor de A y
+ * de cada celda (-1 si no se sabe) y qué celdas valen lo mismo que A.
+ * Un estado es [alcanzable, A, celda 0, celda 1...] más los bytes de
+ * 'igual'; se guarda uno por etiqueta (lo que llega por todos los caminos).
+ */
+typedef struct {
+    int nc;
+    int *val;               // (nc + 2) por etiqueta
+    uint8_t *igual;         // nc por etiqueta
+    int *s, *t;             // estado actual y uno de paso
+    uint8_t *ig;
+    int cambio;
+} Flujo;
+
+static int flujo_crear(Flujo *f, const Gen *g) {
+    f->nc = n_celdas(g);
+    size_t ne = (size_t)g->n_etiquetas + 2;        // + el estado actual y el de paso
+    f->val = malloc(ne * (size_t)(f->nc + 2) * sizeof(int));
+    f->igual = malloc(ne * (size_t)f->nc + 1);
+    f->s = f->val ? f->val + (ne - 2) * (size_t)(f->nc + 2) : NULL;
+    f->t = f->s ? f->s + f->nc + 2 : NULL;
+    f->ig = f->igual ? f->igual + (ne - 2) * (size_t)f->nc : NULL;
+    return f->val && f->igual ? 0 : -1;
+}
+
+static void flujo_liberar(Flujo *f) {
+    free(f->val);
+    free(f->igual);
+}
+
+static int *val_etq(const Flujo *f, int e) { return f->val + (size_t)e * (size_t)(f->nc + 2); }
+static uint8_t *igual_etq(const Flujo *f, int e) { return f->igual + (size_t)e * (size_t)f->nc; }
+
+/* Junta el estado (s, ig) en la etiqueta e */
+static void juntar(Flujo *f, int e, const int *s, const uint8_t *ig) {
+    int *d = val_etq(f, e);
+    uint8_t *dig = igual_etq(f, e);
+    if (!s[0])
+        return;
+    if (!d[0]) {
+        memcpy(d, s, (size_t)(f->nc + 2) * sizeof(int));
+        memcpy(dig, ig, (size_t)f->nc);
+        f->cambio = 1;
+        return;
+    }
+    for (int i = 1; i < f->nc + 2; i++)
+        if (d[i] != s[i] && d[i] != -1) {
+            d[i] = -1;
+            f->cambio = 1;
+        }
+    for (int i = 0; i < f->nc; i++)
+        if (dig[i] && !ig[i]) {
+            dig[i] = 0;
+            f->cambio = 1;
+        }
+}
+
+static int calcular(int op, int a, int x) {
+    return (op == IR_ADD ? a + x : op == IR_SUB ? a - x : a * x) & 0xFF;
+}
+
+/* Aplica 'in' al estado actual (f->s, f->ig) */
+static void transferir(Flujo *f, const Gen *g, const Instr *in) {
+    int *s = f->s;
+    uint8_t *ig = f->ig;
+    int c = celda(g, in);
+
+    if (in->op == IR_ETIQUETA) {
+        juntar(f, in->valor, s, ig);
+        memcpy(s, val_etq(f, in->valor), (size_t)(f->nc + 2) * sizeof(int));
+        memcpy(ig, igual_etq(f, in->valor), (size_t)f->nc);
+        return;
+    }
+    if (!s[0])
+        return;
+
+    switch (in->op) {
+    case IR_LOADI:
+        s[1] = in->valor;
+        memset(ig, 0, (size_t)f->nc);
+        break;
+    case IR_LOADM:
+        s[1] = s[2 + c];
+        memset(ig, 0, (size_t)f->nc);
+        ig[c] = 1;
+        break;
+    case IR_STORE:
+        s[2 + c] = s[1];
+        ig[c] = 1;
+        break;
+    case IR_ADD: case IR_SUB: case IR_MUL:
+        s[1] = s[1] >= 0 && s[2 + c] >= 0 ? calcular(in->op, s[1], s[2 + c]) : -1;
+        memset(ig, 0, (size_t)f->nc);
+        break;
+    case IR_JMP:
+        juntar(f, in->valor, s, ig);
+        s[0] = 0;
+        break;
+    case IR_JMPZ:
+        if (s[1] != 0) {
+            // la rama tomada sabe que A (y lo que vale lo mismo) es 0
+            memcpy(f->t, s, (size_t)(f->nc + 2) * sizeof(int));
+            f->t[1] = 0;
+            for (int i = 0; i < f->nc; i++)
+                if (ig[i])
+                    f->t[2 + i] = 0;
+            if (s[1] < 0)
+                juntar(f, in->valor, f->t, ig);
+        } else {
+            juntar(f, in->valor, s, ig);
+            s[0] = 0;
+        }
+        break;
+    case IR_CALL: {
+        // la única rutina es x < y: escribe A y sus dos operandos
+        juntar(f, in->valor, s, ig);
+        int cmp = g->n_vars + g->n_consts + g->max_temps;
+        s[1] = s[2 + cmp] = s[3 + cmp] = -1;
+        memset(ig, 0, (size_t)f->nc);
+        break;
+    }
+    case IR_RET:
+    case IR_HALT:
+        s[0] = 0;
+        break;
+    }
+}
+
+/* Estado de entrada: nada se sabe (la memoria puede venir parcheada) */
+static void flujo_inicio(Flujo *f) {
+    f->s[0] = 1;
+    for (int i = 1; i < f->nc + 2; i++)
+        f->s[i] = -1;
+    memset(f->ig, 0, (size_t)f->nc);
+}
+
+/* Itera hasta que los estados de las etiquetas no cambian */
+static void analizar(Flujo *f, const Gen *g) {
+    for (int e = 0; e < g->n_etiquetas; e++)
+        val_etq(f, e)[0] = 0;
+    do {
+        f->cambio = 0;
+        flujo_inicio(f);
+        for (int i = 0; i < g->n; i++)
+            transferir(f, g, &g->cod[i]);
+    } while (f->cambio);
+    flujo_inicio(f);
+}
+
+/* Valor conocido del operando de 'in' en el estado actual, o -1 */
+static int operando(const Flujo *f, const Gen *g, const Instr *in) {
+    int c = celda(g, in);
+    return c >= 0 ? f->s[2 + c] : -1;
+}
+
+/*
+ * Constantes: lo que da siempre el mismo valor pasa a LOADI (o desaparece
+ * si A ya lo tiene), los JMPZ con Z conocida pasan a JMP o desaparecen, las
+ * operaciones neutras (+0, -0, *1) y los STORE de un valor que la celda ya
+ * tiene sobran, y también el código inalcanzable.
+ */
+static int pasada_constantes(Gen *g, Flujo *f) {
+    analizar(f, g);
+    for (int i = 0; i < g->n; i++) {
+        Instr *in = &g->cod[i];
+        Instr orig = *in;
+        int a = f->s[1];
+        if (in->op == IR_ETIQUETA) {
+            transferir(f, g, &orig);
+            continue;
+        }
+        if (!f->s[0]) {
+            in->op = IR_BORRADA;
+            continue;
+        }
+        int x = operando(f, g, in);
+        switch (in->op) {
+        case IR_LOADI:
+            if (a == in->valor)
+                in->op = IR_BORRADA;
+            break;
+        case IR_LOADM:
+            if (x >= 0)
+                *in = a == x ? (Instr){ IR_BORRADA, ARG_NADA, 0 } : (Instr){ IR_LOADI, ARG_INM, x };
+            break;
+        case IR_ADD: case IR_SUB: case IR_MUL: {
+            int r = -1;
+            if (x >= 0 && a >= 0)
+                r = calcular(in->op, a, x);
+            else if (x == 0 && in->op == IR_MUL)
+                r = 0;
+            if ((x == 0 && in->op != IR_MUL) || (x == 1 && in->op == IR_MUL) || (r >= 0 && r == a))
+                in->op = IR_BORRADA;
+            else if (r >= 0)
+                *in = (Instr){ IR_LOADI, ARG_INM, r };
+            break;
+        }
+        case IR_STORE:
+            if (a >= 0 && x == a)
+                in->op = IR_BORRADA;
+            break;
+        case IR_JMPZ:
+            if (a == 0)
+                in->op = IR_JMP;
+            else if (a > 0)
+                in->op = IR_BORRADA;
+            break;
+        }
+        transferir(f, g, &orig);
+    }
+    return compactar(g);
+}
+
+/* Acumulador: LOADM x o STORE x cuando A ya vale lo mismo que x */
+static int pasada_acumulador(Gen *g, Flujo *f) {
+    analizar(f, g);
+    for (int i = 0; i < g->n; i++) {
+        Instr *in = &g->cod[i];
+        Instr orig = *in;
+        if (f->s[0] && (in->op == IR_LOADM || in->op == IR_STORE) && f->ig[celda(g, in)])
+            in->op = IR_BORRADA;
+        transferir(f, g, &orig);
+    }
+    return compactar(g);
+}
+
+/*
+ * Almacenes muertos, hacia atrás: qué celdas (y A) se pueden leer todavía.
+ * Al HALT sólo importan las variables del programa; en CALL y RET se toma
+ * todo como vivo. Sobran los STORE a celdas muertas y las instrucciones
+ * que calculan un A que nadie usa.
+ */
+static int pasada_muertos(Gen *g) {
+    int nc = n_celdas(g), ancho = nc + 1;       // [nc] = A
+    uint8_t *vivo_etq = calloc((size_t)g->n_etiquetas + 1, (size_t)ancho);
+    uint8_t *vivo = malloc((size_t)ancho);
+    uint8_t *borrar = calloc((size_t)g->n + 1, 1);
+    if (!vivo_etq || !vivo || !borrar) {
+        free(vivo_etq);
+        free(vivo);
+        free(borrar);
+        return 0;
+    }
+
+    int cambio;
+    do {
+        cambio = 0;
+        memset(vivo, 0, (size_t)ancho);
+        for (int i = g->n - 1; i >= 0; i--) {
+            const Instr *in = &g->cod[i];
+            int c = celda(g, in);
+            uint8_t *ve = in->arg == ARG_ETIQ ? vivo_etq + (size_t)in->valor * (size_t)ancho : NULL;
+            borrar[i] = 0;
+            switch (in->op) {
+            case IR_HALT:
+                memset(vivo, 0, (size_t)ancho);
+                memset(vivo, 1, (size_t)g->n_usuario);
+                break;
+            case IR_RET:
+            case IR_CALL:
+                memset(vivo, 1, (size_t)ancho);
+                break;
+            case IR_JMP:
+                memcpy(vivo, ve, (size_t)ancho);
+                break;
+            case IR_JMPZ:
+                for (int k = 0; k < ancho; k++)
+                    vivo[k] |= ve[k];
+                vivo[nc] = 1;
+                break;
+            case IR_ETIQUETA:
+                if (memcmp(ve, vivo, (size_t)ancho) != 0) {
+                    memcpy(ve, vivo, (size_t)ancho);
+                    cambio = 1;
+                }
+                break;
+            case IR_STORE:
+                borrar[i] = !vivo[c];
+                vivo[c] = 0;
+                vivo[nc] = 1;
+                break;
+            case IR_LOADI: case IR_LOADM: case IR_ADD: case IR_SUB: case IR_MUL:
+                borrar[i] = !vivo[nc];
+                vivo[nc] = in->op != IR_LOADI && in->op != IR_LOADM;
+                if (c >= 0)
+                    vivo[c] = 1;
+                break;
+            }
+        }
+    } while (cambio);
+
+    for (int i = 0; i < g->n; i++)
+        if (borrar[i])
+            g->cod[i].op = IR_BORRADA;
+    free(vivo_etq);
+    free(vivo);
+    free(borrar);
+    return compactar(g);
+}
+
+static int contar(const Gen *g) {
+    int c = 0;
+    for (int i = 0; i < g->n; i++)
+        c += g->cod[i].op != IR_ETIQUETA;
+    return c;
+}
+
+static int optimizar(Gen *g, InformeOptimizacion *inf) {
+    Flujo f;
+    if (flujo_crear(&f, g) < 0) {
+        flujo_liberar(&f);
+        return -1;
+    }
+    for (;;) {
+        int c = pasada_constantes(g, &f);
+        int a = pasada_acumulador(g, &f);
+        int m = pasada_muertos(g);
+        inf->ahorradas[PASADA_CONSTANTES] += c;
+        inf->ahorradas[PASADA_ACUMULADOR] += a;
+        inf->ahorradas[PASADA_MUERTOS] += m;
+        inf->vueltas++;
+        if (c + a + m == 0)
+            break;
+    }
+    flujo_liberar(&f);
+    return 0;
+}
+
+const char *compilador_nombre_pasada(int pasada) {
+    static const char *const nombres[COMPILADOR_PASADAS] = {
+        "constantes", "acumulador", "almacenes muertos"
+    };
+    return pasada >= 0 && pasada < COMPILADOR_PASADAS ? nombres[pasada] : "?";
+}
+
+/* ------------------------------- Salida -----------------------------------
+ * Las variables van desde COMPILADOR_DATOS en orden de declaración; detrás
+ * sólo las constantes, temporales y operandos de x < y que el código
+ * todavía usa.
+ */
+
+/* Bytes de la instrucción en el ensamblador (ver ensamblador.c) */
+static int tam_instr(int op, int ancho) {
+    switch (op) {
+    case IR_ETIQUETA: return 0;
+    case IR_HALT:     return 1;
+    case IR_RET:      return ancho == 16 ? 2 : 1;
+    case IR_LOADI:    return 2;
+    default:          return ancho == 16 ? 3 : 2;
+    }
+}
+
+/*
+ * Ubica los datos en 'dir'. -1 si no caben: la última celda tiene que ser
+ * direccionable con el ancho y quedar por debajo de la pila (al final de
+ * la memoria, con la dirección de vuelta de la rutina x < y si se usa).
+ */
+static int ubicar_datos(const Gen *g, int ancho, uint32_t mem_tam, int *dir, int *base) {
+    // cota del código: la suma de los tamaños (sin contar lo que quite la mirilla)
+    int cota = 0;
+    for (int i = 0; i < g->n; i++)
+        cota += tam_instr(g->cod[i].op, ancho);
+    *base = cota <= COMPILADOR_DATOS ? COMPILADOR_DATOS : cota;
+
+    int nc = n_celdas(g);
+    for (int c = 0; c < nc; c++)
+        dir[c] = c < g->n_vars ? *base + c : -1;
+    int sig = *base + g->n_vars;
+    for (int i = 0; i < g->n; i++) {
+        int c = celda(g, &g->cod[i]);
+        if (c >= 0 && dir[c] < 0)
+            dir[c] = 0;                 // se usa; la dirección va en orden de celda
+    }
+    for (int c = g->n_vars; c < nc; c++)
+        if (dir[c] == 0)
+            dir[c] = sig++;
+
+    long pila = g->rutina_menor >= 0 ? (ancho == 16 ? 2 : 1) : 0;
+    long limite = (long)mem_tam - pila;
+    if (ancho != 16 && limite > MEM_SIZE)
+        limite = MEM_SIZE;
+    if (sig > limite) {
+        fprintf(stderr, "[ERROR] El programa no cabe: los datos terminan en MEM[%d] y con "
+                "ancho %d y %u bytes de memoria sólo hay hasta MEM[%ld]%s\n", sig - 1, ancho,
+                mem_tam, limite - 1, ancho != 16 ? " (use --ancho=16)" :
+                mem_tam < MEM_MAX ? " (use --memoria=64K)" : "");
+        return -1;
+    }
+    return 0;
+}
+
+static void escribir_asm(FILE *out, const Gen *g, const Parser *ps, const int *dir, int base) {
+    int nc = n_celdas(g);
+    fprintf(out, "; generado por c_to_asm\n");
+    if (base != COMPILADOR_DATOS)
+        fprintf(out, "; (los datos van detrás del código)\n");
+    int cmp = g->n_vars + g->n_consts + g->max_temps;
+    for (int c = 0; c < nc; c++) {
+        if (dir[c] < 0)
+            continue;
+        if (c < g->n_vars)
+            fprintf(out, "; MEM[%d] = %s\n", dir[c], ps->vars[c]);
+        else if (c < g->n_vars + g->n_consts)
+            fprintf(out, "; MEM[%d] = const %d\n", dir[c], g->consts[c - g->n_vars]);
+        else if (c < cmp)
+            fprintf(out, "; MEM[%d] = temporal %d\n", dir[c], c - g->n_vars - g->n_consts);
+        else
+            fprintf(out, "; MEM[%d] = %c de x < y\n", dir[c], c == cmp ? 'x' : 'y');
+    }
+    fputc('\n', out);
+
+    for (int i = 0; i < g->n; i++) {
+        const Instr *in = &g->cod[i];
+        if (in->op == IR_ETIQUETA) {
+            fprintf(out, "%s_%d:\n", g->etiquetas[in->valor], in->valor);
+            continue;
+        }
+        const char *m = ir_nombres[in->op];
+        int c = celda(g, in);
+        switch (in->arg) {
+        case ARG_NADA:
+            fprintf(out, "        %s\n", m);
+            break;
+        case ARG_INM:
+            fprintf(out, "        %-5s %d\n", m, in->valor);
+            break;
+        case ARG_VAR:
+            fprintf(out, "        %-5s %-8d ; %s\n", m, dir[c], ps->vars[in->valor]);
+            break;
+        case ARG_CONST:
+            fprintf(out, "        %-5s %-8d ; const %d\n", m, dir[c], g->consts[in->valor]);
+            break;
+        case ARG_TEMP:
+            fprintf(out, "        %-5s %-8d ; temporal %d\n", m, dir[c], in->valor);
+            break;
+        case ARG_CMP:
+            fprintf(out, "        %-5s %-8d ; %c de x < y\n", m, dir[c], in->valor ? 'y' : 'x');
+            break;
+        case ARG_ETIQ:
+            fprintf(out, "        %-5s %s_%d\n", m, g->etiquetas[in->valor], in->valor);
+            break;
+        }
+    }
+}
+
+int compilador_traducir(const char *fuente, size_t len, int nivel, int ancho, uint32_t mem_tam,
+                        char **asm_out, size_t *asm_len, InformeOptimizacion *inf) {
+    *asm_out = NULL;
+    *asm_len = 0;
+
+    InformeOptimizacion propio;
+    if (!inf)
+        inf = &propio;
+    memset(inf, 0, sizeof(*inf));
+
+    Parser ps = { .lx = { .p = fuente, .fin = fuente + len, .linea = 1, .inicio = 1 } };
+    Gen g = { .cod = NULL };
+    int *dir = NULL;
+    int r = -1;
+
+    siguiente(&ps.lx);
+    Nodo *programa = nodo(&ps, N_BLOQUE, 1);
+    if (!programa || sentencias(&ps, programa, T_FIN, 1) < 0)
+        goto fin;
+    ps.n_usuario = ps.n_vars;
+
+    if (nivel >= 2 && sacar_invariantes(&ps, programa, inf) < 0)
+        goto fin;
+    if (generar(&g, &ps, programa) < 0) {
+        fprintf(stderr, "[ERROR] Sin memoria generando código\n");
+        goto fin;
+    }
+    inf->instrucciones_sin = contar(&g);
+    if (nivel >= 1 && optimizar(&g, inf) < 0) {
+        fprintf(stderr, "[ERROR] Sin memoria optimizando\n");
+        goto fin;
+    }
+    inf->instrucciones = contar(&g);
+
+    dir = malloc((size_t)n_celdas(&g) * sizeof(int));
+    int base;
+    if (!dir || ubicar_datos(&g, ancho, mem_tam, dir, &base) < 0)
+        goto fin;
+    FILE *out = open_memstream(asm_out, asm_len);
+    if (!out)
+        goto fin;
+    escribir_asm(out, &g, &ps, dir, base);
+    if (fclose(out) != 0) {
+        free(*asm_out);
+        *asm_out = NULL;
+        *asm_len = 0;
+        goto fin;
+    }
+    r = 0;
+
+fin:
+    while (ps.nodos) {
+        Nodo *n = ps.nodos;
+        ps.nodos = n->todos;
+        free(n);
+    }
+    free(ps.vars);
+    free(dir);
+    gen_liberar(&g);
+    return r;
+}
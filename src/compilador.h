@@ -0,0 +1,75 @@
+#ifndef COMPILADOR_H
+#define COMPILADOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Compilador de un subconjunto de C a ASM con etiquetas, como biblioteca
+ * (lo usan el CLI c_to_asm y libcomputadora).
+ *
+ * Lenguaje (el de ejemplos/factorial.c):
+ *   - variables globales 'int' con o sin inicializador (int a = 1, b;)
+ *   - asignación (x = expr;), bloques { }, while (c) ..., if (c) ... else ...
+ *   - expresiones con + - * y menos unario, paréntesis, constantes
+ *     decimales o 0xHEX y comparaciones == != < > <= >=
+ *   - comentarios // y / * * /; las líneas '#' se ignoran
+ *
+ * Los valores son de 8 bits sin signo (como el acumulador). Las variables
+ * se ubican solas a partir de COMPILADOR_DATOS (o detrás del código si no
+ * cabe antes), en orden de declaración; detrás van las constantes que usan
+ * las operaciones y los temporales. El ASM lleva el mapa en comentarios.
+ * Los datos tienen que ser direccionables con el ancho de destino (con
+ * ancho 8, MEM[0..255]) y quedar por debajo de la pila, al final de la
+ * memoria; si no, la traducción falla con "[ERROR] ... no cabe".
+ *
+ * La máquina sólo tiene la bandera Z: == y != restan y miran Z; < > <= >=
+ * llaman a una rutina que baja los dos operandos de uno en uno hasta que uno
+ * llega a 0 (a lo sumo 255 vueltas).
+ *
+ * Niveles de optimización:
+ *   0  el código tal cual sale del árbol
+ *   1  pasadas sobre el código intermedio, repetidas mientras quiten algo:
+ *      constantes (plegado y propagación, también de saltos y código
+ *      inalcanzable), acumulador (qué celdas valen lo mismo que A: sobran
+ *      los LOADM y STORE que no cambian nada) y almacenes muertos (STORE a
+ *      celdas que no se vuelven a leer y cálculos de A que nadie usa)
+ *   2  además saca de los bucles las expresiones que no cambian dentro de
+ *      ellos, a variables nuevas que se calculan una vez antes del bucle
+ * Al terminar las variables del programa tienen los mismos valores en
+ * cualquier nivel; A, los temporales y las celdas auxiliares no.
+ */
+
+#define COMPILADOR_DATOS 100    // primera dirección de las variables
+#define COMPILADOR_NIVEL_DEFECTO 1
+
+/* Pasadas del optimizador, en el orden en que se aplican */
+enum {
+    PASADA_CONSTANTES,
+    PASADA_ACUMULADOR,
+    PASADA_MUERTOS,
+    COMPILADOR_PASADAS
+};
+
+typedef struct {
+    int instrucciones_sin;      // al entrar a las pasadas
+    int instrucciones;          // al final
+    int ahorradas[COMPILADOR_PASADAS];
+    int vueltas;                // veces que se repitieron las pasadas
+    int invariantes;            // expresiones sacadas de bucles (-O2)
+    int por_vuelta;             // instrucciones que eso quita de cada vuelta (a lo sumo)
+} InformeOptimizacion;
+
+/*
+ * Compila los 'len' bytes de 'fuente' con el nivel 'nivel' (0..2) para
+ * ensamblar con ancho 'ancho' (8 o 16) y correr en 'mem_tam' bytes, y deja
+ * el ASM en *asm_out (malloc, terminado en '\0') y su largo en *asm_len. 0
+ * si todo bien; -1 con el error en stderr ("linea N: ..." o "no cabe").
+ * 'inf' puede ser NULL.
+ */
+int compilador_traducir(const char *fuente, size_t len, int nivel, int ancho, uint32_t mem_tam,
+                        char **asm_out, size_t *asm_len, InformeOptimizacion *inf);
+
+const char *compilador_nombre_pasada(int pasada);
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * computadora.c - pipeline en proceso de libcomputadora (ver computadora.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "computadora.h"
+#include "imagen.h"
+
+int computadora_leer_archivo(const char *path, char **datos, size_t *len) {
+    *datos = NULL;
+    *len = 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+
+    size_t cap = 4096, n = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        n += fread(buf + n, 1, cap - n - 1, f);
+        if (n < cap - 1)
+            break;
+        char *q = realloc(buf, cap * 2);
+        if (!q) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        buf = q;
+        cap *= 2;
+    }
+    int error = !buf || ferror(f);
+    fclose(f);
+    if (error) {
+        fprintf(stderr, "[ERROR] No se pudo leer %s\n", path);
+        free(buf);
+        return -1;
+    }
+
+    buf[n] = '\0';
+    *datos = buf;
+    *len = n;
+    return 0;
+}
+
+int computadora_construir(const char *fuente, size_t len, int ancho, uint32_t mem_tam,
+                          Programa *p, EstadisticasEnsamblado *est) {
+    char *asm_txt;
+    size_t asm_len;
+    if (compilador_traducir(fuente, len, COMPILADOR_NIVEL_DEFECTO, ancho, mem_tam, &asm_txt,
+                            &asm_len, NULL) < 0) {
+        fprintf(stderr, "[ERROR] No se pudo traducir el programa C\n");
+        return -1;
+    }
+    int r = ensamblador_buffer(asm_txt, asm_len, ancho, p, est);
+    free(asm_txt);
+    return r;
+}
+
+int computadora_cargar(Memoria *mem, const Programa *p) {
+    if (p->carga >= mem->tam || p->entrada >= mem->tam) {
+        fprintf(stderr, "[ERROR] Dirección de carga/entrada fuera de memoria\n");
+        return -1;
+    }
+    uint32_t n = p->tam;
+    if (n > mem->tam - p->carga) {
+        fprintf(stderr, "[WARN] El programa no cabe en memoria, se trunca\n");
+        n = mem->tam - p->carga;
+    }
+    if (memoria_copiar(mem, p->carga, p->codigo, n) < 0) {
+        fprintf(stderr, "[ERROR] Sin memoria para el programa\n");
+        return -1;
+    }
+    return (int)n;
+}
+
+int computadora_ejecutar(const Programa *p, uint32_t mem_tam, MotorCPU motor,
+                         CPU *cpu, Memoria *mem) {
+    if (memoria_init_tam(mem, mem_tam) < 0) {
+        fprintf(stderr, "[ERROR] No se pudo crear una memoria de %u bytes\n", mem_tam);
+        return -1;
+    }
+    if (computadora_cargar(mem, p) < 0) {
+        memoria_liberar(mem);
+        return -1;
+    }
+
+    cpu_init(cpu, mem);
+    cpu->motor = motor;
+    cpu->PC = p->entrada;
+    cpu_ejecutar(cpu);
+    return 0;
+}
+
+/*
+ * Formato .mem de texto: cada línea contiene
+ *   - un valor binario (ej. 00101011)
+ *   - o un número decimal
+ *   - o un hexadecimal (0x20)
+ * y se guarda byte a byte desde la dirección 0. Las líneas se cortan cada
+ * 255 caracteres, como con fgets.
+ */
+static int cargar_texto(Memoria *m, const uint8_t *datos, size_t len) {
+    int i = 0;                       // índice de memoria a llenar
+    char line[256];                  // buffer para cada línea del archivo
+    size_t pos_datos = 0;
+
+    // Bucle principal para leer líneas mientras haya espacio en la memoria
+    while ((uint32_t)i < m->tam && pos_datos < len) {
+        size_t n = 0;
+        while (pos_datos < len && n < sizeof(line) - 1) {
+            char ch = (char)datos[pos_datos++];
+            line[n++] = ch;
+            if (ch == '\n')
+                break;
+        }
+        line[n] = '\0';
+
+        // Apunta a p donde inicia la línea (para poder mover el cursor)
+        char *p = line;
+
+        // Quitar espacios en blanco al principio (indentación, tabs, etc.)
+        while (*p && isspace((unsigned char)*p)) p++;
+
+        // Saltar líneas vacías o comentarios que inician con ';'
+        if (*p == ';' || *p == '\0' || *p == '\n' || *p == '\r')
+            continue;
+
+        // Quitar espacios en blanco del final de la línea
+        char *end = p + strlen(p) - 1;
+        while (end >= p && isspace((unsigned char)*end)) {
+            *end = '\0';
+            --end;
+        }
+
+        // Si después de recortar queda vacía, saltar
+        if (strlen(p) == 0)
+            continue;
+
+        // Detectar si la línea contiene solamente ceros y unos (binario)
+        int only01 = 1;
+        for (size_t k = 0; k < strlen(p); ++k) {
+            char ch = p[k];
+
+            // Ignorar espacios dentro del binario
+            if (ch == ' ' || ch == '\t') continue;
+
+            // Si encuentra algo que no sea 0 o 1 → no es binario
+            if (ch != '0' && ch != '1') {
+                only01 = 0;
+                break;
+            }
+        }
+
+        unsigned val = 0; // valor numérico final (sólo cuenta el byte bajo)
+
+        if (only01) {
+            // Si es una línea de puro 0/1, la interpretamos como binario
+            char tmp[64];
+            int pos = 0;
+
+            // Copiar solamente los dígitos 0 o 1 a tmp
+            for (size_t k = 0; k < strlen(p) && pos < (int)sizeof(tmp)-1; ++k) {
+                if (p[k] == '0' || p[k] == '1')
+                    tmp[pos++] = p[k];
+            }
+            tmp[pos] = '\0';
+
+            // Convertir la cadena binaria a número entero (val)
+            val = 0;
+            for (int k = 0; tmp[k]; ++k) {
+                val = (val << 1) + (unsigned)(tmp[k] - '0');   // shift left y agregar bit
+            }
+
+        } else {
+            /*
+             * Si no es binario, puede ser:
+             *   - un decimal (ej. 42)
+             *   - un hexadecimal (ej. 0x1F)
+             */
+            if (strlen(p) > 2 && p[0]=='0' && (p[1]=='x' || p[1]=='X')) {
+                // Interpretar como hexadecimal
+                val = (unsigned)strtol(p, NULL, 16);
+            } else {
+                // Interpretar como decimal
+                val = (unsigned)atoi(p);
+            }
+        }
+
+        // Guardar el valor dentro de la memoria como un byte (0–255)
+        memoria_escribir(m, (uint32_t)i++, (uint8_t)(val & 0xFF));
+    }
+
+    return i; /* bytes cargados */
+}
+
+int computadora_cargar_imagen(Memoria *mem, const uint8_t *datos, size_t len,
+                              uint16_t *entrada) {
+    if (len >= 4 && memcmp(datos, IMAGEN_MAGIA, 4) == 0)
+        return imagen_cargar_buffer(mem, datos, len, "imagen", entrada);
+    *entrada = 0;
+    return cargar_texto(mem, datos, len);
+}
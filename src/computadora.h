@@ -0,0 +1,57 @@
+#ifndef COMPUTADORA_H
+#define COMPUTADORA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compilador.h"
+#include "ensamblador.h"
+#include "cpu.h"
+#include "memoria.h"
+
+/*
+ * libcomputadora: el pipeline C -> ASM -> programa -> ejecución dentro del
+ * mismo proceso, pasando búferes en memoria (sin archivos temporales ni
+ * procesos hijos).
+ *
+ *   compilador_traducir()        C -> texto ASM          (compilador.h)
+ *   ensamblador_buffer()         texto ASM -> Programa   (ensamblador.h)
+ *   computadora_ejecutar()       Programa -> CPU y memoria tras HALT
+ *   computadora_cargar_imagen()  .img o .mem -> memoria
+ *
+ * Los CLI (c_to_asm, assembler, main, cpu_simulator) son envoltorios finos
+ * sobre estas funciones. Se compila como build/libcomputadora.a y .so
+ * (make lib).
+ */
+
+/* Lee el archivo 'path' entero en *datos (malloc, terminado en '\0'). 0 si todo bien */
+int computadora_leer_archivo(const char *path, char **datos, size_t *len);
+
+/* C -> Programa sin pasar por disco (ancho 8 o 16, como en el ensamblador,
+   para correr en 'mem_tam' bytes; optimización COMPILADOR_NIVEL_DEFECTO) */
+int computadora_construir(const char *fuente, size_t len, int ancho, uint32_t mem_tam,
+                          Programa *p, EstadisticasEnsamblado *est);
+
+/*
+ * Copia 'p' a 'mem' (ya inicializada) a partir de su dirección de carga.
+ * Devuelve los bytes cargados (se trunca con aviso si no cabe) o -1.
+ */
+int computadora_cargar(Memoria *mem, const Programa *p);
+
+/*
+ * Carga en 'mem' (ya inicializada) un programa ya ejecutable: imagen binaria
+ * (imagen.h) si empieza con su magia, o si no el .mem de texto de siempre
+ * (un byte por línea en binario, decimal o 0x hexadecimal, ';' comenta)
+ * desde la dirección 0 y con entrada 0. Devuelve los bytes cargados o -1.
+ */
+int computadora_cargar_imagen(Memoria *mem, const uint8_t *datos, size_t len,
+                              uint16_t *entrada);
+
+/*
+ * Crea una memoria de 'mem_tam' bytes, carga 'p', prepara 'cpu' con el
+ * motor pedido y la ejecuta hasta HALT. Al volver el estado queda en 'cpu'
+ * y 'mem' (liberarla con memoria_liberar). 0 si todo bien.
+ */
+int computadora_ejecutar(const Programa *p, uint32_t mem_tam, MotorCPU motor,
+                         CPU *cpu, Memoria *mem);
+
+#endif
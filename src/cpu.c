@@ -1,6 +1,5 @@
 /*
  * Archivo: cpu.c
-<<<<<<< HEAD
  * Implementación del simulador de CPU para el sistema ensamblador.
  *
  * Instrucciones soportadas:
@@ -18,329 +17,1410 @@
  * 12  RET
  * 13  JMPZ dir
  * 14  MUL dir
+ *
+ * Forma ancha (opcode | OP_ANCHO): STORE, ADD, SUB, LOADM, JMP, CALL, JMPZ y
+ * MUL llevan la dirección en dos bytes (little endian); CALL/RET anchos
+ * guardan la dirección de retorno en dos bytes de pila.
  */
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include "cpu.h"
 #include "memoria.h"
 #include "alu.h"
-
-/* --- Métricas/telemetría --- */
-static unsigned long instr_count = 0;
-static unsigned long mem_accesses = 0;
-static unsigned long jumps_taken = 0;
-static unsigned long jumps_not_taken = 0;
-static unsigned long cycles = 0;
-static int sp_min_tracked = 0;
+#include "jit.h"
+#include "perfil.h"
+#include "tiempo.h"
+#include "traza.h"
+#include "dispositivo.h"
 
 /* Estructura CPU inicializa SP y demás */
 void cpu_init(CPU *cpu, Memoria *mem) {
     cpu->A = 0;
     cpu->PC = 0;
-    cpu->SP = MEM_SIZE - 1;   // Pila al final de la memoria
+    cpu->SP = mem->tam - 1;   // Pila al final de la memoria
     cpu->Z = 0;
     cpu->halted = 1;
     cpu->halted = 0;
     cpu->mem = mem;
+    cpu->motor = MOTOR_SWITCH;
+    cpu->silencioso = 0;
+    cpu->limite = 0;
+    cpu->perfil = NULL;
+    cpu->tiempo = NULL;
+    cpu->traza = NULL;
+    cpu->dispositivo = NULL;
+    cpu->jit = NULL;
+    cpu->verbosidad = DIAG_TODO;
+    diagnostico_reiniciar(&cpu->diag);
+    interrupciones_reiniciar(&cpu->irq);
 
-    /* Inicializar métricas por ejecución */
-    instr_count = 0;
-    mem_accesses = 0;
-    jumps_taken = 0;
-    jumps_not_taken = 0;
-    cycles = 0;
-    sp_min_tracked = cpu->SP;
+    /* Métricas por ejecución: propias de esta CPU, no compartidas */
+    memset(&cpu->met, 0, sizeof(cpu->met));
+    cpu->sp_min = cpu->SP;
 }
 
 // ==================== FUNCIONES AUXILIARES ====================
 
-static uint8_t fetch(CPU *cpu) {
-    if (cpu->PC >= MEM_SIZE) {
-        printf("[ERROR] Lectura fuera de memoria en PC=%d\n", cpu->PC);
+/*
+ * El núcleo de referencia se genera varias veces según 'modo', que en cada
+ * llamada es una constante:
+ *   MODO_PAGINADA  pasa por la tabla de páginas (memoria_leer/escribir) en
+ *                  lugar de acceder directo a data[] (sólo página 0)
+ *   MODO_LIMITE    se detiene al llegar a cpu->limite instrucciones
+ *   MODO_PERFIL    anota cada instrucción, acceso y salto en cpu->perfil
+ *   MODO_TIEMPO    cuenta ciclos con las latencias y cachés de cpu->tiempo
+ *   MODO_TRAZA     deja un registro por instrucción en cpu->traza
+ *   MODO_DISPOSITIVO  los STORE a DISPOSITIVO_PUERTO van además a
+ *                  cpu->dispositivo (si lo hay)
+ * El compilador elimina las ramas de los bits apagados, así que el caso
+ * normal no paga nada por la memoria paginada, el perfilador, el modelo
+ * de tiempo, la traza ni el dispositivo.
+ */
+#define CPU_EN_LINEA static inline __attribute__((always_inline))
+
+#define MODO_PAGINADA 1
+#define MODO_LIMITE   2
+#define MODO_PERFIL   4
+#define MODO_TIEMPO   8
+#define MODO_TRAZA    16
+#define MODO_DISPOSITIVO 32
+
+/*
+ * halted = CPU_PAUSA: la instrucción cambió la cola de eventos o dejó lista
+ * una interrupción; el núcleo vuelve a cpu_ejecutar, que la atiende y sigue
+ * (fuera de cpu_ejecutar halted nunca vale CPU_PAUSA).
+ */
+#define CPU_PAUSA 2
+
+/* Sin printf en el núcleo: el texto se arma al informar (diagnostico.h) */
+CPU_EN_LINEA void diagnosticar(CPU *cpu, TipoDiagnostico tipo, uint8_t opcode, uint32_t valor) {
+    diagnostico_anotar(&cpu->diag, tipo, opcode, valor, cpu->met.instrucciones);
+}
+
+CPU_EN_LINEA uint32_t tam_memoria(const CPU *cpu, int modo) {
+    return (modo & MODO_PAGINADA) ? cpu->mem->tam : MEM_SIZE;
+}
+
+CPU_EN_LINEA uint8_t leer(CPU *cpu, uint32_t dir, int modo) {
+    if (modo & MODO_PERFIL)
+        perfil_lectura(cpu->perfil, dir);
+    if (modo & MODO_TIEMPO)
+        cpu->met.ciclos += tiempo_dato(cpu->tiempo, dir);
+    return (modo & MODO_PAGINADA) ? memoria_leer(cpu->mem, dir) : cpu->mem->data[dir];
+}
+
+CPU_EN_LINEA void escribir(CPU *cpu, uint32_t dir, uint8_t v, int modo) {
+    if (modo & MODO_PERFIL)
+        perfil_escritura(cpu->perfil, dir);
+    if (modo & MODO_TIEMPO)
+        cpu->met.ciclos += tiempo_dato(cpu->tiempo, dir);
+    if (modo & MODO_TRAZA)
+        traza_escritura(cpu->traza, dir, v);
+    if (modo & MODO_PAGINADA)
+        memoria_escribir(cpu->mem, dir, v);
+    else
+        cpu->mem->data[dir] = v;
+}
+
+/* Resultado de un salto: métricas y, si se perfila, contadores por PC */
+CPU_EN_LINEA void anotar_salto(CPU *cpu, int tomado, uint32_t destino, int modo) {
+    if (tomado)
+        cpu->met.saltos_tomados++;
+    else
+        cpu->met.saltos_no_tomados++;
+    if (modo & MODO_PERFIL)
+        perfil_salto(cpu->perfil, tomado, destino);
+}
+
+CPU_EN_LINEA uint8_t fetch_gen(CPU *cpu, int modo) {
+    if (cpu->PC >= tam_memoria(cpu, modo)) {
+        diagnosticar(cpu, DIAG_LECTURA_FUERA, 0, cpu->PC);
         cpu->halted = 1;
         return 0;
     }
-    return cpu->mem->data[cpu->PC++];
+    /* Las lecturas de código no son accesos a datos (perfil) y van por L1I */
+    if (modo & MODO_TIEMPO)
+        cpu->met.ciclos += tiempo_codigo(cpu->tiempo, cpu->PC);
+    return leer(cpu, cpu->PC++, modo & ~(MODO_PERFIL | MODO_TIEMPO));
 }
 
-static void push(CPU *cpu, uint8_t val) {
+/* Operando de dirección: un byte, o dos (little endian) en la forma ancha */
+CPU_EN_LINEA uint32_t fetch_dir(CPU *cpu, int ancho, int modo) {
+    uint32_t dir = fetch_gen(cpu, modo);
+    if (ancho)
+        dir |= (uint32_t)fetch_gen(cpu, modo) << 8;
+    if (modo & MODO_TRAZA)
+        traza_operando(cpu->traza, dir);
+    return dir;
+}
+
+CPU_EN_LINEA void push(CPU *cpu, uint8_t val, int modo) {
     if (cpu->SP == 0) {
-        printf("[ERROR] Desbordamiento de pila (SP=%d)\n", cpu->SP);
+        diagnosticar(cpu, DIAG_PILA_LLENA, 0, cpu->SP);
         cpu->halted = 1;
         return;
     }
-    cpu->mem->data[cpu->SP--] = val;
-    mem_accesses++; /* escritura en memoria */
-    if (cpu->SP < sp_min_tracked) sp_min_tracked = cpu->SP;
+    escribir(cpu, cpu->SP--, val, modo);
+    cpu->met.accesos_memoria++; /* escritura en memoria */
+    if (cpu->SP < cpu->sp_min) cpu->sp_min = cpu->SP;
 }
 
-static uint8_t pop(CPU *cpu) {
-    if (cpu->SP >= MEM_SIZE - 1) {
-        printf("[ERROR] Pila vacía (SP=%d)\n", cpu->SP);
+CPU_EN_LINEA uint8_t pop(CPU *cpu, int modo) {
+    if (cpu->SP >= tam_memoria(cpu, modo) - 1) {
+        diagnosticar(cpu, DIAG_PILA_VACIA, 0, cpu->SP);
         cpu->halted = 1;
         return 0;
     }
-    uint8_t v = cpu->mem->data[++cpu->SP];
-    mem_accesses++; /* lectura en memoria */
+    uint8_t v = leer(cpu, ++cpu->SP, modo);
+    cpu->met.accesos_memoria++; /* lectura en memoria */
     return v;
 }
 
-// ==================== EJECUCIÓN PRINCIPAL ====================
+CPU_EN_LINEA void pausar(CPU *cpu) {
+    if (!cpu->halted)
+        cpu->halted = CPU_PAUSA;
+}
 
-void cpu_ejecutar(CPU *cpu) {
-    clock_t t0 = clock();
+/* Los motores rápidos sólo corren con la página 0 */
+static uint8_t fetch(CPU *cpu) {
+    return fetch_gen(cpu, 0);
+}
 
-    while (!cpu->halted && cpu->PC < MEM_SIZE) {
-        instr_count++;
-        cycles++; /* contar un ciclo por instrucción (modelo simple) */
+// ==================== NÚCLEO SWITCH (REFERENCIA) ====================
 
-        uint8_t opcode = fetch(cpu);
+/*
+ * Ejecuta una instrucción ya leída (opcode) sobre el estado de la CPU.
+ * Es la semántica de referencia: el núcleo threaded la usa como camino
+ * lento para los casos raros (borde de memoria, errores de pila).
+ */
+CPU_EN_LINEA void ejecutar_instruccion_gen(CPU *cpu, uint8_t opcode, int modo) {
+    switch (opcode) {
+        case 1: // NOP
+            break;
 
-        switch (opcode) {
-            case 1: // NOP
-                break;
+        case 2: case 2 | OP_ANCHO: { // STORE dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                escribir(cpu, addr, cpu->A, modo);
+                cpu->met.accesos_memoria++;
+                if ((modo & MODO_DISPOSITIVO) && addr == DISPOSITIVO_PUERTO && cpu->dispositivo)
+                    dispositivo_escribir(cpu->dispositivo, cpu->A);
+            } else
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+            break;
+        }
 
-            case 2: { // STORE dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    cpu->mem->data[addr] = cpu->A;
-                    mem_accesses++;
-                } else
-                    printf("[WARN] Dirección fuera de rango en STORE %d\n", addr);
-                break;
+        case 3: case 3 | OP_ANCHO: { // ADD dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->met.accesos_memoria++;
+                cpu->A = alu_add(cpu->A, leer(cpu, addr, modo));
+            } else {
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+                cpu->A = alu_add(cpu->A, 0);
             }
+            cpu->Z = (cpu->A == 0);
+            break;
+        }
 
-            case 3: { // ADD dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    mem_accesses++;
-                    cpu->A = alu_add(cpu->A, cpu->mem->data[addr]);
-                } else {
-                    printf("[WARN] Dirección fuera de rango en ADD %d\n", addr);
-                    cpu->A = alu_add(cpu->A, 0);
-                }
-                cpu->Z = (cpu->A == 0);
-                break;
+        case 4: case 4 | OP_ANCHO: { // SUB dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->met.accesos_memoria++;
+                cpu->A = alu_sub(cpu->A, leer(cpu, addr, modo));
+            } else {
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+                cpu->A = alu_sub(cpu->A, 0);
             }
+            cpu->Z = (cpu->A == 0);
+            break;
+        }
 
-            case 4: { // SUB dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    mem_accesses++;
-                    cpu->A = alu_sub(cpu->A, cpu->mem->data[addr]);
-                } else {
-                    printf("[WARN] Dirección fuera de rango en SUB %d\n", addr);
-                    cpu->A = alu_sub(cpu->A, 0);
-                }
-                cpu->Z = (cpu->A == 0);
-                break;
-            }
+        case 5: { // LOADI val
+            uint8_t val = fetch_gen(cpu, modo);
+            if (modo & MODO_TRAZA)
+                traza_operando(cpu->traza, val);
+            cpu->A = val;
+            cpu->Z = (cpu->A == 0);
+            break;
+        }
 
-            case 5: { // LOADI val
-                uint8_t val = fetch(cpu);
-                cpu->A = val;
-                cpu->Z = (cpu->A == 0);
-                break;
-            }
+        case 6: case 6 | OP_ANCHO: { // LOADM dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->A = leer(cpu, addr, modo);
+                cpu->met.accesos_memoria++;
+            } else
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+            cpu->Z = (cpu->A == 0);
+            break;
+        }
 
-            case 6: { // LOADM dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    cpu->A = cpu->mem->data[addr];
-                    mem_accesses++;
-                } else
-                    printf("[WARN] Dirección fuera de rango en LOADM %d\n", addr);
-                cpu->Z = (cpu->A == 0);
-                break;
+        case 7: case 7 | OP_ANCHO: { // JMP dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->PC = addr;
+                anotar_salto(cpu, 1, addr, modo);
+            } else {
+                diagnosticar(cpu, DIAG_SALTO_FUERA, opcode, addr);
+                anotar_salto(cpu, 0, addr, modo);
             }
+            break;
+        }
 
-            case 7: { // JMP dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    cpu->PC = addr;
-                    jumps_taken++;
-                } else {
-                    printf("[WARN] Salto fuera de rango a %d\n", addr);
-                    jumps_not_taken++;
-                }
-                break;
-            }
+        case 8: // HALT
+            cpu->halted = 1;
+            diagnosticar(cpu, DIAG_HALT, opcode, cpu->PC - 1);
+            break;
 
-            case 8: // HALT
-                cpu->halted = 1;
-                printf("[CPU] HALT ejecutado\n");
-                break;
+        case 9: // PUSH
+            push(cpu, cpu->A, modo);
+            break;
 
-            case 9: // PUSH
-                push(cpu, cpu->A);
-                break;
+        case 10: // POP
+            cpu->A = pop(cpu, modo);
+            cpu->Z = (cpu->A == 0);
+            break;
 
-            case 10: // POP
-                cpu->A = pop(cpu);
-                cpu->Z = (cpu->A == 0);
-                break;
+        case 11: case 11 | OP_ANCHO: { // CALL dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                /* Dirección de retorno: un byte, o dos (alto, bajo) en la forma ancha */
+                if (opcode & OP_ANCHO)
+                    push(cpu, (uint8_t)(cpu->PC >> 8), modo);
+                push(cpu, (uint8_t)cpu->PC, modo);
+                cpu->PC = addr;
+                anotar_salto(cpu, 1, addr, modo);
+                if (modo & MODO_PERFIL)
+                    perfil_llamada(cpu->perfil, addr);
+            } else {
+                diagnosticar(cpu, DIAG_CALL_FUERA, opcode, addr);
+                anotar_salto(cpu, 0, addr, modo);
+            }
+            break;
+        }
 
-            case 11: { // CALL dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    /* Guardamos dirección de retorno como byte */
-                    push(cpu, (uint8_t)cpu->PC);
-                    cpu->PC = addr;
-                    jumps_taken++;
-                } else {
-                    printf("[WARN] Dirección de CALL fuera de rango %d\n", addr);
-                    jumps_not_taken++;
-                }
-                break;
+        case 12: case 12 | OP_ANCHO: { // RET
+            uint32_t retAddr = pop(cpu, modo);
+            if (opcode & OP_ANCHO)
+                retAddr |= (uint32_t)pop(cpu, modo) << 8;
+            if (retAddr < tam_memoria(cpu, modo)) {
+                cpu->PC = retAddr;
+                anotar_salto(cpu, 1, retAddr, modo);
+                if (modo & MODO_PERFIL)
+                    perfil_retorno(cpu->perfil);
+            } else {
+                diagnosticar(cpu, DIAG_RET_INVALIDO, opcode, retAddr);
+                anotar_salto(cpu, 0, retAddr, modo);
             }
+            break;
+        }
 
-            case 12: { // RET
-                uint8_t retAddr = pop(cpu);
-                if (retAddr < MEM_SIZE) {
-                    cpu->PC = retAddr;
-                    jumps_taken++;
-                } else {
-                    printf("[WARN] Dirección de RET inválida %d\n", retAddr);
-                    jumps_not_taken++;
-                }
-                break;
+        case 13: case 13 | OP_ANCHO: { // JMPZ dir (salta si Z == 1)
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (cpu->Z && addr < tam_memoria(cpu, modo)) {
+                cpu->PC = addr;
+                anotar_salto(cpu, 1, addr, modo);
+            } else {
+                anotar_salto(cpu, 0, addr, modo);
             }
+            break;
+        }
 
-            case 13: { // JMPZ dir (salta si Z == 1)
-                uint8_t addr = fetch(cpu);
-                if (cpu->Z && addr < MEM_SIZE) {
-                    cpu->PC = addr;
-                    jumps_taken++;
-                } else {
-                    jumps_not_taken++;
-                }
-                break;
+        case 14: case 14 | OP_ANCHO: { // MUL dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->met.accesos_memoria++;
+                cpu->A = alu_mul(cpu->A, leer(cpu, addr, modo));
+            } else {
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+                cpu->A = alu_mul(cpu->A, 0);
             }
+            cpu->Z = (cpu->A == 0);
+            break;
+        }
 
-            case 14: { // MUL dir
-                uint8_t addr = fetch(cpu);
-                if (addr < MEM_SIZE) {
-                    mem_accesses++;
-                    cpu->A = alu_mul(cpu->A, cpu->mem->data[addr]);
-                } else {
-                    printf("[WARN] Dirección fuera de rango en MUL %d\n", addr);
-                    cpu->A = alu_mul(cpu->A, 0);
-                }
-                cpu->Z = (cpu->A == 0);
-                break;
+        case 15: // EI
+            cpu->irq.habilitadas = 1;
+            if (cpu->irq.pendiente)
+                pausar(cpu);
+            break;
+
+        case 16: // DI
+            cpu->irq.habilitadas = 0;
+            break;
+
+        case 17: case 17 | OP_ANCHO: { // RETI: Z y después el PC, con el marco de la entrada
+            uint8_t z = pop(cpu, modo);
+            uint32_t retAddr = pop(cpu, modo);
+            if (cpu->irq.marco_ancho)
+                retAddr |= (uint32_t)pop(cpu, modo) << 8;
+            cpu->Z = (z != 0);
+            if (retAddr < tam_memoria(cpu, modo)) {
+                cpu->PC = retAddr;
+                anotar_salto(cpu, 1, retAddr, modo);
+                if (modo & MODO_PERFIL)
+                    perfil_retorno(cpu->perfil);
+            } else {
+                diagnosticar(cpu, DIAG_RET_INVALIDO, opcode, retAddr);
+                anotar_salto(cpu, 0, retAddr, modo);
             }
+            cpu->irq.habilitadas = 1;
+            if (cpu->irq.pendiente)
+                pausar(cpu);
+            break;
+        }
 
-            default:
-                printf("[ERROR] Opcode desconocido: %d en PC=%d\n", opcode, cpu->PC - 1);
-                cpu->halted = 1;
-                break;
+        case 18: case 18 | OP_ANCHO: { // TIMER dir (periodo de 16 bits en dir, dir+1)
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr + 1 < tam_memoria(cpu, modo)) {
+                uint16_t periodo = leer(cpu, addr, modo);
+                periodo |= (uint16_t)(leer(cpu, addr + 1, modo) << 8);
+                cpu->met.accesos_memoria += 2;
+                interrupciones_temporizador(&cpu->irq, cpu->met.instrucciones, periodo);
+                pausar(cpu);
+            } else
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+            break;
+        }
+
+        case 19: case 19 | OP_ANCHO: { // VECTOR dir
+            uint32_t addr = fetch_dir(cpu, opcode & OP_ANCHO, modo);
+            if (addr < tam_memoria(cpu, modo)) {
+                cpu->irq.vector = addr;
+                cpu->irq.marco_ancho = (opcode & OP_ANCHO) != 0;
+            } else
+                diagnosticar(cpu, DIAG_DIR_FUERA, opcode, addr);
+            break;
         }
+
+        default:
+            diagnosticar(cpu, DIAG_OPCODE, opcode, cpu->PC - 1);
+            cpu->halted = 1;
+            break;
     }
+}
 
-    clock_t t1 = clock();
-    double elapsed = (double)(t1 - t0) / CLOCKS_PER_SEC;
+/* Camino lento de los motores rápidos (memoria de 8 bits) */
+static void ejecutar_instruccion(CPU *cpu, uint8_t opcode) {
+    ejecutar_instruccion_gen(cpu, opcode, MODO_DISPOSITIVO);
+}
 
-    /* Estado final */
-    printf("\n=== CPU Detenida ===\n");
-    printf("A = %d, PC = %d, SP = %d, Z = %d\n", cpu->A, cpu->PC, cpu->SP, cpu->Z);
+CPU_EN_LINEA void ejecutar_switch_gen(CPU *cpu, int modo, unsigned long limite) {
+    /* Con MODO_LIMITE, limite == 0 también significa "sin límite" */
+    unsigned long tope = (modo & MODO_LIMITE) && limite ? limite : ~0UL;
 
-    /* Imprimir métricas */
-    printf("\n--- MÉTRICAS DE EJECUCIÓN (CPU) ---\n");
-    printf("Instrucciones ejecutadas: %lu\n", instr_count);
-    printf("Ciclos (modelo simple): %lu\n", cycles);
-    printf("Accesos a memoria: %lu\n", mem_accesses);
-    printf("Saltos tomados: %lu\n", jumps_taken);
-    printf("Saltos no tomados: %lu\n", jumps_not_taken);
-    if (sp_min_tracked <= MEM_SIZE - 1)
-        printf("Profundidad máxima de pila (bytes usados): %d\n", (MEM_SIZE - 1) - sp_min_tracked);
-    else
-        printf("Profundidad máxima de pila: 0\n");
-    printf("Tiempo de ejecución (CPU): %.6f s\n", elapsed);
-=======
- * Función: Define la unidad central de procesamiento (CPU) del simulador.
- *           Controla el ciclo FETCH-DECODE-EXECUTE, obteniendo instrucciones
- *           de memoria y ejecutándolas mediante la ALU o acceso a memoria.
- * 
- * El proceso de suma se inicia cuando se ejecuta la instrucción:
- *      - `ADD addr` (opcode 0x03) o `ADDI imm` (opcode 0x09),
- *        las cuales llaman a `alu_suma()` definida en `alu.c`.
+    while (!cpu->halted && cpu->PC < tam_memoria(cpu, modo) &&
+           (!(modo & MODO_LIMITE) || cpu->met.instrucciones < tope)) {
+        if ((modo & MODO_TRAZA) && cpu->met.instrucciones >= cpu->traza->proxima_clave)
+            traza_clave(cpu->traza, cpu);
+        cpu->met.instrucciones++;
+
+        uint32_t pc = cpu->PC;
+        uint8_t opcode = fetch_gen(cpu, modo);
+        if (modo & MODO_TIEMPO)
+            cpu->met.ciclos += cpu->tiempo->cfg->latencias[opcode];
+        else
+            cpu->met.ciclos++; /* contar un ciclo por instrucción (modelo simple) */
+        if (modo & MODO_PERFIL)
+            perfil_instruccion(cpu->perfil, pc, opcode);
+        if (modo & MODO_TRAZA)
+            traza_instruccion(cpu->traza, pc, opcode);
+        ejecutar_instruccion_gen(cpu, opcode, modo);
+        if (modo & MODO_TRAZA)
+            traza_fin(cpu->traza, cpu->A, cpu->SP, cpu->Z);
+    }
+}
+
+/*
+ * Una instancia del núcleo por cada combinación de modos. Las que llevan
+ * perfil, tiempo o traza comprueban siempre el límite (que con 0 no corta) y
+ * el puerto del dispositivo (que sin dispositivo no escribe nada): así son
+ * menos instancias y el coste de esas comparaciones se pierde entre el de
+ * los ganchos.
  */
+static void ejecutar_switch(CPU *cpu, unsigned long limite) {
+    int modo = (cpu->mem->tam > MEM_SIZE ? MODO_PAGINADA : 0) |
+               (limite ? MODO_LIMITE : 0) |
+               (cpu->perfil ? MODO_PERFIL : 0) |
+               (cpu->tiempo ? MODO_TIEMPO : 0) |
+               (cpu->traza ? MODO_TRAZA : 0) |
+               (cpu->dispositivo ? MODO_DISPOSITIVO : 0);
+    if (modo & (MODO_PERFIL | MODO_TIEMPO | MODO_TRAZA))
+        modo |= MODO_LIMITE | MODO_DISPOSITIVO;
 
-#include "cpu.h"
-#include "alu.h"
-#include <stdio.h>
+#define CON_GANCHOS (MODO_LIMITE | MODO_DISPOSITIVO)
+#define INSTANCIA(m) case m: ejecutar_switch_gen(cpu, m, limite); break
+#define INSTANCIAS_PAG(m) INSTANCIA(m); INSTANCIA((m) | MODO_PAGINADA)
+    switch (modo) {
+        INSTANCIAS_PAG(0);
+        INSTANCIAS_PAG(MODO_LIMITE);
+        INSTANCIAS_PAG(MODO_DISPOSITIVO);
+        INSTANCIAS_PAG(MODO_LIMITE | MODO_DISPOSITIVO);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_PERFIL);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_TIEMPO);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_PERFIL | MODO_TIEMPO);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_TRAZA);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_TRAZA | MODO_PERFIL);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_TRAZA | MODO_TIEMPO);
+        INSTANCIAS_PAG(CON_GANCHOS | MODO_TRAZA | MODO_PERFIL | MODO_TIEMPO);
+    }
+#undef INSTANCIAS_PAG
+#undef INSTANCIA
+#undef CON_GANCHOS
+}
 
-void cpu_init(CPU *cpu, Memoria *mem) {
-    cpu->A = 0;           // Registro acumulador inicializado a 0
-    cpu->PC = 0;          // Contador de programa en posición 0
-    cpu->running = true;  // La CPU comienza en modo activo
-    cpu->mem = mem;       // Asocia la memoria al CPU
+// ==================== NÚCLEO THREADED ====================
+
+/*
+ * Despacho directo: cada manejador salta al siguiente a través de una tabla
+ * de 256 direcciones (extensión "labels as values" de GCC/Clang). Así cada
+ * opcode tiene su propio salto indirecto, que el predictor aprende por
+ * separado, en lugar del único salto compartido del switch.
+ *
+ * Registros y contadores viven en variables locales durante el bucle y se
+ * vuelcan a la CPU sólo al salir o al pasar por el camino lento.
+ *
+ * La única comprobación de límites por instrucción es "pc < MEM_SIZE - 1":
+ * si se cumple, el opcode y su operando están dentro de memoria. Las
+ * instrucciones en el último byte, los errores de pila y los opcodes
+ * desconocidos se delegan en ejecutar_instruccion() para que los mensajes,
+ * el estado final y las métricas sean idénticos al núcleo switch.
+ *
+ * Compilar con -DCPU_SIN_GOTO_COMPUTADO fuerza la versión portable (switch).
+ */
+#if defined(__GNUC__) && !defined(CPU_SIN_GOTO_COMPUTADO)
+#define CPU_GOTO_COMPUTADO 1
+#endif
+
+static void ejecutar_threaded(CPU *cpu) {
+    uint8_t *data = cpu->mem->data;
+    uint16_t pc = cpu->PC;
+    uint16_t sp = cpu->SP;
+    uint8_t a = cpu->A;
+    uint8_t z = cpu->Z;
+    uint8_t op, arg;
+
+    unsigned long n_instr = 0, n_mem = 0, n_tomados = 0, n_no_tomados = 0;
+    int sp_min = cpu->sp_min;
+    int puerto = cpu->dispositivo ? DISPOSITIVO_PUERTO : -1;   // ningún arg vale -1
+
+/* Volcar / recargar el estado local hacia / desde la CPU y las métricas */
+#define VOLCAR() do {                                                  \
+        cpu->PC = pc; cpu->SP = sp; cpu->A = a; cpu->Z = z;            \
+        cpu->met.instrucciones += n_instr; cpu->met.ciclos += n_instr; \
+        cpu->met.accesos_memoria += n_mem;                             \
+        cpu->met.saltos_tomados += n_tomados;                          \
+        cpu->met.saltos_no_tomados += n_no_tomados;                    \
+        n_instr = n_mem = n_tomados = n_no_tomados = 0;                \
+        if (sp_min < cpu->sp_min) cpu->sp_min = sp_min;                \
+    } while (0)
+#define RECARGAR() do {                                                \
+        pc = cpu->PC; sp = cpu->SP; a = cpu->A; z = cpu->Z;            \
+        sp_min = cpu->sp_min;                                          \
+    } while (0)
+
+#ifdef CPU_GOTO_COMPUTADO
+    /* El rango da el valor por defecto y las entradas siguientes lo pisan a
+     * propósito: sin esto -Wextra avisa de cada una (-Woverride-init) */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+    static void *const tabla[256] = {
+        [0 ... 255] = &&op_desconocido,
+        [1] = &&op_nop,    [2] = &&op_store,  [3] = &&op_add,
+        [4] = &&op_sub,    [5] = &&op_loadi,  [6] = &&op_loadm,
+        [7] = &&op_jmp,    [8] = &&op_halt,   [9] = &&op_push,
+        [10] = &&op_pop,   [11] = &&op_call,  [12] = &&op_ret,
+        [13] = &&op_jmpz,  [14] = &&op_mul,
+    };
+#pragma GCC diagnostic pop
+#define INSTR(n, etiqueta)  etiqueta:
+#define INSTR_DESCONOCIDA   op_desconocido:
+#define DESPACHAR() do {                                               \
+        if (__builtin_expect(pc >= MEM_SIZE - 1, 0)) goto borde;       \
+        n_instr++;                                                     \
+        op = data[pc++];                                               \
+        goto *tabla[op];                                               \
+    } while (0)
+
+    DESPACHAR();
+#else
+#define INSTR(n, etiqueta)  case n:
+#define INSTR_DESCONOCIDA   default:
+#define DESPACHAR()         goto despacho
+
+despacho:
+    if (pc >= MEM_SIZE - 1) goto borde;
+    n_instr++;
+    op = data[pc++];
+    switch (op) {
+#endif
+
+    INSTR(1, op_nop)
+        DESPACHAR();
+
+    INSTR(2, op_store)
+        arg = data[pc++];
+        data[arg] = a;
+        n_mem++;
+        if (__builtin_expect(arg == puerto, 0))
+            dispositivo_escribir(cpu->dispositivo, a);
+        DESPACHAR();
+
+    INSTR(3, op_add)
+        arg = data[pc++];
+        n_mem++;
+        a = alu_add(a, data[arg]);
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR(4, op_sub)
+        arg = data[pc++];
+        n_mem++;
+        a = alu_sub(a, data[arg]);
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR(5, op_loadi)
+        a = data[pc++];
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR(6, op_loadm)
+        arg = data[pc++];
+        a = data[arg];
+        n_mem++;
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR(7, op_jmp)
+        pc = data[pc];
+        n_tomados++;
+        DESPACHAR();
+
+    INSTR(8, op_halt)
+        pc--;
+        goto lento;
+
+    INSTR(9, op_push)
+        if (sp == 0) { pc--; goto lento; }
+        data[sp--] = a;
+        n_mem++;
+        if (sp < sp_min) sp_min = sp;
+        DESPACHAR();
+
+    INSTR(10, op_pop)
+        if (sp >= MEM_SIZE - 1) { pc--; goto lento; }
+        a = data[++sp];
+        n_mem++;
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR(11, op_call)
+        if (sp == 0) { pc--; goto lento; }
+        arg = data[pc++];
+        data[sp--] = (uint8_t)pc;
+        n_mem++;
+        if (sp < sp_min) sp_min = sp;
+        pc = arg;
+        n_tomados++;
+        DESPACHAR();
+
+    INSTR(12, op_ret)
+        if (sp >= MEM_SIZE - 1) { pc--; goto lento; }
+        pc = data[++sp];
+        n_mem++;
+        n_tomados++;
+        DESPACHAR();
+
+    INSTR(13, op_jmpz)
+        arg = data[pc++];
+        if (z) {
+            pc = arg;
+            n_tomados++;
+        } else {
+            n_no_tomados++;
+        }
+        DESPACHAR();
+
+    INSTR(14, op_mul)
+        arg = data[pc++];
+        n_mem++;
+        a = alu_mul(a, data[arg]);
+        z = (a == 0);
+        DESPACHAR();
+
+    INSTR_DESCONOCIDA
+        pc--;
+        goto lento;
+
+#ifndef CPU_GOTO_COMPUTADO
+    }
+#endif
+
+borde:
+    /* pc >= MEM_SIZE - 1: fin de memoria o instrucción en el último byte */
+    if (pc >= MEM_SIZE)
+        goto fin;
+    n_instr++;
+
+lento:
+    /* pc apunta al opcode de una instrucción ya contada en n_instr */
+    VOLCAR();
+    ejecutar_instruccion(cpu, fetch(cpu));
+    if (cpu->halted)
+        return;
+    RECARGAR();
+    DESPACHAR();
+
+fin:
+    VOLCAR();
+
+#undef VOLCAR
+#undef RECARGAR
+#undef INSTR
+#undef INSTR_DESCONOCIDA
+#undef DESPACHAR
+}
+
+// ==================== NÚCLEO PREDECODIFICADO ====================
+
+/*
+ * Cada dirección de memoria tiene una entrada en una caché de instrucciones
+ * ya decodificadas: manejador, operando y siguiente instrucción. Las entradas
+ * se decodifican la primera vez que el PC pasa por ellas, así que los datos
+ * nunca se interpretan como código. En el bucle caliente no se vuelve a leer
+ * el opcode ni el operando de Memoria.data, y el PC es directamente el
+ * puntero a la entrada actual (pc = op - cache sólo al salir).
+ *
+ * Como la memoria es plana, el programa puede escribir sobre su propio código.
+ * Toda escritura (STORE, PUSH, CALL) en la dirección x invalida las entradas
+ * x y x-1 (la instrucción que empieza en x y la que tiene su operando en x);
+ * al volver a pasar por ellas se decodifican de nuevo.
+ *
+ * La tabla tiene una entrada extra por delante (destino de invalidar x-1 con
+ * x = 0) y otra al final, fija, que termina la ejecución cuando el PC llega a
+ * MEM_SIZE. Así el despacho no necesita comprobar límites.
+ *
+ * Superinstrucciones: al decodificar una entrada se decodifican también las
+ * dos siguientes, y si las tres (o dos) forman una de las secuencias de
+ * 'superinstrucciones' la entrada recibe un manejador que las ejecuta todas
+ * con un solo despacho. Cada instrucción de la secuencia se sigue leyendo de
+ * su propia entrada y, antes de ejecutarla, se comprueba que la entrada
+ * sigue decodificada con el opcode esperado; si una escritura la invalidó o
+ * cambió, se despacha normalmente desde ahí. Las métricas (instrucciones,
+ * accesos, saltos) se cuentan una por una, igual que sin fusionar.
+ *
+ * Con dispositivo, el STORE al puerto se decodifica como PD_SALIDA, que
+ * ningún patrón fusiona: los demás STORE siguen sin comparar la dirección.
+ */
+
+/* Códigos internos además de los opcodes 1..14 */
+enum {
+    PD_DECODIFICAR = 0,   // entrada vacía o invalidada
+    PD_LENTO = 15,        // ejecutar con ejecutar_instruccion()
+    PD_FIN = 16,          // PC == MEM_SIZE
+    PD_SALIDA,            // STORE a DISPOSITIVO_PUERTO con dispositivo
+    PD_LOADM_ADD_STORE,   // superinstrucciones (ver abajo)
+    PD_LOADM_SUB_STORE,
+    PD_LOADM_MUL_STORE,
+    PD_LOADM_JMPZ,
+    PD_SUB_STORE,
+    PD_STORE_LOADM,
+    PD_STORE_JMPZ,
+    PD_STORE_JMP,
+    PD_LOADM_STORE,
+    PD_LOADI_STORE,
+    PD_NUM_CODIGOS
+};
+
+/*
+ * Secuencias fusionadas, elegidas con make bench-pares (banco --pares): de
+ * las secuencias de los programas del banco, en % de sus 10.7 millones de
+ * instrucciones ejecutadas, las ternas LOADM->SUB->STORE 7.6% y
+ * LOADM->ADD->STORE 6.4% y los pares STORE->LOADM 11.0%, SUB->STORE 8.2%,
+ * STORE->JMPZ 4.6%, LOADM->STORE 3.5%, STORE->JMP 3.4% y LOADM->JMPZ 1.5%.
+ * LOADM->MUL->STORE (1.9%) es el bucle del factorial y LOADI->STORE (0.9%)
+ * reinicia sus variables en cada vuelta. Las demás ternas frecuentes son
+ * los mismos bucles tomados en otro punto (STORE->LOADM->SUB,
+ * ADD->STORE->LOADM); los pares de 1.9% que siguen son la llamada de
+ * recursion.asm (PUSH, SUB, CALL, POP, ADD, RET), que no se fusiona.
+ * Volver a medir al cambiar el banco o el compilador. Las más largas van
+ * primero.
+ */
+static const struct {
+    uint8_t codigo;
+    uint8_t ops[3];         // opcodes; 0 = secuencia de dos
+} superinstrucciones[] = {
+    { PD_LOADM_ADD_STORE, { 6, 3, 2 } },
+    { PD_LOADM_SUB_STORE, { 6, 4, 2 } },
+    { PD_LOADM_MUL_STORE, { 6, 14, 2 } },
+    { PD_STORE_LOADM,     { 2, 6 } },
+    { PD_SUB_STORE,       { 4, 2 } },
+    { PD_STORE_JMPZ,      { 2, 13 } },
+    { PD_LOADM_STORE,     { 6, 2 } },
+    { PD_STORE_JMP,       { 2, 7 } },
+    { PD_LOADM_JMPZ,      { 6, 13 } },
+    { PD_LOADI_STORE,     { 5, 2 } },
+};
+
+typedef struct OpDecodificada {
+#ifdef CPU_GOTO_COMPUTADO
+    const void *manejador;                  // etiqueta del manejador
+#endif
+    const struct OpDecodificada *siguiente; // entrada de la instrucción siguiente
+    uint8_t codigo;                         // opcode, superinstrucción o código interno PD_*
+    uint8_t opcode;                         // la instrucción de esta dirección sola (0 = sin decodificar)
+    uint8_t operando;                       // operando ya leído (si tiene)
+} OpDecodificada;
+
+/*
+ * Decodifica la instrucción en 'pc' (opcode, operando y siguiente) y
+ * devuelve su código: el opcode, PD_LENTO para HALT, opcodes desconocidos
+ * u operandos fuera de memoria, o PD_SALIDA para un STORE a 'puerto' (-1
+ * sin dispositivo).
+ */
+static uint8_t decodificar_op(OpDecodificada *cache, const uint8_t *data, uint16_t pc,
+                              int puerto) {
+    OpDecodificada *e = &cache[pc];
+    uint8_t codigo = data[pc];
+    int con_operando = !(codigo == 1 || codigo == 8 || codigo == 9 ||
+                         codigo == 10 || codigo == 12);
+
+    if (codigo < 1 || codigo > 14 || codigo == 8 ||
+        (con_operando && pc >= MEM_SIZE - 1)) {
+        e->opcode = PD_LENTO;
+        return PD_LENTO;
+    }
+    e->operando = con_operando ? data[pc + 1] : 0;
+    e->siguiente = &cache[pc + (con_operando ? 2 : 1)];
+    if (codigo == 2 && e->operando == puerto)
+        codigo = PD_SALIDA;
+    e->opcode = codigo;
+    return codigo;
+}
+
+/* Superinstrucción que empieza en 'e' (con las siguientes ya decodificadas), o su opcode */
+static uint8_t superinstruccion(const OpDecodificada *e) {
+    for (size_t i = 0; i < sizeof(superinstrucciones) / sizeof(superinstrucciones[0]); ++i) {
+        const uint8_t *ops = superinstrucciones[i].ops;
+        const OpDecodificada *e2 = e->siguiente;
+        /* Sólo las entradas con un opcode 1..14 tienen 'siguiente' */
+        if (e->opcode == ops[0] && e2->opcode == ops[1] &&
+            (!ops[2] || e2->siguiente->opcode == ops[2]))
+            return superinstrucciones[i].codigo;
+    }
+    return e->opcode;
+}
+
+static void ejecutar_predecode(CPU *cpu) {
+    OpDecodificada tabla_ops[MEM_SIZE + 2];
+    OpDecodificada *cache = tabla_ops + 1;
+    const OpDecodificada *op = &cache[cpu->PC < MEM_SIZE ? cpu->PC : MEM_SIZE];
+
+    uint8_t *data = cpu->mem->data;
+    uint16_t sp = cpu->SP;
+    uint8_t a = cpu->A;
+    uint8_t z = cpu->Z;
+
+    unsigned long n_instr = 0, n_mem = 0, n_tomados = 0, n_no_tomados = 0;
+    int sp_min = cpu->sp_min;
+    int puerto = cpu->dispositivo ? DISPOSITIVO_PUERTO : -1;
+
+#define PC_ACTUAL()     ((uint16_t)(op - cache))
+#define VOLCAR() do {                                                  \
+        cpu->PC = PC_ACTUAL(); cpu->SP = sp; cpu->A = a; cpu->Z = z;   \
+        cpu->met.instrucciones += n_instr; cpu->met.ciclos += n_instr; \
+        cpu->met.accesos_memoria += n_mem;                             \
+        cpu->met.saltos_tomados += n_tomados;                          \
+        cpu->met.saltos_no_tomados += n_no_tomados;                    \
+        n_instr = n_mem = n_tomados = n_no_tomados = 0;                \
+        if (sp_min < cpu->sp_min) cpu->sp_min = sp_min;                \
+    } while (0)
+#define RECARGAR() do {                                                \
+        op = &cache[cpu->PC < MEM_SIZE ? cpu->PC : MEM_SIZE];          \
+        sp = cpu->SP; a = cpu->A; z = cpu->Z;                          \
+        sp_min = cpu->sp_min;                                          \
+    } while (0)
+
+#ifdef CPU_GOTO_COMPUTADO
+    static void *const manejadores[PD_NUM_CODIGOS] = {
+        [PD_DECODIFICAR] = &&op_decodificar,
+        [1] = &&op_nop,    [2] = &&op_store,  [3] = &&op_add,
+        [4] = &&op_sub,    [5] = &&op_loadi,  [6] = &&op_loadm,
+        [7] = &&op_jmp,    [8] = &&op_lento,  [9] = &&op_push,
+        [10] = &&op_pop,   [11] = &&op_call,  [12] = &&op_ret,
+        [13] = &&op_jmpz,  [14] = &&op_mul,
+        [PD_LENTO] = &&op_lento,
+        [PD_FIN] = &&op_fin,
+        [PD_SALIDA] = &&op_salida,
+        [PD_LOADM_ADD_STORE] = &&op_loadm_add_store,
+        [PD_LOADM_SUB_STORE] = &&op_loadm_sub_store,
+        [PD_LOADM_MUL_STORE] = &&op_loadm_mul_store,
+        [PD_LOADM_JMPZ] = &&op_loadm_jmpz,
+        [PD_SUB_STORE] = &&op_sub_store,
+        [PD_STORE_LOADM] = &&op_store_loadm,
+        [PD_STORE_JMPZ] = &&op_store_jmpz,
+        [PD_STORE_JMP] = &&op_store_jmp,
+        [PD_LOADM_STORE] = &&op_loadm_store,
+        [PD_LOADI_STORE] = &&op_loadi_store,
+    };
+#define FIJAR(e, c)     ((e)->codigo = (c), (e)->manejador = manejadores[(c)])
+#define INVALIDAR(x)    (cache[(x)].manejador = &&op_decodificar, cache[(x)].opcode = 0)
+#define INSTR(n, etiqueta)  etiqueta:
+#define DESPACHAR() do {                                               \
+        n_instr++;                                                     \
+        goto *op->manejador;                                           \
+    } while (0)
+#define REDESPACHAR()   goto *op->manejador
+#else
+#define FIJAR(e, c)     ((e)->codigo = (c))
+#define INVALIDAR(x)    (cache[(x)].codigo = PD_DECODIFICAR, cache[(x)].opcode = 0)
+#define INSTR(n, etiqueta)  case n:
+#define DESPACHAR()     goto despacho
+#define REDESPACHAR()   goto redespacho
+#endif
+#define SIGUIENTE()     do { op = op->siguiente; DESPACHAR(); } while (0)
+#define SALTAR(dir)     do { op = &cache[(dir)]; DESPACHAR(); } while (0)
+/*
+ * Dentro de una superinstrucción: pasar a la siguiente si sigue siendo 'opc'.
+ * Todas las fusionadas ocupan dos bytes, así que la entrada siguiente está
+ * dos más allá sin tener que leer op->siguiente.
+ */
+#define FUSIONADA(opc)  do {                                           \
+        op += 2;                                                       \
+        if (op->opcode != (opc))                                       \
+            DESPACHAR();                                               \
+        n_instr++;                                                     \
+    } while (0)
+
+    for (int i = -1; i < MEM_SIZE; ++i)
+        INVALIDAR(i);
+    FIJAR(&cache[MEM_SIZE], PD_FIN);
+    cache[MEM_SIZE].opcode = PD_FIN;
+
+#ifdef CPU_GOTO_COMPUTADO
+    DESPACHAR();
+#else
+despacho:
+    n_instr++;
+redespacho:
+    switch (op->codigo) {
+#endif
+
+    INSTR(PD_DECODIFICAR, op_decodificar) {
+        OpDecodificada *e = &cache[PC_ACTUAL()];
+        uint8_t codigo = decodificar_op(cache, data, PC_ACTUAL(), puerto);
+
+        /*
+         * Y las dos siguientes, por si forman una superinstrucción. Se quedan
+         * con el manejador de decodificar: al despacharlas se decodifican de
+         * nuevo y pueden empezar otra.
+         */
+        OpDecodificada *s = e;
+        for (int k = 0; k < 2 && s->opcode >= 1 && s->opcode <= 14; ++k) {
+            s = (OpDecodificada *)s->siguiente;
+            if (s->opcode == PD_DECODIFICAR)
+                decodificar_op(cache, data, (uint16_t)(s - cache), puerto);
+        }
+        FIJAR(e, codigo == PD_LENTO ? PD_LENTO : superinstruccion(e));
+        REDESPACHAR();
+    }
+
+    INSTR(1, op_nop)
+        SIGUIENTE();
+
+    INSTR(2, op_store)
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(3, op_add)
+        n_mem++;
+        a = alu_add(a, data[op->operando]);
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(4, op_sub)
+        n_mem++;
+        a = alu_sub(a, data[op->operando]);
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(5, op_loadi)
+        a = op->operando;
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(6, op_loadm)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(7, op_jmp)
+        n_tomados++;
+        SALTAR(op->operando);
+
+    INSTR(9, op_push)
+        if (sp == 0) goto lento;
+        data[sp] = a;
+        INVALIDAR(sp);
+        INVALIDAR(sp - 1);
+        sp--;
+        n_mem++;
+        if (sp < sp_min) sp_min = sp;
+        SIGUIENTE();
+
+    INSTR(10, op_pop)
+        if (sp >= MEM_SIZE - 1) goto lento;
+        a = data[++sp];
+        n_mem++;
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(11, op_call)
+        if (sp == 0) goto lento;
+        data[sp] = (uint8_t)(op->siguiente - cache);
+        INVALIDAR(sp);
+        INVALIDAR(sp - 1);
+        sp--;
+        n_mem++;
+        if (sp < sp_min) sp_min = sp;
+        n_tomados++;
+        SALTAR(op->operando);
+
+    INSTR(12, op_ret)
+        if (sp >= MEM_SIZE - 1) goto lento;
+        n_mem++;
+        n_tomados++;
+        SALTAR(data[++sp]);
+
+    INSTR(13, op_jmpz)
+        if (z) {
+            n_tomados++;
+            SALTAR(op->operando);
+        }
+        n_no_tomados++;
+        SIGUIENTE();
+
+    INSTR(14, op_mul)
+        n_mem++;
+        a = alu_mul(a, data[op->operando]);
+        z = (a == 0);
+        SIGUIENTE();
+
+    /* --- Superinstrucciones: los manejadores de arriba seguidos, con un
+     *     solo despacho; op avanza por cada instrucción de la secuencia --- */
+    INSTR(PD_LOADM_ADD_STORE, op_loadm_add_store)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        FUSIONADA(3);
+        n_mem++;
+        a = alu_add(a, data[op->operando]);
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(PD_LOADM_SUB_STORE, op_loadm_sub_store)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        FUSIONADA(4);
+        n_mem++;
+        a = alu_sub(a, data[op->operando]);
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(PD_LOADM_MUL_STORE, op_loadm_mul_store)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        FUSIONADA(14);
+        n_mem++;
+        a = alu_mul(a, data[op->operando]);
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(PD_LOADM_JMPZ, op_loadm_jmpz)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        FUSIONADA(13);
+        if (z) {
+            n_tomados++;
+            SALTAR(op->operando);
+        }
+        n_no_tomados++;
+        SIGUIENTE();
+
+    INSTR(PD_SUB_STORE, op_sub_store)
+        n_mem++;
+        a = alu_sub(a, data[op->operando]);
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    /* El STORE puede haber invalidado la siguiente: FUSIONADA lo ve */
+    INSTR(PD_STORE_LOADM, op_store_loadm)
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        FUSIONADA(6);
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        SIGUIENTE();
+
+    INSTR(PD_STORE_JMPZ, op_store_jmpz)
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        FUSIONADA(13);
+        if (z) {
+            n_tomados++;
+            SALTAR(op->operando);
+        }
+        n_no_tomados++;
+        SIGUIENTE();
+
+    INSTR(PD_STORE_JMP, op_store_jmp)
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        FUSIONADA(7);
+        n_tomados++;
+        SALTAR(op->operando);
+
+    INSTR(PD_LOADM_STORE, op_loadm_store)
+        a = data[op->operando];
+        n_mem++;
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(PD_LOADI_STORE, op_loadi_store)
+        a = op->operando;
+        z = (a == 0);
+        FUSIONADA(2);
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        SIGUIENTE();
+
+    INSTR(PD_SALIDA, op_salida)
+        data[op->operando] = a;
+        n_mem++;
+        INVALIDAR(op->operando);
+        INVALIDAR(op->operando - 1);
+        dispositivo_escribir(cpu->dispositivo, a);
+        SIGUIENTE();
+
+    INSTR(PD_LENTO, op_lento)
+    lento:
+        /* op apunta al opcode; la instrucción ya está contada en n_instr */
+        VOLCAR();
+        ejecutar_instruccion(cpu, fetch(cpu));
+        if (cpu->halted)
+            return;
+        RECARGAR();
+        /* El camino lento puede haber escrito en cualquier dirección */
+        for (int i = -1; i < MEM_SIZE; ++i)
+            INVALIDAR(i);
+        DESPACHAR();
+
+    INSTR(PD_FIN, op_fin)
+        n_instr--;   /* la entrada final no es una instrucción */
+        VOLCAR();
+
+#ifndef CPU_GOTO_COMPUTADO
+        return;
+    }
+#endif
+
+#undef PC_ACTUAL
+#undef VOLCAR
+#undef RECARGAR
+#undef FIJAR
+#undef INVALIDAR
+#undef INSTR
+#undef DESPACHAR
+#undef REDESPACHAR
+#undef SIGUIENTE
+#undef SALTAR
+#undef FUSIONADA
+}
+
+// ==================== NÚCLEO JIT ====================
+
+/*
+ * El código traducido corre hasta encontrar algo que no sabe ejecutar; eso
+ * lo resuelve ejecutar_instruccion(), instrucción por instrucción hasta un
+ * PC que el JIT acepte, y se vuelve al JIT. Tras cada una se descartan sólo
+ * los bloques que cubren lo que pudo escribir: el operando de un STORE o
+ * los bytes que bajó SP. Si la plataforma no permite generar código se usa
+ * el núcleo predecodificado.
+ */
+static void ejecutar_jit(CPU *cpu, Jit *j) {
+    if (!j) {
+        if (!cpu->silencioso)
+            printf("[AVISO] JIT no disponible en esta plataforma; se usa el motor predecode\n");
+        ejecutar_predecode(cpu);
+        return;
+    }
+    /* La memoria pudo cambiar desde la última llamada (otro motor, otra corrida del lote) */
+    jit_asociar(j, cpu->mem->data, cpu->dispositivo ? DISPOSITIVO_PUERTO : -1);
+
+    while (!cpu->halted && cpu->PC < MEM_SIZE) {
+        JitRegistros r = {
+            .pc = cpu->PC, .sp = cpu->SP, .a = cpu->A, .z = cpu->Z,
+            .sp_min = (uint32_t)cpu->sp_min,
+        };
+        jit_ejecutar(j, &r);
+
+        cpu->PC = r.pc;
+        cpu->SP = r.sp;
+        cpu->A = r.a;
+        cpu->Z = r.z;
+        cpu->met.instrucciones += r.instr;
+        cpu->met.ciclos += r.instr;
+        cpu->met.accesos_memoria += r.mem_accesos;
+        cpu->met.saltos_tomados += r.tomados;
+        cpu->met.saltos_no_tomados += r.no_tomados;
+        if ((int)r.sp_min < cpu->sp_min) cpu->sp_min = (int)r.sp_min;
+
+        if (cpu->PC >= MEM_SIZE)
+            break;
+
+        /* Instrucciones que el JIT no traduce (la primera siempre: puede ser
+           la pila llena o vacía dentro de un bloque) */
+        const uint8_t *data = cpu->mem->data;
+        do {
+            uint32_t pc = cpu->PC;
+            uint16_t sp = cpu->SP;
+            int dir = -1;
+            if (data[pc] == 2 && pc < MEM_SIZE - 1)
+                dir = data[pc + 1];
+            else if (data[pc] == (2 | OP_ANCHO) && pc < MEM_SIZE - 2)
+                dir = data[pc + 1] | data[pc + 2] << 8;
+
+            cpu->met.instrucciones++;
+            cpu->met.ciclos++;
+            ejecutar_instruccion(cpu, fetch(cpu));
+
+            if (dir >= 0 && dir < MEM_SIZE)
+                jit_invalidar(j, (uint16_t)dir);
+            for (uint32_t d = cpu->SP + 1u; d <= sp && d < MEM_SIZE; ++d)
+                jit_invalidar(j, (uint16_t)d);   /* PUSH, CALL */
+        } while (!cpu->halted && cpu->PC < MEM_SIZE && !jit_acepta(j, (uint16_t)cpu->PC));
+    }
+}
+
+// ==================== EJECUCIÓN PRINCIPAL ====================
+
+/*
+ * Entrada a la rutina de atención, entre dos instrucciones: apila el PC
+ * como CALL (dos bytes si el vector se fijó con VECTOR.w) y después Z, e inhibe
+ * las interrupciones hasta el RETI. Con traza se graba una clave antes de
+ * la instrucción siguiente, porque las escrituras en la pila no
+ * pertenecen a ninguna instrucción.
+ */
+static void entrar_interrupcion(CPU *cpu) {
+    int modo = cpu->mem->tam > MEM_SIZE ? MODO_PAGINADA : 0;
+    Interrupciones *irq = &cpu->irq;
+
+    irq->pendiente = 0;
+    irq->habilitadas = 0;
+    if (irq->marco_ancho)
+        push(cpu, (uint8_t)(cpu->PC >> 8), modo);
+    push(cpu, (uint8_t)cpu->PC, modo);
+    push(cpu, cpu->Z, modo);
+    if (cpu->halted)
+        return;
+    irq->atendidas++;
+    cpu->PC = irq->vector;
+    if (cpu->perfil)
+        perfil_llamada(cpu->perfil, irq->vector);
+    if (cpu->traza)
+        cpu->traza->proxima_clave = cpu->met.instrucciones;
+}
+
+static const char *const nombres_motor[] = {
+    [MOTOR_SWITCH]   = "switch",
+    [MOTOR_THREADED] = "threaded",
+    [MOTOR_PREDECODE] = "predecode",
+    [MOTOR_JIT]      = "jit",
+    [MOTOR_SIMD]     = "simd",
+};
+
+int cpu_motor_desde_nombre(const char *nombre) {
+    for (size_t i = 0; i < sizeof(nombres_motor) / sizeof(nombres_motor[0]); ++i)
+        if (strcmp(nombres_motor[i], nombre) == 0)
+            return (int)i;
+    return -1;
+}
+
+void cpu_leer_metricas(const CPU *cpu, CPUMetricas *m) {
+    *m = cpu->met;
+    m->profundidad_pila = (int)(cpu->mem->tam - 1) - cpu->sp_min;
+}
+
+const char *cpu_opcode_nombre(uint8_t op) {
+    static const char *const nombres[] = {
+        "?", "NOP", "STORE", "ADD", "SUB", "LOADI", "LOADM", "JMP",
+        "HALT", "PUSH", "POP", "CALL", "RET", "JMPZ", "MUL", "EI",
+        "DI", "RETI", "TIMER", "VECTOR",
+    };
+    static const char *const anchos[] = {
+        "?", "?", "STORE.w", "ADD.w", "SUB.w", "?", "LOADM.w", "JMP.w",
+        "?", "?", "?", "CALL.w", "RET.w", "JMPZ.w", "MUL.w", "?",
+        "?", "RETI.w", "TIMER.w", "VECTOR.w",
+    };
+    uint8_t base = op & ~OP_ANCHO;
+    if (base >= sizeof(nombres) / sizeof(nombres[0]))
+        return "?";
+    return (op & OP_ANCHO) ? anchos[base] : nombres[base];
+}
+
+const char *cpu_motor_nombre(MotorCPU motor) {
+    if ((size_t)motor < sizeof(nombres_motor) / sizeof(nombres_motor[0]))
+        return nombres_motor[motor];
+    return "?";
 }
 
 void cpu_ejecutar(CPU *cpu) {
-    while (cpu->running) {                       // Ciclo principal de ejecución
-        uint8_t opcode = memoria_leer(cpu->mem, cpu->PC);  // FETCH instrucción
-        cpu->PC++;  // Avanza el contador de programa
-
-        switch (opcode) {
-            case 0x01: { // LOAD addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                cpu->A = memoria_leer(cpu->mem, addr);
-                break;
-            }
-            case 0x02: { // STORE addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                memoria_escribir(cpu->mem, addr, cpu->A);
-                break;
-            }
-            case 0x03: { // ADD addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                uint8_t val = memoria_leer(cpu->mem, addr);
-                cpu->A = alu_suma(cpu->A, val);  // Llama a ALU
-                break;
-            }
-            case 0x04: { // SUB addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                uint8_t val = memoria_leer(cpu->mem, addr);
-                cpu->A = cpu->A - val;
-                break;
-            }
-            case 0x05: { // LOADI imm
-                uint8_t imm = memoria_leer(cpu->mem, cpu->PC++);
-                cpu->A = imm;
-                break;
-            }
-            case 0x09: { // ADDI imm
-                uint8_t imm = memoria_leer(cpu->mem, cpu->PC++);
-                cpu->A = alu_suma(cpu->A, imm);
-                break;
-            }
-            case 0x06: { // JMP addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                cpu->PC = addr;
+    if (cpu->halted)        /* p. ej. una instantánea tomada tras el HALT */
+        return;
+    clock_t t0 = clock();
+
+    /* Los demás motores sólo direccionan la página 0 */
+    if (cpu->mem->tam > MEM_SIZE && cpu->motor != MOTOR_SWITCH) {
+        if (!cpu->silencioso)
+            printf("[AVISO] El motor %s sólo admite memoria de 8 bits; se usa switch\n",
+                   cpu_motor_nombre(cpu->motor));
+        cpu->motor = MOTOR_SWITCH;
+    }
+
+    /* Perfilador, modelo de tiempo y traza sólo están en el núcleo de referencia */
+    if ((cpu->perfil || cpu->tiempo || cpu->traza) && cpu->motor != MOTOR_SWITCH) {
+        if (!cpu->silencioso)
+            printf("[AVISO] El %s usa el motor switch en lugar de %s\n",
+                   cpu->perfil ? "perfilador" : cpu->tiempo ? "modelo de tiempo" : "grabador de trazas",
+                   cpu_motor_nombre(cpu->motor));
+        cpu->motor = MOTOR_SWITCH;
+    }
+
+    /*
+     * El límite de instrucciones sólo lo comprueba el núcleo de referencia;
+     * con eventos programados se corre hasta el primero, se atiende y se
+     * sigue (ver interrupciones.h).
+     */
+    Jit *jit = NULL;        /* si la CPU no trae uno, sirve para todos los tramos */
+    for (;;) {
+        if (cpu->irq.pendiente && cpu->irq.habilitadas) {
+            entrar_interrupcion(cpu);
+            if (cpu->halted)
                 break;
-            }
-            case 0x07: { // JZ addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                if (cpu->A == 0) cpu->PC = addr;
+        }
+        unsigned long evento = interrupciones_proximo(&cpu->irq);
+        unsigned long tope = cpu->limite;
+        if (evento && (!tope || evento < tope))
+            tope = evento;
+
+        switch (tope ? MOTOR_SWITCH : cpu->motor) {
+            case MOTOR_THREADED:
+                ejecutar_threaded(cpu);
                 break;
-            }
-            case 0x0A: { // OUT addr
-                uint8_t addr = memoria_leer(cpu->mem, cpu->PC++);
-                printf("OUT: %d\n", memoria_leer(cpu->mem, addr));
+            case MOTOR_PREDECODE:
+            case MOTOR_SIMD:    /* una sola corrida: no hay carriles que agrupar */
+                ejecutar_predecode(cpu);
                 break;
-            }
-            case 0x08: { // HALT
-                cpu->running = false;
+            case MOTOR_JIT:
+                if (!cpu->jit && !jit)
+                    jit = jit_crear(cpu->mem->data, -1);
+                ejecutar_jit(cpu, cpu->jit ? cpu->jit : jit);
                 break;
-            }
+            case MOTOR_SWITCH:
             default:
-                printf("Error: opcode desconocido 0x%02X en PC=0x%02X\n", opcode, cpu->PC-1);
-                cpu->running = false;
+                ejecutar_switch(cpu, tope);
                 break;
         }
+
+        if (cpu->halted == CPU_PAUSA) {
+            cpu->halted = 0;
+            continue;
+        }
+        if (cpu->halted || cpu->PC >= cpu->mem->tam || !evento ||
+            cpu->met.instrucciones < evento)
+            break;
+        interrupciones_vencer(&cpu->irq, cpu->met.instrucciones);
     }
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
+
+    jit_destruir(jit);
+
+    clock_t t1 = clock();
+    cpu->met.segundos += (double)(t1 - t0) / CLOCKS_PER_SEC;
+}
+
+void cpu_imprimir_resumen(const CPU *cpu) {
+    CPUMetricas m;
+    cpu_leer_metricas(cpu, &m);
+
+    diagnostico_informe(&cpu->diag, cpu->verbosidad, stdout);
+
+    /* Estado final */
+    printf("\n=== CPU Detenida ===\n");
+    printf("A = %d, PC = %d, SP = %d, Z = %d\n", cpu->A, cpu->PC, cpu->SP, cpu->Z);
+
+    /* Imprimir métricas */
+    printf("\n--- MÉTRICAS DE EJECUCIÓN (CPU) ---\n");
+    printf("Motor: %s\n", cpu_motor_nombre(cpu->motor));
+    printf("Instrucciones ejecutadas: %lu\n", m.instrucciones);
+    if (cpu->tiempo)
+        printf("Ciclos estimados (modelo de tiempo): %lu\n", m.ciclos);
+    else
+        printf("Ciclos (modelo simple): %lu\n", m.ciclos);
+    printf("Accesos a memoria: %lu\n", m.accesos_memoria);
+    printf("Saltos tomados: %lu\n", m.saltos_tomados);
+    printf("Saltos no tomados: %lu\n", m.saltos_no_tomados);
+    printf("Profundidad máxima de pila (bytes usados): %d\n", m.profundidad_pila);
+    if (cpu->irq.atendidas)
+        printf("Interrupciones atendidas: %lu\n", cpu->irq.atendidas);
+    printf("Tiempo de ejecución (CPU): %.6f s\n", m.segundos);
+    if (m.segundos > 0)
+        printf("Rendimiento: %.2f MIPS\n", m.instrucciones / m.segundos / 1e6);
+    if (cpu->tiempo)
+        tiempo_informe(cpu->tiempo, m.instrucciones, m.ciclos, stdout);
 }
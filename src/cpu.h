@@ -2,30 +2,80 @@
 #define CPU_H
 
 #include "memoria.h"
+#include "diagnostico.h"
+#include "interrupciones.h"
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Núcleos de intérprete disponibles (seleccionables en tiempo de ejecución) */
+typedef enum {
+    MOTOR_SWITCH = 0,   // Bucle fetch + switch (referencia)
+    MOTOR_THREADED,     // Despacho directo por tabla (goto computado)
+    MOTOR_PREDECODE,    // Ejecuta desde una caché de instrucciones predecodificadas
+    MOTOR_JIT,          // Traduce bloques básicos a x86-64 (ver jit.c)
+    MOTOR_SIMD          // Modo lote: varias corridas en lockstep (ver simd.c)
+} MotorCPU;
+
+/* Métricas de una ejecución; cada CPU lleva las suyas */
+typedef struct {
+    unsigned long instrucciones;
+    unsigned long ciclos;
+    unsigned long accesos_memoria;
+    unsigned long saltos_tomados;
+    unsigned long saltos_no_tomados;
+    int profundidad_pila;       // bytes de pila usados como máximo
+    double segundos;            // tiempo de CPU dentro de cpu_ejecutar
+} CPUMetricas;
+
+/* Bit de opcode que selecciona la forma con dirección de 16 bits (ver cpu.c) */
+#define OP_ANCHO 0x80
+
 typedef struct {
-<<<<<<< HEAD
     uint8_t A;          // Registro acumulador
-    uint16_t PC;        // Contador de programa
+    uint32_t PC;        // Contador de programa (puede valer mem->tam al salir)
     uint16_t SP;        // Puntero de pila
     uint8_t Z;          // Bandera de cero
     Memoria *mem;       // Referencia a memoria
     int halted;         // Estado
+    MotorCPU motor;     // Núcleo usado por cpu_ejecutar
+    int silencioso;     // No avisar de los cambios de motor (modo lote)
+    CPUMetricas met;    // Contadores de esta CPU (los reinicia cpu_init)
+    int sp_min;         // Menor SP alcanzado, para met.profundidad_pila
+    unsigned long limite; // Detenerse al llegar a estas instrucciones (0 = sin límite)
+    struct Perfil *perfil; // Perfilador por PC (NULL = apagado, ver perfil.h)
+    struct Tiempo *tiempo; // Modelo de ciclos con cachés (NULL = un ciclo por instrucción, ver tiempo.h)
+    struct Traza *traza;   // Grabador de trazas (NULL = apagado, ver traza.h)
+    struct Dispositivo *dispositivo; // Salida mapeada en memoria (NULL = sin dispositivo, ver dispositivo.h)
+    Diagnosticos diag;  // Avisos y errores de la ejecución (los reinicia cpu_init, ver diagnostico.h)
+    NivelDiagnostico verbosidad; // Qué diagnósticos muestra cpu_imprimir_resumen (DIAG_TODO)
+    Interrupciones irq; // Temporizador, vector y cola de eventos (ver interrupciones.h)
+    struct Jit *jit;    // Traductor reutilizable entre llamadas (NULL = uno por cpu_ejecutar, ver jit.h)
 } CPU;
 
-
-=======
-    uint8_t A; // Acumulador
-    uint8_t PC; // Program Counter
-    bool running; // bandera de ejecución
-    Memoria *mem;
-} CPU;
-
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
 void cpu_init(CPU *cpu, Memoria *mem);
+
+/*
+ * Ejecuta hasta HALT, salir de memoria o, si cpu->limite != 0, hasta que
+ * met.instrucciones llegue al límite (entonces halted sigue a 0 y se puede
+ * volver a llamar para continuar).
+ */
 void cpu_ejecutar(CPU *cpu);
 
+/* Métricas acumuladas por la CPU desde cpu_init */
+void cpu_leer_metricas(const CPU *cpu, CPUMetricas *m);
+
+/*
+ * Diagnósticos de la ejecución (según cpu->verbosidad), estado final y
+ * métricas en stdout (lo que antes imprimía cpu_ejecutar)
+ */
+void cpu_imprimir_resumen(const CPU *cpu);
+
+/* Conversión nombre <-> motor para la línea de comandos (-1 si no existe) */
+int cpu_motor_desde_nombre(const char *nombre);
+const char *cpu_motor_nombre(MotorCPU motor);
+
+/* Mnemónico de un opcode ("ADD", "ADD.w" en la forma ancha, "?" si no existe) */
+const char *cpu_opcode_nombre(uint8_t op);
+
 #endif
 
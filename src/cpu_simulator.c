@@ -1,138 +1,32 @@
 /*
-<<<<<<< HEAD
- * cpu_simulator.c - main que carga .mem (binario por línea o decimal) y ejecuta CPU
-=======
- * Archivo: cpu_simulator.c
- * Función: Programa principal del simulador de CPU.
- *           Crea e inicializa la memoria y CPU, carga instrucciones
- *           desde archivo o manualmente, y ejecuta el ciclo del CPU.
- * 
- * El proceso de suma se demuestra con un programa ejemplo que suma dos números
- * usando las instrucciones LOADI, STORE y ADD.
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
+ * cpu_simulator.c - main que carga .mem (binario por línea o decimal) o una
+ * imagen binaria .img con computadora_cargar_imagen y ejecuta CPU
  */
 
 #include <stdio.h>
 #include <stdlib.h>
-<<<<<<< HEAD
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
-#include <ctype.h>
 #include <time.h>
 #include "memoria.h"
 #include "cpu.h"
-
-/*
- * Función: cargar_memoria_desde_archivo
- * -------------------------------------
- * Lee un archivo .mem texto donde cada línea contiene:
- *   - un valor binario (ej. 00101011)
- *   - o un número decimal
- *   - o un hexadecimal (0x20)
- * y lo guarda byte a byte dentro de la memoria simulada.
- */
-int cargar_memoria_desde_archivo(Memoria *m, const char *path) {
-
-    FILE *f = fopen(path, "r");      // Intenta abrir el archivo en modo lectura
-    if (!f) {                        // Si no se pudo abrir...
-        fprintf(stderr, "No se pudo abrir %s\n", path);
-        return -1;                     // retorna error
-    }
-
-    int i = 0;                       // índice de memoria a llenar
-    char line[256];                  // buffer para leer cada línea del archivo
-
-    // Bucle principal para leer líneas mientras haya espacio en la memoria
-    while (i < MEM_SIZE && fgets(line, sizeof(line), f)) {
-
-        // Apunta a p donde inicia la línea (para poder mover el cursor)
-        char *p = line;
-
-        // Quitar espacios en blanco al principio (indentación, tabs, etc.)
-        while (*p && isspace((unsigned char)*p)) p++;
-
-        // Saltar líneas vacías o comentarios que inician con ';'
-        if (*p == ';' || *p == '\0' || *p == '\n' || *p == '\r')
-            continue;
-
-        // Quitar espacios en blanco del final de la línea
-        char *end = p + strlen(p) - 1;
-        while (end >= p && isspace((unsigned char)*end)) {
-            *end = '\0';
-            --end;
-        }
-
-        // Si después de recortar queda vacía, saltar
-        if (strlen(p) == 0)
-            continue;
-
-        // Detectar si la línea contiene solamente ceros y unos (binario)
-        int only01 = 1;
-        for (size_t k = 0; k < strlen(p); ++k) {
-            char ch = p[k];
-
-            // Ignorar espacios dentro del binario
-            if (ch == ' ' || ch == '\t') continue;
-
-            // Si encuentra algo que no sea 0 o 1 → no es binario
-            if (ch != '0' && ch != '1') {
-                only01 = 0;
-                break;
-            }
-        }
-
-        int val = 0; // valor numérico final de la instrucción/letra del archivo
-
-        if (only01) {
-            // Si es una línea de puro 0/1, la interpretamos como binario
-            char tmp[64];
-            int pos = 0;
-
-            // Copiar solamente los dígitos 0 o 1 a tmp
-            for (size_t k = 0; k < strlen(p) && pos < (int)sizeof(tmp)-1; ++k) {
-                if (p[k] == '0' || p[k] == '1')
-                    tmp[pos++] = p[k];
-            }
-            tmp[pos] = '\0';
-
-            // Convertir la cadena binaria a número entero (val)
-            val = 0;
-            for (int k = 0; tmp[k]; ++k) {
-                val = (val << 1) + (tmp[k] - '0');   // shift left y agregar bit
-            }
-
-        } else {
-            /*
-             * Si no es binario, puede ser:
-             *   - un decimal (ej. 42)
-             *   - un hexadecimal (ej. 0x1F)
-             */
-            if (strlen(p) > 2 && p[0]=='0' && (p[1]=='x' || p[1]=='X')) {
-                // Interpretar como hexadecimal
-                val = (int)strtol(p, NULL, 16);
-            } else {
-                // Interpretar como decimal
-                val = atoi(p);
-            }
-        }
-
-        // Guardar el valor dentro de la memoria como un byte (0–255)
-        m->data[i++] = (uint8_t)(val & 0xFF);
-    }
-
-    fclose(f);
-
-    return i; /* bytes cargados */
-}
+#include "computadora.h"
+#include "lote.h"
+#include "instantanea.h"
+#include "perfil.h"
+#include "tiempo.h"
+#include "traza.h"
+#include "dispositivo.h"
 
 /*
  * Cargar un programa de ejemplo si el usuario no carga un archivo .mem
  * Este programa:
  *   - guarda 30 en memoria[30]
  *   - LOADI 30 → A = 30
- *   - STORE 200 → guardar A en memoria[200]
+ *   - STORE 102 → guardar A en memoria[102]
  *   - LOADI 20 → A = 20
- *   - ADD 200 → A = A + memoria[200]
+ *   - ADD 102 → A = A + memoria[102]
  *   - HALT → detener ejecución
  */
 void cargar_programa_ejemplo(Memoria *m) {
@@ -143,9 +37,9 @@ void cargar_programa_ejemplo(Memoria *m) {
 
     // Programa de instrucciones:
     m->data[0] = 5;  m->data[1] = 30;   // LOADI 30
-    m->data[2] = 2;  m->data[3] = 200;  // STORE en dirección 200
+    m->data[2] = 2;  m->data[3] = 102;  // STORE en dirección 102
     m->data[4] = 5;  m->data[5] = 20;   // LOADI 20
-    m->data[6] = 3;  m->data[7] = 200;  // ADD memoria[200]
+    m->data[6] = 3;  m->data[7] = 102;  // ADD memoria[102]
     m->data[8] = 8;                      // HALT
 }
 
@@ -154,90 +48,377 @@ void cargar_programa_ejemplo(Memoria *m) {
  * ------
  * Inicializa la memoria, carga un programa (archivo o ejemplo), crea la CPU
  * y la ejecuta. Finalmente muestra estado y variables.
+ *
+ * Uso: cpu_simulator [--motor=switch|threaded|predecode|jit|simd] [--jit]
+ *                     [--memoria=N|NK] [archivo.mem|archivo.img]
+ *
+ * --memoria fija el espacio de direcciones (256 bytes por defecto, hasta
+ * 64K); los programas lo aprovechan con la forma ancha de las instrucciones
+ * (assembler --ancho=16).
+ *
+ * Modo lote (ver lote.h):
+ *   cpu_simulator --lote=parches.txt [--hilos=N] [--celdas=100,101,102]
+ *                 [--salida=res.csv|res.bin] [--motor=...] programa
+ *   Con --motor=simd las corridas se ejecutan en grupos en lockstep (simd.h).
+ *
+ * Instantáneas (ver instantanea.h):
+ *   --instantanea=estado.snap [--en=N]  ejecuta hasta llegar a N instrucciones
+ *                                       (o hasta el final) y guarda el estado
+ *   --reanudar=estado.snap              continúa desde una instantánea en vez
+ *                                       de cargar un programa; con --lote cada
+ *                                       corrida es un fork de ese estado
+ *
+ * Perfilador (ver perfil.h):
+ *   --perfil[=salida.folded]  informe de puntos calientes al terminar y pilas
+ *                             plegadas para flamegraph (perfil.folded por defecto)
+ *
+ * Modelo de tiempo (ver tiempo.h):
+ *   --tiempo=config.cfg       latencias por opcode y cachés L1/L2; los ciclos
+ *                             pasan a ser estimados (también por corrida en lote)
+ *
+ * Trazas (ver traza.h; se reconstruyen con el reproductor):
+ *   --traza=salida.trz [--claves=N]  graba cada instrucción, con una clave
+ *                                    (estado completo) cada N instrucciones
+ *
+ * Dispositivo de salida (ver dispositivo.h):
+ *   --dispositivo[=F]  los STORE a MEM[248] (DISPOSITIVO_PUERTO) escriben un
+ *                      byte en F (stdout por defecto, o con "-")
+ *
+ * Diagnósticos (ver diagnostico.h):
+ *   --verbosidad=N  0 ninguno, 1 errores, 2 además avisos, 3 además HALT (por
+ *                   defecto); se muestran al final, con los últimos 32 sucesos
  */
 int main(int argc, char *argv[]) {
 
-    Memoria mem;              // Crea la estructura de memoria
-    memoria_init(&mem);       // Limpia memoria (probablemente a 0)
+    const char *mem_path = NULL;
+    MotorCPU motor = MOTOR_SWITCH;
+    const char *lote_parches = NULL;
+    const char *lote_salida = NULL;
+    int lote_hilos = 0;
+    uint16_t celdas[LOTE_MAX_CELDAS] = {100, 101, 102};
+    int n_celdas = 3;
+    uint32_t mem_tam = MEM_TAM_DEFECTO;
+    int motor_fijado = 0;
+    const char *snap_guardar = NULL;
+    const char *snap_reanudar = NULL;
+    unsigned long snap_en = 0;
+    const char *perfil_salida = NULL;
+    const char *tiempo_cfg = NULL;
+    const char *traza_salida = NULL;
+    unsigned long traza_claves = 0;
+    const char *dispositivo_destino = NULL;
+    int con_dispositivo = 0;
+    NivelDiagnostico verbosidad = DIAG_TODO;
+
+    for (int k = 1; k < argc; ++k) {
+        if (strncmp(argv[k], "--motor=", 8) == 0) {
+            int m = cpu_motor_desde_nombre(argv[k] + 8);
+            if (m < 0) {
+                fprintf(stderr, "Motor desconocido: %s\n", argv[k] + 8);
+                return 1;
+            }
+            motor = (MotorCPU)m;
+            motor_fijado = 1;
+        } else if (strcmp(argv[k], "--jit") == 0) {
+            motor = MOTOR_JIT;
+            motor_fijado = 1;
+        } else if (strncmp(argv[k], "--instantanea=", 14) == 0) {
+            snap_guardar = argv[k] + 14;
+        } else if (strncmp(argv[k], "--en=", 5) == 0) {
+            char *fin;
+            snap_en = strtoul(argv[k] + 5, &fin, 0);
+            if (*fin || snap_en == 0) {
+                fprintf(stderr, "Número de instrucciones inválido: %s\n", argv[k] + 5);
+                return 1;
+            }
+        } else if (strcmp(argv[k], "--perfil") == 0) {
+            perfil_salida = "perfil.folded";
+        } else if (strncmp(argv[k], "--perfil=", 9) == 0) {
+            perfil_salida = argv[k] + 9;
+        } else if (strncmp(argv[k], "--tiempo=", 9) == 0) {
+            tiempo_cfg = argv[k] + 9;
+        } else if (strcmp(argv[k], "--dispositivo") == 0) {
+            con_dispositivo = 1;
+        } else if (strncmp(argv[k], "--dispositivo=", 14) == 0) {
+            con_dispositivo = 1;
+            dispositivo_destino = argv[k] + 14;
+        } else if (strncmp(argv[k], "--verbosidad=", 13) == 0) {
+            char *fin;
+            long v = strtol(argv[k] + 13, &fin, 0);
+            if (*fin || fin == argv[k] + 13 || v < DIAG_NADA || v > DIAG_TODO) {
+                fprintf(stderr, "Verbosidad inválida: %s (de %d a %d)\n",
+                        argv[k] + 13, DIAG_NADA, DIAG_TODO);
+                return 1;
+            }
+            verbosidad = (NivelDiagnostico)v;
+        } else if (strncmp(argv[k], "--traza=", 8) == 0) {
+            traza_salida = argv[k] + 8;
+        } else if (strncmp(argv[k], "--claves=", 9) == 0) {
+            char *fin;
+            traza_claves = strtoul(argv[k] + 9, &fin, 0);
+            if (*fin || traza_claves == 0) {
+                fprintf(stderr, "Intervalo de claves inválido: %s\n", argv[k] + 9);
+                return 1;
+            }
+        } else if (strncmp(argv[k], "--reanudar=", 11) == 0) {
+            snap_reanudar = argv[k] + 11;
+        } else if (strncmp(argv[k], "--lote=", 7) == 0) {
+            lote_parches = argv[k] + 7;
+        } else if (strncmp(argv[k], "--salida=", 9) == 0) {
+            lote_salida = argv[k] + 9;
+        } else if (strncmp(argv[k], "--memoria=", 10) == 0) {
+            char *fin;
+            unsigned long t = strtoul(argv[k] + 10, &fin, 0);
+            if (*fin == 'K' || *fin == 'k') {
+                t *= 1024;
+                fin++;
+            }
+            if (*fin || t < MEM_SIZE || t > MEM_MAX) {
+                fprintf(stderr, "Tamaño de memoria inválido: %s (de %u a %u bytes)\n",
+                        argv[k] + 10, MEM_SIZE, MEM_MAX);
+                return 1;
+            }
+            mem_tam = (uint32_t)t;
+        } else if (strncmp(argv[k], "--hilos=", 8) == 0) {
+            char *fin;
+            long h = strtol(argv[k] + 8, &fin, 0);
+            if (*fin || fin == argv[k] + 8 || h < 0 || h > INT_MAX) {
+                fprintf(stderr, "Número de hilos inválido: %s (0 = uno por núcleo)\n", argv[k] + 8);
+                return 1;
+            }
+            lote_hilos = (int)h;
+        } else if (strncmp(argv[k], "--celdas=", 9) == 0) {
+            char *p = argv[k] + 9;
+            n_celdas = 0;
+            for (;;) {
+                char *fin;
+                long d = strtol(p, &fin, 0);
+                if (fin == p || (*fin && *fin != ',')) {
+                    fprintf(stderr, "Lista de celdas inválida: %s\n", argv[k] + 9);
+                    return 1;
+                }
+                if (d < 0 || d >= MEM_MAX) {
+                    fprintf(stderr, "Celda fuera de memoria: %ld\n", d);
+                    return 1;
+                }
+                if (n_celdas == LOTE_MAX_CELDAS) {
+                    fprintf(stderr, "Máximo %d celdas por corrida\n", LOTE_MAX_CELDAS);
+                    return 1;
+                }
+                celdas[n_celdas++] = (uint16_t)d;
+                if (!*fin)
+                    break;
+                p = fin + 1;
+            }
+        } else if (argv[k][0] == '-' && argv[k][1] == '-') {
+            fprintf(stderr, "Opción desconocida: %s\n", argv[k]);
+            fprintf(stderr, "Uso: %s [--motor=switch|threaded|predecode|jit|simd] [--jit] [--memoria=N] [--instantanea=F [--en=N]] [--reanudar=F] [--perfil[=F]] [--tiempo=F] [--traza=F [--claves=N]] [--dispositivo[=F]] [--verbosidad=N] [--lote=F [--hilos=N] [--celdas=A,B,...] [--salida=F]] [archivo.mem|archivo.img]\n", argv[0]);
+            return 1;
+        } else {
+            mem_path = argv[k];
+        }
+    }
 
+    if (snap_en && !snap_guardar) {
+        fprintf(stderr, "--en necesita --instantanea\n");
+        return 1;
+    }
+    if (traza_claves && !traza_salida) {
+        fprintf(stderr, "--claves necesita --traza\n");
+        return 1;
+    }
+    if (traza_salida && lote_parches) {
+        fprintf(stderr, "--traza no admite el modo lote\n");
+        return 1;
+    }
+    if (con_dispositivo && lote_parches) {
+        fprintf(stderr, "--dispositivo no admite el modo lote\n");
+        return 1;
+    }
+    if (snap_reanudar && mem_path) {
+        fprintf(stderr, "--reanudar no admite además un programa\n");
+        return 1;
+    }
+
+    ConfigTiempo cfg_tiempo;
+    if (tiempo_cfg && tiempo_config_cargar(&cfg_tiempo, tiempo_cfg) < 0)
+        return 1;
+
+    Memoria mem;              // Crea la estructura de memoria
+    CPU cpu;
     int bytes_loaded = 0;
+    uint16_t entrada = 0;
     clock_t t0 = clock();
 
-    if (argc > 1) {
-        // Si el usuario pasó un archivo .mem como argumento, se carga
-        bytes_loaded = cargar_memoria_desde_archivo(&mem, argv[1]);
-        if (bytes_loaded < 0) {
-            fprintf(stderr, "Error cargando %s\n", argv[1]);
+    if (snap_reanudar) {
+        // Memoria y CPU salen de la instantánea (incluido su tamaño)
+        if (instantanea_cargar(&cpu, &mem, snap_reanudar) < 0)
             return 1;
-        }
+        if (motor_fijado)
+            cpu.motor = motor;
     } else {
-        // Si no se pasó archivo → cargar programa de ejemplo
-        printf("[AVISO] No se proporcionó archivo .mem. Cargando ejemplo.\n");
-        cargar_programa_ejemplo(&mem);
-        bytes_loaded = 9; /* conocido en el ejemplo */
+        if (memoria_init_tam(&mem, mem_tam) < 0) {  // Página 0 a cero, resto bajo demanda
+            fprintf(stderr, "[ERROR] No se pudo crear una memoria de %u bytes\n", mem_tam);
+            return 1;
+        }
+
+        if (mem_path) {
+            // Si el usuario pasó un archivo .mem/.img como argumento, se carga
+            char *datos;
+            size_t len;
+            bytes_loaded = -1;
+            if (computadora_leer_archivo(mem_path, &datos, &len) == 0) {
+                bytes_loaded = computadora_cargar_imagen(&mem, (const uint8_t *)datos, len,
+                                                         &entrada);
+                free(datos);
+            }
+            if (bytes_loaded < 0) {
+                fprintf(stderr, "Error cargando %s\n", mem_path);
+                return 1;
+            }
+        } else {
+            // Si no se pasó archivo → cargar programa de ejemplo
+            printf("[AVISO] No se proporcionó archivo .mem. Cargando ejemplo.\n");
+            cargar_programa_ejemplo(&mem);
+            bytes_loaded = 9; /* conocido en el ejemplo */
+        }
+
+        // Inicializar la CPU con esa memoria
+        cpu_init(&cpu, &mem);
+        cpu.motor = motor;
+        cpu.PC = entrada;
     }
 
     clock_t t1 = clock();
     double load_time = (double)(t1 - t0) / CLOCKS_PER_SEC;
-    printf("[INFO] Memoria cargada: %d bytes\n", bytes_loaded);
-    printf("[METRIC] Tiempo carga .mem: %.6f s\n", load_time);
+    if (lote_parches) {
+        if (!mem_path && !snap_reanudar) {
+            fprintf(stderr, "El modo lote necesita un programa (.mem o .img) o una instantánea\n");
+            return 1;
+        }
+        LoteConfig cfg = {
+            .base = &mem, .entrada = entrada, .motor = motor, .hilos = lote_hilos,
+            .celdas = celdas, .n_celdas = n_celdas,
+            .inicio = snap_reanudar ? &cpu : NULL,
+            .tiempo = tiempo_cfg ? &cfg_tiempo : NULL,
+        };
+        int r = lote_ejecutar(&cfg, lote_parches, lote_salida);
+        memoria_liberar(&mem);
+        return r == 0 ? 0 : 1;
+    }
 
-    // Inicializar la CPU con esa memoria
-    CPU cpu;
-    cpu_init(&cpu, &mem);
+    if (snap_reanudar)
+        printf("[INFO] Reanudando %s: %lu instrucciones ya ejecutadas, PC = %u\n",
+               snap_reanudar, cpu.met.instrucciones, cpu.PC);
+    else
+        printf("[INFO] Memoria cargada: %d bytes\n", bytes_loaded);
+    printf("[METRIC] Tiempo carga programa: %.6f s\n", load_time);
+
+    if (perfil_salida) {
+        cpu.perfil = perfil_crear(mem.tam, cpu.PC);
+        if (!cpu.perfil) {
+            fprintf(stderr, "[ERROR] Sin memoria para el perfilador\n");
+            memoria_liberar(&mem);
+            return 1;
+        }
+    }
 
-    // Ejecutar instrucciones hasta HALT
-    cpu_ejecutar(&cpu);
+    if (tiempo_cfg) {
+        cpu.tiempo = tiempo_crear(&cfg_tiempo);
+        if (!cpu.tiempo) {
+            fprintf(stderr, "[ERROR] Sin memoria para el modelo de tiempo\n");
+            memoria_liberar(&mem);
+            return 1;
+        }
+    }
 
-    // Mostrar estado final (cpu_ejecutar ya imprime estado y métricas CPU)
+    if (traza_salida) {
+        cpu.traza = traza_abrir(traza_salida, traza_claves);
+        if (!cpu.traza) {
+            fprintf(stderr, "[ERROR] No se pudo crear la traza %s\n", traza_salida);
+            memoria_liberar(&mem);
+            return 1;
+        }
+    }
 
-    // Mostrar valores importantes en memoria
-    printf("\n--- Variables principales en memoria ---\n");
-    printf("N (MEM[100]) = %d\n", mem.data[100]);
-    printf("contador (MEM[101]) = %d\n", mem.data[101]);
-    printf("resultado (MEM[200]) = %d\n", mem.data[200]);
+    if (con_dispositivo) {
+        cpu.dispositivo = dispositivo_abrir(dispositivo_destino);
+        if (!cpu.dispositivo) {
+            fprintf(stderr, "[ERROR] No se pudo abrir el dispositivo de salida %s\n",
+                    dispositivo_destino ? dispositivo_destino : "-");
+            memoria_liberar(&mem);
+            return 1;
+        }
+    }
 
-    return 0;
-}
-=======
-#include "cpu.h"
-#include "alu.h"
-#include "memoria.h"
+    // Ejecutar instrucciones hasta HALT (o hasta el punto de la instantánea)
+    cpu.limite = snap_en;
+    cpu.verbosidad = verbosidad;
+    cpu_ejecutar(&cpu);
 
-// Carga datos desde un archivo de texto (.mem) a la memoria simulada.
-void cargar_memoria_desde_archivo(Memoria *m, const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) return;
-    int i = 0;
-    int val;
-    while (i < MEM_SIZE && fscanf(f, "%d", &val) == 1) {
-        m->data[i++] = (uint8_t)val;  // Carga byte a byte
+    if (cpu.dispositivo) {
+        uint64_t bytes, vuelcos;
+        int r = dispositivo_cerrar(cpu.dispositivo, &bytes, &vuelcos, NULL);
+        cpu.dispositivo = NULL;
+        if (r < 0) {
+            fprintf(stderr, "[ERROR] No se pudo escribir la salida del dispositivo\n");
+            memoria_liberar(&mem);
+            return 1;
+        }
+        printf("[INFO] Dispositivo: %llu bytes en %llu vuelcos\n",
+               (unsigned long long)bytes, (unsigned long long)vuelcos);
     }
-    fclose(f);
-}
 
-int main(int argc, char *argv[]) {
-    Memoria mem;
-    memoria_init(&mem);  // Inicializa memoria en 0
+    if (cpu.traza) {
+        uint64_t bytes, registros;
+        int r = traza_cerrar(cpu.traza, &cpu, &bytes, &registros);
+        cpu.traza = NULL;
+        if (r < 0) {
+            fprintf(stderr, "[ERROR] No se pudo escribir la traza %s\n", traza_salida);
+            memoria_liberar(&mem);
+            return 1;
+        }
+        printf("[INFO] Traza en %s: %llu instrucciones, %llu bytes (%.2f bytes/instrucción)\n",
+               traza_salida, (unsigned long long)registros, (unsigned long long)bytes,
+               registros ? (double)bytes / (double)registros : 0.0);
+    }
 
-    if (argc > 1) {
-        cargar_memoria_desde_archivo(&mem, argv[1]);
-    } else {
-        mem.data[100] = 30;  // Dato 1
-        mem.data[101] = 20;  // Dato 2
-        // Programa de ejemplo
-        mem.data[0] = 0x05; mem.data[1] = 30;   // LOADI 30
-        mem.data[2] = 0x02; mem.data[3] = 200;  // STORE 200
-        mem.data[4] = 0x05; mem.data[5] = 20;   // LOADI 20
-        mem.data[6] = 0x03; mem.data[7] = 200;  // ADD 200 -> A=20+30=50
-        mem.data[8] = 0x08;                     // HALT
+    if (snap_guardar) {
+        cpu.limite = 0;
+        if (instantanea_guardar(&cpu, snap_guardar) < 0) {
+            fprintf(stderr, "[ERROR] No se pudo escribir la instantánea %s\n", snap_guardar);
+            memoria_liberar(&mem);
+            return 1;
+        }
+        printf("[INFO] Instantánea guardada en %s tras %lu instrucciones\n",
+               snap_guardar, cpu.met.instrucciones);
     }
 
-    CPU cpu;
-    cpu_init(&cpu, &mem);  // Inicializa CPU
-    cpu_ejecutar(&cpu);    // Ejecuta el programa cargado
+    // Mostrar estado final y métricas de la CPU
+    cpu_imprimir_resumen(&cpu);
+    if (mem.tam > MEM_SIZE)
+        printf("[INFO] Espacio de direcciones: %u bytes, %u páginas de %u reservadas\n",
+               mem.tam, memoria_paginas_usadas(&mem), MEM_PAGINA);
+
+    if (cpu.perfil) {
+        perfil_informe(cpu.perfil, stdout, 10);
+        if (perfil_escribir_plegado(cpu.perfil, perfil_salida) == 0)
+            printf("[INFO] Pilas plegadas (flamegraph) en %s\n", perfil_salida);
+        else
+            fprintf(stderr, "[ERROR] No se pudo escribir %s\n", perfil_salida);
+        perfil_destruir(cpu.perfil);
+        cpu.perfil = NULL;
+    }
+
+    tiempo_destruir(cpu.tiempo);
+    cpu.tiempo = NULL;
+
+    // Mostrar valores importantes en memoria
+    printf("\n--- Variables principales en memoria ---\n");
+    printf("N (MEM[100]) = %d\n", mem.data[100]);
+    printf("contador (MEM[101]) = %d\n", mem.data[101]);
+    printf("resultado (MEM[102]) = %d\n", mem.data[102]);
 
-    printf("Registro A final: %d\n", cpu.A);  // Resultado final
+    memoria_liberar(&mem);
     return 0;
 }
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
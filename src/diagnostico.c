@@ -0,0 +1,113 @@
+/*
+ * Archivo: diagnostico.c
+ * Anillo de diagnósticos por CPU y su informe en texto.
+ */
+
+#include <string.h>
+#include "diagnostico.h"
+#include "cpu.h"
+
+static const struct {
+    NivelDiagnostico nivel;
+    const char *nombre;
+} tipos[DIAG_TIPOS] = {
+    [DIAG_LECTURA_FUERA] = { DIAG_ERRORES, "lectura fuera de memoria" },
+    [DIAG_PILA_LLENA]    = { DIAG_ERRORES, "desbordamiento de pila" },
+    [DIAG_PILA_VACIA]    = { DIAG_ERRORES, "pila vacía" },
+    [DIAG_OPCODE]        = { DIAG_ERRORES, "opcode desconocido" },
+    [DIAG_DIR_FUERA]     = { DIAG_AVISOS,  "dirección fuera de rango" },
+    [DIAG_SALTO_FUERA]   = { DIAG_AVISOS,  "salto fuera de rango" },
+    [DIAG_CALL_FUERA]    = { DIAG_AVISOS,  "CALL fuera de rango" },
+    [DIAG_RET_INVALIDO]  = { DIAG_AVISOS,  "RET inválido" },
+    [DIAG_HALT]          = { DIAG_TODO,    "HALT" },
+};
+
+void diagnostico_reiniciar(Diagnosticos *d) {
+    d->total = 0;
+    memset(d->por_tipo, 0, sizeof(d->por_tipo));
+}
+
+__attribute__((cold))
+void diagnostico_anotar(Diagnosticos *d, TipoDiagnostico tipo, uint8_t opcode,
+                        uint32_t valor, uint64_t instruccion) {
+    SucesoDiagnostico *s = &d->anillo[d->total & (DIAG_ANILLO - 1)];
+    s->instruccion = instruccion;
+    s->valor = valor;
+    s->tipo = (uint8_t)tipo;
+    s->opcode = opcode;
+    d->total++;
+    d->por_tipo[tipo]++;
+}
+
+NivelDiagnostico diagnostico_nivel(TipoDiagnostico tipo) {
+    return tipo < DIAG_TIPOS ? tipos[tipo].nivel : DIAG_ERRORES;
+}
+
+const char *diagnostico_nombre(TipoDiagnostico tipo) {
+    return tipo < DIAG_TIPOS ? tipos[tipo].nombre : "?";
+}
+
+/* Los mismos mensajes que imprimía el núcleo al momento */
+static void escribir_suceso(const SucesoDiagnostico *s, FILE *f) {
+    switch (s->tipo) {
+        case DIAG_LECTURA_FUERA:
+            fprintf(f, "[ERROR] Lectura fuera de memoria en PC=%u\n", s->valor);
+            break;
+        case DIAG_PILA_LLENA:
+            fprintf(f, "[ERROR] Desbordamiento de pila (SP=%u)\n", s->valor);
+            break;
+        case DIAG_PILA_VACIA:
+            fprintf(f, "[ERROR] Pila vacía (SP=%u)\n", s->valor);
+            break;
+        case DIAG_OPCODE:
+            fprintf(f, "[ERROR] Opcode desconocido: %u en PC=%u\n", s->opcode, s->valor);
+            break;
+        case DIAG_DIR_FUERA:
+            fprintf(f, "[WARN] Dirección fuera de rango en %s %u\n",
+                    cpu_opcode_nombre(s->opcode & ~OP_ANCHO), s->valor);
+            break;
+        case DIAG_SALTO_FUERA:
+            fprintf(f, "[WARN] Salto fuera de rango a %u\n", s->valor);
+            break;
+        case DIAG_CALL_FUERA:
+            fprintf(f, "[WARN] Dirección de CALL fuera de rango %u\n", s->valor);
+            break;
+        case DIAG_RET_INVALIDO:
+            fprintf(f, "[WARN] Dirección de RET inválida %u\n", s->valor);
+            break;
+        case DIAG_HALT:
+            fprintf(f, "[CPU] HALT ejecutado\n");
+            break;
+    }
+}
+
+void diagnostico_informe(const Diagnosticos *d, NivelDiagnostico verbosidad, FILE *f) {
+    uint64_t desde = d->total > DIAG_ANILLO ? d->total - DIAG_ANILLO : 0;
+    uint64_t visibles = 0, guardados = 0;
+    for (int t = 0; t < DIAG_TIPOS; ++t)
+        if (tipos[t].nivel <= verbosidad)
+            visibles += d->por_tipo[t];
+    for (uint64_t k = desde; k < d->total; ++k)
+        if (diagnostico_nivel((TipoDiagnostico)d->anillo[k & (DIAG_ANILLO - 1)].tipo) <= verbosidad)
+            guardados++;
+
+    /* Se perdieron sucesos: primero cuántos hubo de cada tipo */
+    if (visibles > guardados) {
+        fprintf(f, "[INFO] %llu diagnósticos, se muestran los últimos %llu; por tipo:",
+                (unsigned long long)visibles, (unsigned long long)guardados);
+        const char *sep = " ";
+        for (int t = 0; t < DIAG_TIPOS; ++t) {
+            if (tipos[t].nivel > verbosidad || d->por_tipo[t] == 0)
+                continue;
+            fprintf(f, "%s%llu %s", sep, (unsigned long long)d->por_tipo[t], tipos[t].nombre);
+            sep = ", ";
+        }
+        fputc('\n', f);
+    }
+
+    for (uint64_t k = desde; k < d->total; ++k) {
+        const SucesoDiagnostico *s = &d->anillo[k & (DIAG_ANILLO - 1)];
+        if (diagnostico_nivel((TipoDiagnostico)s->tipo) <= verbosidad)
+            escribir_suceso(s, f);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef DIAGNOSTICO_H
+#define DIAGNOSTICO_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Diagnósticos de la ejecución (direcciones fuera de rango, errores de
+ * pila, opcodes desconocidos, HALT).
+ *
+ * El núcleo no imprime nada: cada suceso se anota en un anillo de tamaño
+ * fijo dentro de la CPU (tipo, opcode, valor y número de instrucción) y
+ * suma uno al contador de su tipo. El texto se arma sólo al informar
+ * (cpu_imprimir_resumen), con los últimos DIAG_ANILLO sucesos y el total
+ * por tipo si hubo más; así un programa que repite el mismo aviso millones
+ * de veces, o un lote de miles de corridas, no inunda la salida.
+ */
+
+#define DIAG_ANILLO 32              // sucesos guardados por CPU (potencia de dos)
+
+typedef enum {
+    DIAG_LECTURA_FUERA = 0,         // fetch con el PC fuera de memoria
+    DIAG_PILA_LLENA,
+    DIAG_PILA_VACIA,
+    DIAG_OPCODE,                    // opcode desconocido
+    DIAG_DIR_FUERA,                 // operando de datos fuera de memoria
+    DIAG_SALTO_FUERA,
+    DIAG_CALL_FUERA,
+    DIAG_RET_INVALIDO,
+    DIAG_HALT,
+    DIAG_TIPOS
+} TipoDiagnostico;
+
+/* Verbosidad del informe: se muestran los sucesos de nivel <= verbosidad */
+typedef enum {
+    DIAG_NADA = 0,
+    DIAG_ERRORES,                   // [ERROR]: la CPU se detiene
+    DIAG_AVISOS,                    // [WARN]: la instrucción sigue con otro valor
+    DIAG_TODO                       // además [CPU] HALT
+} NivelDiagnostico;
+
+typedef struct {
+    uint64_t instruccion;           // met.instrucciones al ocurrir (los motores rápidos lo vuelcan por tramos)
+    uint32_t valor;                 // dirección, SP o PC según el tipo
+    uint8_t tipo;
+    uint8_t opcode;
+} SucesoDiagnostico;
+
+typedef struct {
+    uint64_t total;                 // sucesos anotados (el anillo guarda los últimos)
+    uint64_t por_tipo[DIAG_TIPOS];
+    SucesoDiagnostico anillo[DIAG_ANILLO];
+} Diagnosticos;
+
+/* Sin sucesos (el anillo no se borra: sólo vale hasta 'total') */
+void diagnostico_reiniciar(Diagnosticos *d);
+
+/* Gancho del núcleo: fuera de línea y marcado frío, no toca libc */
+void diagnostico_anotar(Diagnosticos *d, TipoDiagnostico tipo, uint8_t opcode,
+                        uint32_t valor, uint64_t instruccion);
+
+NivelDiagnostico diagnostico_nivel(TipoDiagnostico tipo);
+const char *diagnostico_nombre(TipoDiagnostico tipo);
+
+/* Sucesos de nivel <= 'verbosidad' en texto y, si se perdieron, el total por tipo */
+void diagnostico_informe(const Diagnosticos *d, NivelDiagnostico verbosidad, FILE *f);
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Archivo: dispositivo.c
+ * Dispositivo de salida: bloques que llena la CPU y un hilo escritor que
+ * los vuelca con writev (o los copia a memoria).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "dispositivo.h"
+
+// ==================== ESCRITOR ====================
+
+/* Escribe los 'n' trozos enteros aunque writev acepte menos de una vez */
+static int volcar_fd(int fd, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t w = writev(fd, iov, n);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        while (n > 0 && (size_t)w >= iov->iov_len) {
+            w -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + w;
+            iov->iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+}
+
+static int volcar_memoria(Dispositivo *d, const struct iovec *iov, int n) {
+    size_t total = d->bytes;
+    for (int i = 0; i < n; ++i)
+        total += iov[i].iov_len;
+    if (total > d->cap_memoria) {
+        size_t cap = d->cap_memoria ? d->cap_memoria : DISPOSITIVO_BLOQUE;
+        while (cap < total)
+            cap *= 2;
+        uint8_t *m = realloc(d->memoria, cap);
+        if (!m)
+            return -1;
+        d->memoria = m;
+        d->cap_memoria = cap;
+    }
+    size_t pos = d->bytes;
+    for (int i = 0; i < n; ++i) {
+        memcpy(d->memoria + pos, iov[i].iov_base, iov[i].iov_len);
+        pos += iov[i].iov_len;
+    }
+    return 0;
+}
+
+/*
+ * Toma todos los bloques llenos, los vuelca fuera del lock y los devuelve
+ * a la lista de libres. Tras un error los bloques se descartan sin volcar
+ * (la CPU no se queda esperando) y dispositivo_cerrar lo informa.
+ */
+static void *escritor(void *arg) {
+    Dispositivo *d = arg;
+    struct iovec iov[DISPOSITIVO_BLOQUES];
+
+    pthread_mutex_lock(&d->lock);
+    for (;;) {
+        while (d->n_llenos == 0 && !d->cerrando)
+            pthread_cond_wait(&d->hay_llenos, &d->lock);
+        if (d->n_llenos == 0)
+            break;
+
+        int n = d->n_llenos;
+        uint8_t *bloques[DISPOSITIVO_BLOQUES];
+        uint64_t bytes = 0;
+        for (int i = 0; i < n; ++i) {
+            bloques[i] = d->llenos[i];
+            iov[i].iov_base = d->llenos[i];
+            iov[i].iov_len = d->tam_llenos[i];
+            bytes += d->tam_llenos[i];
+        }
+        pthread_mutex_unlock(&d->lock);
+
+        if (!d->error) {
+            int r = d->fd >= 0 ? volcar_fd(d->fd, iov, n) : volcar_memoria(d, iov, n);
+            if (r < 0)
+                d->error = 1;
+            else {
+                d->bytes += bytes;
+                d->vuelcos++;
+            }
+        }
+
+        pthread_mutex_lock(&d->lock);
+        /* Llegaron más mientras tanto: quedan detrás de los volcados */
+        memmove(d->llenos, d->llenos + n, (size_t)(d->n_llenos - n) * sizeof(d->llenos[0]));
+        memmove(d->tam_llenos, d->tam_llenos + n,
+                (size_t)(d->n_llenos - n) * sizeof(d->tam_llenos[0]));
+        d->n_llenos -= n;
+        for (int i = 0; i < n; ++i)
+            d->libres[d->n_libres++] = bloques[i];
+        pthread_cond_signal(&d->hay_libres);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+// ==================== CPU ====================
+
+/* Pasa el bloque en curso al escritor y toma uno libre (esperando si no hay) */
+void dispositivo_entregar(Dispositivo *d) {
+    pthread_mutex_lock(&d->lock);
+    if (d->n > 0) {
+        d->llenos[d->n_llenos] = d->bloque;
+        d->tam_llenos[d->n_llenos] = d->n;
+        d->n_llenos++;
+        pthread_cond_signal(&d->hay_llenos);
+        while (d->n_libres == 0)
+            pthread_cond_wait(&d->hay_libres, &d->lock);
+        d->bloque = d->libres[--d->n_libres];
+        d->n = 0;
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+// ==================== API ====================
+
+static void liberar(Dispositivo *d) {
+    for (int i = 0; i < d->n_libres; ++i)
+        free(d->libres[i]);
+    free(d->bloque);
+    free(d->memoria);
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->hay_llenos);
+    pthread_cond_destroy(&d->hay_libres);
+    free(d);
+}
+
+static Dispositivo *crear(int fd, int cerrar_fd) {
+    Dispositivo *d = calloc(1, sizeof(Dispositivo));
+    if (!d)
+        return NULL;
+    d->fd = fd;
+    d->cerrar_fd = cerrar_fd;
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->hay_llenos, NULL);
+    pthread_cond_init(&d->hay_libres, NULL);
+
+    d->bloque = malloc(DISPOSITIVO_BLOQUE);
+    if (!d->bloque)
+        goto error;
+    for (int i = 1; i < DISPOSITIVO_BLOQUES; ++i) {
+        uint8_t *b = malloc(DISPOSITIVO_BLOQUE);
+        if (!b)
+            goto error;
+        d->libres[d->n_libres++] = b;
+    }
+
+    if (pthread_create(&d->hilo, NULL, escritor, d) != 0)
+        goto error;
+    return d;
+
+error:
+    if (cerrar_fd)
+        close(fd);
+    liberar(d);
+    return NULL;
+}
+
+Dispositivo *dispositivo_abrir(const char *destino) {
+    if (!destino || strcmp(destino, "-") == 0) {
+        /* Lo que el simulador ya imprimió va antes que la salida del invitado */
+        fflush(stdout);
+        return crear(STDOUT_FILENO, 0);
+    }
+    int fd = open(destino, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open dispositivo");
+        return NULL;
+    }
+    return crear(fd, 1);
+}
+
+Dispositivo *dispositivo_abrir_memoria(void) {
+    return crear(-1, 0);
+}
+
+int dispositivo_cerrar(Dispositivo *d, uint64_t *bytes, uint64_t *vuelcos, uint8_t **datos) {
+    dispositivo_entregar(d);
+    pthread_mutex_lock(&d->lock);
+    d->cerrando = 1;
+    pthread_cond_signal(&d->hay_llenos);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->hilo, NULL);
+
+    if (d->cerrar_fd && close(d->fd) != 0)
+        d->error = 1;
+    int ret = d->error ? -1 : 0;
+    if (bytes) *bytes = d->bytes;
+    if (vuelcos) *vuelcos = d->vuelcos;
+    if (datos) {
+        *datos = d->memoria;
+        d->memoria = NULL;
+    }
+    liberar(d);
+    return ret;
+}
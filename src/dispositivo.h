@@ -0,0 +1,87 @@
+#ifndef DISPOSITIVO_H
+#define DISPOSITIVO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/*
+ * Dispositivo de salida mapeado en memoria.
+ *
+ * Con cpu->dispositivo != NULL, cada STORE del invitado a DISPOSITIVO_PUERTO
+ * agrega A a la salida (el byte también queda en la celda, así que leer el
+ * puerto devuelve lo último escrito). PUSH y CALL no cuentan: sólo STORE.
+ *
+ * La CPU copia el byte en el bloque en curso y nada más; al llenarse, el
+ * bloque pasa a la cola de un hilo escritor y la CPU toma uno libre. El
+ * escritor vuelca de una vez, con writev, todos los bloques que encuentre
+ * en la cola, así que un invitado que produce mucho hace pocas llamadas al
+ * sistema y nunca espera a stdio. La CPU sólo se detiene si los
+ * DISPOSITIVO_BLOQUES bloques están llenos (el destino no da abasto).
+ *
+ * El destino es un descriptor (stdout o un archivo) o un búfer en memoria
+ * que se recoge al cerrar.
+ *
+ * En el núcleo switch y en el camino lento de los demás el STORE compara
+ * la dirección; threaded compara en su manejador de STORE; predecode
+ * decodifica el STORE al puerto con su propio código y el JIT deja esa
+ * instrucción al intérprete, así que los STORE a otras direcciones no
+ * pagan nada en esos dos. El modo lote (lote.h) no tiene dispositivo.
+ */
+
+#define DISPOSITIVO_PUERTO   0xF8       // STORE aquí = un byte a la salida
+#define DISPOSITIVO_BLOQUE   (1u << 16) // bytes por bloque
+#define DISPOSITIVO_BLOQUES  8          // bloques en total (en curso, en cola y libres)
+
+typedef struct Dispositivo {
+    /* Lado de la CPU */
+    uint8_t *bloque;            // bloque que se llena
+    uint32_t n;                 // bytes en él
+
+    /* Compartido, bajo 'lock' */
+    pthread_mutex_t lock;
+    pthread_cond_t hay_llenos, hay_libres;
+    uint8_t *libres[DISPOSITIVO_BLOQUES];
+    int n_libres;
+    uint8_t *llenos[DISPOSITIVO_BLOQUES];   // en orden de llegada
+    uint32_t tam_llenos[DISPOSITIVO_BLOQUES];
+    int n_llenos;
+    int cerrando;
+
+    /* Lado del escritor */
+    pthread_t hilo;
+    int fd;                     // destino (-1: en memoria)
+    int cerrar_fd;              // el descriptor lo abrió dispositivo_abrir
+    uint8_t *memoria;           // destino en memoria
+    size_t cap_memoria;
+    int error;
+    uint64_t bytes;             // entregados al destino
+    uint64_t vuelcos;           // llamadas a writev (o copias a memoria)
+} Dispositivo;
+
+/*
+ * Salida a 'destino': NULL o "-" es stdout (se vacía antes el búfer de
+ * stdio); si no, el archivo se crea o trunca. NULL si no se pudo.
+ */
+Dispositivo *dispositivo_abrir(const char *destino);
+
+/* Salida a un búfer en memoria (ver dispositivo_cerrar) */
+Dispositivo *dispositivo_abrir_memoria(void);
+
+/*
+ * Entrega lo pendiente, espera al escritor y libera 'd'. 0 si todo llegó al
+ * destino. Con destino en memoria, *datos (si no es NULL) recibe lo escrito
+ * (malloc, lo libera quien llama; NULL si no hubo salida) y *bytes su tamaño.
+ */
+int dispositivo_cerrar(Dispositivo *d, uint64_t *bytes, uint64_t *vuelcos, uint8_t **datos);
+
+/* --- Gancho del núcleo (en línea salvo el bloque lleno) --- */
+void dispositivo_entregar(Dispositivo *d);
+
+static inline void dispositivo_escribir(Dispositivo *d, uint8_t v) {
+    d->bloque[d->n++] = v;
+    if (d->n == DISPOSITIVO_BLOQUE)
+        dispositivo_entregar(d);
+}
+
+#endif
@@ -0,0 +1,813 @@
+/*
+ * ensamblador.c - ensamblador de una pasada con referencias hacia delante
+ * (ver ensamblador.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "ensamblador.h"
+#include "cpu.h"
+#include "dispositivo.h"
+
+#define LECTOR_BLOQUE (1 << 20)     // bytes leídos de una vez de un archivo
+
+/* ------------------------- Tabla de mnemónicos -------------------------------
+ * Una sola tabla, ordenada por nombre, decide el tamaño y la codificación:
+ * añadir un opcode es añadir una fila.
+ */
+typedef enum {
+    OPERANDO_NINGUNO,     // sólo el opcode
+    OPERANDO_INMEDIATO,   // opcode + valor de 8 bits
+    OPERANDO_DIRECCION,   // opcode + dirección de 8 bits (o 16 con ancho 16)
+    OPERANDO_RET          // sin operando; con ancho 16 la forma ancha (retorno de 2 bytes)
+} TipoOperando;
+
+typedef struct {
+    const char *nombre;
+    uint8_t opcode;
+    TipoOperando operando;
+} Mnemonico;
+
+static const Mnemonico mnemonicos[] = {
+    { "ADD",   3,  OPERANDO_DIRECCION },
+    { "CALL",  11, OPERANDO_DIRECCION },
+    { "DI",    16, OPERANDO_NINGUNO },
+    { "EI",    15, OPERANDO_NINGUNO },
+    { "HALT",  8,  OPERANDO_NINGUNO },
+    { "JMP",   7,  OPERANDO_DIRECCION },
+    { "JMPZ",  13, OPERANDO_DIRECCION },
+    { "LOAD",  6,  OPERANDO_DIRECCION },    // alias de LOADM
+    { "LOADA", 5,  OPERANDO_INMEDIATO },    // alias de LOADI
+    { "LOADI", 5,  OPERANDO_INMEDIATO },
+    { "LOADM", 6,  OPERANDO_DIRECCION },
+    { "MUL",   14, OPERANDO_DIRECCION },
+    { "NOP",   1,  OPERANDO_NINGUNO },
+    { "POP",   10, OPERANDO_NINGUNO },
+    { "PUSH",  9,  OPERANDO_NINGUNO },
+    { "RET",   12, OPERANDO_RET },
+    { "RETI",  17, OPERANDO_RET },
+    { "STORE", 2,  OPERANDO_DIRECCION },
+    { "SUB",   4,  OPERANDO_DIRECCION },
+    { "TIMER", 18, OPERANDO_DIRECCION },
+    { "VECTOR", 19, OPERANDO_DIRECCION },
+};
+#define N_MNEMONICOS (sizeof(mnemonicos) / sizeof(mnemonicos[0]))
+
+/* Búsqueda binaria sin distinguir mayúsculas (sin copiar ni convertir el token) */
+static const Mnemonico *buscar_mnemonico(const char *tok) {
+    size_t lo = 0, hi = N_MNEMONICOS;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = strcasecmp(tok, mnemonicos[mid].nombre);
+        if (c == 0)
+            return &mnemonicos[mid];
+        if (c < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+/* ------------------------- Tabla de símbolos (etiquetas) ----------------------
+ * Hash con direccionamiento abierto (sondeo lineal) sobre índices de un
+ * vector de símbolos. Tanto las definiciones como los usos se internan.
+ * Los nombres viven en un único búfer (por desplazamiento, que sobrevive a
+ * los realloc).
+ */
+typedef struct {
+    size_t nombre;      // desplazamiento en 'nombres'
+    uint32_t hash;
+    int address;        // -1 mientras no se defina
+    int pendientes;     // primera referencia sin resolver (en 'arreglos'), o -1
+} Simbolo;
+
+/* ------------- Referencias hacia delante aún sin resolver -------------------
+ * Listas enlazadas por índice, una por símbolo. Los nodos de una etiqueta ya
+ * definida vuelven a la lista libre, así que el vector sólo crece con el
+ * máximo de referencias pendientes a la vez.
+ */
+typedef struct {
+    size_t pos;          // primer byte de la dirección en 'salida'
+    int lineno;          // número de línea para mensajes de error
+    int siguiente;       // siguiente nodo de la lista, o -1
+} Arreglo;
+
+/* ------------------- Lector de la entrada por líneas -------------------------
+ * Devuelve cada línea terminada en '\0' dentro de su propio búfer (se puede
+ * modificar hasta pedir la siguiente). Sin límite de longitud de línea: si
+ * una no cabe, el búfer crece. Desde un archivo se lee por bloques; desde
+ * memoria cada línea se copia al búfer (la fuente no se toca).
+ */
+typedef struct {
+    FILE *f;                // NULL: leer de 'fuente'
+    const char *fuente;
+    size_t fuente_len, fuente_pos;
+    char *buf;
+    size_t cap, ini, fin;
+    int eof;
+} Lector;
+
+/* ---------------- Instrucción retenida para la mirilla ----------------------
+ * Con ENSAMBLADOR_MIRILLA el código no se emite al leerlo: cada instrucción
+ * (y cada definición de etiqueta, en su sitio) queda en una lista que la
+ * mirilla reescribe antes de emitirla entera.
+ */
+typedef struct {
+    const Mnemonico *m;     // NULL: definición de la etiqueta 'simbolo'
+    int valor;              // inmediato, o dirección si 'simbolo' es -1
+    int simbolo;            // etiqueta del operando o la que se define, o -1
+    int lineno;
+} Pendiente;
+
+/* Estado de un ensamblado */
+typedef struct {
+    int ancho;              // bits de los operandos de dirección (8 o 16)
+    int mirilla;            // retener el código y pasarle la mirilla
+    int error;              // sin memoria
+
+    Simbolo *simbolos;
+    int n_simbolos, cap_simbolos;
+    int *tabla_hash;        // índice + 1 (0 = vacío)
+    uint32_t cap_hash;      // potencia de dos
+    char *nombres;
+    size_t nombres_len, nombres_cap;
+
+    Arreglo *arreglos;
+    int n_arreglos, cap_arreglos;
+    int arreglos_libres;
+
+    uint8_t *salida;        // bytes generados
+    size_t salida_len, salida_cap;
+
+    Pendiente *lista;       // sólo con la mirilla
+    int n_lista, cap_lista;
+
+    int lineas, instrucciones;
+    int patrones[ENSAMBLADOR_PATRONES];     // veces que se aplicó cada patrón
+    int bytes_ahorrados;
+} Ensamblador;
+
+/* realloc que marca el error en vez de perder el bloque */
+static int crecer(Ensamblador *e, void **p, size_t n) {
+    void *q = realloc(*p, n);
+    if (!q) {
+        e->error = 1;
+        return -1;
+    }
+    *p = q;
+    return 0;
+}
+
+static uint32_t hash_nombre(const char *s) {
+    uint32_t h = 2166136261u;           // FNV-1a
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int rehash(Ensamblador *e, uint32_t cap) {
+    int *t = calloc(cap, sizeof(int));
+    if (!t) {
+        e->error = 1;
+        return -1;
+    }
+    for (int i = 0; i < e->n_simbolos; ++i) {
+        uint32_t k = e->simbolos[i].hash & (cap - 1);
+        while (t[k])
+            k = (k + 1) & (cap - 1);
+        t[k] = i + 1;
+    }
+    free(e->tabla_hash);
+    e->tabla_hash = t;
+    e->cap_hash = cap;
+    return 0;
+}
+
+/* Índice del símbolo 'name' (lo crea sin dirección si no existe); -1 sin memoria */
+static int simbolo(Ensamblador *e, const char *name) {
+    uint32_t h = hash_nombre(name);
+    if (e->cap_hash) {
+        uint32_t m = e->cap_hash - 1;
+        for (uint32_t k = h & m; e->tabla_hash[k]; k = (k + 1) & m) {
+            Simbolo *s = &e->simbolos[e->tabla_hash[k] - 1];
+            if (s->hash == h && strcmp(e->nombres + s->nombre, name) == 0)
+                return e->tabla_hash[k] - 1;
+        }
+    }
+
+    /* Nuevo: la tabla se mantiene a menos de la mitad de ocupación */
+    if (e->n_simbolos == e->cap_simbolos) {
+        int cap = e->cap_simbolos ? e->cap_simbolos * 2 : 256;
+        if (crecer(e, (void **)&e->simbolos, (size_t)cap * sizeof(Simbolo)) < 0)
+            return -1;
+        e->cap_simbolos = cap;
+    }
+    size_t len = strlen(name) + 1;
+    if (e->nombres_len + len > e->nombres_cap) {
+        size_t cap = e->nombres_cap ? e->nombres_cap : 4096;
+        while (e->nombres_len + len > cap)
+            cap *= 2;
+        if (crecer(e, (void **)&e->nombres, cap) < 0)
+            return -1;
+        e->nombres_cap = cap;
+    }
+    if ((uint32_t)(e->n_simbolos + 1) * 2 > e->cap_hash &&
+        rehash(e, e->cap_hash ? e->cap_hash * 2 : 1024) < 0)
+        return -1;
+
+    memcpy(e->nombres + e->nombres_len, name, len);
+    e->simbolos[e->n_simbolos] = (Simbolo){ e->nombres_len, h, -1, -1 };
+    e->nombres_len += len;
+
+    uint32_t m = e->cap_hash - 1;
+    uint32_t k = h & m;
+    while (e->tabla_hash[k])
+        k = (k + 1) & m;
+    e->tabla_hash[k] = ++e->n_simbolos;
+    return e->n_simbolos - 1;
+}
+
+static void emitir_byte(Ensamblador *e, int val) {
+    if (e->salida_len == e->salida_cap) {
+        size_t cap = e->salida_cap ? e->salida_cap * 2 : 256;
+        if (crecer(e, (void **)&e->salida, cap) < 0)
+            return;
+        e->salida_cap = cap;
+    }
+    e->salida[e->salida_len++] = (uint8_t)(val & 0xFF);
+}
+
+/* ---- Escribe la dirección en 'pos' (1 byte, o 2 little endian con ancho 16) ---- */
+static void escribir_dir(Ensamblador *e, size_t pos, int addr, int lineno) {
+    if (e->error)
+        return;
+    if (e->ancho == 16) {
+        if (addr < 0 || addr > 0xFFFF)
+            fprintf(stderr, "[WARN] linea %d: dirección %d fuera de 16 bits\n", lineno, addr);
+        e->salida[pos] = (uint8_t)addr;
+        e->salida[pos + 1] = (uint8_t)(addr >> 8);
+        return;
+    }
+    if (addr < 0 || addr > 0xFF)
+        fprintf(stderr, "[WARN] linea %d: dirección %d no cabe en 8 bits (use --ancho=16)\n",
+                lineno, addr);
+    e->salida[pos] = (uint8_t)addr;
+}
+
+/* ------ Opcode (forma ancha con ancho 16) y hueco para la dirección ---------- */
+static size_t reservar_dir(Ensamblador *e, int opcode) {
+    emitir_byte(e, e->ancho == 16 ? opcode | OP_ANCHO : opcode);
+    size_t pos = e->salida_len;
+    emitir_byte(e, 0);
+    if (e->ancho == 16)
+        emitir_byte(e, 0);
+    return pos;
+}
+
+static void emitir_dir(Ensamblador *e, int opcode, int addr, int lineno) {
+    escribir_dir(e, reservar_dir(e, opcode), addr, lineno);
+}
+
+/* Apunta el hueco 'pos' en la lista de pendientes del símbolo 'i' */
+static void referencia_pendiente(Ensamblador *e, int i, size_t pos, int lineno) {
+    int n = e->arreglos_libres;
+    if (n >= 0) {
+        e->arreglos_libres = e->arreglos[n].siguiente;
+    } else {
+        if (e->n_arreglos == e->cap_arreglos) {
+            int cap = e->cap_arreglos ? e->cap_arreglos * 2 : 256;
+            if (crecer(e, (void **)&e->arreglos, (size_t)cap * sizeof(Arreglo)) < 0)
+                return;
+            e->cap_arreglos = cap;
+        }
+        n = e->n_arreglos++;
+    }
+    e->arreglos[n] = (Arreglo){ pos, lineno, e->simbolos[i].pendientes };
+    e->simbolos[i].pendientes = n;
+}
+
+/* Rellena las referencias pendientes del símbolo 'i' y recicla sus nodos */
+static void resolver_pendientes(Ensamblador *e, int i) {
+    int n = e->simbolos[i].pendientes;
+    while (n >= 0) {
+        Arreglo *a = &e->arreglos[n];
+        int sig = a->siguiente;
+        escribir_dir(e, a->pos, e->simbolos[i].address, a->lineno);
+        a->siguiente = e->arreglos_libres;
+        e->arreglos_libres = n;
+        n = sig;
+    }
+    e->simbolos[i].pendientes = -1;
+}
+
+static char *leer_linea(Ensamblador *e, Lector *l) {
+    if (!l->f) {
+        if (l->fuente_pos >= l->fuente_len)
+            return NULL;
+        const char *ini = l->fuente + l->fuente_pos;
+        size_t resto = l->fuente_len - l->fuente_pos;
+        const char *nl = memchr(ini, '\n', resto);
+        size_t n = nl ? (size_t)(nl - ini) : resto;
+        if (n + 1 > l->cap) {
+            size_t cap = l->cap ? l->cap : 256;
+            while (n + 1 > cap)
+                cap *= 2;
+            if (crecer(e, (void **)&l->buf, cap) < 0)
+                return NULL;
+            l->cap = cap;
+        }
+        memcpy(l->buf, ini, n);
+        l->buf[n] = '\0';
+        l->fuente_pos += n + 1;
+        return l->buf;
+    }
+
+    for (;;) {
+        char *nl = memchr(l->buf + l->ini, '\n', l->fin - l->ini);
+        if (nl) {
+            char *linea = l->buf + l->ini;
+            *nl = '\0';
+            l->ini = (size_t)(nl - l->buf) + 1;
+            return linea;
+        }
+        if (l->eof) {
+            if (l->ini == l->fin)
+                return NULL;
+            char *linea = l->buf + l->ini;    // última línea sin '\n'
+            l->buf[l->fin] = '\0';
+            l->ini = l->fin;
+            return linea;
+        }
+
+        // Mover el resto al principio y leer otro bloque
+        memmove(l->buf, l->buf + l->ini, l->fin - l->ini);
+        l->fin -= l->ini;
+        l->ini = 0;
+        if (l->fin == l->cap) {
+            if (crecer(e, (void **)&l->buf, l->cap * 2 + 1) < 0)
+                return NULL;
+            l->cap *= 2;
+        }
+        size_t n = fread(l->buf + l->fin, 1, l->cap - l->fin, l->f);
+        if (n == 0) {
+            if (ferror(l->f)) {
+                perror("leer entrada");
+                e->error = 1;
+                return NULL;
+            }
+            l->eof = 1;
+        }
+        l->fin += n;
+    }
+}
+
+/* ------------------------------ trim(): limpia espacios ----------------------- */
+static void trim(char *s) {
+    char *p = s;
+    while (*p && isspace((unsigned char)*p)) p++;      // quitar espacios iniciales
+    if (p != s) memmove(s, p, strlen(p)+1);
+
+    int len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len-1])) // quitar espacios finales
+        s[--len] = '\0';
+}
+
+/* ------------------- parse_number(): detecta decimal, hex o binario ------------ */
+static int parse_number(const char *tok) {
+    if (!tok) return -1;
+
+    // Hexadecimal: 0x??
+    if (strlen(tok) > 2 && tok[0]=='0' && (tok[1]=='x' || tok[1]=='X'))
+        return (int)strtol(tok, NULL, 16);
+
+    // Binario: 0b??
+    if (strlen(tok) > 2 && tok[0]=='0' && (tok[1]=='b' || tok[1]=='B'))
+        return (int)strtol(tok+2, NULL, 2);
+
+    // Decimal
+    if ((tok[0] == '-') || isdigit((unsigned char)tok[0]))
+        return atoi(tok);
+
+    return -1; // Si no es número, probablemente es etiqueta
+}
+
+/*
+ * Siguiente token separado por espacios, tabuladores o comas: lo termina en
+ * '\0' dentro de la línea y deja *p detrás (como strtok, pero sin estado
+ * global). NULL si no quedan.
+ */
+static char *siguiente_token(char **p) {
+    char *s = *p;
+    while (*s == ' ' || *s == '\t' || *s == ',') s++;
+    if (!*s) return NULL;
+    char *tok = s;
+    while (*s && *s != ' ' && *s != '\t' && *s != ',') s++;
+    if (*s) *s++ = '\0';
+    *p = s;
+    return tok;
+}
+
+/* Define la etiqueta 'i' en la posición actual y parchea lo que la esperaba */
+static void definir_etiqueta(Ensamblador *e, int i, int lineno) {
+    if (e->simbolos[i].address >= 0) {
+        fprintf(stderr, "[WARN] linea %d: etiqueta '%s' repetida; se usa la primera\n",
+                lineno, e->nombres + e->simbolos[i].nombre);
+        return;
+    }
+    e->simbolos[i].address = (int)e->salida_len;
+    resolver_pendientes(e, i);
+}
+
+/* Genera una instrucción; con 'sim' >= 0 la dirección es esa etiqueta */
+static void emitir_instruccion(Ensamblador *e, const Mnemonico *m, int valor, int sim,
+                               int lineno) {
+    switch (m->operando) {
+        case OPERANDO_NINGUNO:
+            emitir_byte(e, m->opcode);
+            break;
+        case OPERANDO_RET:
+            emitir_byte(e, e->ancho == 16 ? m->opcode | OP_ANCHO : m->opcode);
+            break;
+        case OPERANDO_INMEDIATO:
+            emitir_byte(e, m->opcode);
+            emitir_byte(e, valor);
+            break;
+        case OPERANDO_DIRECCION:
+            if (sim < 0)
+                emitir_dir(e, m->opcode, valor, lineno);
+            else if (e->simbolos[sim].address >= 0)
+                emitir_dir(e, m->opcode, e->simbolos[sim].address, lineno);
+            else
+                referencia_pendiente(e, sim, reservar_dir(e, m->opcode), lineno);
+            break;
+    }
+}
+
+/* ------------------------------- MIRILLA ------------------------------------
+ * Patrones de dos instrucciones vecinas (sin etiqueta entre ellas, salvo en
+ * los saltos a la etiqueta que sigue) que se pueden acortar sin cambiar lo
+ * que hace el programa. Se repite la tabla hasta que ninguno se aplique; como
+ * las etiquetas se definen al emitir la lista ya reescrita, sus direcciones
+ * salen del código encogido.
+ */
+enum { OP_STORE = 2, OP_LOADI = 5, OP_LOADM = 6, OP_JMP = 7, OP_HALT = 8,
+       OP_CALL = 11, OP_RET = 12, OP_JMPZ = 13, OP_VECTOR = 19 };
+
+typedef enum {
+    SIEMPRE,
+    MISMO_OPERANDO,         // la misma dirección (número o etiqueta) en las dos
+    INMEDIATO_CERO,         // el LOADI del primero carga 0
+    INMEDIATO_NO_CERO,
+    DESTINO_SIGUIENTE,      // el salto va a una de las etiquetas que lo siguen
+} Condicion;
+
+typedef enum {
+    QUITAR_PRIMERO,
+    QUITAR_SEGUNDO,
+    SEGUNDO_A_JMP,          // el salto condicional se toma siempre
+} Accion;
+
+typedef struct {
+    const char *nombre;
+    uint8_t primero, segundo;   // opcodes; segundo 0 = cualquier instrucción
+    Condicion condicion;
+    Accion accion;
+    int z_coherente;        // sólo si Z ya vale (A == 0) antes del primero
+} Patron;
+
+static const Patron patrones[] = {
+    /* El LOADM volvería a cargar lo mismo; sólo recalcula Z, que ya está bien */
+    { "STORE x; LOADM x", OP_STORE, OP_LOADM, MISMO_OPERANDO,    QUITAR_SEGUNDO, 1 },
+    { "LOADM x; LOADM x", OP_LOADM, OP_LOADM, MISMO_OPERANDO,    QUITAR_SEGUNDO, 0 },
+    { "LOADM x; STORE x", OP_LOADM, OP_STORE, MISMO_OPERANDO,    QUITAR_SEGUNDO, 0 },
+    { "STORE x; STORE x", OP_STORE, OP_STORE, MISMO_OPERANDO,    QUITAR_SEGUNDO, 0 },
+    { "LOADI a; LOADI b", OP_LOADI, OP_LOADI, SIEMPRE,           QUITAR_PRIMERO, 0 },
+    { "LOADI 0; JMPZ l",  OP_LOADI, OP_JMPZ,  INMEDIATO_CERO,    SEGUNDO_A_JMP,  0 },
+    { "LOADI n; JMPZ l",  OP_LOADI, OP_JMPZ,  INMEDIATO_NO_CERO, QUITAR_SEGUNDO, 0 },
+    { "JMP l; l:",        OP_JMP,   0,        DESTINO_SIGUIENTE, QUITAR_PRIMERO, 0 },
+    { "JMPZ l; l:",       OP_JMPZ,  0,        DESTINO_SIGUIENTE, QUITAR_PRIMERO, 0 },
+    /* Sin etiqueta delante nadie llega a la instrucción siguiente */
+    { "JMP; inalcanzable",  OP_JMP,  0,       SIEMPRE,           QUITAR_SEGUNDO, 0 },
+    { "HALT; inalcanzable", OP_HALT, 0,       SIEMPRE,           QUITAR_SEGUNDO, 0 },
+    { "RET; inalcanzable",  OP_RET,  0,       SIEMPRE,           QUITAR_SEGUNDO, 0 },
+};
+_Static_assert(sizeof(patrones) / sizeof(patrones[0]) == ENSAMBLADOR_PATRONES,
+               "ENSAMBLADOR_PATRONES no coincide con la tabla");
+
+const char *ensamblador_nombre_patron(int patron) {
+    return patron >= 0 && patron < ENSAMBLADOR_PATRONES ? patrones[patron].nombre : "?";
+}
+
+static void apuntar(Ensamblador *e, Pendiente x) {
+    if (e->n_lista == e->cap_lista) {
+        int cap = e->cap_lista ? e->cap_lista * 2 : 1024;
+        if (crecer(e, (void **)&e->lista, (size_t)cap * sizeof(Pendiente)) < 0)
+            return;
+        e->cap_lista = cap;
+    }
+    e->lista[e->n_lista++] = x;
+}
+
+/* Mientras se llena la lista, address -2 marca las etiquetas ya apuntadas */
+static void apuntar_etiqueta(Ensamblador *e, int i, int lineno) {
+    if (e->simbolos[i].address == -2) {
+        fprintf(stderr, "[WARN] linea %d: etiqueta '%s' repetida; se usa la primera\n",
+                lineno, e->nombres + e->simbolos[i].nombre);
+        return;
+    }
+    e->simbolos[i].address = -2;
+    apuntar(e, (Pendiente){ NULL, 0, i, lineno });
+}
+
+static int tam_instruccion(const Ensamblador *e, const Mnemonico *m) {
+    switch (m->operando) {
+        case OPERANDO_NINGUNO:   return 1;
+        case OPERANDO_RET:       return e->ancho == 16 ? 2 : 1;
+        case OPERANDO_INMEDIATO: return 2;
+        default:                 return e->ancho == 16 ? 3 : 2;
+    }
+}
+
+static int escribe_a(const Mnemonico *m) {
+    switch (m->opcode) {
+        case 3: case 4: case 5: case 6: case 10: case 14:   // ADD SUB LOADI LOADM POP MUL
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * La mirilla sólo entiende programas cuyo código se toca por etiquetas: un
+ * salto a un número o un dato dentro del código (por número o por etiqueta)
+ * dejarían de apuntar a lo mismo al encoger el código. Entonces se deja todo
+ * como está.
+ */
+static int mirilla_segura(const Ensamblador *e) {
+    int tam = 0;
+    for (int i = 0; i < e->n_lista; ++i)
+        if (e->lista[i].m)
+            tam += tam_instruccion(e, e->lista[i].m);
+
+    for (int i = 0; i < e->n_lista; ++i) {
+        const Pendiente *x = &e->lista[i];
+        if (!x->m || x->m->operando != OPERANDO_DIRECCION)
+            continue;
+        int salto = x->m->opcode == OP_JMP || x->m->opcode == OP_JMPZ ||
+                    x->m->opcode == OP_CALL || x->m->opcode == OP_VECTOR;
+        if (salto ? x->simbolo < 0 : x->simbolo >= 0 || x->valor < tam) {
+            fprintf(stderr, "[WARN] linea %d: %s al código sin etiqueta; sin mirilla\n",
+                    x->lineno, salto ? "salto" : "dato");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* El puerto del dispositivo no es memoria: dos STORE ahí son dos bytes de salida */
+static int mismo_operando(const Pendiente *a, const Pendiente *b) {
+    if (a->simbolo < 0 && a->valor == DISPOSITIVO_PUERTO)
+        return 0;
+    return a->simbolo == b->simbolo && (a->simbolo >= 0 || a->valor == b->valor);
+}
+
+/* ¿Alguna de las etiquetas entre 'i' y 'j' es el destino de 'i'? */
+static int destino_entre(const Ensamblador *e, int i, int j) {
+    for (int k = i + 1; k < j; ++k)
+        if (!e->lista[k].m && e->lista[k].simbolo == e->lista[i].simbolo)
+            return 1;
+    return 0;
+}
+
+static int cumple(const Ensamblador *e, const Patron *pt, int i, int j, int etiquetas,
+                  int coherente) {
+    const Pendiente *a = &e->lista[i], *b = &e->lista[j];
+    if (a->m->opcode != pt->primero || (pt->z_coherente && !coherente))
+        return 0;
+    if (pt->condicion == DESTINO_SIGUIENTE)
+        return etiquetas && destino_entre(e, i, j);
+    if (etiquetas || j >= e->n_lista || (pt->segundo && b->m->opcode != pt->segundo))
+        return 0;
+    switch (pt->condicion) {
+        case MISMO_OPERANDO:    return mismo_operando(a, b);
+        case INMEDIATO_CERO:    return (a->valor & 0xFF) == 0;
+        case INMEDIATO_NO_CERO: return (a->valor & 0xFF) != 0;
+        default:                return 1;
+    }
+}
+
+/* Una vuelta por la lista; 1 si cambió algo */
+static int vuelta_mirilla(Ensamblador *e) {
+    static const Mnemonico jmp = { "JMP", OP_JMP, OPERANDO_DIRECCION };
+    int cambio = 0;
+    int coherente = 0;      // Z == (A == 0) seguro (no hay etiqueta desde el último que escribe A)
+
+    for (int i = 0; i < e->n_lista; ++i) {
+        Pendiente *a = &e->lista[i];
+        if (!a->m) {
+            if (a->simbolo >= 0)
+                coherente = 0;
+            continue;
+        }
+
+        // Siguiente instrucción viva, y si hay etiquetas en medio
+        int j = i + 1, etiquetas = 0;
+        while (j < e->n_lista && !e->lista[j].m) {
+            etiquetas |= e->lista[j].simbolo >= 0;
+            j++;
+        }
+
+        for (int k = 0; k < ENSAMBLADOR_PATRONES; ++k) {
+            const Patron *pt = &patrones[k];
+            if (!cumple(e, pt, i, j, etiquetas, coherente))
+                continue;
+            Pendiente *b = &e->lista[j];
+            switch (pt->accion) {
+                case QUITAR_PRIMERO:
+                    e->bytes_ahorrados += tam_instruccion(e, a->m);
+                    *a = (Pendiente){ NULL, 0, -1, a->lineno };
+                    break;
+                case QUITAR_SEGUNDO:
+                    e->bytes_ahorrados += tam_instruccion(e, b->m);
+                    *b = (Pendiente){ NULL, 0, -1, b->lineno };
+                    break;
+                case SEGUNDO_A_JMP:
+                    b->m = &jmp;
+                    break;
+            }
+            e->patrones[k]++;
+            cambio = 1;
+            break;
+        }
+        if (a->m && escribe_a(a->m))
+            coherente = 1;
+    }
+    return cambio;
+}
+
+/* Reescribe la lista y emite lo que quedó (las etiquetas en su sitio) */
+static void emitir_pendientes(Ensamblador *e) {
+    if (mirilla_segura(e))
+        while (vuelta_mirilla(e))
+            ;
+
+    for (int i = 0; i < e->n_simbolos; ++i)
+        if (e->simbolos[i].address == -2)
+            e->simbolos[i].address = -1;
+    for (int i = 0; i < e->n_lista && !e->error; ++i) {
+        const Pendiente *x = &e->lista[i];
+        if (x->m)
+            emitir_instruccion(e, x->m, x->valor, x->simbolo, x->lineno);
+        else if (x->simbolo >= 0)
+            definir_etiqueta(e, x->simbolo, x->lineno);
+    }
+}
+
+/* -------------------------- ENSAMBLADO -------------------------------------
+ * Lee el ASM línea por línea
+ * - Elimina comentarios
+ * - Define etiquetas (y parchea las referencias que las esperaban)
+ * - Genera cada instrucción; las etiquetas aún no definidas quedan
+ *   pendientes hasta que aparezcan
+ * - Con la mirilla, etiquetas e instrucciones van a la lista y se generan
+ *   al final
+ */
+static int ensamblar(Ensamblador *e, Lector *l) {
+    char *buf;
+    int lineno = 0;
+
+    while (!e->error && (buf = leer_linea(e, l))) {
+        lineno++;
+
+        // Quitar comentario comenzando en ';'
+        char *c = strchr(buf, ';');
+        if (c) *c = '\0';
+
+        trim(buf);
+        if (buf[0] == '\0') continue; // línea vacía
+
+        // ------------------- Si es etiqueta -------------------
+        size_t L = strlen(buf);
+        if (buf[L-1] == ':') {
+            buf[L-1] = '\0';
+            trim(buf);
+
+            int i = simbolo(e, buf);
+            if (i < 0)
+                break;
+            if (e->mirilla)
+                apuntar_etiqueta(e, i, lineno);
+            else
+                definir_etiqueta(e, i, lineno);
+            continue; // no consume dirección
+        }
+
+        // ---------------- Generar la instrucción ----------------
+        char *p = buf;
+        char *tok = siguiente_token(&p);
+        if (!tok) continue;
+
+        const Mnemonico *m = buscar_mnemonico(tok);
+        if (!m) {
+            fprintf(stderr, "Instrucción desconocida en linea %d: %s\n", lineno, tok);
+            return -1;
+        }
+        e->instrucciones++;
+
+        int valor = 0, sim = -1;
+        if (m->operando == OPERANDO_INMEDIATO) {
+            valor = parse_number(siguiente_token(&p));
+        } else if (m->operando == OPERANDO_DIRECCION) {
+            char *op = siguiente_token(&p);
+            valor = parse_number(op);
+            if (valor < 0 && op && (sim = simbolo(e, op)) < 0)
+                break;
+        }
+        if (e->mirilla)
+            apuntar(e, (Pendiente){ m, valor, sim, lineno });
+        else
+            emitir_instruccion(e, m, valor, sim, lineno);
+    }
+    e->lineas = lineno;
+
+    if (!e->error && e->mirilla)
+        emitir_pendientes(e);
+    if (e->error) {
+        fprintf(stderr, "[ERROR] Sin memoria ensamblando (linea %d)\n", lineno);
+        return -1;
+    }
+
+    // Lo que sigue pendiente es una etiqueta que nunca se definió (vale -1)
+    for (int i = 0; i < e->n_simbolos; ++i)
+        if (e->simbolos[i].pendientes >= 0) {
+            fprintf(stderr, "[WARN] etiqueta '%s' no definida\n", e->nombres + e->simbolos[i].nombre);
+            resolver_pendientes(e, i);
+        }
+    return 0;
+}
+
+/* Ensambla desde 'l' y entrega la salida en 'p'; libera el resto del estado */
+static int terminar(Ensamblador *e, Lector *l, Programa *p, EstadisticasEnsamblado *est) {
+    int r = ensamblar(e, l);
+
+    free(l->buf);
+    free(e->simbolos);
+    free(e->tabla_hash);
+    free(e->nombres);
+    free(e->arreglos);
+    free(e->lista);
+
+    memset(p, 0, sizeof(*p));
+    if (est) {
+        est->lineas = e->lineas;
+        est->instrucciones = e->instrucciones;
+        est->simbolos = e->n_simbolos;
+        memcpy(est->patrones, e->patrones, sizeof(est->patrones));
+        est->bytes_ahorrados = e->bytes_ahorrados;
+    }
+    if (r < 0) {
+        free(e->salida);
+        return -1;
+    }
+    p->codigo = e->salida;
+    p->tam = (uint32_t)e->salida_len;
+    return 0;
+}
+
+int ensamblador_buffer(const char *fuente, size_t len, int ancho, Programa *p,
+                       EstadisticasEnsamblado *est) {
+    Ensamblador e = { .ancho = ancho & ~ENSAMBLADOR_MIRILLA,
+                      .mirilla = !!(ancho & ENSAMBLADOR_MIRILLA), .arreglos_libres = -1 };
+    Lector l = { .fuente = fuente, .fuente_len = len };
+    return terminar(&e, &l, p, est);
+}
+
+int ensamblador_archivo(const char *path, int ancho, Programa *p,
+                        EstadisticasEnsamblado *est) {
+    Ensamblador e = { .ancho = ancho & ~ENSAMBLADOR_MIRILLA,
+                      .mirilla = !!(ancho & ENSAMBLADOR_MIRILLA), .arreglos_libres = -1 };
+    Lector l = { .f = fopen(path, "r"), .cap = LECTOR_BLOQUE };
+    if (!l.f) {
+        perror("fopen entrada");
+        memset(p, 0, sizeof(*p));
+        return -1;
+    }
+    l.buf = malloc(l.cap + 1);              // + 1 para el '\0' de la última línea
+    if (!l.buf) {
+        fclose(l.f);
+        memset(p, 0, sizeof(*p));
+        return -1;
+    }
+    int r = terminar(&e, &l, p, est);
+    fclose(l.f);
+    return r;
+}
+
+void programa_liberar(Programa *p) {
+    free(p->codigo);
+    p->codigo = NULL;
+    p->tam = 0;
+}
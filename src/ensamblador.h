@@ -0,0 +1,85 @@
+#ifndef ENSAMBLADOR_H
+#define ENSAMBLADOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Ensamblador de una pasada como biblioteca (lo usan el CLI assembler y
+ * libcomputadora).
+ *
+ * - El tamaño de cada instrucción sólo depende del mnemónico (y del ancho),
+ *   así que el código se genera mientras se lee el ASM, en una sola pasada.
+ * - Una etiqueta ya definida se resuelve al momento. Una referencia hacia
+ *   delante deja los bytes de la dirección reservados y se apunta en la
+ *   lista de pendientes de esa etiqueta; al definirla se parchean todos y
+ *   la lista se recicla.
+ * - Desde un archivo la entrada se lee por bloques grandes y se analiza en
+ *   el mismo búfer; no se guarda ninguna línea. La memoria crece con el
+ *   código generado, las etiquetas y las referencias aún sin resolver, no
+ *   con las líneas.
+ *
+ * Cada llamada trabaja sobre su propio estado: se puede ensamblar en varios
+ * hilos a la vez. Los avisos (etiquetas repetidas o sin definir,
+ * direcciones fuera de rango) salen por stderr.
+ *
+ * Sintaxis:
+ * - Mnemónicos: NOP, STORE, ADD, SUB, LOADI/LOADA, LOADM/LOAD, JMP, HALT,
+ *   PUSH, POP, CALL, RET, JMPZ, MUL y los de interrupciones EI, DI, RETI,
+ *   TIMER, VECTOR (interrupciones.h), sin distinguir mayúsculas
+ * - Etiquetas terminan con ':' (p. ej. loop:); comentarios desde ';'
+ * - Los operandos pueden ser números decimales, 0xHEX, 0bBINARIO o etiquetas.
+ * - Con ancho 16 las instrucciones con dirección usan la forma ancha
+ *   (opcode | OP_ANCHO + 2 bytes little endian) y RET y RETI la de 2 bytes, para
+ *   programas de más de 256 bytes (cpu_simulator --memoria=64K).
+ *
+ * Mirilla (opcional, ancho | ENSAMBLADOR_MIRILLA): el código se retiene en
+ * una lista en vez de emitirse al leerlo, una tabla de patrones de dos
+ * instrucciones lo acorta (cargas y almacenes repetidos, LOADI pisados,
+ * saltos a la instrucción siguiente o que se deciden con el LOADI anterior,
+ * código inalcanzable tras JMP/HALT/RET) y recién entonces se emite, así que
+ * las etiquetas quedan en su sitio en el código encogido. Si algún salto va
+ * a un número, o algún dato está dentro del código, se avisa y no se toca
+ * nada. Las cargas y almacenes en el puerto del dispositivo de salida
+ * (DISPOSITIVO_PUERTO, dispositivo.h) no se quitan nunca: cada STORE ahí
+ * es un byte de salida. Se supone que las rutinas de atención de
+ * interrupciones no tocan las variables del código interrumpido.
+ */
+
+/* Código listo para cargar en memoria */
+typedef struct {
+    uint8_t *codigo;        // bytes (malloc); se cargan a partir de 'carga'
+    uint32_t tam;
+    uint32_t carga;
+    uint16_t entrada;       // PC inicial
+} Programa;
+
+#define ENSAMBLADOR_MIRILLA  0x100     // se combina con el ancho
+#define ENSAMBLADOR_PATRONES 12
+
+typedef struct {
+    int lineas;
+    int instrucciones;
+    int simbolos;           // etiquetas definidas o referenciadas
+    int patrones[ENSAMBLADOR_PATRONES];     // instrucciones que quitó (o cambió) cada patrón
+    int bytes_ahorrados;
+} EstadisticasEnsamblado;
+
+/*
+ * Ensambla los 'len' bytes de 'fuente' (ancho 8 o 16). 0 si todo bien, -1
+ * si hay un error (instrucción desconocida, sin memoria); entonces 'p'
+ * queda vacío. 'est' puede ser NULL.
+ */
+int ensamblador_buffer(const char *fuente, size_t len, int ancho, Programa *p,
+                       EstadisticasEnsamblado *est);
+
+/* Igual, leyendo el archivo 'path' por bloques */
+int ensamblador_archivo(const char *path, int ancho, Programa *p,
+                        EstadisticasEnsamblado *est);
+
+/* Nombre del patrón 'patron' de la mirilla (0..ENSAMBLADOR_PATRONES-1) */
+const char *ensamblador_nombre_patron(int patron);
+
+void programa_liberar(Programa *p);
+
+#endif
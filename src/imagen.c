@@ -0,0 +1,131 @@
+/*
+ * Archivo: imagen.c
+ * Lectura y escritura del formato binario de imagen de memoria.
+ *
+ * El ensamblador lo genera con imagen_escribir() y el simulador lo carga con
+ * imagen_cargar(), que mapea el archivo con mmap en lugar de parsear texto
+ * línea por línea.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "imagen.h"
+#include "bytes.h"
+
+uint32_t imagen_checksum(const uint8_t *datos, uint32_t tam) {
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; i < tam; ++i) {
+        h ^= datos[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int imagen_es_binaria(const char *path) {
+    char magia[4];
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    size_t n = fread(magia, 1, sizeof(magia), f);
+    fclose(f);
+    return n == sizeof(magia) && memcmp(magia, IMAGEN_MAGIA, 4) == 0;
+}
+
+int imagen_escribir(const char *path, const uint8_t *payload, uint32_t tam,
+                    uint32_t carga, uint32_t entrada) {
+    uint8_t *buf = malloc(IMAGEN_TAM_CABECERA + (size_t)tam);
+    if (!buf) return -1;
+
+    memcpy(buf, IMAGEN_MAGIA, 4);
+    poner16(buf + 4, IMAGEN_VERSION);
+    poner16(buf + 6, 0);
+    poner32(buf + 8, carga);
+    poner32(buf + 12, entrada);
+    poner32(buf + 16, tam);
+    poner32(buf + 20, imagen_checksum(payload, tam));
+    memcpy(buf + IMAGEN_TAM_CABECERA, payload, tam);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(buf);
+        return -1;
+    }
+    size_t total = IMAGEN_TAM_CABECERA + (size_t)tam;
+    int ok = fwrite(buf, 1, total, f) == total;
+    ok = (fclose(f) == 0) && ok;
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+int imagen_cargar_buffer(Memoria *m, const uint8_t *p, size_t largo, const char *nombre,
+                         uint16_t *entrada) {
+    if (largo < IMAGEN_TAM_CABECERA) {
+        fprintf(stderr, "[ERROR] %s: imagen demasiado corta\n", nombre);
+        return -1;
+    }
+
+    int resultado = -1;
+    ImagenCabecera c;
+    c.version = leer16(p + 4);
+    c.carga = leer32(p + 8);
+    c.entrada = leer32(p + 12);
+    c.tam = leer32(p + 16);
+    c.checksum = leer32(p + 20);
+    const uint8_t *payload = p + IMAGEN_TAM_CABECERA;
+
+    if (memcmp(p, IMAGEN_MAGIA, 4) != 0) {
+        fprintf(stderr, "[ERROR] %s: no es una imagen binaria\n", nombre);
+    } else if (c.version != IMAGEN_VERSION) {
+        fprintf(stderr, "[ERROR] %s: versión de imagen %u no soportada\n", nombre, c.version);
+    } else if (c.tam > largo - IMAGEN_TAM_CABECERA) {
+        fprintf(stderr, "[ERROR] %s: payload truncado\n", nombre);
+    } else if (imagen_checksum(payload, c.tam) != c.checksum) {
+        fprintf(stderr, "[ERROR] %s: checksum incorrecto\n", nombre);
+    } else if (c.carga >= m->tam || c.entrada >= m->tam) {
+        fprintf(stderr, "[ERROR] %s: dirección de carga/entrada fuera de memoria\n", nombre);
+    } else {
+        uint32_t n = c.tam;
+        if (n > m->tam - c.carga) {
+            fprintf(stderr, "[WARN] %s: la imagen no cabe en memoria, se trunca\n", nombre);
+            n = m->tam - c.carga;
+        }
+        if (memoria_copiar(m, c.carga, payload, n) < 0) {
+            fprintf(stderr, "[ERROR] %s: sin memoria para la imagen\n", nombre);
+        } else {
+            if (entrada) *entrada = (uint16_t)c.entrada;
+            resultado = (int)n;
+        }
+    }
+    return resultado;
+}
+
+int imagen_cargar(Memoria *m, const char *path, uint16_t *entrada) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < IMAGEN_TAM_CABECERA) {
+        fprintf(stderr, "[ERROR] %s: imagen demasiado corta\n", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t largo = (size_t)st.st_size;
+    const uint8_t *p = mmap(NULL, largo, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    int resultado = imagen_cargar_buffer(m, p, largo, path, entrada);
+    munmap((void *)p, largo);
+    return resultado;
+}
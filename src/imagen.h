@@ -0,0 +1,55 @@
+#ifndef IMAGEN_H
+#define IMAGEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "memoria.h"
+
+/*
+ * Formato binario de imagen de memoria (.img)
+ *
+ *   offset  tamaño  campo
+ *   0       4       magia "VNIM"
+ *   4       2       versión (IMAGEN_VERSION)
+ *   6       2       reservado (0)
+ *   8       4       dirección de carga
+ *   12      4       PC de entrada
+ *   16      4       bytes de payload
+ *   20      4       checksum FNV-1a del payload
+ *   24      ...     payload (bytes crudos)
+ *
+ * Todos los enteros en little endian.
+ */
+
+#define IMAGEN_MAGIA        "VNIM"
+#define IMAGEN_VERSION      1
+#define IMAGEN_TAM_CABECERA 24
+
+typedef struct {
+    uint16_t version;
+    uint32_t carga;       // dirección donde se copia el payload
+    uint32_t entrada;     // PC inicial
+    uint32_t tam;         // bytes de payload
+    uint32_t checksum;    // FNV-1a de 32 bits del payload
+} ImagenCabecera;
+
+uint32_t imagen_checksum(const uint8_t *datos, uint32_t tam);
+
+/* 1 si el archivo empieza con la magia del formato binario */
+int imagen_es_binaria(const char *path);
+
+/* Escribe cabecera + payload con una sola escritura. 0 si todo bien */
+int imagen_escribir(const char *path, const uint8_t *payload, uint32_t tam,
+                    uint32_t carga, uint32_t entrada);
+
+/*
+ * Mapea el archivo, valida cabecera y checksum y copia el payload a memoria.
+ * Devuelve los bytes cargados o -1 si hay error; *entrada recibe el PC inicial.
+ */
+int imagen_cargar(Memoria *m, const char *path, uint16_t *entrada);
+
+/* Igual que imagen_cargar sobre 'largo' bytes ya leídos; 'nombre' va en los mensajes */
+int imagen_cargar_buffer(Memoria *m, const uint8_t *p, size_t largo, const char *nombre,
+                         uint16_t *entrada);
+
+#endif
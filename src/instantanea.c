@@ -0,0 +1,185 @@
+/*
+ * Archivo: instantanea.c
+ * Guardado/restauración del estado de la CPU y bifurcación de invitados.
+ *
+ * Las corridas largas suelen compartir un prefijo de calentamiento (las
+ * inicializaciones al principio del programa): se ejecuta una vez, se toma
+ * la instantánea y cada variante arranca desde ahí en lugar de repetirlo.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "instantanea.h"
+#include "imagen.h"
+#include "bytes.h"
+
+/* Página 'pag' (> 0) si existe y tiene algo distinto de cero */
+static const uint8_t *pagina_con_datos(Memoria *m, uint32_t pag) {
+    const uint8_t *p = memoria_pagina_lectura(m, pag);
+    if (!p)
+        return NULL;
+    for (int i = 0; i < MEM_PAGINA; ++i)
+        if (p[i])
+            return p;
+    return NULL;
+}
+
+int instantanea_guardar(const CPU *cpu, const char *path) {
+    Memoria *m = cpu->mem;
+    uint32_t n_pag = m->tam >> MEM_PAGINA_BITS;
+
+    uint32_t guardadas = 0;
+    for (uint32_t pag = 1; pag < n_pag; ++pag)
+        guardadas += pagina_con_datos(m, pag) != NULL;
+
+    size_t total = INSTANTANEA_TAM_CABECERA + MEM_SIZE + (size_t)guardadas * (4 + MEM_PAGINA);
+    uint8_t *buf = malloc(total);
+    if (!buf) return -1;
+
+    /* Cuerpo: página 0 y luego las demás con su número */
+    uint8_t *q = buf + INSTANTANEA_TAM_CABECERA;
+    memcpy(q, m->data, MEM_SIZE);
+    q += MEM_SIZE;
+    for (uint32_t pag = 1; pag < n_pag; ++pag) {
+        const uint8_t *p = pagina_con_datos(m, pag);
+        if (!p) continue;
+        poner32(q, pag);
+        memcpy(q + 4, p, MEM_PAGINA);
+        q += 4 + MEM_PAGINA;
+    }
+
+    uint64_t seg;
+    memcpy(&seg, &cpu->met.segundos, sizeof(seg));
+    memcpy(buf, INSTANTANEA_MAGIA, 4);
+    poner16(buf + 4, INSTANTANEA_VERSION);
+    poner16(buf + 6, (uint16_t)cpu->motor);
+    poner32(buf + 8, m->tam);
+    poner32(buf + 12, cpu->PC);
+    poner16(buf + 16, cpu->SP);
+    buf[18] = cpu->A;
+    buf[19] = cpu->Z;
+    poner32(buf + 20, (uint32_t)cpu->halted);
+    poner32(buf + 24, (uint32_t)cpu->sp_min);
+    poner64(buf + 28, cpu->met.instrucciones);
+    poner64(buf + 36, cpu->met.ciclos);
+    poner64(buf + 44, cpu->met.accesos_memoria);
+    poner64(buf + 52, cpu->met.saltos_tomados);
+    poner64(buf + 60, cpu->met.saltos_no_tomados);
+    poner64(buf + 68, seg);
+    poner32(buf + 76, guardadas);
+    interrupciones_guardar(&cpu->irq, buf + 84);
+    poner32(buf + 80, imagen_checksum(buf + INSTANTANEA_TAM_CABECERA,
+                                      (uint32_t)(total - INSTANTANEA_TAM_CABECERA)));
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        free(buf);
+        return -1;
+    }
+    int ok = fwrite(buf, 1, total, f) == total;
+    ok = (fclose(f) == 0) && ok;
+    free(buf);
+    return ok ? 0 : -1;
+}
+
+/* Lee el archivo entero; NULL si no se puede */
+static uint8_t *leer_archivo(const char *path, size_t *largo) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return NULL;
+    }
+    uint8_t *buf = NULL;
+    long n = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (n = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0)
+        buf = malloc(n ? (size_t)n : 1);
+    if (buf && fread(buf, 1, (size_t)n, f) != (size_t)n) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (!buf)
+        fprintf(stderr, "[ERROR] %s: no se pudo leer\n", path);
+    *largo = (size_t)n;
+    return buf;
+}
+
+int instantanea_cargar(CPU *cpu, Memoria *mem, const char *path) {
+    size_t largo;
+    uint8_t *p = leer_archivo(path, &largo);
+    if (!p)
+        return -1;
+
+    int resultado = -1;
+    uint16_t version = largo >= INSTANTANEA_TAM_CABECERA_V1 ? leer16(p + 4) : 0;
+    size_t cabecera = version == 1 ? INSTANTANEA_TAM_CABECERA_V1 : INSTANTANEA_TAM_CABECERA;
+    uint32_t tam = largo >= cabecera ? leer32(p + 8) : 0;
+    uint32_t guardadas = largo >= cabecera ? leer32(p + 76) : 0;
+    size_t esperado = cabecera + MEM_SIZE + (size_t)guardadas * (4 + MEM_PAGINA);
+
+    if (largo < cabecera || memcmp(p, INSTANTANEA_MAGIA, 4) != 0) {
+        fprintf(stderr, "[ERROR] %s: no es una instantánea\n", path);
+    } else if (version != 1 && version != INSTANTANEA_VERSION) {
+        fprintf(stderr, "[ERROR] %s: versión de instantánea %u no soportada\n", path, version);
+    } else if (largo != esperado) {
+        fprintf(stderr, "[ERROR] %s: tamaño incorrecto\n", path);
+    } else if (imagen_checksum(p + cabecera, (uint32_t)(largo - cabecera)) != leer32(p + 80)) {
+        fprintf(stderr, "[ERROR] %s: checksum incorrecto\n", path);
+    } else if (memoria_init_tam(mem, tam) < 0 || mem->tam != tam) {
+        fprintf(stderr, "[ERROR] %s: memoria de %u bytes inválida\n", path, tam);
+        memoria_liberar(mem);
+    } else {
+        const uint8_t *q = p + cabecera;
+        memcpy(mem->data, q, MEM_SIZE);
+        q += MEM_SIZE;
+        resultado = 0;
+        for (uint32_t k = 0; k < guardadas && resultado == 0; ++k, q += 4 + MEM_PAGINA) {
+            uint32_t pag = leer32(q);
+            if (pag == 0 || pag >= (tam >> MEM_PAGINA_BITS) ||
+                memoria_copiar(mem, pag << MEM_PAGINA_BITS, q + 4, MEM_PAGINA) < 0) {
+                fprintf(stderr, "[ERROR] %s: página %u inválida\n", path, pag);
+                memoria_liberar(mem);
+                resultado = -1;
+            }
+        }
+    }
+
+    if (resultado == 0) {
+        cpu_init(cpu, mem);
+        cpu->motor = (MotorCPU)leer16(p + 6);
+        cpu->PC = leer32(p + 12);
+        cpu->SP = leer16(p + 16);
+        cpu->A = p[18];
+        cpu->Z = p[19];
+        cpu->halted = (int)leer32(p + 20);
+        cpu->sp_min = (int)leer32(p + 24);
+        cpu->met.instrucciones = leer64(p + 28);
+        cpu->met.ciclos = leer64(p + 36);
+        cpu->met.accesos_memoria = leer64(p + 44);
+        cpu->met.saltos_tomados = leer64(p + 52);
+        cpu->met.saltos_no_tomados = leer64(p + 60);
+        uint64_t seg = leer64(p + 68);
+        memcpy(&cpu->met.segundos, &seg, sizeof(seg));
+        if (cpu->motor > MOTOR_SIMD)
+            cpu->motor = MOTOR_SWITCH;
+        if (version >= 2)
+            interrupciones_cargar(&cpu->irq, p + 84);
+    }
+
+    free(p);
+    return resultado;
+}
+
+int instantanea_fork(CPU *origen, CPU *hijo, Memoria *mem_hijo) {
+    if (memoria_clonar(mem_hijo, origen->mem) < 0)
+        return -1;
+    *hijo = *origen;
+    hijo->mem = mem_hijo;
+    hijo->perfil = NULL;        // perfil, cachés, traza, dispositivo y JIT son del original
+    hijo->tiempo = NULL;
+    hijo->traza = NULL;
+    hijo->dispositivo = NULL;
+    hijo->jit = NULL;
+    return 0;
+}
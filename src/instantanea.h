@@ -0,0 +1,69 @@
+#ifndef INSTANTANEA_H
+#define INSTANTANEA_H
+
+#include <stdint.h>
+#include "memoria.h"
+#include "cpu.h"
+
+/*
+ * Instantáneas del estado completo de un invitado (CPU + Memoria + métricas)
+ * para reanudarlo más tarde, y bifurcación en el mismo proceso.
+ *
+ * Formato del archivo (.snap), little endian:
+ *
+ *   offset  tamaño  campo
+ *   0       4       magia "VNSN"
+ *   4       2       versión (INSTANTANEA_VERSION)
+ *   6       2       motor
+ *   8       4       tamaño de la memoria (mem->tam)
+ *   12      4       PC
+ *   16      2       SP
+ *   18      1       A
+ *   19      1       Z
+ *   20      4       halted
+ *   24      4       sp_min
+ *   28      8 x 5   instrucciones, ciclos, accesos, saltos tomados y no tomados
+ *   68      8       segundos (bits del double)
+ *   76      4       páginas guardadas además de la 0
+ *   80      4       checksum FNV-1a de todo lo que sigue a la cabecera
+ *   84      8       próximo vencimiento del temporizador (0 = parado)
+ *   92      4       vector de interrupción
+ *   96      2       periodo del temporizador
+ *   98      1       1 = interrupciones habilitadas, 2 = marco ancho (VECTOR.w)
+ *   99      1       interrupción pendiente
+ *   100     8       interrupciones atendidas
+ *   108     256     página 0
+ *   ...             por página: u32 número + 256 bytes
+ *
+ * La versión 1 no tenía los campos de 84 a 107 (la página 0 empezaba en
+ * 84); se sigue leyendo, con el controlador de interrupciones en reposo.
+ *
+ * Sólo se guardan las páginas reservadas y con algún byte distinto de cero,
+ * así que una instantánea de 64K apenas ocupa más que lo que el programa tocó.
+ */
+
+#define INSTANTANEA_MAGIA        "VNSN"
+#define INSTANTANEA_VERSION      2
+#define INSTANTANEA_TAM_CABECERA 108
+#define INSTANTANEA_TAM_CABECERA_V1 84
+
+/* Escribe el estado de 'cpu' y su memoria. 0 si todo bien */
+int instantanea_guardar(const CPU *cpu, const char *path);
+
+/*
+ * Crea 'mem' con el tamaño guardado, la llena y deja 'cpu' apuntando a ella
+ * listo para cpu_ejecutar. 0 si todo bien (mem hay que liberarla después).
+ */
+int instantanea_cargar(CPU *cpu, Memoria *mem, const char *path);
+
+/*
+ * Clona un invitado en marcha: 'hijo' continúa desde el mismo estado sobre
+ * 'mem_hijo', que comparte las páginas del original hasta que alguno las
+ * escribe (ver memoria_clonar). Sólo se copian la página 0, la tabla de
+ * páginas y después las páginas que se ensucien. El hijo no hereda el
+ * dispositivo de salida ni el perfil, la traza o el JIT del original: sus
+ * STORE al puerto sólo quedan en su memoria. 0 si todo bien.
+ */
+int instantanea_fork(CPU *origen, CPU *hijo, Memoria *mem_hijo);
+
+#endif
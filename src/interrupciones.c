@@ -0,0 +1,116 @@
+/*
+ * Archivo: interrupciones.c
+ * Cola de eventos (montículo mínimo por instante) y temporizador.
+ */
+
+#include <string.h>
+#include "interrupciones.h"
+#include "bytes.h"
+
+void interrupciones_reiniciar(Interrupciones *irq) {
+    memset(irq, 0, sizeof(*irq));
+}
+
+// ==================== MONTÍCULO ====================
+
+static void intercambiar(Evento *a, Evento *b) {
+    Evento t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void subir(Evento *v, int i) {
+    while (i > 0 && v[(i - 1) / 2].instante > v[i].instante) {
+        intercambiar(&v[(i - 1) / 2], &v[i]);
+        i = (i - 1) / 2;
+    }
+}
+
+static void bajar(Evento *v, int n, int i) {
+    for (;;) {
+        int menor = i, h = 2 * i + 1;
+        if (h < n && v[h].instante < v[menor].instante)
+            menor = h;
+        if (h + 1 < n && v[h + 1].instante < v[menor].instante)
+            menor = h + 1;
+        if (menor == i)
+            return;
+        intercambiar(&v[i], &v[menor]);
+        i = menor;
+    }
+}
+
+/* Saca el evento en la posición 'i' */
+static void quitar(Interrupciones *irq, int i) {
+    irq->cola[i] = irq->cola[--irq->n];
+    if (i < irq->n) {
+        bajar(irq->cola, irq->n, i);
+        subir(irq->cola, i);
+    }
+}
+
+int interrupciones_programar(Interrupciones *irq, TipoEvento tipo, unsigned long instante) {
+    if (irq->n == INTERRUPCIONES_EVENTOS)
+        return -1;
+    irq->cola[irq->n] = (Evento){ instante, (uint8_t)tipo };
+    subir(irq->cola, irq->n++);
+    return 0;
+}
+
+// ==================== TEMPORIZADOR ====================
+
+static int buscar(const Interrupciones *irq, TipoEvento tipo) {
+    for (int i = 0; i < irq->n; ++i)
+        if (irq->cola[i].tipo == tipo)
+            return i;
+    return -1;
+}
+
+void interrupciones_temporizador(Interrupciones *irq, unsigned long ahora, uint16_t periodo) {
+    int i = buscar(irq, EVENTO_TEMPORIZADOR);
+    if (i >= 0)
+        quitar(irq, i);
+    irq->periodo = periodo;
+    if (periodo)
+        interrupciones_programar(irq, EVENTO_TEMPORIZADOR, ahora + periodo);
+}
+
+unsigned long interrupciones_vencimiento(const Interrupciones *irq) {
+    int i = buscar(irq, EVENTO_TEMPORIZADOR);
+    return i >= 0 ? irq->cola[i].instante : 0;
+}
+
+void interrupciones_guardar(const Interrupciones *irq, uint8_t *p) {
+    poner64(p, interrupciones_vencimiento(irq));
+    poner32(p + 8, irq->vector);
+    poner16(p + 12, irq->periodo);
+    p[14] = (uint8_t)(irq->habilitadas | irq->marco_ancho << 1);
+    p[15] = irq->pendiente;
+    poner64(p + 16, irq->atendidas);
+}
+
+void interrupciones_cargar(Interrupciones *irq, const uint8_t *p) {
+    uint64_t vence = leer64(p);
+    interrupciones_reiniciar(irq);
+    irq->vector = leer32(p + 8);
+    irq->periodo = leer16(p + 12);
+    irq->habilitadas = p[14] & 1;
+    irq->marco_ancho = (p[14] >> 1) & 1;
+    irq->pendiente = p[15] != 0;
+    irq->atendidas = leer64(p + 16);
+    if (vence)
+        interrupciones_programar(irq, EVENTO_TEMPORIZADOR, vence);
+}
+
+void interrupciones_vencer(Interrupciones *irq, unsigned long ahora) {
+    while (irq->n && irq->cola[0].instante <= ahora) {
+        Evento e = irq->cola[0];
+        quitar(irq, 0);
+        switch (e.tipo) {
+            case EVENTO_TEMPORIZADOR:
+                irq->pendiente = 1;
+                interrupciones_programar(irq, EVENTO_TEMPORIZADOR, e.instante + irq->periodo);
+                break;
+        }
+    }
+}
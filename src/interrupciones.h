@@ -0,0 +1,92 @@
+#ifndef INTERRUPCIONES_H
+#define INTERRUPCIONES_H
+
+#include <stdint.h>
+
+/*
+ * Controlador de interrupciones con un temporizador programable.
+ *
+ * Instrucciones (ver cpu.c):
+ *   EI / DI      habilitan / inhiben las interrupciones (inhibidas al empezar)
+ *   VECTOR dir   la rutina de atención empieza en 'dir' (0 por defecto)
+ *   TIMER dir    periodo = MEM[dir] | MEM[dir+1] << 8 instrucciones, contadas
+ *                desde el propio TIMER; 0 para el temporizador
+ *   RETI         vuelve de la rutina y habilita las interrupciones
+ *
+ * Al vencer el temporizador la interrupción queda pendiente. Si están
+ * habilitadas, antes de la siguiente instrucción la CPU apila el PC y
+ * después Z, las inhibe y salta al vector; RETI desapila en orden inverso.
+ * El ancho del marco lo fija la forma de VECTOR: con VECTOR.w el PC va en
+ * dos bytes (alto y bajo, como CALL.w), con VECTOR en uno, y RETI y RETI.w
+ * desapilan ese mismo marco. A no se guarda: la rutina lo apila si lo usa.
+ *
+ * Los vencimientos son instantes en met.instrucciones y esperan en un
+ * montículo mínimo. Ningún núcleo mira la cola: con eventos programados
+ * cpu_ejecutar corre el núcleo switch con el límite en el primero, los
+ * atiende y sigue. TIMER, y EI o RETI con una interrupción pendiente,
+ * devuelven el control a cpu_ejecutar para que vuelva a planificar; los
+ * motores rápidos las ejecutan por su camino lento. Sin eventos cada motor
+ * corre como siempre, así que un invitado sin interrupciones no paga nada.
+ */
+
+#define INTERRUPCIONES_EVENTOS 8        // capacidad de la cola de eventos
+#define INTERRUPCIONES_TAM_ESTADO 24    // bytes de interrupciones_guardar
+
+typedef enum {
+    EVENTO_TEMPORIZADOR = 0,
+} TipoEvento;
+
+typedef struct {
+    unsigned long instante;             // met.instrucciones al vencer
+    uint8_t tipo;
+} Evento;
+
+typedef struct {
+    Evento cola[INTERRUPCIONES_EVENTOS]; // montículo mínimo por instante
+    int n;
+    uint32_t vector;
+    uint16_t periodo;                   // del temporizador (0 = parado)
+    uint8_t marco_ancho;                // PC de dos bytes en la pila (VECTOR.w)
+    uint8_t habilitadas;
+    uint8_t pendiente;
+    unsigned long atendidas;            // entradas a la rutina de atención
+} Interrupciones;
+
+/* Sin eventos, inhibidas, vector 0 y temporizador parado */
+void interrupciones_reiniciar(Interrupciones *irq);
+
+/* Instante del primer evento (0 si la cola está vacía) */
+static inline unsigned long interrupciones_proximo(const Interrupciones *irq) {
+    return irq->n ? irq->cola[0].instante : 0;
+}
+
+/* Hay algo que atender fuera de los núcleos: eventos o una interrupción lista */
+static inline int interrupciones_activas(const Interrupciones *irq) {
+    return irq->n > 0 || (irq->pendiente && irq->habilitadas);
+}
+
+/* Agrega un evento a la cola. -1 si está llena */
+int interrupciones_programar(Interrupciones *irq, TipoEvento tipo, unsigned long instante);
+
+/* Reprograma el temporizador desde 'ahora' (periodo 0 lo para) */
+void interrupciones_temporizador(Interrupciones *irq, unsigned long ahora, uint16_t periodo);
+
+/* Próximo vencimiento del temporizador (0 si está parado), para las instantáneas */
+unsigned long interrupciones_vencimiento(const Interrupciones *irq);
+
+/*
+ * Estado del controlador para instantáneas y trazas, little endian:
+ * u64 próximo vencimiento del temporizador (0 = parado), u32 vector,
+ * u16 periodo, u8 habilitadas | marco ancho << 1, u8 pendiente y
+ * u64 atendidas. interrupciones_cargar deja 'irq' en ese estado.
+ */
+void interrupciones_guardar(const Interrupciones *irq, uint8_t *p);
+void interrupciones_cargar(Interrupciones *irq, const uint8_t *p);
+
+/*
+ * Atiende los eventos con instante <= 'ahora': el temporizador deja la
+ * interrupción pendiente y se vuelve a programar un periodo más tarde.
+ */
+void interrupciones_vencer(Interrupciones *irq, unsigned long ahora);
+
+#endif
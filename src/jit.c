@@ -0,0 +1,609 @@
+/*
+ * Archivo: jit.c
+ * Traductor de bloques básicos del ISA acumulador a código x86-64.
+ *
+ * Un bloque empieza en un PC y termina en el primer salto (JMP, JMPZ, CALL,
+ * RET) o antes de una instrucción que no se traduce. El código generado se
+ * guarda en un búfer mmap ejecutable y se indexa por PC de inicio.
+ *
+ * Registros del host dentro del código traducido:
+ *   rbx = A (bl)        r15 = Z (r15b)
+ *   rbp = PC            r14 = SP
+ *   r12 = Memoria.data  r13 = contexto (métricas, tablas)
+ *
+ * Al final de cada bloque se carga el PC destino en ebp y se salta a un
+ * despachador común que busca el bloque siguiente en la tabla sin volver a C.
+ * Si no existe, sale a jit_ejecutar(), que lo traduce y vuelve a entrar.
+ *
+ * Código automodificable: el contexto lleva, por dirección, cuántos bloques
+ * traducidos cubren ese byte. Cada escritura del invitado (STORE, PUSH,
+ * CALL) lo consulta y, si pisa código traducido, el bloque sale justo
+ * después de la escritura para que se invaliden los bloques afectados.
+ * Un PC cuyo bloque se descartó JIT_UMBRAL_SMC veces (p. ej. una subrutina
+ * a la que el programa le reescribe el operando en cada llamada) ya no se
+ * traduce: lo ejecuta el intérprete, que no paga nada por la escritura.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "jit.h"
+#include "memoria.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__unix__))
+
+#include <sys/mman.h>
+
+#define JIT_TAM_CODIGO  (1 << 20)   // búfer de código ejecutable
+#define JIT_MAX_INSTR   64          // instrucciones por bloque
+#define JIT_MAX_BLOQUE  8192        // cota de bytes generados por bloque
+#define JIT_UMBRAL_SMC  4           // descartes tras los que un PC queda al intérprete
+
+/* Motivo por el que el código traducido vuelve a C */
+enum {
+    RAZON_FALTA = 0,      // no hay bloque traducido para ctx.pc
+    RAZON_SMC,            // escritura sobre código traducido (ctx.dir_smc)
+    RAZON_INTERPRETAR     // la instrucción en ctx.pc la ejecuta el intérprete
+};
+
+/* Contexto accesible desde el código generado a través de r13 */
+typedef struct {
+    uint8_t *mem;
+    uint64_t instr;
+    uint64_t mem_accesos;
+    uint64_t tomados;
+    uint64_t no_tomados;
+    uint32_t sp_min;
+    uint32_t razon;
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t dir_smc;
+    uint8_t a;
+    uint8_t z;
+    uint8_t codigo[MEM_SIZE + 1];   // nº de bloques que cubren cada byte
+    void *bloques[MEM_SIZE + 1];    // código traducido por PC de inicio
+} JitContexto;
+
+#define OFF(campo) ((int32_t)offsetof(JitContexto, campo))
+
+/* Métricas acumuladas en el bloque hasta un punto de salida */
+typedef struct {
+    int instr, mem, tomados, no_tomados;
+} Cuentas;
+
+typedef enum {
+    STUB_INTERPRETAR,   // salir antes de ejecutar la instrucción en pc
+    STUB_SMC_FIJO,      // escritura en dirección conocida (STORE)
+    STUB_SMC_PILA       // escritura en [SP+1] (PUSH, CALL)
+} TipoStub;
+
+typedef struct {
+    TipoStub tipo;
+    uint8_t *parche;    // rel32 del jcc que salta al stub
+    uint16_t pc;        // PC con el que se sale
+    uint16_t dir;       // dirección escrita (STUB_SMC_FIJO)
+    Cuentas cuentas;    // métricas hasta este punto
+} Stub;
+
+typedef void (*JitEntrada)(JitContexto *ctx, void *bloque);
+
+struct Jit {
+    JitContexto ctx;
+    uint8_t *codigo;              // búfer mmap
+    uint8_t *libre;               // siguiente byte libre
+    uint8_t *despacho;            // despachador común
+    uint8_t *salida;              // guarda registros y vuelve a C
+    uint8_t *inicio_bloques;      // primer byte después de los stubs fijos
+    JitEntrada entrada;
+    uint16_t fin_bloque[MEM_SIZE];  // fin (exclusivo) del bloque en cada PC
+    uint8_t descartes[MEM_SIZE];  // veces que se invalidó el bloque de cada PC
+    uint8_t imagen[MEM_SIZE];     // bytes invitados al traducir (donde codigo[] > 0)
+    uint8_t *p;                   // posición de emisión
+    Stub stubs[JIT_MAX_INSTR * 2];  // stubs pendientes del bloque actual
+    int n_stubs;
+    int puerto;                   // dirección del dispositivo (-1: sin dispositivo)
+};
+
+// ==================== EMISIÓN DE BYTES ====================
+
+static void e8(Jit *j, uint8_t b) { *j->p++ = b; }
+
+static void e32(Jit *j, int32_t v) {
+    memcpy(j->p, &v, 4);
+    j->p += 4;
+}
+
+static void e16(Jit *j, uint16_t v) {
+    memcpy(j->p, &v, 2);
+    j->p += 2;
+}
+
+/* Salto relativo de 32 bits ya emitido en 'parche' hacia 'destino' */
+static void parchear_rel32(uint8_t *parche, const uint8_t *destino) {
+    int32_t rel = (int32_t)(destino - (parche + 4));
+    memcpy(parche, &rel, 4);
+}
+
+static void jmp_a(Jit *j, const uint8_t *destino) {
+    e8(j, 0xE9);
+    e32(j, 0);
+    parchear_rel32(j->p - 4, destino);
+}
+
+/* add qword [r13+disp], imm32 (omitido si imm es 0) */
+static void sumar_contador(Jit *j, int32_t disp, int32_t imm) {
+    if (imm == 0) return;
+    e8(j, 0x49); e8(j, 0x81); e8(j, 0x85); e32(j, disp); e32(j, imm);
+}
+
+static void emitir_cuentas(Jit *j, Cuentas c) {
+    sumar_contador(j, OFF(instr), c.instr);
+    sumar_contador(j, OFF(mem_accesos), c.mem);
+    sumar_contador(j, OFF(tomados), c.tomados);
+    sumar_contador(j, OFF(no_tomados), c.no_tomados);
+}
+
+/* mov ebp, pc ; jmp despacho */
+static void emitir_ir_a(Jit *j, uint16_t pc) {
+    e8(j, 0xBD); e32(j, pc);
+    jmp_a(j, j->despacho);
+}
+
+/* mov dword [r13+razon], r ; jmp salida */
+static void emitir_salir(Jit *j, uint32_t razon) {
+    e8(j, 0x41); e8(j, 0xC7); e8(j, 0x85); e32(j, OFF(razon)); e32(j, (int32_t)razon);
+    jmp_a(j, j->salida);
+}
+
+// ==================== STUBS FUERA DE LÍNEA ====================
+
+/*
+ * Los casos raros de un bloque (pila vacía/llena, escritura sobre código) se
+ * resuelven en stubs que se emiten al final del bloque, para que el camino
+ * normal sea lineal.
+ */
+
+/* jcc rel32 hacia un stub que se emitirá después */
+static void saltar_a_stub(Jit *j, uint8_t cc, TipoStub tipo, uint16_t pc, uint16_t dir, Cuentas c) {
+    e8(j, 0x0F); e8(j, cc); e32(j, 0);
+    j->stubs[j->n_stubs].tipo = tipo;
+    j->stubs[j->n_stubs].parche = j->p - 4;
+    j->stubs[j->n_stubs].pc = pc;
+    j->stubs[j->n_stubs].dir = dir;
+    j->stubs[j->n_stubs].cuentas = c;
+    j->n_stubs++;
+}
+
+static void emitir_stubs(Jit *j) {
+    for (int i = 0; i < j->n_stubs; ++i) {
+        Stub *s = &j->stubs[i];
+        parchear_rel32(s->parche, j->p);
+        emitir_cuentas(j, s->cuentas);
+        e8(j, 0xBD); e32(j, s->pc);                                     // mov ebp, pc
+        if (s->tipo == STUB_INTERPRETAR) {
+            emitir_salir(j, RAZON_INTERPRETAR);
+            continue;
+        }
+        if (s->tipo == STUB_SMC_FIJO) {
+            e8(j, 0x66); e8(j, 0x41); e8(j, 0xC7); e8(j, 0x85);         // mov word [r13+dir_smc], imm16
+            e32(j, OFF(dir_smc)); e16(j, s->dir);
+        } else {
+            e8(j, 0x41); e8(j, 0x8D); e8(j, 0x46); e8(j, 0x01);         // lea eax, [r14+1]
+            e8(j, 0x66); e8(j, 0x41); e8(j, 0x89); e8(j, 0x85);         // mov [r13+dir_smc], ax
+            e32(j, OFF(dir_smc));
+        }
+        emitir_salir(j, RAZON_SMC);
+    }
+    j->n_stubs = 0;
+}
+
+// ==================== FRAGMENTOS DE INSTRUCCIONES ====================
+
+#define JCC_E   0x84
+#define JCC_NE  0x85
+#define JCC_AE  0x83
+
+/* sete r15b (Z = resultado == 0 según ZF) */
+static void fijar_z(Jit *j) {
+    e8(j, 0x41); e8(j, 0x0F); e8(j, 0x94); e8(j, 0xC7);
+}
+
+/* cmp byte [r13+codigo+dir], 0 ; jne stub */
+static void comprobar_smc_fijo(Jit *j, uint8_t dir, uint16_t pc_sig, Cuentas c) {
+    e8(j, 0x41); e8(j, 0x80); e8(j, 0xBD); e32(j, OFF(codigo) + dir); e8(j, 0x00);
+    saltar_a_stub(j, JCC_NE, STUB_SMC_FIJO, pc_sig, dir, c);
+}
+
+/* Tras "dec r14": cmp byte [r13+r14+codigo+1], 0 ; jne stub */
+static void comprobar_smc_pila(Jit *j, uint16_t pc_sig, Cuentas c) {
+    e8(j, 0x43); e8(j, 0x80); e8(j, 0xBC); e8(j, 0x35); e32(j, OFF(codigo) + 1); e8(j, 0x00);
+    saltar_a_stub(j, JCC_NE, STUB_SMC_PILA, pc_sig, 0, c);
+}
+
+/* Si SP == 0 (pila llena) sale al intérprete antes de la instrucción */
+static void comprobar_pila_llena(Jit *j, uint16_t pc, Cuentas c) {
+    e8(j, 0x45); e8(j, 0x85); e8(j, 0xF6);                              // test r14d, r14d
+    saltar_a_stub(j, JCC_E, STUB_INTERPRETAR, pc, 0, c);
+}
+
+/* Si SP >= MEM_SIZE-1 (pila vacía) sale al intérprete antes de la instrucción */
+static void comprobar_pila_vacia(Jit *j, uint16_t pc, Cuentas c) {
+    e8(j, 0x41); e8(j, 0x81); e8(j, 0xFE); e32(j, MEM_SIZE - 1);        // cmp r14d, MEM_SIZE-1
+    saltar_a_stub(j, JCC_AE, STUB_INTERPRETAR, pc, 0, c);
+}
+
+/* dec r14d y actualización del SP mínimo */
+static void bajar_sp(Jit *j) {
+    e8(j, 0x41); e8(j, 0xFF); e8(j, 0xCE);                              // dec r14d
+    e8(j, 0x45); e8(j, 0x3B); e8(j, 0xB5); e32(j, OFF(sp_min));         // cmp r14d, [r13+sp_min]
+    e8(j, 0x73); e8(j, 0x07);                                           // jae +7
+    e8(j, 0x45); e8(j, 0x89); e8(j, 0xB5); e32(j, OFF(sp_min));         // mov [r13+sp_min], r14d
+}
+
+// ==================== TRADUCCIÓN DE BLOQUES ====================
+
+static int tiene_operando(uint8_t op) {
+    return !(op == 1 || op == 8 || op == 9 || op == 10 || op == 12);
+}
+
+/*
+ * HALT, opcodes desconocidos, operandos fuera de memoria y el STORE al
+ * puerto del dispositivo van al intérprete
+ */
+static int traducible(const Jit *j, uint16_t pc) {
+    const uint8_t *data = j->ctx.mem;
+    uint8_t op = data[pc];
+    if (op < 1 || op > 14 || op == 8)
+        return 0;
+    if (tiene_operando(op) && pc >= MEM_SIZE - 1)
+        return 0;
+    if (op == 2 && data[pc + 1] == j->puerto)
+        return 0;
+    return 1;
+}
+
+static void vaciar_cache(Jit *j) {
+    memset(j->ctx.codigo, 0, sizeof(j->ctx.codigo));
+    memset(j->ctx.bloques, 0, sizeof(j->ctx.bloques));
+    memset(j->fin_bloque, 0, sizeof(j->fin_bloque));
+    j->libre = j->inicio_bloques;
+}
+
+static void *traducir(Jit *j, uint16_t inicio) {
+    const uint8_t *data = j->ctx.mem;
+
+    if (!traducible(j, inicio) || j->descartes[inicio] >= JIT_UMBRAL_SMC)
+        return NULL;
+    if (j->libre + JIT_MAX_BLOQUE > j->codigo + JIT_TAM_CODIGO)
+        vaciar_cache(j);
+
+    uint8_t *bloque = j->libre;
+    j->p = bloque;
+    j->n_stubs = 0;
+
+    Cuentas c = {0, 0, 0, 0};
+    uint16_t pc = inicio;
+    int terminado = 0;
+
+    while (!terminado) {
+        if (pc >= MEM_SIZE || c.instr >= JIT_MAX_INSTR || !traducible(j, pc)) {
+            emitir_cuentas(j, c);
+            emitir_ir_a(j, pc);
+            break;
+        }
+
+        uint8_t op = data[pc];
+        uint8_t arg = tiene_operando(op) ? data[pc + 1] : 0;
+        uint16_t sig = pc + (tiene_operando(op) ? 2 : 1);
+
+        switch (op) {
+            case 1: // NOP
+                c.instr++;
+                break;
+
+            case 2: // STORE dir
+                e8(j, 0x41); e8(j, 0x88); e8(j, 0x9C); e8(j, 0x24); e32(j, arg);  // mov [r12+arg], bl
+                c.instr++; c.mem++;
+                comprobar_smc_fijo(j, arg, sig, c);
+                break;
+
+            case 3: // ADD dir
+                e8(j, 0x41); e8(j, 0x02); e8(j, 0x9C); e8(j, 0x24); e32(j, arg);  // add bl, [r12+arg]
+                fijar_z(j);
+                c.instr++; c.mem++;
+                break;
+
+            case 4: // SUB dir
+                e8(j, 0x41); e8(j, 0x2A); e8(j, 0x9C); e8(j, 0x24); e32(j, arg);  // sub bl, [r12+arg]
+                fijar_z(j);
+                c.instr++; c.mem++;
+                break;
+
+            case 5: // LOADI val
+                e8(j, 0xB3); e8(j, arg);                                // mov bl, arg
+                e8(j, 0x41); e8(j, 0xB7); e8(j, arg == 0);              // mov r15b, (arg == 0)
+                c.instr++;
+                break;
+
+            case 6: // LOADM dir
+                e8(j, 0x41); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0x9C); e8(j, 0x24); e32(j, arg);  // movzx ebx, byte [r12+arg]
+                e8(j, 0x84); e8(j, 0xDB);                               // test bl, bl
+                fijar_z(j);
+                c.instr++; c.mem++;
+                break;
+
+            case 7: // JMP dir
+                c.instr++; c.tomados++;
+                emitir_cuentas(j, c);
+                emitir_ir_a(j, arg);
+                terminado = 1;
+                break;
+
+            case 9: // PUSH
+                comprobar_pila_llena(j, pc, c);
+                e8(j, 0x43); e8(j, 0x88); e8(j, 0x1C); e8(j, 0x34);     // mov [r12+r14], bl
+                bajar_sp(j);
+                c.instr++; c.mem++;
+                comprobar_smc_pila(j, sig, c);
+                break;
+
+            case 10: // POP
+                comprobar_pila_vacia(j, pc, c);
+                e8(j, 0x41); e8(j, 0xFF); e8(j, 0xC6);                  // inc r14d
+                e8(j, 0x43); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0x1C); e8(j, 0x34);  // movzx ebx, byte [r12+r14]
+                e8(j, 0x84); e8(j, 0xDB);                               // test bl, bl
+                fijar_z(j);
+                c.instr++; c.mem++;
+                break;
+
+            case 11: // CALL dir
+                comprobar_pila_llena(j, pc, c);
+                e8(j, 0x43); e8(j, 0xC6); e8(j, 0x04); e8(j, 0x34); e8(j, (uint8_t)sig);  // mov byte [r12+r14], sig
+                bajar_sp(j);
+                c.instr++; c.mem++; c.tomados++;
+                comprobar_smc_pila(j, arg, c);
+                emitir_cuentas(j, c);
+                emitir_ir_a(j, arg);
+                terminado = 1;
+                break;
+
+            case 12: // RET
+                comprobar_pila_vacia(j, pc, c);
+                e8(j, 0x41); e8(j, 0xFF); e8(j, 0xC6);                  // inc r14d
+                e8(j, 0x43); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0x2C); e8(j, 0x34);  // movzx ebp, byte [r12+r14]
+                c.instr++; c.mem++; c.tomados++;
+                emitir_cuentas(j, c);
+                jmp_a(j, j->despacho);
+                terminado = 1;
+                break;
+
+            case 13: { // JMPZ dir
+                Cuentas tomado = c, no_tomado = c;
+                tomado.instr++; tomado.tomados++;
+                no_tomado.instr++; no_tomado.no_tomados++;
+                e8(j, 0x45); e8(j, 0x84); e8(j, 0xFF);                  // test r15b, r15b
+                e8(j, 0x0F); e8(j, JCC_E); e32(j, 0);                   // jz no_tomado
+                uint8_t *parche = j->p - 4;
+                emitir_cuentas(j, tomado);
+                emitir_ir_a(j, arg);
+                parchear_rel32(parche, j->p);
+                emitir_cuentas(j, no_tomado);
+                emitir_ir_a(j, sig);
+                terminado = 1;
+                break;
+            }
+
+            case 14: // MUL dir
+                e8(j, 0x41); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0x84); e8(j, 0x24); e32(j, arg);  // movzx eax, byte [r12+arg]
+                e8(j, 0x0F); e8(j, 0xAF); e8(j, 0xC3);                  // imul eax, ebx
+                e8(j, 0x88); e8(j, 0xC3);                               // mov bl, al
+                e8(j, 0x84); e8(j, 0xDB);                               // test bl, bl
+                fijar_z(j);
+                c.instr++; c.mem++;
+                break;
+        }
+        pc = sig;
+    }
+
+    emitir_stubs(j);
+    j->libre = j->p;
+
+    /* Registrar el rango de memoria invitada que cubre el bloque */
+    uint16_t fin = pc < MEM_SIZE ? pc : MEM_SIZE;
+    j->fin_bloque[inicio] = fin;
+    for (uint16_t d = inicio; d < fin; ++d) {
+        j->ctx.codigo[d]++;
+        j->imagen[d] = data[d];
+    }
+    j->ctx.bloques[inicio] = bloque;
+    return bloque;
+}
+
+/* Elimina todos los bloques que cubren la dirección 'dir' */
+static void invalidar(Jit *j, uint16_t dir) {
+    if (dir >= MEM_SIZE || !j->ctx.codigo[dir])
+        return;     /* ningún bloque la cubre: lo común fuera del JIT */
+    for (int s = 0; s <= dir && s < MEM_SIZE; ++s) {
+        if (!j->ctx.bloques[s] || dir >= j->fin_bloque[s])
+            continue;
+        for (uint16_t d = s; d < j->fin_bloque[s]; ++d)
+            j->ctx.codigo[d]--;
+        j->ctx.bloques[s] = NULL;
+        j->fin_bloque[s] = 0;
+        if (j->descartes[s] < JIT_UMBRAL_SMC)
+            j->descartes[s]++;
+    }
+}
+
+// ==================== CÓDIGO FIJO: ENTRADA, SALIDA, DESPACHO ====================
+
+static void generar_fijos(Jit *j) {
+    j->p = j->codigo;
+
+    /* salida: guarda registros invitados y restaura los del host */
+    j->salida = j->p;
+    e8(j, 0x41); e8(j, 0x88); e8(j, 0x9D); e32(j, OFF(a));              // mov [r13+a], bl
+    e8(j, 0x45); e8(j, 0x88); e8(j, 0xBD); e32(j, OFF(z));              // mov [r13+z], r15b
+    e8(j, 0x66); e8(j, 0x41); e8(j, 0x89); e8(j, 0xAD); e32(j, OFF(pc));  // mov [r13+pc], bp
+    e8(j, 0x66); e8(j, 0x45); e8(j, 0x89); e8(j, 0xB5); e32(j, OFF(sp));  // mov [r13+sp], r14w
+    e8(j, 0x48); e8(j, 0x83); e8(j, 0xC4); e8(j, 0x08);                 // add rsp, 8
+    e8(j, 0x41); e8(j, 0x5F);                                           // pop r15
+    e8(j, 0x41); e8(j, 0x5E);                                           // pop r14
+    e8(j, 0x41); e8(j, 0x5D);                                           // pop r13
+    e8(j, 0x41); e8(j, 0x5C);                                           // pop r12
+    e8(j, 0x5D);                                                        // pop rbp
+    e8(j, 0x5B);                                                        // pop rbx
+    e8(j, 0xC3);                                                        // ret
+
+    /* despacho: bloque = bloques[ebp]; si no existe, RAZON_FALTA */
+    j->despacho = j->p;
+    e8(j, 0x49); e8(j, 0x8B); e8(j, 0x84); e8(j, 0xED); e32(j, OFF(bloques));  // mov rax, [r13+rbp*8+bloques]
+    e8(j, 0x48); e8(j, 0x85); e8(j, 0xC0);                              // test rax, rax
+    e8(j, 0x74); e8(j, 0x02);                                           // jz +2
+    e8(j, 0xFF); e8(j, 0xE0);                                           // jmp rax
+    emitir_salir(j, RAZON_FALTA);
+
+    /* entrada(ctx = rdi, bloque = rsi) */
+    j->entrada = (JitEntrada)(void *)j->p;
+    e8(j, 0x53);                                                        // push rbx
+    e8(j, 0x55);                                                        // push rbp
+    e8(j, 0x41); e8(j, 0x54);                                           // push r12
+    e8(j, 0x41); e8(j, 0x55);                                           // push r13
+    e8(j, 0x41); e8(j, 0x56);                                           // push r14
+    e8(j, 0x41); e8(j, 0x57);                                           // push r15
+    e8(j, 0x48); e8(j, 0x83); e8(j, 0xEC); e8(j, 0x08);                 // sub rsp, 8
+    e8(j, 0x49); e8(j, 0x89); e8(j, 0xFD);                              // mov r13, rdi
+    e8(j, 0x4D); e8(j, 0x8B); e8(j, 0xA5); e32(j, OFF(mem));            // mov r12, [r13+mem]
+    e8(j, 0x41); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0x9D); e32(j, OFF(a)); // movzx ebx, byte [r13+a]
+    e8(j, 0x45); e8(j, 0x0F); e8(j, 0xB6); e8(j, 0xBD); e32(j, OFF(z)); // movzx r15d, byte [r13+z]
+    e8(j, 0x41); e8(j, 0x0F); e8(j, 0xB7); e8(j, 0xAD); e32(j, OFF(pc));  // movzx ebp, word [r13+pc]
+    e8(j, 0x45); e8(j, 0x0F); e8(j, 0xB7); e8(j, 0xB5); e32(j, OFF(sp));  // movzx r14d, word [r13+sp]
+    e8(j, 0xFF); e8(j, 0xE6);                                           // jmp rsi
+
+    j->inicio_bloques = j->p;
+    j->libre = j->p;
+}
+
+// ==================== API ====================
+
+Jit *jit_crear(uint8_t *data, int puerto) {
+    Jit *j = calloc(1, sizeof(Jit));
+    if (!j) return NULL;
+
+    void *p = mmap(NULL, JIT_TAM_CODIGO, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        free(j);
+        return NULL;
+    }
+
+    j->codigo = p;
+    j->ctx.mem = data;
+    j->puerto = puerto;
+    generar_fijos(j);
+    return j;
+}
+
+void jit_destruir(Jit *j) {
+    if (!j) return;
+    munmap(j->codigo, JIT_TAM_CODIGO);
+    free(j);
+}
+
+void jit_asociar(Jit *j, uint8_t *data, int puerto) {
+    if (puerto != j->puerto) {
+        j->puerto = puerto;
+        memset(j->descartes, 0, sizeof(j->descartes));
+        vaciar_cache(j);
+    }
+    j->ctx.mem = data;
+    for (int d = 0; d < MEM_SIZE; ++d)
+        if (j->ctx.codigo[d] && data[d] != j->imagen[d])
+            invalidar(j, (uint16_t)d);
+}
+
+void jit_invalidar_todo(Jit *j) {
+    vaciar_cache(j);
+}
+
+void jit_invalidar(Jit *j, uint16_t dir) {
+    invalidar(j, dir);
+}
+
+int jit_acepta(const Jit *j, uint16_t pc) {
+    return pc < MEM_SIZE && (j->ctx.bloques[pc] ||
+                             (j->descartes[pc] < JIT_UMBRAL_SMC && traducible(j, pc)));
+}
+
+void jit_ejecutar(Jit *j, JitRegistros *r) {
+    JitContexto *ctx = &j->ctx;
+
+    ctx->pc = r->pc;
+    ctx->sp = r->sp;
+    ctx->a = r->a;
+    ctx->z = r->z;
+    ctx->sp_min = r->sp_min;
+    ctx->instr = ctx->mem_accesos = ctx->tomados = ctx->no_tomados = 0;
+
+    while (ctx->pc < MEM_SIZE) {
+        void *bloque = ctx->bloques[ctx->pc];
+        if (!bloque && !(bloque = traducir(j, ctx->pc)))
+            break;   /* no traducible: lo ejecuta el intérprete */
+
+        ctx->razon = RAZON_FALTA;
+        j->entrada(ctx, bloque);
+
+        if (ctx->razon == RAZON_SMC)
+            invalidar(j, ctx->dir_smc);
+        else if (ctx->razon == RAZON_INTERPRETAR)
+            break;
+    }
+
+    r->pc = ctx->pc;
+    r->sp = ctx->sp;
+    r->a = ctx->a;
+    r->z = ctx->z;
+    r->sp_min = ctx->sp_min;
+    r->instr += ctx->instr;
+    r->mem_accesos += ctx->mem_accesos;
+    r->tomados += ctx->tomados;
+    r->no_tomados += ctx->no_tomados;
+}
+
+#else /* plataforma sin soporte: el motor JIT usa el intérprete */
+
+Jit *jit_crear(uint8_t *data, int puerto) {
+    (void)data;
+    (void)puerto;
+    return NULL;
+}
+
+void jit_destruir(Jit *j) { (void)j; }
+
+void jit_asociar(Jit *j, uint8_t *data, int puerto) {
+    (void)j;
+    (void)data;
+    (void)puerto;
+}
+
+int jit_acepta(const Jit *j, uint16_t pc) {
+    (void)j;
+    (void)pc;
+    return 0;
+}
+
+void jit_invalidar_todo(Jit *j) { (void)j; }
+
+void jit_invalidar(Jit *j, uint16_t dir) {
+    (void)j;
+    (void)dir;
+}
+
+void jit_ejecutar(Jit *j, JitRegistros *r) {
+    (void)j;
+    (void)r;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+
+/*
+ * Traductor de bloques básicos a código x86-64.
+ *
+ * Sólo traduce; las instrucciones que no sabe manejar (HALT, opcodes
+ * desconocidos, errores de pila, operando fuera de memoria) y los STORE al
+ * puerto del dispositivo (dispositivo.h) se devuelven al intérprete de
+ * cpu.c, que conserva la semántica de referencia.
+ */
+
+typedef struct Jit Jit;
+
+/* Registros de la CPU invitada y métricas acumuladas por el código traducido */
+typedef struct {
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t a;
+    uint8_t z;
+    uint32_t sp_min;              // menor SP alcanzado (profundidad de pila)
+    unsigned long instr;          // instrucciones ejecutadas
+    unsigned long mem_accesos;    // lecturas/escrituras a memoria
+    unsigned long tomados;        // saltos tomados
+    unsigned long no_tomados;     // saltos no tomados
+} JitRegistros;
+
+/*
+ * 'puerto' es la dirección del dispositivo de salida, o -1 sin dispositivo.
+ * Devuelve NULL si la plataforma no permite generar código (no x86-64, mmap).
+ */
+Jit *jit_crear(uint8_t *data, int puerto);
+void jit_destruir(Jit *j);
+
+/*
+ * Reutiliza 'j' (el búfer ejecutable se conserva) para otra memoria o tras
+ * escrituras fuera del JIT: descarta sólo las traducciones cuyos bytes ya
+ * no son los de 'data' (todas si cambia el puerto)
+ */
+void jit_asociar(Jit *j, uint8_t *data, int puerto);
+
+/*
+ * Ejecuta código traducido desde r->pc. Vuelve cuando el PC sale de memoria
+ * o cuando la instrucción en r->pc debe ejecutarla el intérprete. Las
+ * métricas se suman a las que ya tenga r.
+ */
+void jit_ejecutar(Jit *j, JitRegistros *r);
+
+/* Descarta todas las traducciones (p. ej. tras escrituras fuera del JIT) */
+void jit_invalidar_todo(Jit *j);
+
+/* Descarta sólo las que cubren 'dir' (una escritura conocida fuera del JIT) */
+void jit_invalidar(Jit *j, uint16_t dir);
+
+/*
+ * 1 si jit_ejecutar() correría algo desde 'pc': hay bloque o se puede
+ * traducir. 0 para lo que va al intérprete, incluidos los PC cuyo bloque
+ * se reescribe solo una y otra vez.
+ */
+int jit_acepta(const Jit *j, uint16_t pc);
+
+#endif
@@ -0,0 +1,556 @@
+/*
+ * Archivo: lote.c
+ * Ejecución de muchas corridas independientes del mismo programa.
+ *
+ * Las corridas se reparten al inicio en rangos contiguos, uno por hilo.
+ * Cada hilo consume su rango por el frente en bloques pequeños; cuando se
+ * queda sin trabajo roba la mitad final del rango más grande que quede en
+ * otro hilo. Así los hilos no compiten por una cola central y el reparto se
+ * equilibra solo aunque unas corridas sean mucho más largas que otras.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "lote.h"
+#include "simd.h"
+#include "metricas.h"
+#include "jit.h"
+#include "bytes.h"
+
+#define LOTE_BLOQUE 16   // corridas que toma un hilo de su propio rango
+                         // (SIMD_CARRILES con el motor simd)
+
+/* --------------------------- Parches de memoria ------------------------------ */
+typedef struct {
+    uint16_t dir;
+    uint8_t valor;
+} ParMemoria;
+
+typedef struct {
+    ParMemoria *pares;          // todos los pares, corrida tras corrida
+    size_t n_pares, cap_pares;
+    size_t *inicio;             // índice del primer par de cada corrida (+1 final)
+    size_t n_corridas, cap_corridas;
+} Parches;
+
+static int agregar_par(Parches *p, uint16_t dir, uint8_t valor) {
+    if (p->n_pares == p->cap_pares) {
+        p->cap_pares = p->cap_pares ? p->cap_pares * 2 : 1024;
+        ParMemoria *n = realloc(p->pares, p->cap_pares * sizeof(ParMemoria));
+        if (!n) return -1;
+        p->pares = n;
+    }
+    p->pares[p->n_pares].dir = dir;
+    p->pares[p->n_pares].valor = valor;
+    p->n_pares++;
+    return 0;
+}
+
+static int cerrar_corrida(Parches *p) {
+    if (p->n_corridas + 1 >= p->cap_corridas) {
+        p->cap_corridas = p->cap_corridas ? p->cap_corridas * 2 : 1024;
+        size_t *n = realloc(p->inicio, p->cap_corridas * sizeof(size_t));
+        if (!n) return -1;
+        p->inicio = n;
+    }
+    p->n_corridas++;
+    p->inicio[p->n_corridas] = p->n_pares;
+    return 0;
+}
+
+/*
+ * Formato: una corrida por línea con pares "dir=valor" separados por
+ * espacios o comas. ';' inicia un comentario; las líneas vacías se ignoran
+ * y una línea con sólo "-" es una corrida sin parche.
+ */
+static int leer_parches(const char *path, uint32_t tam, Parches *p) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+
+    memset(p, 0, sizeof(*p));
+    p->cap_corridas = 1024;
+    p->inicio = malloc(p->cap_corridas * sizeof(size_t));
+    if (!p->inicio) { fclose(f); return -1; }
+    p->inicio[0] = 0;
+
+    char line[4096];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *c = strchr(line, ';');
+        if (c) *c = '\0';
+
+        char *s = line;
+        while (*s && isspace((unsigned char)*s)) s++;
+        if (*s == '\0')
+            continue;
+
+        if (*s != '-') {
+            while (*s) {
+                while (*s && (isspace((unsigned char)*s) || *s == ',')) s++;
+                if (!*s) break;
+
+                char *fin;
+                long dir = strtol(s, &fin, 0);
+                if (fin == s || *fin != '=') {
+                    fprintf(stderr, "[ERROR] %s:%d: se esperaba dir=valor\n", path, lineno);
+                    fclose(f);
+                    return -1;
+                }
+                s = fin + 1;
+                long valor = strtol(s, &fin, 0);
+                if (fin == s || dir < 0 || dir >= (long)tam) {
+                    fprintf(stderr, "[ERROR] %s:%d: par inválido\n", path, lineno);
+                    fclose(f);
+                    return -1;
+                }
+                s = fin;
+                if (agregar_par(p, (uint16_t)dir, (uint8_t)(valor & 0xFF)) < 0) {
+                    fclose(f);
+                    return -1;
+                }
+            }
+        }
+        if (cerrar_corrida(p) < 0) {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+/* ------------------------------ Resultados ----------------------------------- */
+typedef struct {
+    uint8_t A, Z;
+    uint16_t PC, SP;
+    CPUMetricas met;
+    uint8_t celdas[LOTE_MAX_CELDAS];
+} ResultadoCorrida;
+
+/* ---------------------- Colas con robo de trabajo ----------------------------- */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t ini, fin;            // corridas pendientes [ini, fin)
+} RangoTrabajo;
+
+typedef struct {
+    const LoteConfig *cfg;
+    const Parches *parches;
+    ResultadoCorrida *res;
+    RangoTrabajo *rangos;
+    int n_hilos;
+    size_t bloque;
+    AgregadorMetricas metricas;     // una ranura por hilo
+    int simd;                       // grupos en lockstep (sólo memoria de 8 bits)
+    Tiempo **tiempos;               // cachés del modelo de tiempo, una por hilo
+    Jit **jits;                     // traductores del motor jit, uno por hilo
+    CPU inicio;                     // estado de partida de todas las corridas
+    Memoria base;                   // clon de cfg->base del que se bifurca cada corrida
+} Lote;
+
+typedef struct {
+    Lote *lote;
+    int id;
+    size_t robos;
+} Trabajador;
+
+/*
+ * Bifurca la memoria base: con páginas fuera de la 0 sólo se copian las que
+ * el parche o la corrida escriben (memoria_clonar).
+ */
+static int aplicar_parche(Lote *l, size_t i, Memoria *mem) {
+    if (memoria_clonar(mem, &l->base) < 0)
+        return -1;
+    for (size_t k = l->parches->inicio[i]; k < l->parches->inicio[i + 1]; ++k)
+        memoria_escribir(mem, l->parches->pares[k].dir, l->parches->pares[k].valor);
+    return 0;
+}
+
+static void guardar_resultado(Lote *l, int hilo, size_t i, const CPU *cpu,
+                              const CPUMetricas *met, const Memoria *mem) {
+    const LoteConfig *cfg = l->cfg;
+    ResultadoCorrida *r = &l->res[i];
+    r->A = cpu->A;
+    r->Z = cpu->Z;
+    r->PC = cpu->PC;
+    r->SP = cpu->SP;
+    r->met = *met;
+    for (int c = 0; c < cfg->n_celdas; ++c)
+        r->celdas[c] = memoria_leer((Memoria *)mem, cfg->celdas[c]);
+    agregador_sumar(&l->metricas, hilo, met);
+    agregador_sumar_diagnosticos(&l->metricas, hilo, &cpu->diag);
+}
+
+static void ejecutar_corrida(Lote *l, int hilo, size_t i) {
+    const LoteConfig *cfg = l->cfg;
+    Memoria mem;
+    if (aplicar_parche(l, i, &mem) < 0) {
+        fprintf(stderr, "[ERROR] Corrida %zu: sin memoria para el fork\n", i);
+        return;
+    }
+
+    CPU cpu = l->inicio;
+    cpu.mem = &mem;
+    cpu.motor = cfg->motor;
+    cpu.silencioso = 1;
+    if (l->tiempos) {
+        /* Cada corrida arranca con las cachés frías */
+        cpu.tiempo = l->tiempos[hilo];
+        tiempo_vaciar(cpu.tiempo);
+    }
+    if (l->jits)
+        cpu.jit = l->jits[hilo];    /* el búfer ejecutable sirve para todas las corridas */
+    cpu_ejecutar(&cpu);
+
+    CPUMetricas met;
+    cpu_leer_metricas(&cpu, &met);
+    guardar_resultado(l, hilo, i, &cpu, &met, &mem);
+    if (mem.paginas)
+        memoria_liberar(&mem);
+}
+
+/* Corridas [ini, fin) en grupos de SIMD_CARRILES con el motor vectorial */
+static void ejecutar_grupos_simd(Lote *l, int hilo, size_t ini, size_t fin) {
+    Memoria mems[SIMD_CARRILES];
+    Memoria *ptrs[SIMD_CARRILES];
+    CPU cpus[SIMD_CARRILES];
+    CPUMetricas met[SIMD_CARRILES];
+
+    for (size_t i = ini; i < fin; i += SIMD_CARRILES) {
+        int n = fin - i < SIMD_CARRILES ? (int)(fin - i) : SIMD_CARRILES;
+        for (int k = 0; k < n; ++k) {
+            aplicar_parche(l, i + k, &mems[k]);
+            ptrs[k] = &mems[k];
+        }
+        simd_ejecutar(ptrs, n, &l->inicio, cpus, met);
+        for (int k = 0; k < n; ++k)
+            guardar_resultado(l, hilo, i + k, &cpus[k], &met[k], &mems[k]);
+    }
+}
+
+/* Toma hasta 'bloque' corridas del frente del propio rango */
+static int tomar_propio(RangoTrabajo *r, size_t bloque, size_t *ini, size_t *fin) {
+    pthread_mutex_lock(&r->lock);
+    size_t n = r->fin - r->ini;
+    if (n > bloque) n = bloque;
+    *ini = r->ini;
+    *fin = r->ini + n;
+    r->ini += n;
+    pthread_mutex_unlock(&r->lock);
+    return n > 0;
+}
+
+/* Roba la mitad final del rango más grande de otro hilo y la hace propia */
+static int robar(Trabajador *t) {
+    Lote *l = t->lote;
+    int victima = -1;
+    size_t mayor = 0;
+
+    for (int k = 0; k < l->n_hilos; ++k) {
+        if (k == t->id) continue;
+        pthread_mutex_lock(&l->rangos[k].lock);
+        size_t n = l->rangos[k].fin - l->rangos[k].ini;
+        pthread_mutex_unlock(&l->rangos[k].lock);
+        if (n > mayor) { mayor = n; victima = k; }
+    }
+    if (victima < 0)
+        return 0;
+
+    RangoTrabajo *v = &l->rangos[victima];
+    size_t ini, fin;
+    pthread_mutex_lock(&v->lock);
+    size_t n = v->fin - v->ini;
+    size_t k = n / 2 ? n / 2 : n;
+    fin = v->fin;
+    ini = fin - k;
+    v->fin = ini;
+    pthread_mutex_unlock(&v->lock);
+    if (k == 0)
+        return 1;   /* otro ladrón llegó antes; volver a buscar */
+
+    RangoTrabajo *propio = &l->rangos[t->id];
+    pthread_mutex_lock(&propio->lock);
+    propio->ini = ini;
+    propio->fin = fin;
+    pthread_mutex_unlock(&propio->lock);
+    t->robos++;
+    return 1;
+}
+
+static void *trabajador(void *arg) {
+    Trabajador *t = arg;
+    Lote *l = t->lote;
+    size_t ini, fin;
+
+    for (;;) {
+        if (tomar_propio(&l->rangos[t->id], l->bloque, &ini, &fin)) {
+            if (l->simd)
+                ejecutar_grupos_simd(l, t->id, ini, fin);
+            else
+                for (size_t i = ini; i < fin; ++i)
+                    ejecutar_corrida(l, t->id, i);
+            continue;
+        }
+        if (!robar(t))
+            break;
+    }
+    return NULL;
+}
+
+/* ----------------------------- Escritura ------------------------------------- */
+static int escribir_csv(FILE *f, const LoteConfig *cfg, const ResultadoCorrida *res, size_t n) {
+    fprintf(f, "corrida,A,Z,PC,SP,instrucciones,ciclos,accesos_memoria,"
+               "saltos_tomados,saltos_no_tomados,pila_max");
+    for (int c = 0; c < cfg->n_celdas; ++c)
+        fprintf(f, ",MEM[%u]", cfg->celdas[c]);
+    fputc('\n', f);
+
+    for (size_t i = 0; i < n; ++i) {
+        const ResultadoCorrida *r = &res[i];
+        fprintf(f, "%zu,%u,%u,%u,%u,%lu,%lu,%lu,%lu,%lu,%d", i,
+                r->A, r->Z, r->PC, r->SP, r->met.instrucciones, r->met.ciclos,
+                r->met.accesos_memoria, r->met.saltos_tomados,
+                r->met.saltos_no_tomados, r->met.profundidad_pila);
+        for (int c = 0; c < cfg->n_celdas; ++c)
+            fprintf(f, ",%u", r->celdas[c]);
+        fputc('\n', f);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+/*
+ * Binario (little endian):
+ *   "VNLR", u32 versión (1), u32 corridas, u32 celdas, u16 dirección de cada celda
+ *   por corrida: u8 A, u8 Z, u16 PC, u16 SP, u16 pila_max,
+ *                u64 instrucciones, ciclos, accesos, tomados, no_tomados,
+ *                u8 valor de cada celda
+ */
+static int escribir_binario(FILE *f, const LoteConfig *cfg, const ResultadoCorrida *res, size_t n) {
+    uint8_t cab[16 + 2 * LOTE_MAX_CELDAS];
+    memcpy(cab, "VNLR", 4);
+    poner32(cab + 4, 1);
+    poner32(cab + 8, (uint32_t)n);
+    poner32(cab + 12, (uint32_t)cfg->n_celdas);
+    for (int c = 0; c < cfg->n_celdas; ++c)
+        poner16(cab + 16 + 2 * c, cfg->celdas[c]);
+    fwrite(cab, 1, 16 + 2 * (size_t)cfg->n_celdas, f);
+
+    size_t tam = 8 + 5 * 8 + (size_t)cfg->n_celdas;
+    uint8_t reg[8 + 5 * 8 + LOTE_MAX_CELDAS];
+    for (size_t i = 0; i < n; ++i) {
+        const ResultadoCorrida *r = &res[i];
+        reg[0] = r->A;
+        reg[1] = r->Z;
+        poner16(reg + 2, r->PC);
+        poner16(reg + 4, r->SP);
+        poner16(reg + 6, (uint16_t)r->met.profundidad_pila);
+        poner64(reg + 8, r->met.instrucciones);
+        poner64(reg + 16, r->met.ciclos);
+        poner64(reg + 24, r->met.accesos_memoria);
+        poner64(reg + 32, r->met.saltos_tomados);
+        poner64(reg + 40, r->met.saltos_no_tomados);
+        memcpy(reg + 48, r->celdas, (size_t)cfg->n_celdas);
+        fwrite(reg, 1, tam, f);
+    }
+    return ferror(f) ? -1 : 0;
+}
+
+static double segundos_reloj(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Los diagnósticos de todas las corridas, por tipo (HALT no se cuenta) */
+static void informe_diagnosticos(const uint64_t por_tipo[DIAG_TIPOS]) {
+    const char *sep = "[LOTE] diagnósticos: ";
+    for (int t = 0; t < DIAG_TIPOS; ++t) {
+        if (t == DIAG_HALT || por_tipo[t] == 0)
+            continue;
+        fprintf(stderr, "%s%llu %s", sep, (unsigned long long)por_tipo[t],
+                diagnostico_nombre((TipoDiagnostico)t));
+        sep = ", ";
+    }
+    if (sep[0] != '[')
+        fprintf(stderr, "\n");
+}
+
+static void liberar_tiempos(Lote *l) {
+    if (!l->tiempos) return;
+    for (int k = 0; k < l->n_hilos; ++k)
+        tiempo_destruir(l->tiempos[k]);
+    free(l->tiempos);
+    l->tiempos = NULL;
+}
+
+static void liberar_jits(Lote *l) {
+    if (!l->jits) return;
+    for (int k = 0; k < l->n_hilos; ++k)
+        jit_destruir(l->jits[k]);
+    free(l->jits);
+    l->jits = NULL;
+}
+
+/* ------------------------------ API ------------------------------------------ */
+int lote_ejecutar(const LoteConfig *cfg, const char *path_parches, const char *salida) {
+    if (cfg->n_celdas > LOTE_MAX_CELDAS) {
+        fprintf(stderr, "[ERROR] Máximo %d celdas por corrida\n", LOTE_MAX_CELDAS);
+        return -1;
+    }
+    for (int c = 0; c < cfg->n_celdas; ++c) {
+        if (cfg->celdas[c] >= cfg->base->tam) {
+            fprintf(stderr, "[ERROR] Celda fuera de memoria: %u\n", cfg->celdas[c]);
+            return -1;
+        }
+    }
+
+    Parches parches;
+    if (leer_parches(path_parches, cfg->base->tam, &parches) < 0)
+        return -1;
+    size_t n = parches.n_corridas;
+
+    int n_hilos = cfg->hilos;
+    if (n_hilos <= 0) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        n_hilos = nucleos > 0 ? (int)nucleos : 1;
+    }
+    if ((size_t)n_hilos > n) n_hilos = n ? (int)n : 1;
+
+    ResultadoCorrida *res = calloc(n ? n : 1, sizeof(ResultadoCorrida));
+    RangoTrabajo *rangos = calloc((size_t)n_hilos, sizeof(RangoTrabajo));
+    Trabajador *trab = calloc((size_t)n_hilos, sizeof(Trabajador));
+    pthread_t *hilos = calloc((size_t)n_hilos, sizeof(pthread_t));
+    if (!res || !rangos || !trab || !hilos) {
+        fprintf(stderr, "[ERROR] Sin memoria para %zu corridas\n", n);
+        free(res); free(rangos); free(trab); free(hilos);
+        free(parches.pares); free(parches.inicio);
+        return -1;
+    }
+
+    int simd = cfg->motor == MOTOR_SIMD;
+    if (simd && (cfg->base->tam > MEM_SIZE || cfg->tiempo)) {
+        fprintf(stderr, "[AVISO] El motor simd no admite %s; se usa switch\n",
+                cfg->tiempo ? "el modelo de tiempo" : "memoria de más de 8 bits");
+        simd = 0;
+    }
+    Lote lote = { cfg, &parches, res, rangos, n_hilos,
+                  simd ? SIMD_CARRILES : LOTE_BLOQUE };
+    lote.simd = simd;
+    if (cfg->inicio) {
+        lote.inicio = *cfg->inicio;
+        lote.inicio.limite = 0;
+        lote.inicio.perfil = NULL;
+        lote.inicio.tiempo = NULL;
+        lote.inicio.traza = NULL;
+        lote.inicio.jit = NULL;
+    } else {
+        cpu_init(&lote.inicio, cfg->base);
+        lote.inicio.PC = cfg->entrada;
+    }
+
+    /*
+     * Los hilos bifurcan de un clon propio de la base, que nadie escribe:
+     * clonarlo desde varios hilos sólo toca contadores de referencias.
+     */
+    int sin_memoria = memoria_clonar(&lote.base, cfg->base) < 0;
+    if (!sin_memoria && cfg->tiempo) {
+        lote.tiempos = calloc((size_t)n_hilos, sizeof(Tiempo *));
+        sin_memoria = !lote.tiempos;
+        for (int k = 0; !sin_memoria && k < n_hilos; ++k)
+            sin_memoria = !(lote.tiempos[k] = tiempo_crear(cfg->tiempo));
+    }
+    /* Sin JIT en la plataforma cada corrida cae sola al predecodificado */
+    if (!sin_memoria && cfg->motor == MOTOR_JIT && cfg->base->tam == MEM_SIZE) {
+        lote.jits = calloc((size_t)n_hilos, sizeof(Jit *));
+        sin_memoria = !lote.jits;
+        for (int k = 0; !sin_memoria && k < n_hilos; ++k)
+            lote.jits[k] = jit_crear(NULL, -1);
+        if (!sin_memoria && !lote.jits[0])
+            fprintf(stderr, "[AVISO] JIT no disponible en esta plataforma; se usa el motor predecode\n");
+    }
+    if (sin_memoria || agregador_init(&lote.metricas, n_hilos) < 0) {
+        fprintf(stderr, "[ERROR] Sin memoria para la base y las métricas\n");
+        memoria_liberar(&lote.base);
+        liberar_tiempos(&lote);
+        liberar_jits(&lote);
+        free(res); free(rangos); free(trab); free(hilos);
+        free(parches.pares); free(parches.inicio);
+        return -1;
+    }
+    for (int k = 0; k < n_hilos; ++k) {
+        pthread_mutex_init(&rangos[k].lock, NULL);
+        rangos[k].ini = n * (size_t)k / (size_t)n_hilos;
+        rangos[k].fin = n * (size_t)(k + 1) / (size_t)n_hilos;
+        trab[k].lote = &lote;
+        trab[k].id = k;
+    }
+
+    /* Si no arrancan todos, los rangos de los que faltan se los roban los demás */
+    double t0 = segundos_reloj();
+    int lanzados = 1;
+    while (lanzados < n_hilos &&
+           pthread_create(&hilos[lanzados], NULL, trabajador, &trab[lanzados]) == 0)
+        lanzados++;
+    if (lanzados < n_hilos)
+        fprintf(stderr, "[AVISO] Sólo se pudieron crear %d de %d hilos\n", lanzados, n_hilos);
+    trabajador(&trab[0]);
+    for (int k = 1; k < lanzados; ++k)
+        pthread_join(hilos[k], NULL);
+    double t1 = segundos_reloj();
+
+    CPUMetricas total;
+    uint64_t diagnosticos[DIAG_TIPOS];
+    agregador_total(&lote.metricas, &total, NULL);
+    agregador_diagnosticos(&lote.metricas, diagnosticos);
+    agregador_destruir(&lote.metricas);
+    memoria_liberar(&lote.base);
+    if (lote.tiempos)
+        for (int k = 1; k < n_hilos; ++k)
+            tiempo_sumar(lote.tiempos[0], lote.tiempos[k]);
+    size_t robos = 0;
+    for (int k = 0; k < n_hilos; ++k) {
+        robos += trab[k].robos;
+        pthread_mutex_destroy(&rangos[k].lock);
+    }
+
+    int ret = 0;
+    FILE *f = salida ? fopen(salida, "wb") : stdout;
+    if (!f) {
+        perror("fopen salida");
+        ret = -1;
+    } else {
+        const char *ext = salida ? strrchr(salida, '.') : NULL;
+        if (ext && strcmp(ext, ".bin") == 0)
+            ret = escribir_binario(f, cfg, res, n);
+        else
+            ret = escribir_csv(f, cfg, res, n);
+        if (f != stdout) fclose(f);
+    }
+
+    double t = t1 - t0;
+    fprintf(stderr, "[LOTE] %zu corridas, %d hilos, %zu robos, %.6f s", n, lanzados, robos, t);
+    if (t > 0)
+        fprintf(stderr, " (%.0f corridas/s, %.2f MIPS)", n / t, total.instrucciones / t / 1e6);
+    fprintf(stderr, "\n");
+    if (lote.tiempos) {
+        fprintf(stderr, "[LOTE] %lu ciclos estimados; ", total.ciclos);
+        tiempo_informe(lote.tiempos[0], total.instrucciones, total.ciclos, stderr);
+    }
+    informe_diagnosticos(diagnosticos);
+    liberar_tiempos(&lote);
+    liberar_jits(&lote);
+
+    free(res); free(rangos); free(trab); free(hilos);
+    free(parches.pares); free(parches.inicio);
+    return ret;
+}
@@ -0,0 +1,41 @@
+#ifndef LOTE_H
+#define LOTE_H
+
+#include <stdint.h>
+#include "memoria.h"
+#include "cpu.h"
+#include "tiempo.h"
+
+/*
+ * Modo lote: ejecuta el mismo programa muchas veces, cada corrida con su
+ * parche de memoria (pares dirección=valor), repartiendo las corridas en
+ * un pool de hilos con robo de trabajo. Cada tarea usa su propio par
+ * CPU/Memoria copiado de la imagen base.
+ *
+ * Con 'inicio' cada corrida es un fork de ese estado: los parches se
+ * aplican después del prefijo ya ejecutado, que no se repite.
+ */
+
+#define LOTE_MAX_CELDAS 32
+
+typedef struct {
+    Memoria *base;              // imagen del programa ya cargada
+    uint16_t entrada;           // PC inicial
+    const CPU *inicio;          // estado de partida (instantánea); NULL = cpu_init
+    const ConfigTiempo *tiempo; // modelo de ciclos por corrida; NULL = modelo simple
+    MotorCPU motor;
+    int hilos;                  // <= 0: uno por núcleo
+    const uint16_t *celdas;     // direcciones a reportar por corrida
+    int n_celdas;
+} LoteConfig;
+
+/*
+ * Lee el archivo de parches (una corrida por línea: "100=5 101=0", ';' para
+ * comentarios, "-" = corrida sin parche; las líneas vacías no cuentan),
+ * ejecuta todas las corridas y escribe los resultados en 'salida' (CSV, o
+ * binario si termina en .bin; NULL = CSV por stdout). Devuelve 0 si todo
+ * bien.
+ */
+int lote_ejecutar(const LoteConfig *cfg, const char *parches, const char *salida);
+
+#endif
@@ -1,47 +1,248 @@
+/*
+ * main.c - pipeline completo C -> ASM -> programa -> CPU en un solo proceso
+ * con libcomputadora (ver computadora.h): los pasos se pasan búferes en
+ * memoria, sin archivos intermedios ni procesos hijos.
+ *
+ * Uso: main                          demostración con ejemplos/factorial.c
+ *      main [opciones] fuente|dir...  muchos programas en pipeline (tuberia.h)
+ *
+ *   --hilos=N      hilos por etapa (uno por núcleo por defecto)
+ *   --cola=N       programas por cola entre etapas (2 por hilo)
+ *   --ancho=16     operandos de dirección de 16 bits
+ *   --memoria=N|NK espacio de cada simulación (256 bytes por defecto)
+ *   --motor=M      núcleo de la CPU
+ *   --limite=N     instrucciones como máximo por programa
+ *   --celdas=a,b   celdas a reportar (100,101,102 por defecto)
+ *   -O0|-O1|-O2    optimización al traducir los .c (-O1 por defecto)
+ *   --mirilla      mirilla del ensamblador (ver ensamblador.h)
+ *   --salida=F     CSV de resultados (stdout por defecto)
+ *
+ * Un directorio aporta sus archivos .c y .asm en orden alfabético.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <dirent.h>
+#include "computadora.h"
+#include "tuberia.h"
+
+/* Lista de fuentes que crece (rutas propias, malloc) */
+typedef struct {
+    char **rutas;
+    int n, cap;
+} ListaFuentes;
+
+static int agregar_fuente(ListaFuentes *l, const char *ruta) {
+    if (l->n == l->cap) {
+        int cap = l->cap ? l->cap * 2 : 64;
+        char **r = realloc(l->rutas, (size_t)cap * sizeof(char *));
+        if (!r) return -1;
+        l->rutas = r;
+        l->cap = cap;
+    }
+    if (!(l->rutas[l->n] = strdup(ruta))) return -1;
+    l->n++;
+    return 0;
+}
+
+static int comparar_rutas(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Agrega 'ruta', o si es un directorio sus .c y .asm ordenados */
+static int agregar_ruta(ListaFuentes *l, const char *ruta) {
+    DIR *d = opendir(ruta);
+    if (!d)
+        return agregar_fuente(l, ruta);
+
+    int desde = l->n;
+    struct dirent *ent;
+    while ((ent = readdir(d))) {
+        const char *ext = strrchr(ent->d_name, '.');
+        if (!ext || (strcmp(ext, ".c") != 0 && strcmp(ext, ".asm") != 0))
+            continue;
+        char completa[4096];
+        snprintf(completa, sizeof(completa), "%s/%s", ruta, ent->d_name);
+        if (agregar_fuente(l, completa) < 0) {
+            closedir(d);
+            return -1;
+        }
+    }
+    closedir(d);
+    qsort(l->rutas + desde, (size_t)(l->n - desde), sizeof(char *), comparar_rutas);
+    return 0;
+}
+
+static int varios_programas(int argc, char *argv[]) {
+    uint16_t celdas[TUBERIA_MAX_CELDAS] = {100, 101, 102};
+    TuberiaConfig cfg = {
+        .ancho = 8, .nivel = COMPILADOR_NIVEL_DEFECTO, .mem_tam = MEM_TAM_DEFECTO,
+        .motor = MOTOR_SWITCH, .celdas = celdas, .n_celdas = 3,
+    };
+    const char *salida = NULL;
+    ListaFuentes fuentes = { 0 };
+    int ret = 1;
+
+    for (int k = 1; k < argc; ++k) {
+        if (strncmp(argv[k], "--hilos=", 8) == 0) {
+            cfg.hilos = atoi(argv[k] + 8);
+        } else if (strncmp(argv[k], "--cola=", 7) == 0) {
+            cfg.cola = atoi(argv[k] + 7);
+        } else if (strcmp(argv[k], "--ancho=16") == 0) {
+            cfg.ancho = 16;
+        } else if (strcmp(argv[k], "--ancho=8") == 0) {
+            cfg.ancho = 8;
+        } else if (strcmp(argv[k], "--mirilla") == 0) {
+            cfg.mirilla = 1;
+        } else if (strncmp(argv[k], "--memoria=", 10) == 0) {
+            char *fin;
+            unsigned long t = strtoul(argv[k] + 10, &fin, 0);
+            if (*fin == 'K' || *fin == 'k') {
+                t *= 1024;
+                fin++;
+            }
+            if (*fin || t < MEM_SIZE || t > MEM_MAX) {
+                fprintf(stderr, "Tamaño de memoria inválido: %s (de %u a %u bytes)\n",
+                        argv[k] + 10, MEM_SIZE, MEM_MAX);
+                goto fin;
+            }
+            cfg.mem_tam = (uint32_t)t;
+        } else if (strncmp(argv[k], "--motor=", 8) == 0) {
+            int m = cpu_motor_desde_nombre(argv[k] + 8);
+            if (m < 0 || m == MOTOR_SIMD) {
+                fprintf(stderr, "Motor no válido aquí: %s\n", argv[k] + 8);
+                goto fin;
+            }
+            cfg.motor = (MotorCPU)m;
+        } else if (strncmp(argv[k], "--limite=", 9) == 0) {
+            cfg.limite = strtoul(argv[k] + 9, NULL, 0);
+        } else if (strncmp(argv[k], "--celdas=", 9) == 0) {
+            char *p = argv[k] + 9;
+            cfg.n_celdas = 0;
+            for (;;) {
+                char *fin_num;
+                long d = strtol(p, &fin_num, 0);
+                if (fin_num == p || (*fin_num && *fin_num != ',')) {
+                    fprintf(stderr, "Lista de celdas inválida: %s\n", argv[k] + 9);
+                    goto fin;
+                }
+                if (d < 0 || d >= MEM_MAX) {
+                    fprintf(stderr, "Celda fuera de memoria: %ld\n", d);
+                    goto fin;
+                }
+                if (cfg.n_celdas == TUBERIA_MAX_CELDAS) {
+                    fprintf(stderr, "Máximo %d celdas por programa\n", TUBERIA_MAX_CELDAS);
+                    goto fin;
+                }
+                celdas[cfg.n_celdas++] = (uint16_t)d;
+                if (!*fin_num)
+                    break;
+                p = fin_num + 1;
+            }
+        } else if (strncmp(argv[k], "--salida=", 9) == 0) {
+            salida = argv[k] + 9;
+        } else if (argv[k][0] == '-' && argv[k][1] == 'O' && argv[k][2] >= '0' &&
+                   argv[k][2] <= '2' && !argv[k][3]) {
+            cfg.nivel = argv[k][2] - '0';
+        } else if (argv[k][0] == '-' && argv[k][1] == '-') {
+            fprintf(stderr, "Opción desconocida: %s\n", argv[k]);
+            fprintf(stderr, "Uso: %s [--hilos=N] [--cola=N] [--ancho=16] [--memoria=N] [--motor=M] [--limite=N] [--celdas=a,b] [--salida=F] [-O0|-O1|-O2] [--mirilla] fuente|dir...\n", argv[0]);
+            goto fin;
+        } else if (agregar_ruta(&fuentes, argv[k]) < 0) {
+            fprintf(stderr, "[ERROR] Sin memoria para la lista de fuentes\n");
+            goto fin;
+        }
+    }
+
+    if (fuentes.n == 0) {
+        fprintf(stderr, "No hay fuentes .c ni .asm que procesar\n");
+        goto fin;
+    }
+
+    FILE *f = salida ? fopen(salida, "w") : stdout;
+    if (!f) {
+        perror("fopen salida");
+        goto fin;
+    }
+    int r = tuberia_ejecutar(&cfg, (const char *const *)fuentes.rutas, fuentes.n, f);
+    if (f != stdout) fclose(f);
+    ret = r == 0 ? 0 : 1;
+
+fin:
+    for (int i = 0; i < fuentes.n; ++i)
+        free(fuentes.rutas[i]);
+    free(fuentes.rutas);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1)
+        return varios_programas(argc, argv);
+
+    const char *fuente_path = "ejemplos/factorial.c";
 
-int main() {
     printf("\n===============================\n");
     printf("  SISTEMA VON NEUMANN INTEGRADO\n");
     printf("===============================\n\n");
 
     clock_t t_start = clock();
 
+    char *fuente;
+    size_t fuente_len;
+    if (computadora_leer_archivo(fuente_path, &fuente, &fuente_len) < 0)
+        return 1;
+
     printf("[1] Traduciendo C → ASM...\n");
     clock_t t0 = clock();
-    int ret = system("./build/c_to_asm ejemplos/factorial.c");
+    char *asm_txt;
+    size_t asm_len;
+    InformeOptimizacion inf;
+    int ret = compilador_traducir(fuente, fuente_len, COMPILADOR_NIVEL_DEFECTO, 8, MEM_TAM_DEFECTO,
+                                  &asm_txt, &asm_len, &inf);
     clock_t t1 = clock();
     double t_c_to_asm = (double)(t1 - t0) / CLOCKS_PER_SEC;
+    free(fuente);
     if (ret != 0) {
-        fprintf(stderr, "[ERROR] c_to_asm devolvió %d\n", ret);
+        fprintf(stderr, "[ERROR] No se pudo traducir %s\n", fuente_path);
         return 1;
     }
+    printf("    -O%d: %d -> %d instrucciones\n", COMPILADOR_NIVEL_DEFECTO,
+           inf.instrucciones_sin, inf.instrucciones);
 
-    /* mover archivo generado (c_to_asm crea factorial.asm en cwd) */
-    system("mv -f factorial.asm build/factorial.asm");
-
-    printf("[2] Ensamblando ASM → MEM...\n");
+    printf("[2] Ensamblando ASM → programa...\n");
     clock_t t2 = clock();
-    ret = system("./build/assembler build/factorial.asm build/factorial.mem");
+    Programa prog;
+    ret = ensamblador_buffer(asm_txt, asm_len, 8, &prog, NULL);
     clock_t t3 = clock();
     double t_asm_to_mem = (double)(t3 - t2) / CLOCKS_PER_SEC;
+    free(asm_txt);
     if (ret != 0) {
-        fprintf(stderr, "[ERROR] assembler devolvió %d\n", ret);
+        fprintf(stderr, "[ERROR] No se pudo ensamblar el programa\n");
         return 1;
     }
 
     printf("[3] Ejecutando simulador de CPU...\n");
     clock_t t4 = clock();
-    ret = system("./build/cpu_simulator build/factorial.mem");
+    CPU cpu;
+    Memoria mem;
+    ret = computadora_ejecutar(&prog, MEM_TAM_DEFECTO, MOTOR_SWITCH, &cpu, &mem);
     clock_t t5 = clock();
     double t_cpu = (double)(t5 - t4) / CLOCKS_PER_SEC;
+    programa_liberar(&prog);
     if (ret != 0) {
-        fprintf(stderr, "[ERROR] cpu_simulator devolvió %d\n", ret);
+        fprintf(stderr, "[ERROR] No se pudo ejecutar el programa\n");
         return 1;
     }
 
+    cpu_imprimir_resumen(&cpu);
+    printf("\n--- Variables principales en memoria ---\n");
+    printf("N (MEM[100]) = %d\n", mem.data[100]);
+    printf("contador (MEM[101]) = %d\n", mem.data[101]);
+    printf("resultado (MEM[102]) = %d\n", mem.data[102]);
+    memoria_liberar(&mem);
+
     clock_t t_end = clock();
     double t_total = (double)(t_end - t_start) / CLOCKS_PER_SEC;
 
@@ -53,4 +254,4 @@ int main() {
 
     printf("\n=== PROGRAMA FINALIZADO ===\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,33 +1,147 @@
-<<<<<<< HEAD
 #include "memoria.h"
+#include <stdlib.h>
 #include <string.h>
 
+/* Los contadores de referencias se tocan desde varios hilos (fork en lote) */
+#define REFS_LEER(p)    __atomic_load_n(&(p)->refs, __ATOMIC_ACQUIRE)
+#define REFS_MAS(p)     __atomic_add_fetch(&(p)->refs, 1, __ATOMIC_RELAXED)
+#define REFS_MENOS(p)   __atomic_sub_fetch(&(p)->refs, 1, __ATOMIC_ACQ_REL)
+
+static void soltar(Pagina *p) {
+    if (p && REFS_MENOS(p) == 0)
+        free(p);
+}
+
+static void olvidar_caches(Memoria *m) {
+    m->cache_pag = 0;       // la página 0 nunca pasa por las cachés
+    m->cache_ptr = NULL;
+    m->cache_escr_pag = 0;
+    m->cache_escr_ptr = NULL;
+}
+
 void memoria_init(Memoria *m) {
     memset(m->data, 0, MEM_SIZE);
+    m->tam = MEM_SIZE;
+    m->paginas = NULL;
+    olvidar_caches(m);
 }
 
-=======
-/*
- * Archivo: memoria.c
- * Función: Implementa el módulo de memoria principal del simulador.
- *           Se encarga de almacenar y recuperar datos e instrucciones.
- */
+int memoria_init_tam(Memoria *m, uint32_t tam) {
+    memoria_init(m);
+    if (tam < MEM_SIZE || tam > MEM_MAX)
+        return -1;
+    tam = (tam + MEM_PAGINA - 1) & ~(MEM_PAGINA - 1);
+    if (tam == MEM_SIZE)
+        return 0;
 
-#include "memoria.h"  // Define la estructura y tamaño de la memoria.
+    m->paginas = calloc(tam >> MEM_PAGINA_BITS, sizeof(Pagina *));
+    if (!m->paginas)
+        return -1;
+    m->tam = tam;
+    return 0;
+}
 
-// Inicializa toda la memoria a 0
-void memoria_init(Memoria *m) {
-    for (int i = 0; i < MEM_SIZE; i++)
-        m->data[i] = 0;  // Limpia cada posición
+void memoria_liberar(Memoria *m) {
+    if (m->paginas) {
+        for (uint32_t p = 1; p < (m->tam >> MEM_PAGINA_BITS); ++p)
+            soltar(m->paginas[p]);
+        free(m->paginas);
+    }
+    memoria_init(m);
+}
+
+const uint8_t *memoria_pagina_lectura(Memoria *m, uint32_t pag) {
+    if (pag == 0 || pag >= (m->tam >> MEM_PAGINA_BITS) || !m->paginas[pag])
+        return NULL;
+    m->cache_pag = pag;
+    m->cache_ptr = m->paginas[pag]->datos;
+    return m->cache_ptr;
 }
 
-// Lee un byte desde una dirección específica
-uint8_t memoria_leer(Memoria *m, uint8_t direccion) {
-    return m->data[direccion];  // Retorna el valor almacenado
+uint8_t *memoria_pagina_escritura(Memoria *m, uint32_t pag) {
+    if (pag == 0 || pag >= (m->tam >> MEM_PAGINA_BITS))
+        return NULL;
+
+    Pagina *p = m->paginas[pag];
+    if (!p || REFS_LEER(p) > 1) {
+        /* Nueva, o compartida: esta memoria pasa a tener su propia copia */
+        Pagina *nueva = malloc(sizeof(Pagina));
+        if (!nueva)
+            return NULL;
+        nueva->refs = 1;
+        if (p)
+            memcpy(nueva->datos, p->datos, MEM_PAGINA);
+        else
+            memset(nueva->datos, 0, MEM_PAGINA);
+        m->paginas[pag] = nueva;
+        soltar(p);
+        p = nueva;
+    }
+
+    m->cache_escr_pag = m->cache_pag = pag;
+    m->cache_escr_ptr = p->datos;
+    m->cache_ptr = p->datos;
+    return p->datos;
+}
+
+int memoria_clonar(Memoria *dst, Memoria *src) {
+    memcpy(dst->data, src->data, MEM_SIZE);
+    dst->tam = src->tam;
+    dst->paginas = NULL;
+    olvidar_caches(dst);
+    if (!src->paginas)
+        return 0;
+
+    uint32_t n = src->tam >> MEM_PAGINA_BITS;
+    dst->paginas = malloc(n * sizeof(Pagina *));
+    if (!dst->paginas) {
+        dst->tam = MEM_SIZE;
+        return -1;
+    }
+    memcpy(dst->paginas, src->paginas, n * sizeof(Pagina *));
+    for (uint32_t p = 1; p < n; ++p)
+        if (dst->paginas[p])
+            REFS_MAS(dst->paginas[p]);
+
+    /*
+     * El origen tampoco puede seguir escribiendo en sitio sobre páginas que
+     * ahora comparte: su caché de escritura queda invalidada. (Sólo se toca
+     * si hace falta, para poder clonar desde varios hilos una memoria que
+     * nadie escribe.)
+     */
+    if (src->cache_escr_ptr) {
+        src->cache_escr_pag = 0;
+        src->cache_escr_ptr = NULL;
+    }
+    return 0;
+}
+
+int memoria_copiar(Memoria *m, uint32_t dir, const uint8_t *src, uint32_t n) {
+    if (dir > m->tam || n > m->tam - dir)
+        return -1;
+
+    /* Página 0 de una vez; el resto página a página */
+    if (dir < MEM_SIZE) {
+        uint32_t k = n < MEM_SIZE - dir ? n : MEM_SIZE - dir;
+        memcpy(m->data + dir, src, k);
+        dir += k; src += k; n -= k;
+    }
+    while (n > 0) {
+        uint32_t off = dir & (MEM_PAGINA - 1);
+        uint32_t k = n < MEM_PAGINA - off ? n : MEM_PAGINA - off;
+        uint8_t *p = memoria_pagina_escritura(m, dir >> MEM_PAGINA_BITS);
+        if (!p)
+            return -1;
+        memcpy(p + off, src, k);
+        dir += k; src += k; n -= k;
+    }
+    return 0;
 }
 
-// Escribe un byte en una dirección específica
-void memoria_escribir(Memoria *m, uint8_t direccion, uint8_t valor) {
-    m->data[direccion] = valor;  // Guarda el valor en la dirección dada
+uint32_t memoria_paginas_usadas(const Memoria *m) {
+    uint32_t n = 0;
+    if (m->paginas)
+        for (uint32_t p = 1; p < (m->tam >> MEM_PAGINA_BITS); ++p)
+            n += m->paginas[p] != NULL;
+    return n;
 }
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
@@ -3,18 +3,98 @@
 
 #include <stdint.h>
 
-#define MEM_SIZE 256
+/*
+ * Memoria paginada dispersa.
+ *
+ * Los primeros MEM_SIZE bytes (la página 0, el espacio clásico de 8 bits)
+ * viven dentro de la estructura y siempre existen: los motores rápidos
+ * (threaded, predecode, jit, simd) trabajan sólo sobre ellos.
+ *
+ * Con memoria_init_tam() el espacio puede crecer hasta MEM_MAX bytes. El
+ * resto se reparte en páginas de MEM_PAGINA bytes que se reservan al
+ * escribirlas por primera vez; una página nunca escrita se lee como ceros.
+ * Así una imagen grande y casi vacía no cuesta ni la reserva ni el memset
+ * de todo el espacio.
+ */
+
+#define MEM_SIZE 256                            // página 0 / espacio de 8 bits
+#define MEM_PAGINA_BITS 8
+#define MEM_PAGINA (1u << MEM_PAGINA_BITS)      // bytes por página
+#define MEM_MAX (1u << 16)                      // límite con operandos de 16 bits
+
+/* Espacio del simulador si no se pasa --memoria (p. ej. -DMEM_TAM_DEFECTO=65536) */
+#ifndef MEM_TAM_DEFECTO
+#define MEM_TAM_DEFECTO MEM_SIZE
+#endif
+
+/* Página fuera de la 0; varias memorias la comparten tras memoria_clonar */
+typedef struct {
+    int refs;                   // memorias que la referencian
+    uint8_t datos[MEM_PAGINA];
+} Pagina;
 
 typedef struct {
-    uint8_t data[MEM_SIZE];
+    uint8_t data[MEM_SIZE];     // página 0, siempre presente
+    uint32_t tam;               // bytes direccionables (MEM_SIZE .. MEM_MAX)
+    Pagina **paginas;           // tabla de páginas (NULL si tam == MEM_SIZE)
+
+    /* Última página (> 0) leída y última escrita (ésta siempre propia) */
+    uint32_t cache_pag;
+    const uint8_t *cache_ptr;
+    uint32_t cache_escr_pag;
+    uint8_t *cache_escr_ptr;
 } Memoria;
 
+/* Memoria de 8 bits: sólo la página 0, a cero */
 void memoria_init(Memoria *m);
-<<<<<<< HEAD
-=======
-uint8_t memoria_leer(Memoria *m, uint8_t direccion);
-void memoria_escribir(Memoria *m, uint8_t direccion, uint8_t valor);
->>>>>>> 3f14a8867c6b4f7bdc29a45de37cf8e4e9dfae36
 
-#endif
+/* Espacio de 'tam' bytes (se redondea a páginas). -1 si tam no es válido */
+int memoria_init_tam(Memoria *m, uint32_t tam);
+
+/* Suelta las páginas (las compartidas siguen vivas en las otras memorias) */
+void memoria_liberar(Memoria *m);
 
+/*
+ * Página 'pag' (> 0) para leer (NULL si nunca se escribió) o para escribir:
+ * se reserva si no existe y se copia si está compartida con otra memoria.
+ */
+const uint8_t *memoria_pagina_lectura(Memoria *m, uint32_t pag);
+uint8_t *memoria_pagina_escritura(Memoria *m, uint32_t pag);
+
+/*
+ * Copia 'src' en 'dst' (sin inicializar) compartiendo sus páginas: sólo se
+ * duplican la página 0 y la tabla. Cada página se copia al escribirla por
+ * primera vez en cualquiera de las dos (copy-on-write). -1 sin memoria.
+ */
+int memoria_clonar(Memoria *dst, Memoria *src);
+
+/* Copia n bytes a partir de 'dir'. -1 si se sale del espacio */
+int memoria_copiar(Memoria *m, uint32_t dir, const uint8_t *src, uint32_t n);
+
+/* Páginas reservadas fuera de la página 0 */
+uint32_t memoria_paginas_usadas(const Memoria *m);
+
+/* --- Acceso en el camino rápido: página 0 y última página en línea --- */
+static inline uint8_t memoria_leer(Memoria *m, uint32_t dir) {
+    if (dir < MEM_SIZE)
+        return m->data[dir];
+    uint32_t pag = dir >> MEM_PAGINA_BITS;
+    if (pag == m->cache_pag)
+        return m->cache_ptr[dir & (MEM_PAGINA - 1)];
+    const uint8_t *p = memoria_pagina_lectura(m, pag);
+    return p ? p[dir & (MEM_PAGINA - 1)] : 0;
+}
+
+static inline void memoria_escribir(Memoria *m, uint32_t dir, uint8_t v) {
+    if (dir < MEM_SIZE) {
+        m->data[dir] = v;
+        return;
+    }
+    uint32_t pag = dir >> MEM_PAGINA_BITS;
+    uint8_t *p = pag == m->cache_escr_pag ? m->cache_escr_ptr
+                                          : memoria_pagina_escritura(m, pag);
+    if (p)
+        p[dir & (MEM_PAGINA - 1)] = v;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Archivo: metricas.c
+ * Agregación sin locks de las métricas de varias CPUs.
+ *
+ * Las escrituras y lecturas de cada campo usan __atomic relajado: en x86-64
+ * y ARM64 son loads/stores normales, pero garantizan que un lector
+ * concurrente nunca ve un valor a medio escribir.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "metricas.h"
+
+#define LEER(x)         __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define SUMAR(x, v)     __atomic_store_n(&(x), LEER(x) + (v), __ATOMIC_RELAXED)
+
+int agregador_init(AgregadorMetricas *ag, int n_ranuras) {
+    if (n_ranuras < 1) n_ranuras = 1;
+    ag->ranuras = aligned_alloc(METRICAS_LINEA_CACHE,
+                                (size_t)n_ranuras * sizeof(RanuraMetricas));
+    if (!ag->ranuras) {
+        ag->n = 0;
+        return -1;
+    }
+    memset(ag->ranuras, 0, (size_t)n_ranuras * sizeof(RanuraMetricas));
+    ag->n = n_ranuras;
+    return 0;
+}
+
+void agregador_destruir(AgregadorMetricas *ag) {
+    free(ag->ranuras);
+    ag->ranuras = NULL;
+    ag->n = 0;
+}
+
+void agregador_sumar(AgregadorMetricas *ag, int ranura, const CPUMetricas *m) {
+    RanuraMetricas *r = &ag->ranuras[ranura];
+    SUMAR(r->suma.instrucciones, m->instrucciones);
+    SUMAR(r->suma.ciclos, m->ciclos);
+    SUMAR(r->suma.accesos_memoria, m->accesos_memoria);
+    SUMAR(r->suma.saltos_tomados, m->saltos_tomados);
+    SUMAR(r->suma.saltos_no_tomados, m->saltos_no_tomados);
+    if (m->profundidad_pila > LEER(r->suma.profundidad_pila))
+        __atomic_store_n(&r->suma.profundidad_pila, m->profundidad_pila, __ATOMIC_RELAXED);
+    SUMAR(r->corridas, 1);
+
+    double seg;
+    __atomic_load(&r->suma.segundos, &seg, __ATOMIC_RELAXED);
+    seg += m->segundos;
+    __atomic_store(&r->suma.segundos, &seg, __ATOMIC_RELAXED);
+}
+
+void agregador_total(const AgregadorMetricas *ag, CPUMetricas *total, unsigned long *corridas) {
+    memset(total, 0, sizeof(*total));
+    unsigned long n = 0;
+    for (int k = 0; k < ag->n; ++k) {
+        const RanuraMetricas *r = &ag->ranuras[k];
+        total->instrucciones += LEER(r->suma.instrucciones);
+        total->ciclos += LEER(r->suma.ciclos);
+        total->accesos_memoria += LEER(r->suma.accesos_memoria);
+        total->saltos_tomados += LEER(r->suma.saltos_tomados);
+        total->saltos_no_tomados += LEER(r->suma.saltos_no_tomados);
+        int p = LEER(r->suma.profundidad_pila);
+        if (p > total->profundidad_pila) total->profundidad_pila = p;
+        double seg;
+        __atomic_load(&r->suma.segundos, &seg, __ATOMIC_RELAXED);
+        total->segundos += seg;
+        n += LEER(r->corridas);
+    }
+    if (corridas) *corridas = n;
+}
+
+void agregador_sumar_diagnosticos(AgregadorMetricas *ag, int ranura, const Diagnosticos *d) {
+    RanuraMetricas *r = &ag->ranuras[ranura];
+    for (int t = 0; t < DIAG_TIPOS; ++t)
+        if (d->por_tipo[t])
+            SUMAR(r->diagnosticos[t], d->por_tipo[t]);
+}
+
+void agregador_diagnosticos(const AgregadorMetricas *ag, uint64_t por_tipo[DIAG_TIPOS]) {
+    memset(por_tipo, 0, DIAG_TIPOS * sizeof(por_tipo[0]));
+    for (int k = 0; k < ag->n; ++k)
+        for (int t = 0; t < DIAG_TIPOS; ++t)
+            por_tipo[t] += LEER(ag->ranuras[k].diagnosticos[t]);
+}
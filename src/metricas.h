@@ -0,0 +1,43 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include "cpu.h"
+
+/*
+ * Agregador de métricas de muchas ejecuciones concurrentes.
+ *
+ * Cada hilo suma en su propia ranura (alineada a una línea de caché para
+ * que los hilos no se pisen) sin locks ni operaciones atómicas costosas:
+ * sólo su dueño la escribe. agregador_total() puede llamarse en cualquier
+ * momento, incluso con los hilos corriendo, y combina todas las ranuras.
+ */
+
+#define METRICAS_LINEA_CACHE 64
+
+typedef struct {
+    _Alignas(METRICAS_LINEA_CACHE) CPUMetricas suma;
+    unsigned long corridas;
+    uint64_t diagnosticos[DIAG_TIPOS];      // sucesos por tipo (Diagnosticos.por_tipo)
+} RanuraMetricas;
+
+typedef struct {
+    RanuraMetricas *ranuras;
+    int n;
+} AgregadorMetricas;
+
+int agregador_init(AgregadorMetricas *ag, int n_ranuras);
+void agregador_destruir(AgregadorMetricas *ag);
+
+/* Suma una ejecución en la ranura 'ranura' (sólo desde el hilo dueño) */
+void agregador_sumar(AgregadorMetricas *ag, int ranura, const CPUMetricas *m);
+
+/* Suma los contadores por tipo de 'd' en la ranura (sólo desde el hilo dueño) */
+void agregador_sumar_diagnosticos(AgregadorMetricas *ag, int ranura, const Diagnosticos *d);
+
+/* Diagnósticos por tipo de todas las ranuras */
+void agregador_diagnosticos(const AgregadorMetricas *ag, uint64_t por_tipo[DIAG_TIPOS]);
+
+/* Total de todas las ranuras; profundidad_pila es el máximo */
+void agregador_total(const AgregadorMetricas *ag, CPUMetricas *total, unsigned long *corridas);
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * Archivo: perfil.c
+ * Perfilador por PC: reserva de contadores, árbol de llamadas e informes.
+ *
+ * Los contadores se actualizan desde los ganchos en línea de perfil.h; aquí
+ * sólo está lo que no se ejecuta en cada instrucción.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "perfil.h"
+#include "cpu.h"
+
+Perfil *perfil_crear(uint32_t tam, uint32_t entrada) {
+    Perfil *p = calloc(1, sizeof(Perfil));
+    if (!p) return NULL;
+
+    p->tam = tam;
+    p->ejecuciones = calloc(tam, sizeof(uint64_t));
+    p->opcodes = calloc(tam, sizeof(uint8_t));
+    p->tomados = calloc(tam, sizeof(uint64_t));
+    p->no_tomados = calloc(tam, sizeof(uint64_t));
+    p->destinos = calloc(tam, sizeof(uint32_t));
+    p->lecturas = calloc(tam, sizeof(uint64_t));
+    p->escrituras = calloc(tam, sizeof(uint64_t));
+    p->nodos = malloc(64 * sizeof(NodoLlamada));
+    if (!p->ejecuciones || !p->opcodes || !p->tomados || !p->no_tomados ||
+        !p->destinos || !p->lecturas || !p->escrituras || !p->nodos) {
+        perfil_destruir(p);
+        return NULL;
+    }
+
+    /* Raíz del árbol: el código que se ejecuta desde la entrada */
+    p->nodos[0] = (NodoLlamada){ .funcion = entrada, .padre = -1, .hijo = -1, .hermano = -1 };
+    p->n_nodos = 1;
+    return p;
+}
+
+void perfil_destruir(Perfil *p) {
+    if (!p) return;
+    free(p->ejecuciones);
+    free(p->opcodes);
+    free(p->tomados);
+    free(p->no_tomados);
+    free(p->destinos);
+    free(p->lecturas);
+    free(p->escrituras);
+    free(p->nodos);
+    free(p);
+}
+
+// ==================== ÁRBOL DE LLAMADAS ====================
+
+static int nuevo_nodo(Perfil *p, int padre, uint32_t funcion) {
+    if (p->n_nodos == PERFIL_MAX_NODOS)
+        return -1;
+    /* Capacidad en potencias de dos a partir de 64 */
+    if (p->n_nodos >= 64 && (p->n_nodos & (p->n_nodos - 1)) == 0) {
+        NodoLlamada *n = realloc(p->nodos, 2 * (size_t)p->n_nodos * sizeof(NodoLlamada));
+        if (!n) return -1;
+        p->nodos = n;
+    }
+    int k = p->n_nodos++;
+    p->nodos[k] = (NodoLlamada){ .funcion = funcion, .padre = padre,
+                                 .hijo = -1, .hermano = p->nodos[padre].hijo };
+    p->nodos[padre].hijo = k;
+    return k;
+}
+
+void perfil_llamada(Perfil *p, uint32_t destino) {
+    /* Con el árbol lleno se cuenta la profundidad para emparejar los RET */
+    if (p->sin_nodo) {
+        p->sin_nodo++;
+        return;
+    }
+    int k = p->nodos[p->nodo_actual].hijo;
+    while (k >= 0 && p->nodos[k].funcion != destino)
+        k = p->nodos[k].hermano;
+    if (k < 0)
+        k = nuevo_nodo(p, p->nodo_actual, destino);
+    if (k < 0)
+        p->sin_nodo = 1;
+    else
+        p->nodo_actual = k;
+}
+
+void perfil_retorno(Perfil *p) {
+    if (p->sin_nodo)
+        p->sin_nodo--;
+    else if (p->nodos[p->nodo_actual].padre >= 0)   /* RET sin CALL: se ignora */
+        p->nodo_actual = p->nodos[p->nodo_actual].padre;
+}
+
+// ==================== INFORMES ====================
+
+/* Orden descendente por una clave de 64 bits (para qsort) */
+typedef struct {
+    uint64_t clave;
+    uint32_t a, b;
+} Entrada;
+
+static int por_clave(const void *x, const void *y) {
+    const Entrada *p = x, *q = y;
+    if (p->clave != q->clave) return p->clave < q->clave ? 1 : -1;
+    if (p->a != q->a) return p->a < q->a ? -1 : 1;
+    return p->b < q->b ? -1 : (p->b > q->b);
+}
+
+static double pct(uint64_t parte, uint64_t total) {
+    return total ? 100.0 * (double)parte / (double)total : 0.0;
+}
+
+void perfil_informe(const Perfil *p, FILE *f, int top) {
+    size_t cap = p->tam > 256 * 256 ? p->tam : 256 * 256;
+    Entrada *e = malloc(cap * sizeof(Entrada));
+    if (!e) return;
+
+    uint64_t total = 0;
+    for (uint32_t pc = 0; pc < p->tam; ++pc)
+        total += p->ejecuciones[pc];
+
+    fprintf(f, "\n--- PERFIL: PUNTOS CALIENTES ---\n");
+    fprintf(f, "Instrucciones perfiladas: %llu\n", (unsigned long long)total);
+
+    /* Instrucciones más ejecutadas */
+    size_t n = 0;
+    for (uint32_t pc = 0; pc < p->tam; ++pc)
+        if (p->ejecuciones[pc])
+            e[n++] = (Entrada){ p->ejecuciones[pc], pc, 0 };
+    qsort(e, n, sizeof(Entrada), por_clave);
+    fprintf(f, "\n  PC       veces          %%      opcode\n");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k)
+        fprintf(f, "  0x%04x  %12llu  %6.2f%%  %s\n", e[k].a, (unsigned long long)e[k].clave,
+                pct(e[k].clave, total), cpu_opcode_nombre(p->opcodes[e[k].a]));
+
+    /*
+     * Bucles: cada salto hacia atrás tomado (JMP/JMPZ con destino <= PC)
+     * cierra el cuerpo [destino, PC]; su peso son las instrucciones
+     * ejecutadas dentro del rango.
+     */
+    n = 0;
+    for (uint32_t pc = 0; pc < p->tam; ++pc) {
+        uint8_t base = p->opcodes[pc] & ~OP_ANCHO;
+        if ((base == 7 || base == 13) && p->tomados[pc] && p->destinos[pc] <= pc) {
+            uint64_t cuerpo = 0;
+            for (uint32_t d = p->destinos[pc]; d <= pc; ++d)
+                cuerpo += p->ejecuciones[d];
+            e[n++] = (Entrada){ cuerpo, p->destinos[pc], pc };
+        }
+    }
+    qsort(e, n, sizeof(Entrada), por_clave);
+    fprintf(f, "\n  Bucles (saltos hacia atrás)\n");
+    if (n == 0)
+        fprintf(f, "  (ninguno)\n");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k) {
+        uint32_t s = e[k].b;
+        fprintf(f, "  [0x%04x-0x%04x]  %llu vueltas, %llu instrucciones (%.2f%%), "
+                   "cierra %s en 0x%04x (%.1f%% tomado)\n",
+                e[k].a, s, (unsigned long long)p->tomados[s],
+                (unsigned long long)e[k].clave, pct(e[k].clave, total),
+                cpu_opcode_nombre(p->opcodes[s]), s,
+                pct(p->tomados[s], p->tomados[s] + p->no_tomados[s]));
+    }
+
+    /* Saltos */
+    n = 0;
+    for (uint32_t pc = 0; pc < p->tam; ++pc)
+        if (p->tomados[pc] + p->no_tomados[pc])
+            e[n++] = (Entrada){ p->tomados[pc] + p->no_tomados[pc], pc, 0 };
+    qsort(e, n, sizeof(Entrada), por_clave);
+    fprintf(f, "\n  Saltos           tomados     no tomados   %%tomado\n");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k) {
+        uint32_t pc = e[k].a;
+        fprintf(f, "  0x%04x %-7s %12llu %12llu   %6.2f%%\n", pc, cpu_opcode_nombre(p->opcodes[pc]),
+                (unsigned long long)p->tomados[pc], (unsigned long long)p->no_tomados[pc],
+                pct(p->tomados[pc], e[k].clave));
+    }
+
+    /* Memoria de datos */
+    n = 0;
+    for (uint32_t d = 0; d < p->tam; ++d)
+        if (p->lecturas[d] + p->escrituras[d])
+            e[n++] = (Entrada){ p->lecturas[d] + p->escrituras[d], d, 0 };
+    qsort(e, n, sizeof(Entrada), por_clave);
+    fprintf(f, "\n  Dirección     lecturas   escrituras\n");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k)
+        fprintf(f, "  0x%04x  %12llu %12llu\n", e[k].a,
+                (unsigned long long)p->lecturas[e[k].a],
+                (unsigned long long)p->escrituras[e[k].a]);
+
+    /* Pares de opcodes (la fila 0 es el arranque, no un opcode) */
+    n = 0;
+    uint64_t total_pares = 0;
+    for (int a = 1; a < 256; ++a)
+        for (int b = 0; b < 256; ++b)
+            if (p->pares[a][b]) {
+                e[n++] = (Entrada){ p->pares[a][b], (uint32_t)a, (uint32_t)b };
+                total_pares += p->pares[a][b];
+            }
+    qsort(e, n, sizeof(Entrada), por_clave);
+    fprintf(f, "\n  Pares de opcodes          veces          %%\n");
+    for (size_t k = 0; k < n && k < (size_t)top; ++k)
+        fprintf(f, "  %-8s -> %-8s %12llu  %6.2f%%\n", cpu_opcode_nombre((uint8_t)e[k].a),
+                cpu_opcode_nombre((uint8_t)e[k].b), (unsigned long long)e[k].clave,
+                pct(e[k].clave, total_pares));
+
+    free(e);
+}
+
+int perfil_escribir_plegado(const Perfil *p, const char *path) {
+    int *camino = malloc((size_t)p->n_nodos * sizeof(int));
+    FILE *f = camino ? fopen(path, "w") : NULL;
+    if (!f) {
+        free(camino);
+        return -1;
+    }
+
+    for (int k = 0; k < p->n_nodos; ++k) {
+        if (!p->nodos[k].instrucciones)
+            continue;
+        int prof = 0;
+        for (int j = k; j >= 0; j = p->nodos[j].padre)
+            camino[prof++] = j;
+        for (int i = prof - 1; i >= 0; --i) {
+            const NodoLlamada *nd = &p->nodos[camino[i]];
+            fprintf(f, i == prof - 1 ? "entrada_0x%04x" : ";f_0x%04x", nd->funcion);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)p->nodos[k].instrucciones);
+    }
+
+    free(camino);
+    int ok = !ferror(f);
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
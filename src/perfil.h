@@ -0,0 +1,94 @@
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Perfilador del programa invitado.
+ *
+ * Con cpu->perfil != NULL, cpu_ejecutar usa una instancia del núcleo switch
+ * que llama a los ganchos de abajo en cada instrucción, acceso a datos y
+ * salto. Con NULL esa instancia no se usa y los demás núcleos no tienen
+ * ningún gancho: el perfilador apagado no cuesta nada.
+ *
+ * Recoge:
+ *   - ejecuciones por PC (y el último opcode visto en ese PC)
+ *   - saltos tomados / no tomados por PC, con su último destino
+ *   - lecturas y escrituras de datos por dirección (pila incluida)
+ *   - frecuencia de pares de opcodes consecutivos
+ *   - árbol de llamadas construido con CALL/RET, para flamegraph
+ */
+
+#define PERFIL_MAX_NODOS 65536      // nodos del árbol de llamadas
+
+typedef struct {
+    uint32_t funcion;           // dirección de entrada (la raíz: PC inicial)
+    int padre;
+    int hijo, hermano;          // primer hijo y siguiente hermano
+    uint64_t instrucciones;     // ejecutadas con este nodo en la cima
+} NodoLlamada;
+
+typedef struct Perfil {
+    uint32_t tam;               // direcciones cubiertas
+    uint64_t *ejecuciones;      // por PC
+    uint8_t *opcodes;
+    uint64_t *tomados;          // por PC del salto
+    uint64_t *no_tomados;
+    uint32_t *destinos;
+    uint64_t *lecturas;         // por dirección de datos
+    uint64_t *escrituras;
+    uint64_t pares[256][256];   // [anterior][actual]; fila 0 = primera instrucción
+
+    uint32_t pc_actual;         // instrucción en curso (para los saltos)
+    uint8_t op_anterior;
+
+    NodoLlamada *nodos;
+    int n_nodos;
+    int nodo_actual;
+    unsigned long sin_nodo;     // llamadas anidadas sin nodo propio (árbol lleno)
+} Perfil;
+
+/* Reserva un perfil para 'tam' direcciones con raíz en 'entrada'; NULL si no hay memoria */
+Perfil *perfil_crear(uint32_t tam, uint32_t entrada);
+void perfil_destruir(Perfil *p);
+
+/* Informe de puntos calientes (instrucciones, bucles, saltos, memoria, pares) */
+void perfil_informe(const Perfil *p, FILE *f, int top);
+
+/*
+ * Pilas plegadas ("raiz;f_0x0014;f_0x0030 1234" por línea), el formato de
+ * entrada de flamegraph.pl / speedscope. 0 si todo bien.
+ */
+int perfil_escribir_plegado(const Perfil *p, const char *path);
+
+/* --- Ganchos del núcleo (en línea: se llaman en cada instrucción) --- */
+void perfil_llamada(Perfil *p, uint32_t destino);
+void perfil_retorno(Perfil *p);
+
+static inline void perfil_instruccion(Perfil *p, uint32_t pc, uint8_t op) {
+    p->pc_actual = pc;
+    p->ejecuciones[pc]++;
+    p->opcodes[pc] = op;
+    p->pares[p->op_anterior][op]++;
+    p->op_anterior = op;
+    p->nodos[p->nodo_actual].instrucciones++;
+}
+
+static inline void perfil_salto(Perfil *p, int tomado, uint32_t destino) {
+    if (tomado)
+        p->tomados[p->pc_actual]++;
+    else
+        p->no_tomados[p->pc_actual]++;
+    p->destinos[p->pc_actual] = destino;
+}
+
+static inline void perfil_lectura(Perfil *p, uint32_t dir) {
+    p->lecturas[dir]++;
+}
+
+static inline void perfil_escritura(Perfil *p, uint32_t dir) {
+    p->escrituras[dir]++;
+}
+
+#endif
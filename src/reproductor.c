@@ -0,0 +1,95 @@
+/*
+ * reproductor.c - reconstruye el estado de un invitado a partir de una
+ * traza grabada con cpu_simulator --traza (ver traza.h)
+ *
+ * Uso: reproductor [--en=N] [--listar=D[:H]] [--instantanea=F] traza.trz
+ *
+ *   --en=N            estado tras N instrucciones (por defecto, el final)
+ *   --listar=D[:H]    registros de las instrucciones D..H (100 si no hay H)
+ *   --instantanea=F   guarda el estado reconstruido como instantánea, para
+ *                     seguir desde ahí con cpu_simulator --reanudar=F
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cpu.h"
+#include "memoria.h"
+#include "instantanea.h"
+#include "traza.h"
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    const char *snap = NULL;
+    unsigned long en = ~0UL;
+    unsigned long desde = 0, hasta = 0;
+    int listar = 0;
+
+    for (int k = 1; k < argc; ++k) {
+        if (strncmp(argv[k], "--en=", 5) == 0) {
+            char *fin;
+            en = strtoul(argv[k] + 5, &fin, 0);
+            if (*fin) {
+                fprintf(stderr, "Número de instrucciones inválido: %s\n", argv[k] + 5);
+                return 1;
+            }
+        } else if (strncmp(argv[k], "--listar=", 9) == 0) {
+            char *fin;
+            desde = strtoul(argv[k] + 9, &fin, 0);
+            hasta = desde + 99;
+            if (*fin == ':')
+                hasta = strtoul(fin + 1, &fin, 0);
+            if (*fin || hasta < desde) {
+                fprintf(stderr, "Rango inválido: %s\n", argv[k] + 9);
+                return 1;
+            }
+            listar = 1;
+        } else if (strncmp(argv[k], "--instantanea=", 14) == 0) {
+            snap = argv[k] + 14;
+        } else if (argv[k][0] == '-' && argv[k][1] == '-') {
+            fprintf(stderr, "Opción desconocida: %s\n", argv[k]);
+            fprintf(stderr, "Uso: %s [--en=N] [--listar=D[:H]] [--instantanea=F] traza.trz\n", argv[0]);
+            return 1;
+        } else {
+            path = argv[k];
+        }
+    }
+
+    if (!path) {
+        fprintf(stderr, "Uso: %s [--en=N] [--listar=D[:H]] [--instantanea=F] traza.trz\n", argv[0]);
+        return 1;
+    }
+
+    if (listar)
+        return traza_listar(path, desde, hasta, stdout) == 0 ? 0 : 1;
+
+    CPU cpu;
+    Memoria mem;
+    clock_t t0 = clock();
+    if (traza_reconstruir(path, en, &cpu, &mem) < 0)
+        return 1;
+    clock_t t1 = clock();
+
+    printf("[INFO] Estado tras %lu instrucciones reconstruido en %.6f s\n",
+           cpu.met.instrucciones, (double)(t1 - t0) / CLOCKS_PER_SEC);
+    printf("A = %d, PC = %d, SP = %d, Z = %d%s\n", cpu.A, cpu.PC, cpu.SP, cpu.Z,
+           cpu.halted ? " (detenida)" : "");
+
+    if (snap) {
+        if (instantanea_guardar(&cpu, snap) < 0) {
+            fprintf(stderr, "[ERROR] No se pudo escribir la instantánea %s\n", snap);
+            memoria_liberar(&mem);
+            return 1;
+        }
+        printf("[INFO] Instantánea guardada en %s\n", snap);
+    }
+
+    printf("\n--- Variables principales en memoria ---\n");
+    printf("N (MEM[100]) = %d\n", mem.data[100]);
+    printf("contador (MEM[101]) = %d\n", mem.data[101]);
+    printf("resultado (MEM[102]) = %d\n", mem.data[102]);
+
+    memoria_liberar(&mem);
+    return 0;
+}
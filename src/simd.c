@@ -0,0 +1,466 @@
+/*
+ * Archivo: simd.c
+ * Motor vectorial: ejecuta hasta SIMD_CARRILES instancias en lockstep.
+ *
+ * Se usan vectores de GCC/Clang (vector_size); el compilador los baja a
+ * SSE2 o AVX2. En x86-64 Linux se generan dos versiones del núcleo y se
+ * elige la AVX2 en tiempo de ejecución si la CPU la soporta. Las
+ * operaciones de 8 bits del vector (+, -, *) envuelven módulo 256 igual
+ * que alu_add/alu_sub/alu_mul.
+ *
+ * Mientras todos los carriles activos tienen el mismo PC ("convergidos") se
+ * usa un único PC escalar. Un JMPZ con resultados distintos por carril, o
+ * un RET a direcciones distintas, separa los carriles; entonces cada paso
+ * ejecuta el grupo con el menor PC (los demás quedan enmascarados) hasta
+ * que todos vuelven a coincidir.
+ *
+ * Lo que el motor no resuelve en vector (errores de pila, opcodes
+ * desconocidos, operando fuera de memoria) se entrega al intérprete escalar
+ * para ese carril, que termina la ejecución con la semántica de referencia.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "simd.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if SIMD_CARRILES != 16 && SIMD_CARRILES != 32
+#error "SIMD_CARRILES debe ser 16 o 32"
+#endif
+
+typedef uint8_t VecU8 __attribute__((vector_size(SIMD_CARRILES)));
+
+#define TODOS_BITS ((uint32_t)(((uint64_t)1 << SIMD_CARRILES) - 1))
+
+/* Versión AVX2 + genérica elegida al cargar el programa (ifunc) */
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+/*
+ * Todo lo que se llama desde el núcleo se inserta en él: así se compila con
+ * el mismo conjunto de instrucciones que el clon y se evita mezclar código
+ * SSE heredado con AVX (cada transición cuesta decenas de ciclos).
+ */
+#define SIMD_EN_LINEA static inline __attribute__((always_inline))
+
+typedef struct {
+    VecU8 mem[MEM_SIZE];            // mem[dir][carril]
+    VecU8 a;                        // acumulador por carril
+    VecU8 z;                        // bandera Z (0/1) por carril
+    uint16_t pc[SIMD_CARRILES];     // PC de los carriles fuera del grupo actual
+    uint16_t sp[SIMD_CARRILES];
+    int sp_min[SIMD_CARRILES];
+
+    /*
+     * Métricas: los pasos se acumulan en 'pendiente' mientras se repite la
+     * misma máscara de carriles y se reparten a 'propio' cuando cambia (o
+     * cuando sale un carril). Convergidos, la máscara casi nunca cambia y
+     * contar un paso cuesta lo mismo que en el intérprete escalar.
+     */
+    uint32_t m_pendiente;
+    CPUMetricas pendiente;
+    CPUMetricas propio[SIMD_CARRILES];
+} Grupo;
+
+// ==================== MÁSCARAS ====================
+
+/* Bit i = 1 si el carril i de v es distinto de cero */
+SIMD_EN_LINEA uint32_t bits_de(const VecU8 *v) {
+    VecU8 nz = (VecU8)(*v != 0);
+#if defined(__SSE2__)
+    uint32_t r = 0;
+    for (int k = 0; k < SIMD_CARRILES / 16; ++k) {
+        __m128i x;
+        memcpy(&x, (uint8_t *)&nz + 16 * k, 16);
+        r |= (uint32_t)_mm_movemask_epi8(x) << (16 * k);
+    }
+    return r;
+#else
+    uint32_t r = 0;
+    for (int i = 0; i < SIMD_CARRILES; ++i)
+        if (nz[i]) r |= 1u << i;
+    return r;
+#endif
+}
+
+/* expandir[b]: 8 bytes con 0xFF donde el bit de b está activo */
+static uint64_t expandir[256];
+static pthread_once_t expandir_listo = PTHREAD_ONCE_INIT;
+
+static void iniciar_expandir(void) {
+    for (int b = 0; b < 256; ++b) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i)
+            if ((b >> i) & 1) v |= (uint64_t)0xFF << (8 * i);
+        expandir[b] = v;
+    }
+}
+
+/* Vector con 0xFF en los carriles cuyo bit está activo */
+SIMD_EN_LINEA void vec_de_bits(uint32_t bits, VecU8 *v) {
+    uint64_t partes[SIMD_CARRILES / 8];
+    for (int k = 0; k < SIMD_CARRILES / 8; ++k)
+        partes[k] = expandir[(bits >> (8 * k)) & 0xFF];
+    memcpy(v, partes, sizeof(partes));
+}
+
+#define MEZCLAR(m, si, no) (((m) & (si)) | (~(m) & (no)))
+
+SIMD_EN_LINEA int primer_bit(uint32_t b) { return __builtin_ctz(b); }
+
+// ==================== MÉTRICAS ====================
+
+static void repartir(Grupo *g) {
+    for (uint32_t b = g->m_pendiente; b; b &= b - 1) {
+        CPUMetricas *p = &g->propio[primer_bit(b)];
+        p->instrucciones += g->pendiente.instrucciones;
+        p->accesos_memoria += g->pendiente.accesos_memoria;
+        p->saltos_tomados += g->pendiente.saltos_tomados;
+        p->saltos_no_tomados += g->pendiente.saltos_no_tomados;
+    }
+    memset(&g->pendiente, 0, sizeof(g->pendiente));
+}
+
+SIMD_EN_LINEA void contar(Grupo *g, uint32_t m,
+                          int instr, int mem, int tomados, int no_tomados) {
+    if (m != g->m_pendiente) {
+        repartir(g);
+        g->m_pendiente = m;
+    }
+    g->pendiente.instrucciones += instr;
+    g->pendiente.accesos_memoria += mem;
+    g->pendiente.saltos_tomados += tomados;
+    g->pendiente.saltos_no_tomados += no_tomados;
+}
+
+/* Cierra el carril i: estado final, métricas y memoria */
+static void salir(Grupo *g, int i, uint16_t pc, int halted,
+                  Memoria *mem, CPU *cpu, CPUMetricas *met) {
+    cpu->A = g->a[i];
+    cpu->Z = g->z[i];
+    cpu->PC = pc;
+    cpu->SP = g->sp[i];
+    cpu->halted = halted;
+
+    if (g->m_pendiente & (1u << i)) {
+        repartir(g);
+        g->m_pendiente = 0;
+    }
+    met->instrucciones = g->propio[i].instrucciones;
+    met->accesos_memoria = g->propio[i].accesos_memoria;
+    met->saltos_tomados = g->propio[i].saltos_tomados;
+    met->saltos_no_tomados = g->propio[i].saltos_no_tomados;
+    met->ciclos = met->instrucciones;
+    met->profundidad_pila = (MEM_SIZE - 1) - g->sp_min[i];
+    met->segundos = 0;          // el tiempo sólo se mide por grupo
+
+    for (int d = 0; d < MEM_SIZE; ++d)
+        mem->data[d] = g->mem[d][i];
+}
+
+/*
+ * Entrega el carril i al intérprete escalar a partir de 'pc' (la
+ * instrucción en pc aún no se ha contado) y combina las métricas.
+ */
+static void entregar_a_escalar(Grupo *g, int i, uint16_t pc,
+                               Memoria *mem, CPU *cpu, CPUMetricas *met) {
+    salir(g, i, pc, 0, mem, cpu, met);
+
+    CPUMetricas previas = *met;
+    CPU escalar;
+    cpu_init(&escalar, mem);
+    escalar.motor = MOTOR_SWITCH;
+    escalar.silencioso = 1;
+    escalar.A = cpu->A;
+    escalar.Z = cpu->Z;
+    escalar.PC = cpu->PC;
+    escalar.SP = cpu->SP;
+    escalar.irq = cpu->irq;
+    cpu_ejecutar(&escalar);
+
+    CPUMetricas extra;
+    cpu_leer_metricas(&escalar, &extra);
+    *cpu = escalar;
+    met->instrucciones = previas.instrucciones + extra.instrucciones;
+    met->ciclos = met->instrucciones;
+    met->accesos_memoria = previas.accesos_memoria + extra.accesos_memoria;
+    met->saltos_tomados = previas.saltos_tomados + extra.saltos_tomados;
+    met->saltos_no_tomados = previas.saltos_no_tomados + extra.saltos_no_tomados;
+    if (extra.profundidad_pila > met->profundidad_pila)
+        met->profundidad_pila = extra.profundidad_pila;
+    met->segundos = extra.segundos;
+}
+
+SIMD_EN_LINEA int tiene_operando(uint8_t op) {
+    return !(op == 1 || op == 8 || op == 9 || op == 10 || op == 12);
+}
+
+// ==================== NÚCLEO ====================
+
+static SIMD_CLONES void nucleo(Grupo *g, uint32_t activos, uint16_t entrada,
+                               Memoria *mems[], CPU cpus[], CPUMetricas met[]) {
+    /*
+     * 'grupo' son los carriles que ejecutan juntos desde 'pc_grupo'; su
+     * g->pc no se actualiza mientras el grupo siga siendo el de menor PC
+     * (destino < min_otros). grupo == 0 obliga a volver a elegir a partir
+     * de g->pc. Convergidos, grupo == activos y min_otros == 0xFFFF.
+     */
+    uint32_t grupo = activos;
+    uint16_t pc_grupo = entrada;
+    uint16_t min_otros = 0xFFFF;
+    VecU8 vm = {0};                 /* máscara vectorial de 'm_vm' */
+    uint32_t m_vm = 0;
+
+    while (activos) {
+        /* 1. Elegir carriles: los de menor PC */
+        if (!grupo) {
+            pc_grupo = 0xFFFF;
+            for (uint32_t b = activos; b; b &= b - 1) {
+                int i = primer_bit(b);
+                if (g->pc[i] < pc_grupo) pc_grupo = g->pc[i];
+            }
+            min_otros = 0xFFFF;
+            for (uint32_t b = activos; b; b &= b - 1) {
+                int i = primer_bit(b);
+                if (g->pc[i] == pc_grupo) grupo |= 1u << i;
+                else if (g->pc[i] < min_otros) min_otros = g->pc[i];
+            }
+        }
+        uint16_t pc = pc_grupo;
+        uint32_t m = grupo;
+
+        if (pc >= MEM_SIZE) {
+            /* Fin de memoria: el bucle escalar termina sin error */
+            for (uint32_t b = m; b; b &= b - 1) {
+                int i = primer_bit(b);
+                salir(g, i, pc, 0, mems[i], &cpus[i], &met[i]);
+            }
+            activos &= ~m;
+            grupo = 0;
+            continue;
+        }
+
+        /* 2. Decodificar; si el código difiere entre carriles, sólo avanza
+         *    el subgrupo que coincide con el primer carril */
+        int primero = primer_bit(m);
+        VecU8 vop = g->mem[pc];
+        uint8_t op = vop[primero];
+        VecU8 dif = vop ^ op;
+        int con_operando = tiene_operando(op);
+        uint8_t arg = 0;
+        if (con_operando && pc < MEM_SIZE - 1) {
+            VecU8 varg = g->mem[pc + 1];
+            arg = varg[primero];
+            dif |= varg ^ arg;
+        }
+        m &= ~bits_de(&dif);
+
+        if (m != grupo) {
+            for (uint32_t b = grupo; b; b &= b - 1)
+                g->pc[primer_bit(b)] = pc;
+            grupo = 0;
+        }
+
+        if (op < 1 || op > 14 || (con_operando && pc >= MEM_SIZE - 1)) {
+            for (uint32_t b = m; b; b &= b - 1) {
+                int i = primer_bit(b);
+                entregar_a_escalar(g, i, pc, mems[i], &cpus[i], &met[i]);
+            }
+            activos &= ~m;
+            grupo = 0;
+            continue;
+        }
+
+        if (m != m_vm) {
+            vec_de_bits(m, &vm);
+            m_vm = m;
+        }
+        uint16_t sig = pc + (con_operando ? 2 : 1);
+        uint16_t destino = sig;       /* PC siguiente si es uniforme */
+        uint32_t tomados = 0;         /* carriles que saltan a 'arg' (JMPZ) */
+        int por_carril = 0;           /* PC ya asignado carril a carril */
+
+        /* 3. Ejecutar */
+        switch (op) {
+            case 1: // NOP
+                contar(g, m, 1, 0, 0, 0);
+                break;
+
+            case 2: // STORE dir
+                g->mem[arg] = MEZCLAR(vm, g->a, g->mem[arg]);
+                contar(g, m, 1, 1, 0, 0);
+                break;
+
+            case 3: // ADD dir
+                g->a = MEZCLAR(vm, g->a + g->mem[arg], g->a);
+                g->z = MEZCLAR(vm, (VecU8)(g->a == 0) & 1, g->z);
+                contar(g, m, 1, 1, 0, 0);
+                break;
+
+            case 4: // SUB dir
+                g->a = MEZCLAR(vm, g->a - g->mem[arg], g->a);
+                g->z = MEZCLAR(vm, (VecU8)(g->a == 0) & 1, g->z);
+                contar(g, m, 1, 1, 0, 0);
+                break;
+
+            case 5: // LOADI val
+                g->a = MEZCLAR(vm, (VecU8){0} + arg, g->a);
+                g->z = MEZCLAR(vm, (VecU8){0} + (uint8_t)(arg == 0), g->z);
+                contar(g, m, 1, 0, 0, 0);
+                break;
+
+            case 6: // LOADM dir
+                g->a = MEZCLAR(vm, g->mem[arg], g->a);
+                g->z = MEZCLAR(vm, (VecU8)(g->a == 0) & 1, g->z);
+                contar(g, m, 1, 1, 0, 0);
+                break;
+
+            case 7: // JMP dir
+                destino = arg;
+                contar(g, m, 1, 0, 1, 0);
+                break;
+
+            case 8: // HALT
+                contar(g, m, 1, 0, 0, 0);
+                for (uint32_t b = m; b; b &= b - 1) {
+                    int i = primer_bit(b);
+                    salir(g, i, sig, 1, mems[i], &cpus[i], &met[i]);
+                }
+                activos &= ~m;
+                grupo = 0;
+                continue;
+
+            case 13: { // JMPZ dir
+                tomados = m & bits_de(&g->z);
+                if (tomados == m) {
+                    destino = arg;
+                    contar(g, m, 1, 0, 1, 0);
+                } else if (tomados == 0) {
+                    contar(g, m, 1, 0, 0, 1);
+                } else {
+                    contar(g, tomados, 1, 0, 1, 0);
+                    contar(g, m & ~tomados, 1, 0, 0, 1);
+                    for (uint32_t b = m; b; b &= b - 1) {
+                        int i = primer_bit(b);
+                        g->pc[i] = (tomados >> i) & 1 ? arg : sig;
+                    }
+                    por_carril = 1;
+                }
+                break;
+            }
+
+            case 14: // MUL dir
+                g->a = MEZCLAR(vm, g->a * g->mem[arg], g->a);
+                g->z = MEZCLAR(vm, (VecU8)(g->a == 0) & 1, g->z);
+                contar(g, m, 1, 1, 0, 0);
+                break;
+
+            default: { // PUSH, POP, CALL, RET: pila propia de cada carril
+                uint32_t errores = 0;
+                for (uint32_t b = m; b; b &= b - 1) {
+                    int i = primer_bit(b);
+                    uint16_t sp = g->sp[i];
+                    CPUMetricas *p = &g->propio[i];
+
+                    if ((op == 9 || op == 11) && sp == 0) { errores |= 1u << i; continue; }
+                    if ((op == 10 || op == 12) && sp >= MEM_SIZE - 1) { errores |= 1u << i; continue; }
+
+                    if (op == 9) {              // PUSH
+                        g->mem[sp][i] = g->a[i];
+                        sp--;
+                        g->pc[i] = sig;
+                    } else if (op == 11) {      // CALL dir
+                        g->mem[sp][i] = (uint8_t)sig;
+                        sp--;
+                        g->pc[i] = arg;
+                        p->saltos_tomados++;
+                    } else if (op == 10) {      // POP
+                        g->a[i] = g->mem[++sp][i];
+                        g->z[i] = g->a[i] == 0;
+                        g->pc[i] = sig;
+                    } else {                    // RET
+                        g->pc[i] = g->mem[++sp][i];
+                        p->saltos_tomados++;
+                    }
+                    if (sp < g->sp_min[i]) g->sp_min[i] = sp;
+                    g->sp[i] = sp;
+                    p->instrucciones++;
+                    p->accesos_memoria++;
+                }
+                for (uint32_t b = errores; b; b &= b - 1) {
+                    int i = primer_bit(b);
+                    entregar_a_escalar(g, i, pc, mems[i], &cpus[i], &met[i]);
+                }
+                activos &= ~errores;
+                m &= ~errores;
+                por_carril = 1;
+                break;
+            }
+        }
+
+        /* 4. Actualizar PCs; al alcanzar a otro grupo se vuelve a elegir
+         *    (y si todos coinciden, el grupo vuelve a ser 'activos') */
+        if (!por_carril && grupo && destino < min_otros) {
+            pc_grupo = destino;
+            continue;
+        }
+        if (!por_carril)
+            for (uint32_t b = m; b; b &= b - 1)
+                g->pc[primer_bit(b)] = destino;
+        grupo = 0;
+    }
+}
+
+// ==================== API ====================
+
+void simd_ejecutar(Memoria *mems[], int n, const CPU *inicio, CPU cpus[], CPUMetricas met[]) {
+    static _Thread_local Grupo g __attribute__((aligned(64)));
+
+    for (int i = 0; i < n; ++i) {
+        cpus[i] = *inicio;
+        cpus[i].mem = mems[i];
+    }
+    if (inicio->halted) {
+        /* Instantánea de un programa ya terminado: nada que ejecutar */
+        for (int i = 0; i < n; ++i)
+            cpu_leer_metricas(&cpus[i], &met[i]);
+        return;
+    }
+    if (interrupciones_activas(&inicio->irq)) {
+        /* Los carriles no atienden eventos: cada corrida, por su cuenta */
+        for (int i = 0; i < n; ++i) {
+            cpus[i].motor = MOTOR_SWITCH;
+            cpus[i].silencioso = 1;
+            cpu_ejecutar(&cpus[i]);
+            cpu_leer_metricas(&cpus[i], &met[i]);
+        }
+        return;
+    }
+
+    pthread_once(&expandir_listo, iniciar_expandir);
+    memset(&g, 0, sizeof(g));
+    for (int d = 0; d < MEM_SIZE; ++d)
+        for (int i = 0; i < n; ++i)
+            g.mem[d][i] = mems[i]->data[d];
+    for (int i = 0; i < SIMD_CARRILES; ++i) {
+        g.a[i] = inicio->A;
+        g.z[i] = inicio->Z;
+        g.sp[i] = inicio->SP;
+        g.sp_min[i] = inicio->sp_min;
+        g.pc[i] = (uint16_t)inicio->PC;
+        g.propio[i].instrucciones = inicio->met.instrucciones;
+        g.propio[i].accesos_memoria = inicio->met.accesos_memoria;
+        g.propio[i].saltos_tomados = inicio->met.saltos_tomados;
+        g.propio[i].saltos_no_tomados = inicio->met.saltos_no_tomados;
+    }
+
+    uint32_t activos = n >= SIMD_CARRILES ? TODOS_BITS : ((1u << n) - 1);
+    nucleo(&g, activos, (uint16_t)inicio->PC, mems, cpus, met);
+}
@@ -0,0 +1,31 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+#include "memoria.h"
+#include "cpu.h"
+
+/*
+ * Ejecución en lockstep de varias instancias del mismo programa.
+ *
+ * Los registros se guardan como estructura de arrays (un carril por
+ * instancia) y las memorias entrelazadas: el byte 'dir' de todas las
+ * instancias ocupa un vector contiguo. Cada paso ejecuta una instrucción
+ * para todos los carriles que comparten PC.
+ */
+
+#ifndef SIMD_CARRILES
+#define SIMD_CARRILES 32   // 16 o 32 (un vector AVX2 de bytes)
+#endif
+
+/*
+ * Ejecuta n (<= SIMD_CARRILES) instancias que arrancan todas con los
+ * registros y métricas de 'inicio' (recién creada con cpu_init, o una
+ * instantánea). mems[i] es la memoria inicial del carril i y al terminar
+ * contiene la final; cpus[i] recibe A, Z, PC, SP y halted, y met[i] sus
+ * métricas. Si 'inicio' tiene eventos programados (interrupciones.h), cada
+ * instancia corre por separado en el núcleo switch.
+ */
+void simd_ejecutar(Memoria *mems[], int n, const CPU *inicio, CPU cpus[], CPUMetricas met[]);
+
+#endif
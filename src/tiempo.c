@@ -0,0 +1,216 @@
+/*
+ * Archivo: tiempo.c
+ * Modelo de tiempo: configuración, cachés LRU asociativas e informe.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "tiempo.h"
+#include "cpu.h"
+
+#define LINEA_VACIA 0xFFFFFFFFu
+
+void tiempo_config_defecto(ConfigTiempo *c) {
+    memset(c, 0, sizeof(*c));
+    for (int op = 0; op < 256; ++op)
+        c->latencias[op] = 1;
+}
+
+static int potencia_de_dos(uint32_t x) {
+    return x && (x & (x - 1)) == 0;
+}
+
+static int validar_cache(const ConfigCache *c) {
+    if (c->tam == 0)
+        return 1;
+    if (c->vias == 0 || c->vias > TIEMPO_MAX_VIAS || !potencia_de_dos(c->linea))
+        return 0;
+    uint32_t conjuntos = c->tam / (c->vias * c->linea);
+    return conjuntos * c->vias * c->linea == c->tam && potencia_de_dos(conjuntos);
+}
+
+/* "X" fija X y X.w; "X.w" sólo la forma ancha. 0 si el nombre no existe */
+static int fijar_latencia(ConfigTiempo *c, const char *nombre, uint16_t lat) {
+    int encontrado = 0;
+    for (int op = 1; op < 256; ++op) {
+        const char *n = cpu_opcode_nombre((uint8_t)op);
+        if (strcmp(n, "?") == 0)
+            continue;
+        if (strcasecmp(n, nombre) == 0 ||
+            ((op & OP_ANCHO) && strcasecmp(cpu_opcode_nombre((uint8_t)(op & ~OP_ANCHO)), nombre) == 0)) {
+            c->latencias[op] = lat;
+            encontrado = 1;
+        }
+    }
+    return encontrado;
+}
+
+int tiempo_config_cargar(ConfigTiempo *c, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+    tiempo_config_defecto(c);
+
+    char line[256];
+    int lineno = 0, ret = 0;
+    while (ret == 0 && fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *com = strchr(line, ';');
+        if (com) *com = '\0';
+
+        char nombre[32];
+        unsigned long v[4];
+        int n = sscanf(line, "%31s %lu %lu %lu %lu", nombre, &v[0], &v[1], &v[2], &v[3]);
+        if (n <= 0)
+            continue;
+
+        ConfigCache *cache = NULL;
+        if (strcmp(nombre, "l1i") == 0) cache = &c->l1i;
+        else if (strcmp(nombre, "l1d") == 0) cache = &c->l1d;
+        else if (strcmp(nombre, "l2") == 0) cache = &c->l2;
+
+        if (cache) {
+            *cache = (ConfigCache){ (uint32_t)v[0], (uint32_t)v[1], (uint32_t)v[2], (uint32_t)v[3] };
+            if (n != 5 || !validar_cache(cache)) {
+                fprintf(stderr, "[ERROR] %s:%d: caché inválida (tamaño vías línea latencia; "
+                                "conjuntos y línea potencias de dos, hasta %d vías)\n",
+                        path, lineno, TIEMPO_MAX_VIAS);
+                ret = -1;
+            }
+        } else if (strcmp(nombre, "memoria") == 0 && n == 2) {
+            c->lat_memoria = (uint32_t)v[0];
+        } else if (n == 2 && v[0] <= 0xFFFF && fijar_latencia(c, nombre, (uint16_t)v[0])) {
+            /* latencia de opcode */
+        } else {
+            fprintf(stderr, "[ERROR] %s:%d: directiva desconocida '%s'\n", path, lineno, nombre);
+            ret = -1;
+        }
+    }
+
+    fclose(f);
+    return ret;
+}
+
+// ==================== CACHÉS ====================
+
+static int nivel_init(NivelCache *c, const ConfigCache *cfg) {
+    memset(c, 0, sizeof(*c));
+    c->cfg = *cfg;
+    if (cfg->tam == 0)
+        return 0;
+    uint32_t conjuntos = cfg->tam / (cfg->vias * cfg->linea);
+    c->bits_linea = (uint32_t)__builtin_ctz(cfg->linea);
+    c->mascara = conjuntos - 1;
+    c->etiquetas = malloc((size_t)conjuntos * cfg->vias * sizeof(uint32_t));
+    if (!c->etiquetas)
+        return -1;
+    memset(c->etiquetas, 0xFF, (size_t)conjuntos * cfg->vias * sizeof(uint32_t));
+    return 0;
+}
+
+/*
+ * Busca la línea en el conjunto (vías en orden MRU). Acierto: la sube al
+ * frente. Fallo: la inserta al frente y la LRU (la última) sale.
+ */
+static int buscar(NivelCache *c, uint32_t dir) {
+    uint32_t linea = dir >> c->bits_linea;
+    uint32_t *v = c->etiquetas + (size_t)(linea & c->mascara) * c->cfg.vias;
+    uint32_t k = 0;
+    while (k < c->cfg.vias && v[k] != linea)
+        k++;
+    int acierto = k < c->cfg.vias;
+    if (!acierto)
+        k = c->cfg.vias - 1;
+    memmove(v + 1, v, k * sizeof(uint32_t));
+    v[0] = linea;
+    if (acierto) c->aciertos++;
+    else         c->fallos++;
+    return acierto;
+}
+
+uint32_t tiempo_acceso(Tiempo *t, NivelCache *l1, uint32_t dir) {
+    uint32_t ciclos = 0;
+    if (l1->etiquetas) {
+        ciclos += l1->cfg.latencia;
+        if (buscar(l1, dir))
+            return ciclos;
+    }
+    if (t->l2.etiquetas) {
+        ciclos += t->l2.cfg.latencia;
+        if (buscar(&t->l2, dir))
+            return ciclos;
+    }
+    return ciclos + t->cfg->lat_memoria;
+}
+
+Tiempo *tiempo_crear(const ConfigTiempo *cfg) {
+    Tiempo *t = calloc(1, sizeof(Tiempo));
+    if (!t) return NULL;
+    t->cfg = cfg;
+    if (nivel_init(&t->l1i, &cfg->l1i) < 0 || nivel_init(&t->l1d, &cfg->l1d) < 0 ||
+        nivel_init(&t->l2, &cfg->l2) < 0) {
+        tiempo_destruir(t);
+        return NULL;
+    }
+
+    /*
+     * Sin L1I cada tramo de código va directo a L2/memoria: se agrupa por
+     * la línea de L2 o, sin cachés, por byte (linea_i no se repite).
+     */
+    t->bits_i = cfg->l1i.tam ? t->l1i.bits_linea : cfg->l2.tam ? t->l2.bits_linea : 0;
+    t->bits_d = t->l1d.bits_linea;
+    t->atajo_d = cfg->l1d.tam != 0;
+    t->linea_i = t->linea_d = LINEA_VACIA;
+    return t;
+}
+
+void tiempo_destruir(Tiempo *t) {
+    if (!t) return;
+    free(t->l1i.etiquetas);
+    free(t->l1d.etiquetas);
+    free(t->l2.etiquetas);
+    free(t);
+}
+
+static void nivel_vaciar(NivelCache *c) {
+    if (c->etiquetas)
+        memset(c->etiquetas, 0xFF, (size_t)(c->mascara + 1) * c->cfg.vias * sizeof(uint32_t));
+}
+
+void tiempo_vaciar(Tiempo *t) {
+    nivel_vaciar(&t->l1i);
+    nivel_vaciar(&t->l1d);
+    nivel_vaciar(&t->l2);
+    t->linea_i = t->linea_d = LINEA_VACIA;
+}
+
+void tiempo_sumar(Tiempo *dst, const Tiempo *src) {
+    dst->l1i.aciertos += src->l1i.aciertos;  dst->l1i.fallos += src->l1i.fallos;
+    dst->l1d.aciertos += src->l1d.aciertos;  dst->l1d.fallos += src->l1d.fallos;
+    dst->l2.aciertos += src->l2.aciertos;    dst->l2.fallos += src->l2.fallos;
+}
+
+// ==================== INFORME ====================
+
+static void informe_nivel(const char *nombre, const NivelCache *c, FILE *f) {
+    if (!c->etiquetas)
+        return;
+    unsigned long total = c->aciertos + c->fallos;
+    fprintf(f, "%s (%u B, %u vías, línea %u B): %lu accesos, %lu aciertos, %lu fallos",
+            nombre, c->cfg.tam, c->cfg.vias, c->cfg.linea, total, c->aciertos, c->fallos);
+    if (total)
+        fprintf(f, " (%.2f%% aciertos)", 100.0 * (double)c->aciertos / (double)total);
+    fputc('\n', f);
+}
+
+void tiempo_informe(const Tiempo *t, unsigned long instrucciones,
+                    unsigned long ciclos, FILE *f) {
+    if (instrucciones)
+        fprintf(f, "CPI: %.3f\n", (double)ciclos / (double)instrucciones);
+    informe_nivel("L1I", &t->l1i, f);
+    informe_nivel("L1D", &t->l1d, f);
+    informe_nivel("L2", &t->l2, f);
+}
@@ -0,0 +1,113 @@
+#ifndef TIEMPO_H
+#define TIEMPO_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Modelo de tiempo aproximado a ciclos.
+ *
+ * Cada instrucción cuesta la latencia base de su opcode más lo que cuesten
+ * sus accesos a memoria en una jerarquía opcional L1I/L1D + L2 unificada
+ * (tamaño, asociatividad y línea configurables, reemplazo LRU) y, si fallan
+ * todos los niveles, la latencia de memoria.
+ *
+ * Para que pueda quedarse encendido en barridos largos:
+ *   - el código se busca en L1I una vez por tramo de bytes consecutivos en
+ *     la misma línea (un bloque básico corto es una sola búsqueda), no por
+ *     byte leído;
+ *   - un acceso a datos en la misma línea que el anterior es un acierto en
+ *     la vía MRU y no recorre el conjunto.
+ * Con L1I y L1D ninguno de los dos atajos cambia el estado LRU respecto a
+ * buscar siempre (sólo se dejan de contar aciertos repetidos en L1I). Sin
+ * L1I el tramo de código se agrupa por línea de L2.
+ *
+ * Archivo de configuración (una directiva por línea, ';' comenta):
+ *   ADD 1          latencia base de un opcode (nombre como en el ensamblador;
+ *   MUL.w 5        "X" fija X y X.w, "X.w" sólo la forma ancha)
+ *   l1i 256 2 16 0 caché: tamaño en bytes, vías, bytes por línea, latencia
+ *   l1d 256 2 16 1
+ *   l2 4096 4 32 8
+ *   memoria 40     latencia de un acceso que falla en todos los niveles
+ * Sin directivas, todo opcode cuesta 1 y la memoria 0: el "modelo simple".
+ */
+
+#define TIEMPO_MAX_VIAS 16
+
+typedef struct {
+    uint32_t tam;               // bytes (0 = nivel ausente)
+    uint32_t vias;
+    uint32_t linea;             // bytes por línea (potencia de dos)
+    uint32_t latencia;          // ciclos que añade cada acceso a este nivel
+} ConfigCache;
+
+typedef struct {
+    uint16_t latencias[256];    // ciclos base por opcode
+    ConfigCache l1i, l1d, l2;
+    uint32_t lat_memoria;
+} ConfigTiempo;
+
+typedef struct {
+    ConfigCache cfg;
+    uint32_t bits_linea;
+    uint32_t mascara;           // conjuntos - 1
+    uint32_t *etiquetas;        // [conjunto][vía], MRU primero
+    unsigned long aciertos, fallos;
+} NivelCache;
+
+typedef struct Tiempo {
+    const ConfigTiempo *cfg;
+    NivelCache l1i, l1d, l2;
+    uint32_t linea_i;           // línea del último byte de código leído
+    uint32_t linea_d;           // línea del último dato (MRU en L1D)
+    uint32_t bits_i, bits_d;
+    int atajo_d;                // hay L1D: se puede usar linea_d
+} Tiempo;
+
+/* Modelo simple: latencia 1 por opcode, sin cachés */
+void tiempo_config_defecto(ConfigTiempo *c);
+
+/* Lee un archivo de configuración sobre los valores por defecto. 0 si todo bien */
+int tiempo_config_cargar(ConfigTiempo *c, const char *path);
+
+/* Estado de cachés para una CPU (vacías). NULL si no hay memoria */
+Tiempo *tiempo_crear(const ConfigTiempo *cfg);
+void tiempo_destruir(Tiempo *t);
+
+/*
+ * Vacía las cachés sin tocar los contadores: un mismo estado sirve para
+ * corridas sucesivas (modo lote) y acumula sus aciertos y fallos.
+ */
+void tiempo_vaciar(Tiempo *t);
+
+/* Suma los aciertos/fallos de 'src' a 'dst' (misma configuración) */
+void tiempo_sumar(Tiempo *dst, const Tiempo *src);
+
+/* Aciertos/fallos por nivel y CPI */
+void tiempo_informe(const Tiempo *t, unsigned long instrucciones,
+                    unsigned long ciclos, FILE *f);
+
+/* --- Ganchos del núcleo (en línea) --- */
+
+/* Recorre la jerarquía desde 'l1' y devuelve los ciclos del acceso */
+uint32_t tiempo_acceso(Tiempo *t, NivelCache *l1, uint32_t dir);
+
+static inline uint32_t tiempo_codigo(Tiempo *t, uint32_t dir) {
+    uint32_t linea = dir >> t->bits_i;
+    if (linea == t->linea_i)
+        return 0;               // mismo tramo: la línea ya se buscó
+    t->linea_i = linea;
+    return tiempo_acceso(t, &t->l1i, dir);
+}
+
+static inline uint32_t tiempo_dato(Tiempo *t, uint32_t dir) {
+    uint32_t linea = dir >> t->bits_d;
+    if (t->atajo_d && linea == t->linea_d) {
+        t->l1d.aciertos++;
+        return t->l1d.cfg.latencia;
+    }
+    t->linea_d = linea;
+    return tiempo_acceso(t, &t->l1d, dir);
+}
+
+#endif
@@ -0,0 +1,798 @@
+/*
+ * Archivo: traza.c
+ * Grabador de trazas (anillo + hilo escritor) y lector para reconstruir el
+ * estado en cualquier instrucción.
+ *
+ * La CPU sólo llena registros en el anillo desde los ganchos de traza.h;
+ * la codificación, las claves y la E/S se hacen aquí, en el hilo escritor.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "traza.h"
+#include "bytes.h"
+
+#define TRAZA_BLOQUE      65536     // bytes de registros por bloque 'R'
+#define TRAZA_MAX_REG     32        // cota de un registro codificado
+#define TRAZA_TAM_CLAVE   (25 + INTERRUPCIONES_TAM_ESTADO) // 'C' + campos fijos de una clave
+#define TRAZA_TAM_FIN     (18 + INTERRUPCIONES_TAM_ESTADO) // 'F' + campos del estado final
+
+/* --- Varint (LEB128, con zigzag para diferencias) --- */
+static uint8_t *poner_varint(uint8_t *q, uint32_t v) {
+    while (v >= 0x80) {
+        *q++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *q++ = (uint8_t)v;
+    return q;
+}
+
+static uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t dezigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/* Bytes de operando que lee el núcleo para cada opcode (ver cpu.c) */
+static const uint8_t bytes_op[256] = {
+    [2] = 1, [3] = 1, [4] = 1, [5] = 1, [6] = 1, [7] = 1, [11] = 1, [13] = 1, [14] = 1,
+    [18] = 1, [19] = 1,
+    [2 | OP_ANCHO] = 2, [3 | OP_ANCHO] = 2, [4 | OP_ANCHO] = 2, [6 | OP_ANCHO] = 2,
+    [7 | OP_ANCHO] = 2, [11 | OP_ANCHO] = 2, [13 | OP_ANCHO] = 2, [14 | OP_ANCHO] = 2,
+    [18 | OP_ANCHO] = 2, [19 | OP_ANCHO] = 2,
+};
+
+static int bytes_operando(uint8_t op) {
+    return bytes_op[op];
+}
+
+// ==================== ESCRITOR ====================
+
+static void escribir(Traza *t, const void *p, size_t n) {
+    if (!t->error && fwrite(p, 1, n, t->f) != n)
+        t->error = 1;
+    t->bytes += n;
+}
+
+static void volcar_bloque(Traza *t) {
+    if (t->bloque_registros == 0)
+        return;
+    uint8_t cab[9] = { 'R' };
+    poner32(cab + 1, t->bloque_registros);
+    poner32(cab + 5, (uint32_t)t->bloque_bytes);
+    escribir(t, cab, sizeof(cab));
+    escribir(t, t->bloque, t->bloque_bytes);
+    t->bloque_bytes = 0;
+    t->bloque_registros = 0;
+}
+
+/* Página 'pag' (> 0) si existe y tiene algo distinto de cero */
+static const uint8_t *pagina_con_datos(Memoria *m, uint32_t pag) {
+    const uint8_t *p = memoria_pagina_lectura(m, pag);
+    if (!p)
+        return NULL;
+    for (int i = 0; i < MEM_PAGINA; ++i)
+        if (p[i])
+            return p;
+    return NULL;
+}
+
+/* Escribe la clave, reinicia el codificador desde ella y la libera */
+static void escribir_clave(Traza *t, ClaveTraza *c) {
+    Memoria *m = &c->mem;
+    uint32_t n_pag = m->tam >> MEM_PAGINA_BITS;
+    uint32_t guardadas = 0;
+    for (uint32_t pag = 1; pag < n_pag; ++pag)
+        guardadas += pagina_con_datos(m, pag) != NULL;
+
+    uint8_t cab[TRAZA_TAM_CLAVE] = { 'C' };
+    poner64(cab + 1, c->instrucciones);
+    poner32(cab + 9, c->PC);
+    poner16(cab + 13, c->SP);
+    cab[15] = c->A;
+    cab[16] = c->Z;
+    poner32(cab + 17, m->tam);
+    poner32(cab + 21, guardadas);
+    interrupciones_guardar(&c->irq, cab + 25);
+    escribir(t, cab, sizeof(cab));
+    escribir(t, m->data, MEM_SIZE);
+    for (uint32_t pag = 1; pag < n_pag; ++pag) {
+        const uint8_t *p = pagina_con_datos(m, pag);
+        if (!p) continue;
+        uint8_t num[4];
+        poner32(num, pag);
+        escribir(t, num, 4);
+        escribir(t, p, MEM_PAGINA);
+    }
+
+    t->pc_predicho = c->PC;
+    t->a_ant = c->A;
+    t->sp_ant = c->SP;
+    t->dir_ant = 0;
+    t->claves++;
+
+    memoria_liberar(m);
+    free(c);
+}
+
+/*
+ * Los campos que casi siempre cambian o casi nunca se escriben sin saltos
+ * (se guarda el byte y se avanza 0 o 1): el patrón de A y de los operandos
+ * es impredecible y un salto mal predicho cuesta más que el registro.
+ */
+static void codificar(Traza *t, const RegistroTraza *r) {
+    uint8_t *q = t->bloque + t->bloque_bytes;
+    uint8_t *banderas = q++;
+    uint8_t b = (uint8_t)(r->n_escr << 3) | (r->z ? TRAZA_F_Z : 0);
+
+    *q++ = r->opcode;
+    int n_op = bytes_operando(r->opcode);
+    q[0] = (uint8_t)r->operando;
+    q[1] = (uint8_t)(r->operando >> 8);
+    q += n_op;
+
+    if (r->pc != t->pc_predicho) {
+        b |= TRAZA_F_PC;
+        q = poner_varint(q, zigzag((int32_t)(r->pc - t->pc_predicho)));
+    }
+    int cambia_a = r->a != t->a_ant;
+    b |= cambia_a ? TRAZA_F_A : 0;
+    *q = r->a;
+    q += cambia_a;
+    if (r->sp != t->sp_ant) {
+        b |= TRAZA_F_SP;
+        q = poner_varint(q, zigzag((int32_t)r->sp - (int32_t)t->sp_ant));
+    }
+    for (int i = 0; i < r->n_escr; ++i) {
+        uint16_t dir = r->dir[i];
+        if (i == 0 && dir == r->operando)
+            b |= TRAZA_F_DIR_OP;
+        else
+            q = poner_varint(q, zigzag((int32_t)dir - (int32_t)t->dir_ant));
+        t->dir_ant = dir;
+        if (i == 0 && r->val[0] == r->a)
+            b |= TRAZA_F_VAL_A;
+        else
+            *q++ = r->val[i];
+    }
+    *banderas = b;
+
+    t->pc_predicho = r->pc + 1 + (uint32_t)n_op;
+    t->a_ant = r->a;
+    t->sp_ant = r->sp;
+    t->bloque_bytes = (size_t)(q - t->bloque);
+    t->bloque_registros++;
+    t->registros++;
+    if (t->bloque_bytes > TRAZA_BLOQUE - TRAZA_MAX_REG)
+        volcar_bloque(t);
+}
+
+/* Espera con tope: un aviso perdido sólo retrasa al escritor, no lo bloquea */
+static void dormir_escritor(Traza *t, uint64_t cola) {
+    struct timespec hasta;
+    clock_gettime(CLOCK_REALTIME, &hasta);
+    hasta.tv_nsec += 10000000;
+    if (hasta.tv_nsec >= 1000000000) {
+        hasta.tv_sec++;
+        hasta.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&t->lock);
+    __atomic_store_n(&t->escritor_dormido, 1, __ATOMIC_RELAXED);
+    if (cola == __atomic_load_n(&t->publicada, __ATOMIC_ACQUIRE) && !t->cerrando)
+        pthread_cond_timedwait(&t->hay_datos, &t->lock, &hasta);
+    __atomic_store_n(&t->escritor_dormido, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/*
+ * Hilo escritor: consume lo publicado por la CPU. Devuelve la cola cada
+ * TRAZA_PUBLICAR registros para que la CPU pueda reutilizar el anillo, y
+ * duerme cuando no hay nada hasta que la CPU publica medio anillo.
+ */
+static void *escritor(void *arg) {
+    Traza *t = arg;
+    uint64_t cola = 0;
+
+    for (;;) {
+        uint64_t listos = __atomic_load_n(&t->publicada, __ATOMIC_ACQUIRE);
+        if (cola == listos) {
+            if (!__atomic_load_n(&t->cerrando, __ATOMIC_ACQUIRE)) {
+                dormir_escritor(t, cola);
+                continue;
+            }
+            /* Lo publicado antes de cerrar ya es visible: ¿queda algo? */
+            if (cola == __atomic_load_n(&t->publicada, __ATOMIC_ACQUIRE))
+                break;
+            continue;
+        }
+
+        while (cola < listos) {
+            RegistroTraza *r = &t->anillo[cola & (TRAZA_ANILLO - 1)];
+            if (r->n_escr == TRAZA_ES_CLAVE) {
+                volcar_bloque(t);
+                escribir_clave(t, r->clave);
+            } else {
+                codificar(t, r);
+            }
+            if ((++cola & (TRAZA_PUBLICAR - 1)) == 0)
+                __atomic_store_n(&t->cola, cola, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&t->cola, cola, __ATOMIC_RELEASE);
+
+        pthread_mutex_lock(&t->lock);
+        if (t->cpu_esperando)
+            pthread_cond_signal(&t->hay_sitio);
+        pthread_mutex_unlock(&t->lock);
+    }
+
+    volcar_bloque(t);
+    return NULL;
+}
+
+static void liberar(Traza *t) {
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->hay_datos);
+    pthread_cond_destroy(&t->hay_sitio);
+    free(t->anillo);
+    free(t->bloque);
+    free(t);
+}
+
+Traza *traza_abrir(const char *path, unsigned long intervalo) {
+    Traza *t = calloc(1, sizeof(Traza));
+    if (!t) return NULL;
+    t->intervalo = intervalo ? intervalo : TRAZA_INTERVALO;
+    t->anillo = malloc(TRAZA_ANILLO * sizeof(RegistroTraza));
+    t->bloque = malloc(TRAZA_BLOQUE);
+    t->f = fopen(path, "wb");
+    if (!t->anillo || !t->bloque || !t->f)
+        goto error;
+
+    uint8_t cab[12];
+    memcpy(cab, TRAZA_MAGIA, 4);
+    poner16(cab + 4, TRAZA_VERSION);
+    poner16(cab + 6, 0);
+    poner32(cab + 8, (uint32_t)t->intervalo);
+    escribir(t, cab, sizeof(cab));
+
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->hay_datos, NULL);
+    pthread_cond_init(&t->hay_sitio, NULL);
+    if (pthread_create(&t->hilo, NULL, escritor, t) != 0) {
+        fclose(t->f);
+        liberar(t);
+        return NULL;
+    }
+    return t;
+
+error:
+    if (t->f) fclose(t->f);
+    free(t->anillo);
+    free(t->bloque);
+    free(t);
+    return NULL;
+}
+
+void traza_despertar(Traza *t) {
+    pthread_mutex_lock(&t->lock);
+    pthread_cond_signal(&t->hay_datos);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* Anillo lleno: la CPU duerme hasta que el escritor libere sitio */
+void traza_esperar(Traza *t) {
+    __atomic_store_n(&t->publicada, t->cabeza, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&t->lock);
+    pthread_cond_signal(&t->hay_datos);
+    while ((t->cola_vista = __atomic_load_n(&t->cola, __ATOMIC_ACQUIRE)) + TRAZA_ANILLO <= t->cabeza) {
+        t->cpu_esperando = 1;
+        pthread_cond_wait(&t->hay_sitio, &t->lock);
+    }
+    t->cpu_esperando = 0;
+    pthread_mutex_unlock(&t->lock);
+}
+
+void traza_clave(Traza *t, CPU *cpu) {
+    t->proxima_clave = cpu->met.instrucciones + t->intervalo;
+
+    /* Sin memoria se pierde esta clave; la reconstrucción usa la anterior */
+    ClaveTraza *c = malloc(sizeof(ClaveTraza));
+    if (!c) return;
+    if (memoria_clonar(&c->mem, cpu->mem) < 0) {
+        free(c);
+        return;
+    }
+    c->instrucciones = cpu->met.instrucciones;
+    c->PC = cpu->PC;
+    c->SP = cpu->SP;
+    c->A = cpu->A;
+    c->Z = cpu->Z;
+    c->irq = cpu->irq;
+
+    if (t->cabeza - t->cola_vista >= TRAZA_ANILLO)
+        traza_esperar(t);
+    RegistroTraza *r = &t->anillo[t->cabeza & (TRAZA_ANILLO - 1)];
+    r->n_escr = TRAZA_ES_CLAVE;
+    r->clave = c;
+    t->cabeza++;
+    traza_publicar(t);
+}
+
+int traza_cerrar(Traza *t, const CPU *cpu, uint64_t *bytes, uint64_t *registros) {
+    __atomic_store_n(&t->publicada, t->cabeza, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&t->lock);
+    __atomic_store_n(&t->cerrando, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&t->hay_datos);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->hilo, NULL);
+
+    uint8_t fin[TRAZA_TAM_FIN] = { 'F' };
+    poner64(fin + 1, cpu->met.instrucciones);
+    poner32(fin + 9, cpu->PC);
+    poner16(fin + 13, cpu->SP);
+    fin[15] = cpu->A;
+    fin[16] = cpu->Z;
+    fin[17] = (uint8_t)(cpu->halted != 0);
+    interrupciones_guardar(&cpu->irq, fin + 18);
+    escribir(t, fin, sizeof(fin));
+
+    if (fclose(t->f) != 0)
+        t->error = 1;
+    int ret = t->error ? -1 : 0;
+    if (bytes) *bytes = t->bytes;
+    if (registros) *registros = t->registros;
+    liberar(t);
+    return ret;
+}
+
+// ==================== LECTOR ====================
+
+typedef struct {
+    FILE *f;
+    const char *path;
+    uint8_t *bloque;            // registros del bloque 'R' en curso
+    size_t n, pos;
+    uint32_t quedan;
+    uint32_t pc_predicho;       // estado del decodificador
+    uint8_t a, z;
+    uint16_t sp;
+    uint16_t dir_ant;
+} Lector;
+
+/* Lo que puede venir a continuación en la traza */
+enum { LEIDO_REGISTRO, LEIDO_CLAVE, LEIDO_FIN, LEIDO_EOF, LEIDO_ERROR };
+
+/* Estado completo de una clave o del bloque final */
+typedef struct {
+    uint64_t instrucciones;
+    uint32_t PC, tam, paginas;
+    uint16_t SP;
+    uint8_t A, Z, halted;
+    uint8_t irq[INTERRUPCIONES_TAM_ESTADO];     // como lo deja interrupciones_guardar
+} EstadoTraza;
+
+static int lector_error(Lector *l, const char *msg) {
+    fprintf(stderr, "[ERROR] %s: %s\n", l->path, msg);
+    return LEIDO_ERROR;
+}
+
+static int lector_abrir(Lector *l, const char *path) {
+    memset(l, 0, sizeof(*l));
+    l->path = path;
+    l->f = fopen(path, "rb");
+    if (!l->f) {
+        fprintf(stderr, "No se pudo abrir %s\n", path);
+        return -1;
+    }
+    uint8_t cab[12];
+    if (fread(cab, 1, sizeof(cab), l->f) != sizeof(cab) ||
+        memcmp(cab, TRAZA_MAGIA, 4) != 0 || leer16(cab + 4) != TRAZA_VERSION) {
+        lector_error(l, "no es una traza de esta versión");
+        fclose(l->f);
+        return -1;
+    }
+    l->bloque = malloc(TRAZA_BLOQUE);
+    if (!l->bloque) {
+        fclose(l->f);
+        return -1;
+    }
+    return 0;
+}
+
+static void lector_cerrar(Lector *l) {
+    fclose(l->f);
+    free(l->bloque);
+}
+
+/*
+ * Lee la cabecera del siguiente bloque que no sea de registros. La memoria
+ * de una clave queda por leer: la carga cargar_memoria() o se salta con
+ * saltar_memoria().
+ */
+static int leer_bloque(Lector *l, EstadoTraza *e) {
+    for (;;) {
+        int tipo = fgetc(l->f);
+        if (tipo == EOF)
+            return LEIDO_EOF;
+
+        if (tipo == 'R') {
+            uint8_t cab[8];
+            if (fread(cab, 1, 8, l->f) != 8)
+                return lector_error(l, "bloque de registros truncado");
+            l->quedan = leer32(cab);
+            l->n = leer32(cab + 4);
+            l->pos = 0;
+            if (l->n > TRAZA_BLOQUE || fread(l->bloque, 1, l->n, l->f) != l->n)
+                return lector_error(l, "bloque de registros truncado");
+            return LEIDO_REGISTRO;
+        }
+
+        if (tipo == 'C') {
+            uint8_t cab[TRAZA_TAM_CLAVE - 1];
+            if (fread(cab, 1, sizeof(cab), l->f) != sizeof(cab))
+                return lector_error(l, "clave truncada");
+            e->instrucciones = leer64(cab);
+            e->PC = leer32(cab + 8);
+            e->SP = leer16(cab + 12);
+            e->A = cab[14];
+            e->Z = cab[15];
+            e->tam = leer32(cab + 16);
+            e->paginas = leer32(cab + 20);
+            memcpy(e->irq, cab + 24, INTERRUPCIONES_TAM_ESTADO);
+            e->halted = 0;
+            if (e->tam < MEM_SIZE || e->tam > MEM_MAX)
+                return lector_error(l, "clave con un tamaño de memoria inválido");
+            l->pc_predicho = e->PC;
+            l->a = e->A;
+            l->z = e->Z;
+            l->sp = e->SP;
+            l->dir_ant = 0;
+            return LEIDO_CLAVE;
+        }
+
+        if (tipo == 'F') {
+            uint8_t cab[TRAZA_TAM_FIN - 1];
+            if (fread(cab, 1, sizeof(cab), l->f) != sizeof(cab))
+                return lector_error(l, "bloque final truncado");
+            e->instrucciones = leer64(cab);
+            e->PC = leer32(cab + 8);
+            e->SP = leer16(cab + 12);
+            e->A = cab[14];
+            e->Z = cab[15];
+            e->halted = cab[16];
+            memcpy(e->irq, cab + 17, INTERRUPCIONES_TAM_ESTADO);
+            return LEIDO_FIN;
+        }
+
+        return lector_error(l, "bloque desconocido");
+    }
+}
+
+static int saltar_memoria(Lector *l, const EstadoTraza *e) {
+    long n = MEM_SIZE + (long)e->paginas * (4 + MEM_PAGINA);
+    return fseek(l->f, n, SEEK_CUR);
+}
+
+static int cargar_memoria(Lector *l, const EstadoTraza *e, Memoria *mem) {
+    if (memoria_init_tam(mem, e->tam) < 0 || fread(mem->data, 1, MEM_SIZE, l->f) != MEM_SIZE)
+        return -1;
+    for (uint32_t k = 0; k < e->paginas; ++k) {
+        uint8_t num[4], datos[MEM_PAGINA];
+        if (fread(num, 1, 4, l->f) != 4 || fread(datos, 1, MEM_PAGINA, l->f) != MEM_PAGINA)
+            return -1;
+        uint32_t pag = leer32(num);
+        if (pag == 0 || memoria_copiar(mem, pag << MEM_PAGINA_BITS, datos, MEM_PAGINA) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int leer_varint(Lector *l, uint32_t *v) {
+    *v = 0;
+    for (int s = 0; s < 35; s += 7) {
+        if (l->pos >= l->n)
+            return -1;
+        uint8_t b = l->bloque[l->pos++];
+        *v |= (uint32_t)(b & 0x7F) << s;
+        if (!(b & 0x80))
+            return 0;
+    }
+    return -1;
+}
+
+static int leer_byte(Lector *l, uint8_t *v) {
+    if (l->pos >= l->n)
+        return -1;
+    *v = l->bloque[l->pos++];
+    return 0;
+}
+
+/* Decodifica el siguiente registro del bloque en curso (inversa de codificar) */
+static int decodificar(Lector *l, RegistroTraza *r) {
+    uint8_t b, v;
+    uint32_t x;
+    if (leer_byte(l, &b) < 0 || leer_byte(l, &r->opcode) < 0)
+        return -1;
+    int n_op = bytes_operando(r->opcode);
+    r->operando = 0;
+    for (int i = 0; i < n_op; ++i) {
+        if (leer_byte(l, &v) < 0)
+            return -1;
+        r->operando |= (uint16_t)(v << (8 * i));
+    }
+
+    uint32_t pc = l->pc_predicho;
+    if (b & TRAZA_F_PC) {
+        if (leer_varint(l, &x) < 0) return -1;
+        pc += (uint32_t)dezigzag(x);
+    }
+    r->pc = (uint16_t)pc;
+    if ((b & TRAZA_F_A) && leer_byte(l, &l->a) < 0)
+        return -1;
+    if (b & TRAZA_F_SP) {
+        if (leer_varint(l, &x) < 0) return -1;
+        l->sp = (uint16_t)(l->sp + dezigzag(x));
+    }
+    r->a = l->a;
+    r->sp = l->sp;
+    r->z = l->z = (b & TRAZA_F_Z) != 0;
+
+    r->n_escr = (b & TRAZA_F_ESCR) >> 3;
+    if (r->n_escr > 2)
+        return -1;
+    for (int i = 0; i < r->n_escr; ++i) {
+        if (i == 0 && (b & TRAZA_F_DIR_OP)) {
+            r->dir[0] = r->operando;
+        } else {
+            if (leer_varint(l, &x) < 0) return -1;
+            r->dir[i] = (uint16_t)(l->dir_ant + dezigzag(x));
+        }
+        l->dir_ant = r->dir[i];
+        if (i == 0 && (b & TRAZA_F_VAL_A))
+            r->val[0] = r->a;
+        else if (leer_byte(l, &r->val[i]) < 0)
+            return -1;
+    }
+
+    l->pc_predicho = pc + 1 + (uint32_t)n_op;
+    l->quedan--;
+    return 0;
+}
+
+/*
+ * Siguiente elemento de la traza: un registro (en 'r'), una clave (cuya
+ * memoria se salta) o el final (en 'e').
+ */
+static int siguiente(Lector *l, RegistroTraza *r, EstadoTraza *e) {
+    while (l->quedan == 0) {
+        int tipo = leer_bloque(l, e);
+        if (tipo == LEIDO_CLAVE) {
+            if (saltar_memoria(l, e) != 0)
+                return lector_error(l, "clave truncada");
+            return LEIDO_CLAVE;
+        }
+        if (tipo != LEIDO_REGISTRO)
+            return tipo;
+    }
+    if (decodificar(l, r) < 0)
+        return lector_error(l, "registro corrupto");
+    return LEIDO_REGISTRO;
+}
+
+/*
+ * Recorre los bloques sin decodificarlos: posición de la última clave con
+ * a lo sumo 'n' instrucciones y, si lo hay, el estado final.
+ */
+static int buscar_clave(Lector *l, unsigned long n, long *pos_clave, EstadoTraza *fin, int *hay_fin) {
+    EstadoTraza e;
+    *pos_clave = -1;
+    *hay_fin = 0;
+    for (;;) {
+        long pos = ftell(l->f);
+        int tipo = leer_bloque(l, &e);
+        if (tipo == LEIDO_EOF)
+            return 0;
+        if (tipo == LEIDO_ERROR)
+            return -1;
+        if (tipo == LEIDO_CLAVE) {
+            if (e.instrucciones <= n)
+                *pos_clave = pos;
+            if (saltar_memoria(l, &e) != 0)
+                return -1;
+        } else if (tipo == LEIDO_FIN) {
+            *fin = e;
+            *hay_fin = 1;
+        }
+        l->quedan = 0;
+    }
+}
+
+/* Se coloca en la clave anterior a 'n' y carga su estado en cpu/mem */
+static int ir_a_clave(Lector *l, unsigned long *n, CPU *cpu, Memoria *mem, EstadoTraza *fin, int *hay_fin) {
+    long pos;
+    if (buscar_clave(l, *n, &pos, fin, hay_fin) < 0)
+        return -1;
+    if (*n == ~0UL) {
+        if (!*hay_fin) {
+            lector_error(l, "traza sin bloque final (¿se cortó la grabación?); indica --en");
+            return -1;
+        }
+        *n = fin->instrucciones;
+        if (buscar_clave(l, *n, &pos, fin, hay_fin) < 0)
+            return -1;
+    }
+    if (*hay_fin && *n > fin->instrucciones) {
+        fprintf(stderr, "[ERROR] La traza sólo tiene %lu instrucciones\n",
+                (unsigned long)fin->instrucciones);
+        return -1;
+    }
+    if (pos < 0) {
+        lector_error(l, "no hay ninguna clave anterior a esa instrucción");
+        return -1;
+    }
+
+    EstadoTraza e;
+    if (fseek(l->f, pos, SEEK_SET) != 0 || leer_bloque(l, &e) != LEIDO_CLAVE ||
+        cargar_memoria(l, &e, mem) < 0) {
+        lector_error(l, "clave ilegible");
+        return -1;
+    }
+    l->quedan = 0;
+    cpu_init(cpu, mem);
+    cpu->PC = e.PC;
+    cpu->SP = e.SP;
+    cpu->A = e.A;
+    cpu->Z = e.Z;
+    cpu->met.instrucciones = e.instrucciones;
+    interrupciones_cargar(&cpu->irq, e.irq);
+    return 0;
+}
+
+/*
+ * Lo que hace el registro 'r' (ya contado en met.instrucciones) en el
+ * controlador de interrupciones, como en cpu.c, y los vencimientos hasta
+ * esa instrucción. Las entradas a la rutina de atención no hacen falta:
+ * cada una deja una clave, así que quedan antes de la clave de partida.
+ */
+static void aplicar_interrupciones(CPU *cpu, const RegistroTraza *r) {
+    Interrupciones *irq = &cpu->irq;
+    switch (r->opcode) {
+        case 15:                                    // EI
+        case 17: case 17 | OP_ANCHO:                // RETI
+            irq->habilitadas = 1;
+            break;
+        case 16:                                    // DI
+            irq->habilitadas = 0;
+            break;
+        case 18: case 18 | OP_ANCHO:                // TIMER
+            if ((uint32_t)r->operando + 1 < cpu->mem->tam) {
+                uint16_t periodo = memoria_leer(cpu->mem, r->operando);
+                periodo |= (uint16_t)(memoria_leer(cpu->mem, r->operando + 1u) << 8);
+                interrupciones_temporizador(irq, cpu->met.instrucciones, periodo);
+            }
+            break;
+        case 19: case 19 | OP_ANCHO:                // VECTOR
+            if (r->operando < cpu->mem->tam) {
+                irq->vector = r->operando;
+                irq->marco_ancho = (r->opcode & OP_ANCHO) != 0;
+            }
+            break;
+    }
+    interrupciones_vencer(irq, cpu->met.instrucciones);
+}
+
+int traza_reconstruir(const char *path, unsigned long n, CPU *cpu, Memoria *mem) {
+    Lector l;
+    if (lector_abrir(&l, path) < 0)
+        return -1;
+    memoria_init(mem);
+
+    EstadoTraza fin, e;
+    int hay_fin, ret = -1;
+    if (ir_a_clave(&l, &n, cpu, mem, &fin, &hay_fin) < 0)
+        goto salir;
+
+    /* Se aplican registros hasta llegar a n; el PC lo da el siguiente */
+    while (cpu->met.instrucciones < n) {
+        RegistroTraza r;
+        int tipo = siguiente(&l, &r, &e);
+        if (tipo == LEIDO_REGISTRO) {
+            for (int i = 0; i < r.n_escr; ++i)
+                memoria_escribir(mem, r.dir[i], r.val[i]);
+            cpu->A = r.a;
+            cpu->SP = r.sp;
+            cpu->Z = r.z;
+            cpu->PC = l.pc_predicho;
+            cpu->met.instrucciones++;
+            aplicar_interrupciones(cpu, &r);
+        } else if (tipo == LEIDO_CLAVE || tipo == LEIDO_FIN) {
+            if (e.instrucciones != cpu->met.instrucciones) {
+                lector_error(&l, "la traza no es continua");
+                goto salir;
+            }
+        } else {
+            if (tipo == LEIDO_EOF)
+                lector_error(&l, "la traza termina antes de esa instrucción");
+            goto salir;
+        }
+    }
+
+    /* El PC tras la instrucción n es el de la siguiente, o el del final */
+    for (;;) {
+        RegistroTraza r;
+        int tipo = siguiente(&l, &r, &e);
+        if (tipo == LEIDO_REGISTRO) {
+            cpu->PC = r.pc;
+            break;
+        }
+        if (tipo == LEIDO_FIN) {
+            cpu->PC = e.PC;
+            cpu->halted = e.halted;
+            interrupciones_cargar(&cpu->irq, e.irq);
+            break;
+        }
+        if (tipo == LEIDO_CLAVE) {
+            cpu->PC = e.PC;
+            break;
+        }
+        if (tipo == LEIDO_EOF)
+            break;      // traza cortada: queda el PC predicho
+        goto salir;
+    }
+    ret = 0;
+
+salir:
+    lector_cerrar(&l);
+    if (ret < 0)
+        memoria_liberar(mem);
+    return ret;
+}
+
+int traza_listar(const char *path, unsigned long desde, unsigned long hasta, FILE *f) {
+    Lector l;
+    if (lector_abrir(&l, path) < 0)
+        return -1;
+
+    CPU cpu;
+    Memoria mem;
+    memoria_init(&mem);
+    EstadoTraza fin, e;
+    int hay_fin, ret = -1;
+    unsigned long n = desde ? desde - 1 : 0;
+    if (ir_a_clave(&l, &n, &cpu, &mem, &fin, &hay_fin) < 0)
+        goto salir;
+
+    fprintf(f, "%10s %6s  %-8s %6s  %4s %6s %2s  escrituras\n",
+            "instr", "PC", "opcode", "oper", "A", "SP", "Z");
+    unsigned long k = cpu.met.instrucciones;
+    while (k < hasta) {
+        RegistroTraza r;
+        int tipo = siguiente(&l, &r, &e);
+        if (tipo == LEIDO_CLAVE)
+            continue;
+        if (tipo != LEIDO_REGISTRO) {
+            ret = tipo == LEIDO_ERROR ? -1 : 0;
+            goto salir;
+        }
+        if (++k < desde)
+            continue;
+        fprintf(f, "%10lu %6u  %-8s ", k, r.pc, cpu_opcode_nombre(r.opcode));
+        if (bytes_operando(r.opcode))
+            fprintf(f, "%6u", r.operando);
+        else
+            fprintf(f, "%6s", "");
+        fprintf(f, "  %4u %6u %2u ", r.a, r.sp, r.z);
+        for (int i = 0; i < r.n_escr; ++i)
+            fprintf(f, " MEM[%u]=%u", r.dir[i], r.val[i]);
+        fputc('\n', f);
+    }
+    ret = 0;
+
+salir:
+    memoria_liberar(&mem);
+    lector_cerrar(&l);
+    return ret;
+}
@@ -0,0 +1,204 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "cpu.h"
+
+/*
+ * Grabación de trazas completas de ejecución y reconstrucción posterior.
+ *
+ * Con cpu->traza != NULL, cpu_ejecutar usa una instancia del núcleo switch
+ * que deja un registro por instrucción (PC, opcode, operando, A/SP/Z
+ * después de ejecutarla y hasta dos escrituras en memoria) en un anillo
+ * de un productor y un consumidor, sin locks. Un hilo escritor vacía el
+ * anillo, codifica cada registro como diferencia respecto al anterior y
+ * lo vuelca al archivo por bloques; la CPU sólo copia unos bytes por
+ * instrucción y espera únicamente si el anillo se llena. El mutex y las
+ * condiciones sirven sólo para dormir y despertar a uno u otro lado en
+ * esos casos, nunca en el camino de cada instrucción.
+ *
+ * Cada 'intervalo' instrucciones se emite una clave: registros y memoria
+ * completos (la memoria se clona con copy-on-write, así que la CPU no
+ * copia nada salvo la página 0). Para reconstruir el estado tras la
+ * instrucción N basta con cargar la última clave anterior a N y aplicar
+ * los registros que la siguen.
+ *
+ * Formato del archivo (.trz), little endian:
+ *   cabecera   "VNTR", u16 versión, u16 0, u32 intervalo de claves
+ *   'C'        clave: u64 instrucciones, u32 PC, u16 SP, u8 A, u8 Z,
+ *              u32 tamaño de memoria, u32 páginas, estado de las
+ *              interrupciones (interrupciones_guardar), página 0 y por
+ *              página u32 número + 256 bytes (como en las instantáneas)
+ *   'R'        u32 registros, u32 bytes y los registros codificados
+ *   'F'        fin: u64 instrucciones, u32 PC, u16 SP, u8 A, u8 Z, u8 halted
+ *              y el estado de las interrupciones
+ *
+ * Registro codificado: un byte de banderas (TRAZA_F_*), el opcode, sus
+ * bytes de operando y sólo lo que no se puede predecir: el PC si no es el
+ * siguiente a la instrucción anterior, A y SP si cambiaron, y cada
+ * escritura como diferencia con la anterior (o nada si es el operando) y
+ * su valor (o nada si es A). Un bucle típico ocupa 3-4 bytes por instrucción.
+ *
+ * El controlador de interrupciones se reconstruye igual: el de la clave y
+ * después, registro a registro, lo que hacen EI, DI, RETI, TIMER y VECTOR
+ * y los vencimientos del temporizador. Cada entrada a la rutina de
+ * atención deja una clave (ver entrar_interrupcion en cpu.c). La versión 1
+ * no guardaba el controlador y ya no se lee.
+ */
+
+#define TRAZA_MAGIA          "VNTR"
+#define TRAZA_VERSION        2
+#define TRAZA_INTERVALO      65536      // instrucciones entre claves por defecto
+#define TRAZA_ANILLO         (1u << 13) // registros en el anillo (potencia de dos)
+#define TRAZA_PUBLICAR       256        // registros que se publican de una vez
+
+/* Banderas del registro codificado */
+#define TRAZA_F_PC      0x01    // sigue el PC (zigzag respecto al predicho)
+#define TRAZA_F_A       0x02    // sigue A
+#define TRAZA_F_SP      0x04    // sigue SP (zigzag respecto al anterior)
+#define TRAZA_F_ESCR    0x18    // número de escrituras (0..2) << 3
+#define TRAZA_F_VAL_A   0x20    // la primera escritura vale A
+#define TRAZA_F_DIR_OP  0x40    // la primera escritura es en la dirección del operando
+#define TRAZA_F_Z       0x80    // Z tras la instrucción
+
+#define TRAZA_ES_CLAVE  0xFF    // n_escr de un registro que lleva una clave
+
+/* Estado completo en un punto de la traza */
+typedef struct ClaveTraza {
+    uint64_t instrucciones;
+    uint32_t PC;
+    uint16_t SP;
+    uint8_t A, Z;
+    Interrupciones irq;
+    Memoria mem;                // clon de la memoria del invitado
+} ClaveTraza;
+
+/*
+ * Una instrucción tal como la deja la CPU en el anillo: 16 bytes, para que
+ * el anillo quepa en L2. Los ganchos escriben directamente en la ranura
+ * (armarlo aparte y copiarlo entero cuesta un fallo de store forwarding
+ * por instrucción). Un registro
+ * con n_escr == TRAZA_ES_CLAVE sólo lleva el puntero a la clave.
+ */
+typedef struct {
+    union {
+        struct {
+            uint16_t pc;        // < 64K: sólo se graban instrucciones en memoria
+            uint16_t operando;
+            uint16_t sp;        // registros tras la instrucción
+            uint8_t opcode;
+            uint8_t a;
+        };
+        ClaveTraza *clave;
+    };
+    uint16_t dir[2];            // escrituras en memoria
+    uint8_t val[2];
+    uint8_t z;
+    uint8_t n_escr;             // 0..2, o TRAZA_ES_CLAVE
+} RegistroTraza;
+
+typedef struct Traza {
+    /* Lado de la CPU */
+    RegistroTraza *anillo;
+    uint64_t cabeza;            // siguiente registro a llenar
+    uint64_t cola_vista;        // última cola leída (para no leerla siempre)
+    RegistroTraza *actual;      // ranura de la instrucción en curso
+    unsigned long proxima_clave;
+    unsigned long intervalo;
+
+    /* Compartido: contadores publicados por cada lado */
+    _Alignas(64) uint64_t publicada;    // registros listos (escribe la CPU)
+    _Alignas(64) uint64_t cola;         // registros consumidos (escribe el escritor)
+    _Alignas(64) int cerrando;
+    int escritor_dormido;               // el escritor espera en 'hay_datos'
+    int cpu_esperando;                  // la CPU espera en 'hay_sitio'
+    pthread_mutex_t lock;
+    pthread_cond_t hay_datos, hay_sitio;
+
+    /* Lado del escritor */
+    FILE *f;
+    pthread_t hilo;
+    uint8_t *bloque;
+    size_t bloque_bytes;
+    uint32_t bloque_registros;
+    uint32_t pc_predicho;       // estado del codificador
+    uint8_t a_ant;
+    uint16_t sp_ant;
+    uint16_t dir_ant;
+    int error;
+    uint64_t bytes;             // escritos en el archivo
+    uint64_t registros;
+    unsigned long claves;
+} Traza;
+
+/*
+ * Abre 'path' y arranca el hilo escritor. intervalo = 0 usa TRAZA_INTERVALO.
+ * NULL si no se pudo.
+ */
+Traza *traza_abrir(const char *path, unsigned long intervalo);
+
+/*
+ * Vacía el anillo, escribe el estado final de 'cpu', espera al escritor y
+ * cierra el archivo. 0 si todo se escribió bien. Libera 't'.
+ */
+int traza_cerrar(Traza *t, const CPU *cpu, uint64_t *bytes, uint64_t *registros);
+
+/*
+ * Estado tras 'n' instrucciones (contadas como met.instrucciones; ~0UL =
+ * hasta el final de la traza). Deja 'cpu' listo sobre 'mem', que hay que
+ * liberar después. 0 si todo bien.
+ */
+int traza_reconstruir(const char *path, unsigned long n, CPU *cpu, Memoria *mem);
+
+/* Registros de las instrucciones desde..hasta (inclusive) en texto */
+int traza_listar(const char *path, unsigned long desde, unsigned long hasta, FILE *f);
+
+/* --- Ganchos del núcleo (en línea salvo los caminos raros) --- */
+void traza_clave(Traza *t, CPU *cpu);
+void traza_esperar(Traza *t);
+void traza_despertar(Traza *t);
+
+/* Publica lo grabado; si el escritor duerme, lo despierta cada medio anillo */
+static inline void traza_publicar(Traza *t) {
+    __atomic_store_n(&t->publicada, t->cabeza, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&t->escritor_dormido, __ATOMIC_RELAXED) &&
+        (t->cabeza & (TRAZA_ANILLO / 2 - 1)) == 0)
+        traza_despertar(t);
+}
+
+static inline void traza_instruccion(Traza *t, uint32_t pc, uint8_t op) {
+    if (t->cabeza - t->cola_vista >= TRAZA_ANILLO)
+        traza_esperar(t);
+    RegistroTraza *r = &t->anillo[t->cabeza & (TRAZA_ANILLO - 1)];
+    r->pc = (uint16_t)pc;
+    r->opcode = op;
+    r->operando = 0;
+    r->n_escr = 0;
+    t->actual = r;
+}
+
+static inline void traza_operando(Traza *t, uint32_t v) {
+    t->actual->operando = (uint16_t)v;
+}
+
+static inline void traza_escritura(Traza *t, uint32_t dir, uint8_t v) {
+    RegistroTraza *r = t->actual;
+    if (r->n_escr < 2) {
+        r->dir[r->n_escr] = (uint16_t)dir;
+        r->val[r->n_escr] = v;
+        r->n_escr++;
+    }
+}
+
+static inline void traza_fin(Traza *t, uint8_t a, uint16_t sp, uint8_t z) {
+    RegistroTraza *r = t->actual;
+    r->a = a;
+    r->sp = sp;
+    r->z = z;
+    if ((++t->cabeza & (TRAZA_PUBLICAR - 1)) == 0)
+        traza_publicar(t);
+}
+
+#endif
@@ -0,0 +1,414 @@
+/*
+ * Archivo: tuberia.c
+ * Pipeline traducir -> ensamblar -> simular sobre muchos programas (ver
+ * tuberia.h).
+ *
+ * Cada etapa tiene sus hilos. La primera reparte las fuentes con un índice
+ * atómico; las demás sacan de la cola de la etapa anterior. Un programa que
+ * falla sigue por la tubería marcado con el error (las etapas siguientes lo
+ * dejan pasar sin tocarlo) para que todos lleguen al final y el CSV salga
+ * completo y en orden.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "tuberia.h"
+#include "computadora.h"
+#include "jit.h"
+
+static const char *nombres_etapa[TUBERIA_ETAPAS] = { "traducir", "ensamblar", "simular" };
+
+/* Un programa en su paso por la tubería */
+typedef struct {
+    const char *path;
+    int error;                  // 0, o etapa que falló + 1
+    char *texto;                // ASM (etapa 0 -> 1)
+    size_t len;
+    Programa prog;              // código (etapa 1 -> 2)
+    uint32_t bytes;
+
+    /* Resultado de la simulación */
+    uint8_t A, Z;
+    uint32_t PC;
+    int halted;
+    unsigned long instrucciones;
+    uint8_t celdas[TUBERIA_MAX_CELDAS];
+} Trabajo;
+
+/* ---------------------------- Cola acotada ----------------------------------- */
+typedef struct {
+    Trabajo **anillo;
+    int cap, ini, n;
+    int productores;            // hilos que todavía pueden meter
+    pthread_mutex_t lock;
+    pthread_cond_t no_vacia, no_llena;
+} Cola;
+
+typedef struct {
+    double ocupado;             // segundos procesando (suma de los hilos)
+    double espera_entrada;      // esperando a la cola de entrada vacía
+    double espera_salida;       // esperando a la cola de salida llena
+    unsigned long programas;
+} EstadisticaEtapa;
+
+typedef struct {
+    const TuberiaConfig *cfg;
+    Trabajo *trabajos;
+    int n;
+    int siguiente;              // próxima fuente para la etapa 0 (atómico)
+    Cola colas[TUBERIA_ETAPAS - 1];
+    EstadisticaEtapa est[TUBERIA_ETAPAS];
+    pthread_mutex_t lock_est;
+} Tuberia;
+
+typedef struct {
+    Tuberia *t;
+    int etapa;
+    int hasta;                  // corre las etapas etapa..hasta-1 seguidas
+} Hilo;
+
+static double segundos_reloj(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cola_init(Cola *c, int cap, int productores) {
+    c->anillo = calloc((size_t)cap, sizeof(Trabajo *));
+    if (!c->anillo)
+        return -1;
+    c->cap = cap;
+    c->ini = c->n = 0;
+    c->productores = productores;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->no_vacia, NULL);
+    pthread_cond_init(&c->no_llena, NULL);
+    return 0;
+}
+
+static void cola_destruir(Cola *c) {
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->no_vacia);
+    pthread_cond_destroy(&c->no_llena);
+    free(c->anillo);
+}
+
+/* Mete 't' esperando si la cola está llena; devuelve los segundos de espera */
+static double cola_meter(Cola *c, Trabajo *t) {
+    double espera = 0;
+    pthread_mutex_lock(&c->lock);
+    if (c->n == c->cap) {
+        double t0 = segundos_reloj();
+        while (c->n == c->cap)
+            pthread_cond_wait(&c->no_llena, &c->lock);
+        espera = segundos_reloj() - t0;
+    }
+    c->anillo[(c->ini + c->n) % c->cap] = t;
+    c->n++;
+    pthread_cond_signal(&c->no_vacia);
+    pthread_mutex_unlock(&c->lock);
+    return espera;
+}
+
+/* Saca el siguiente programa; NULL cuando ya no quedan productores ni programas */
+static Trabajo *cola_sacar(Cola *c, double *espera) {
+    Trabajo *t = NULL;
+    *espera = 0;
+    pthread_mutex_lock(&c->lock);
+    if (c->n == 0 && c->productores > 0) {
+        double t0 = segundos_reloj();
+        while (c->n == 0 && c->productores > 0)
+            pthread_cond_wait(&c->no_vacia, &c->lock);
+        *espera = segundos_reloj() - t0;
+    }
+    if (c->n > 0) {
+        t = c->anillo[c->ini];
+        c->ini = (c->ini + 1) % c->cap;
+        c->n--;
+        pthread_cond_signal(&c->no_llena);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return t;
+}
+
+/* Terminaron 'k' productores; con el último se despierta a todos los consumidores */
+static void cola_quitar_productores(Cola *c, int k) {
+    if (k <= 0)
+        return;
+    pthread_mutex_lock(&c->lock);
+    c->productores -= k;
+    if (c->productores == 0)
+        pthread_cond_broadcast(&c->no_vacia);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* ------------------------------ Etapas --------------------------------------- */
+static int es_fuente_c(const char *path) {
+    const char *ext = strrchr(path, '.');
+    return ext && strcmp(ext, ".c") == 0;
+}
+
+static int traducir(Tuberia *tb, Trabajo *t) {
+    char *fuente;
+    size_t len;
+    if (computadora_leer_archivo(t->path, &fuente, &len) < 0)
+        return -1;
+    if (!es_fuente_c(t->path)) {
+        t->texto = fuente;          // ya es ASM
+        t->len = len;
+        return 0;
+    }
+    int r = compilador_traducir(fuente, len, tb->cfg->nivel, tb->cfg->ancho, tb->cfg->mem_tam,
+                                &t->texto, &t->len, NULL);
+    free(fuente);
+    if (r < 0)
+        fprintf(stderr, "[ERROR] %s: no se pudo traducir\n", t->path);
+    return r;
+}
+
+static int ensamblar(Tuberia *tb, Trabajo *t) {
+    int r = ensamblador_buffer(t->texto, t->len,
+                               tb->cfg->ancho | (tb->cfg->mirilla ? ENSAMBLADOR_MIRILLA : 0),
+                               &t->prog, NULL);
+    free(t->texto);
+    t->texto = NULL;
+    if (r < 0)
+        fprintf(stderr, "[ERROR] %s: no se pudo ensamblar\n", t->path);
+    t->bytes = t->prog.tam;
+    return r;
+}
+
+static int simular(Tuberia *tb, Trabajo *t) {
+    const TuberiaConfig *cfg = tb->cfg;
+    Memoria mem;
+    CPU cpu;
+
+    if (memoria_init_tam(&mem, cfg->mem_tam) < 0) {
+        fprintf(stderr, "[ERROR] %s: no se pudo crear la memoria\n", t->path);
+        programa_liberar(&t->prog);
+        return -1;
+    }
+    int r = computadora_cargar(&mem, &t->prog);
+    programa_liberar(&t->prog);
+    if (r < 0) {
+        memoria_liberar(&mem);
+        return -1;
+    }
+
+    cpu_init(&cpu, &mem);
+    cpu.motor = cfg->motor;
+    cpu.PC = t->prog.entrada;
+    cpu.silencioso = 1;
+    cpu.limite = cfg->limite;
+    cpu_ejecutar(&cpu);
+
+    t->A = cpu.A;
+    t->Z = cpu.Z;
+    t->PC = cpu.PC;
+    t->halted = cpu.halted;
+    t->instrucciones = cpu.met.instrucciones;
+    for (int c = 0; c < cfg->n_celdas; ++c)
+        t->celdas[c] = memoria_leer(&mem, cfg->celdas[c]);
+    memoria_liberar(&mem);
+    return 0;
+}
+
+static int (*const etapas[TUBERIA_ETAPAS])(Tuberia *, Trabajo *) = {
+    traducir, ensamblar, simular
+};
+
+static void *hilo_etapa(void *arg) {
+    Hilo *h = arg;
+    Tuberia *tb = h->t;
+    Cola *entrada = h->etapa > 0 ? &tb->colas[h->etapa - 1] : NULL;
+    Cola *salida = h->hasta < TUBERIA_ETAPAS ? &tb->colas[h->hasta - 1] : NULL;
+    EstadisticaEtapa est[TUBERIA_ETAPAS];
+    memset(est, 0, sizeof(est));
+
+    for (;;) {
+        Trabajo *t;
+        if (entrada) {
+            double espera;
+            t = cola_sacar(entrada, &espera);
+            est[h->etapa].espera_entrada += espera;
+            if (!t)
+                break;
+        } else {
+            int i = __atomic_fetch_add(&tb->siguiente, 1, __ATOMIC_RELAXED);
+            if (i >= tb->n)
+                break;
+            t = &tb->trabajos[i];
+        }
+
+        for (int e = h->etapa; e < h->hasta; ++e) {
+            if (t->error)
+                break;
+            double t0 = segundos_reloj();
+            if (etapas[e](tb, t) < 0)
+                t->error = e + 1;
+            est[e].ocupado += segundos_reloj() - t0;
+            est[e].programas++;
+        }
+
+        if (salida)
+            est[h->hasta - 1].espera_salida += cola_meter(salida, t);
+    }
+    if (salida)
+        cola_quitar_productores(salida, 1);
+
+    pthread_mutex_lock(&tb->lock_est);
+    for (int e = h->etapa; e < h->hasta; ++e) {
+        tb->est[e].ocupado += est[e].ocupado;
+        tb->est[e].espera_entrada += est[e].espera_entrada;
+        tb->est[e].espera_salida += est[e].espera_salida;
+        tb->est[e].programas += est[e].programas;
+    }
+    pthread_mutex_unlock(&tb->lock_est);
+    return NULL;
+}
+
+/* ------------------------------ Salida --------------------------------------- */
+static void escribir_csv(FILE *f, const TuberiaConfig *cfg, const Trabajo *trabajos, int n) {
+    fprintf(f, "fuente,estado,bytes,instrucciones,A,Z,PC");
+    for (int c = 0; c < cfg->n_celdas; ++c)
+        fprintf(f, ",MEM[%u]", cfg->celdas[c]);
+    fprintf(f, "\n");
+
+    for (int i = 0; i < n; ++i) {
+        const Trabajo *t = &trabajos[i];
+        if (t->error) {
+            fprintf(f, "%s,error:%s\n", t->path, nombres_etapa[t->error - 1]);
+            continue;
+        }
+        fprintf(f, "%s,%s,%u,%lu,%u,%u,%u", t->path, t->halted ? "ok" : "limite",
+                t->bytes, t->instrucciones, t->A, t->Z, t->PC);
+        for (int c = 0; c < cfg->n_celdas; ++c)
+            fprintf(f, ",%u", t->celdas[c]);
+        fprintf(f, "\n");
+    }
+}
+
+/* ------------------------------ API ------------------------------------------ */
+int tuberia_ejecutar(const TuberiaConfig *cfg, const char *const *fuentes, int n, FILE *salida) {
+    if (cfg->n_celdas > TUBERIA_MAX_CELDAS) {
+        fprintf(stderr, "[ERROR] Máximo %d celdas por programa\n", TUBERIA_MAX_CELDAS);
+        return -1;
+    }
+    for (int c = 0; c < cfg->n_celdas; ++c) {
+        if (cfg->celdas[c] >= cfg->mem_tam) {
+            fprintf(stderr, "[ERROR] Celda fuera de memoria: %u\n", cfg->celdas[c]);
+            return -1;
+        }
+    }
+
+    /* Las CPU de la etapa de ejecución son silenciosas: se avisa una vez */
+    if (cfg->motor == MOTOR_JIT && cfg->mem_tam == MEM_SIZE) {
+        Jit *j = jit_crear(NULL, -1);
+        if (!j)
+            fprintf(stderr, "[AVISO] JIT no disponible en esta plataforma; se usa el motor predecode\n");
+        jit_destruir(j);
+    }
+
+    int n_hilos = cfg->hilos;
+    if (n_hilos <= 0) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        n_hilos = nucleos > 0 ? (int)nucleos : 1;
+    }
+    if (n_hilos > n) n_hilos = n ? n : 1;
+    int cap = cfg->cola > 0 ? cfg->cola : 2 * n_hilos;
+
+    Tuberia tb = { .cfg = cfg, .n = n };
+    tb.trabajos = calloc(n ? (size_t)n : 1, sizeof(Trabajo));
+    Hilo *hilos = calloc((size_t)(TUBERIA_ETAPAS * n_hilos), sizeof(Hilo));
+    pthread_t *ids = calloc((size_t)(TUBERIA_ETAPAS * n_hilos), sizeof(pthread_t));
+    int colas = 0;
+    if (tb.trabajos && hilos && ids)
+        while (colas < TUBERIA_ETAPAS - 1 && cola_init(&tb.colas[colas], cap, n_hilos) == 0)
+            colas++;
+    if (colas < TUBERIA_ETAPAS - 1) {
+        fprintf(stderr, "[ERROR] Sin memoria para %d programas\n", n);
+        while (colas > 0)
+            cola_destruir(&tb.colas[--colas]);
+        free(tb.trabajos); free(hilos); free(ids);
+        return -1;
+    }
+    pthread_mutex_init(&tb.lock_est, NULL);
+    for (int i = 0; i < n; ++i)
+        tb.trabajos[i].path = fuentes[i];
+
+    /*
+     * Los hilos se lanzan de la última etapa a la primera. Si pthread_create
+     * falla, las etapas que quedan sin hilos son las primeras: las corre este
+     * hilo, una tras otra, como único productor de la primera cola con
+     * consumidores. Las colas esperan tantos productores como hilos hubo.
+     */
+    double t0 = segundos_reloj();
+    int lanzados[TUBERIA_ETAPAS] = { 0 };
+    int fallo = 0, total = 0;
+    for (int e = TUBERIA_ETAPAS - 1; e >= 0 && !fallo; --e) {
+        for (int i = 0; i < n_hilos; ++i) {
+            Hilo *h = &hilos[e * n_hilos + i];
+            h->t = &tb;
+            h->etapa = e;
+            h->hasta = e + 1;
+            if (pthread_create(&ids[e * n_hilos + i], NULL, hilo_etapa, h) != 0) {
+                fallo = 1;
+                break;
+            }
+            lanzados[e]++;
+            total++;
+        }
+    }
+    int primera = TUBERIA_ETAPAS;           // primera etapa con hilos propios
+    while (primera > 0 && lanzados[primera - 1] > 0)
+        primera--;
+    if (fallo)
+        fprintf(stderr, "[AVISO] Sólo se pudieron crear %d de %d hilos\n",
+                total, TUBERIA_ETAPAS * n_hilos);
+    for (int e = primera; e < TUBERIA_ETAPAS - 1; ++e)
+        cola_quitar_productores(&tb.colas[e], n_hilos - lanzados[e]);
+    if (primera > 0) {
+        if (primera < TUBERIA_ETAPAS)
+            cola_quitar_productores(&tb.colas[primera - 1], n_hilos - 1);
+        Hilo principal = { .t = &tb, .etapa = 0, .hasta = primera };
+        hilo_etapa(&principal);
+    }
+    for (int e = 0; e < TUBERIA_ETAPAS; ++e)
+        for (int i = 0; i < lanzados[e]; ++i)
+            pthread_join(ids[e * n_hilos + i], NULL);
+    double t = segundos_reloj() - t0;
+
+    escribir_csv(salida, cfg, tb.trabajos, n);
+
+    int errores = 0;
+    unsigned long instrucciones = 0;
+    for (int i = 0; i < n; ++i) {
+        errores += tb.trabajos[i].error != 0;
+        instrucciones += tb.trabajos[i].instrucciones;
+    }
+
+    fprintf(stderr, "[TUBERIA] %d programas (%d con error), %d hilos por etapa, colas de %d, %.6f s",
+            n, errores, n_hilos, cap, t);
+    if (t > 0)
+        fprintf(stderr, " (%.1f programas/s, %.2f MIPS)", n / t, instrucciones / t / 1e6);
+    fprintf(stderr, "\n");
+    for (int e = 0; e < TUBERIA_ETAPAS; ++e) {
+        const EstadisticaEtapa *s = &tb.est[e];
+        fprintf(stderr, "[TUBERIA] %-9s %lu programas, ocupada %.6f s", nombres_etapa[e],
+                s->programas, s->ocupado);
+        if (s->ocupado > 0)
+            fprintf(stderr, " (%.1f programas/s por hilo)", s->programas / s->ocupado);
+        fprintf(stderr, ", espera entrada %.6f s, salida %.6f s\n",
+                s->espera_entrada, s->espera_salida);
+    }
+
+    for (int c = 0; c < TUBERIA_ETAPAS - 1; ++c)
+        cola_destruir(&tb.colas[c]);
+    pthread_mutex_destroy(&tb.lock_est);
+    free(tb.trabajos); free(hilos); free(ids);
+    return errores;
+}
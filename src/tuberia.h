@@ -0,0 +1,43 @@
+#ifndef TUBERIA_H
+#define TUBERIA_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "cpu.h"
+
+/*
+ * Pipeline de muchos programas: traducir (C -> ASM, o leer el .asm),
+ * ensamblar y simular, cada etapa con su grupo de hilos y unidas por colas
+ * acotadas. Mientras se simula el archivo k ya se traduce y ensambla el
+ * k+1; si una etapa se atrasa, la cola llena frena a la anterior en vez de
+ * acumular programas en memoria.
+ *
+ * Los tiempos se toman con reloj de pared (CLOCK_MONOTONIC): por etapa, el
+ * tiempo ocupado y el de espera en las colas (entrada vacía o salida llena).
+ */
+
+#define TUBERIA_ETAPAS    3
+#define TUBERIA_MAX_CELDAS 32
+
+typedef struct {
+    int hilos;                  // hilos por etapa (<= 0: uno por núcleo)
+    int cola;                   // programas por cola (<= 0: 2 por hilo)
+    int ancho;                  // operandos de dirección de 8 o 16 bits
+    int nivel;                  // optimización de los .c (ver compilador.h)
+    int mirilla;                // pasar la mirilla del ensamblador (ver ensamblador.h)
+    uint32_t mem_tam;           // espacio de cada simulación
+    MotorCPU motor;
+    unsigned long limite;       // instrucciones como máximo por programa (0 = sin límite)
+    const uint16_t *celdas;     // direcciones a reportar por programa
+    int n_celdas;
+} TuberiaConfig;
+
+/*
+ * Procesa las 'n' fuentes (.c se traduce, el resto se toma como ASM) y
+ * escribe un CSV en 'salida' con una fila por fuente, en el orden dado.
+ * Las estadísticas por etapa van a stderr. Devuelve el número de fuentes
+ * con error (0 si todas bien) o -1 si no se pudo arrancar.
+ */
+int tuberia_ejecutar(const TuberiaConfig *cfg, const char *const *fuentes, int n, FILE *salida);
+
+#endif